@@ -0,0 +1,425 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/AnimationState.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "AnimationBenchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Count heap allocations by replacing the global allocation functions. This is done before including DebugNew.h, as its
+// new operator macro would interfere with the definitions. Only allocations of the main thread are expected while measuring
+static unsigned long long allocationCount = 0;
+
+// Dynamic exception specifications are deprecated in C++11 and invalid in C++17, which compilers may default to
+#if __cplusplus >= 201103L
+void* operator new(std::size_t size)
+#else
+void* operator new(std::size_t size) throw(std::bad_alloc)
+#endif
+{
+    ++allocationCount;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+#if __cplusplus >= 201103L
+void* operator new[](std::size_t size)
+#else
+void* operator new[](std::size_t size) throw(std::bad_alloc)
+#endif
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+    free(ptr);
+}
+
+#include <Urho3D/DebugNew.h>
+
+static const char* stageNames[] =
+{
+    "Keyframe sampling",
+    "Layered blending",
+    "Bone node transforms",
+    "Skin matrices",
+    "Morph application"
+};
+
+static const char* animationNames[] =
+{
+    "Models/Mutant/Mutant_Idle0.ani",
+    "Models/Mutant/Mutant_Walk.ani",
+    "Models/Mutant/Mutant_Run.ani",
+    "Models/Mutant/Mutant_Punch.ani",
+    "Models/Mutant/Mutant_Kick.ani",
+    "Models/Mutant/Mutant_Swipe.ani",
+    "Models/Mutant/Mutant_HipHop1.ani",
+    "Models/Mutant/Mutant_Jump.ani",
+    "Models/Mutant/Mutant_Idle1.ani",
+    "Models/Mutant/Mutant_Death.ani"
+};
+
+static const unsigned NUM_ANIMATIONS = sizeof(animationNames) / sizeof(animationNames[0]);
+static const unsigned NUM_WARMUP_FRAMES = 10;
+static const float TIME_STEP = 1.0f / 60.0f;
+
+/// Format a row of the results table. String::AppendWithFormat does not support field widths, so use sprintf.
+static String FormatRow(const char* name, double msPerFrame, double usPerModel, double allocsPerFrame)
+{
+    char tempBuffer[CONVERSION_BUFFER_LENGTH];
+    sprintf(tempBuffer, "%-24s %12.3f %12.3f %14.1f", name, msPerFrame, usPerModel, allocsPerFrame);
+    return String(tempBuffer);
+}
+
+URHO3D_DEFINE_APPLICATION_MAIN(AnimationBenchmark)
+
+AnimationBenchmark::AnimationBenchmark(Context* context) :
+    Application(context),
+    numModels_(100),
+    numStates_(4),
+    numFrames_(1000),
+    compiled_(false)
+{
+    for (unsigned i = 0; i < MAX_STAGES; ++i)
+    {
+        stageTimes_[i] = 0;
+        stageAllocations_[i] = 0;
+    }
+}
+
+void AnimationBenchmark::Setup()
+{
+    // Run without a window, renderer and sound. Animation is still fully updated, as the vertex buffers are shadowed
+    engineParameters_[EP_LOG_NAME] = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "logs") + GetTypeName() + ".log";
+    engineParameters_[EP_HEADLESS] = true;
+    engineParameters_[EP_SOUND] = false;
+
+    // Use the same resource prefix path search as the other samples
+    if (!engineParameters_.Contains(EP_RESOURCE_PREFIX_PATHS))
+        engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";../share/Resources;../share/Urho3D/Resources";
+}
+
+void AnimationBenchmark::Start()
+{
+    ParseArguments();
+    CreateScene();
+    if (models_.Empty())
+    {
+        ErrorExit("Failed to load the benchmark model");
+        return;
+    }
+
+    // Warm up so that one-time allocations, such as bone bounding box and skin matrix storage, are not measured
+    for (unsigned i = 0; i < NUM_WARMUP_FRAMES; ++i)
+        RunFrame(i, false);
+    for (unsigned i = 0; i < numFrames_; ++i)
+        RunFrame(NUM_WARMUP_FRAMES + i, true);
+
+    PrintResults();
+    engine_->Exit();
+}
+
+void AnimationBenchmark::ParseArguments()
+{
+    const Vector<String>& arguments = GetArguments();
+
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() < 2 || arguments[i][0] != '-')
+            continue;
+
+        String argument = arguments[i].Substring(1).ToLower();
+        unsigned value = i + 1 < arguments.Size() ? ToUInt(arguments[i + 1]) : 0;
+        if (argument == "compiled")
+            compiled_ = true;
+        else if (argument == "models" && value)
+            numModels_ = value;
+        else if (argument == "states" && value)
+            numStates_ = Min((int)value, (int)NUM_ANIMATIONS);
+        else if (argument == "frames" && value)
+            numFrames_ = value;
+    }
+}
+
+SharedPtr<Model> AnimationBenchmark::CreateMorphedModel(Model* source)
+{
+    SharedPtr<Model> model = source->Clone();
+    const Vector<SharedPtr<VertexBuffer> >& buffers = model->GetVertexBuffers();
+    if (buffers.Empty())
+        return model;
+
+    // Morph all vertices of the first vertex buffer: push positions outward along the normal and bend the normals slightly
+    VertexBuffer* buffer = buffers[0];
+    unsigned vertexCount = buffer->GetVertexCount();
+    unsigned vertexSize = buffer->GetVertexSize();
+    unsigned positionOffset = buffer->GetElementOffset(SEM_POSITION);
+    unsigned normalOffset = buffer->GetElementOffset(SEM_NORMAL);
+    bool hasNormals = normalOffset != M_MAX_UNSIGNED;
+    const unsigned char* vertexData = buffer->GetShadowData();
+    if (!vertexData || positionOffset == M_MAX_UNSIGNED)
+        return model;
+
+    VertexBufferMorph bufferMorph;
+    bufferMorph.elementMask_ = hasNormals ? MASK_POSITION | MASK_NORMAL : MASK_POSITION;
+    bufferMorph.vertexCount_ = vertexCount;
+    bufferMorph.dataSize_ = vertexCount * (sizeof(unsigned) + (hasNormals ? 6 : 3) * sizeof(float));
+    bufferMorph.morphData_ = new unsigned char[bufferMorph.dataSize_];
+
+    unsigned char* dest = bufferMorph.morphData_.Get();
+    for (unsigned i = 0; i < vertexCount; ++i)
+    {
+        const unsigned char* vertex = vertexData + i * vertexSize;
+        Vector3 normal = hasNormals ? *reinterpret_cast<const Vector3*>(vertex + normalOffset) : Vector3::UP;
+        Vector3 positionDelta = normal * 0.05f;
+        Vector3 normalDelta = Vector3(0.0f, 0.1f, 0.0f);
+
+        *reinterpret_cast<unsigned*>(dest) = i;
+        dest += sizeof(unsigned);
+        memcpy(dest, positionDelta.Data(), 3 * sizeof(float));
+        dest += 3 * sizeof(float);
+        if (hasNormals)
+        {
+            memcpy(dest, normalDelta.Data(), 3 * sizeof(float));
+            dest += 3 * sizeof(float);
+        }
+    }
+
+    ModelMorph morph;
+    morph.name_ = "Inflate";
+    morph.nameHash_ = morph.name_;
+    morph.weight_ = 0.0f;
+    morph.buffers_[0] = bufferMorph;
+    Vector<ModelMorph> morphs;
+    morphs.Push(morph);
+
+    PODVector<unsigned> morphRangeStarts;
+    PODVector<unsigned> morphRangeCounts;
+    morphRangeStarts.Resize(buffers.Size());
+    morphRangeCounts.Resize(buffers.Size());
+    for (unsigned i = 0; i < buffers.Size(); ++i)
+    {
+        morphRangeStarts[i] = 0;
+        morphRangeCounts[i] = i == 0 ? vertexCount : 0;
+    }
+
+    // Copy the buffer vector, as setting the buffers reassigns the model's own vector
+    Vector<SharedPtr<VertexBuffer> > newBuffers = buffers;
+    model->SetVertexBuffers(newBuffers, morphRangeStarts, morphRangeCounts);
+    model->SetMorphs(morphs);
+    return model;
+}
+
+void AnimationBenchmark::CreateScene()
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    Model* sourceModel = cache->GetResource<Model>("Models/Mutant/Mutant.mdl");
+    if (!sourceModel)
+        return;
+    SharedPtr<Model> model = CreateMorphedModel(sourceModel);
+
+    Vector<Animation*> animations;
+    for (unsigned i = 0; i < numStates_; ++i)
+    {
+        Animation* animation = cache->GetResource<Animation>(animationNames[i]);
+        if (animation)
+        {
+            if (compiled_)
+                animation->Compile();
+            animations.Push(animation);
+        }
+    }
+
+    // The scene has no octree, as nothing is rendered. The models are spread on a grid so that their transforms differ
+    scene_ = new Scene(context_);
+    unsigned gridSize = (unsigned)ceilf(sqrtf((float)numModels_));
+
+    for (unsigned i = 0; i < numModels_; ++i)
+    {
+        Node* modelNode = scene_->CreateChild("Mutant");
+        modelNode->SetPosition(Vector3((float)(i % gridSize) * 2.0f, 0.0f, (float)(i / gridSize) * 2.0f));
+        modelNode->SetRotation(Quaternion(0.0f, Random(360.0f), 0.0f));
+
+        AnimatedModel* modelObject = modelNode->CreateComponent<AnimatedModel>();
+        modelObject->SetModel(model);
+        // Running headless, so morphs must be explicitly enabled to measure them
+        modelObject->SetHeadlessMorphs(true);
+
+        // The first state is the full weight base layer, the rest are blended on top of it with partial weights
+        for (unsigned j = 0; j < animations.Size(); ++j)
+        {
+            AnimationState* state = modelObject->AddAnimationState(animations[j]);
+            state->SetLooped(true);
+            state->SetLayer((unsigned char)j);
+            state->SetWeight(j == 0 ? 1.0f : 0.5f);
+            state->SetTime(Random(animations[j]->GetLength()));
+        }
+
+        models_.Push(modelObject);
+    }
+}
+
+void AnimationBenchmark::RunFrame(unsigned frameNumber, bool measure)
+{
+    HiresTimer timer;
+    unsigned long long allocations;
+    FrameInfo frame;
+    frame.frameNumber_ = frameNumber;
+    frame.timeStep_ = TIME_STEP;
+
+    // Keyframe sampling: advance all states, then apply the base layer only
+    for (unsigned i = 0; i < models_.Size(); ++i)
+    {
+        const Vector<SharedPtr<AnimationState> >& states = models_[i]->GetAnimationStates();
+        for (unsigned j = 1; j < states.Size(); ++j)
+            states[j]->SetWeight(0.0f);
+    }
+    timer.Reset();
+    allocations = allocationCount;
+    for (unsigned i = 0; i < models_.Size(); ++i)
+    {
+        const Vector<SharedPtr<AnimationState> >& states = models_[i]->GetAnimationStates();
+        for (unsigned j = 0; j < states.Size(); ++j)
+            states[j]->AddTime(TIME_STEP);
+        models_[i]->ApplyAnimation();
+    }
+    if (measure)
+    {
+        stageTimes_[STAGE_SAMPLING] += timer.GetUSec(false);
+        stageAllocations_[STAGE_SAMPLING] += allocationCount - allocations;
+    }
+
+    // Layered blending: apply all states. This includes sampling the additional states
+    for (unsigned i = 0; i < models_.Size(); ++i)
+    {
+        const Vector<SharedPtr<AnimationState> >& states = models_[i]->GetAnimationStates();
+        for (unsigned j = 1; j < states.Size(); ++j)
+            states[j]->SetWeight(0.5f);
+    }
+    timer.Reset();
+    allocations = allocationCount;
+    for (unsigned i = 0; i < models_.Size(); ++i)
+        models_[i]->ApplyAnimation();
+    if (measure)
+    {
+        stageTimes_[STAGE_BLENDING] += timer.GetUSec(false);
+        stageAllocations_[STAGE_BLENDING] += allocationCount - allocations;
+    }
+
+    // Bone node transforms: the bone bounding box update in ApplyAnimation() already resolved the world transforms, so dirty
+    // the hierarchies again to measure the dirty propagation and world transform recalculation on their own
+    timer.Reset();
+    allocations = allocationCount;
+    for (unsigned i = 0; i < models_.Size(); ++i)
+    {
+        models_[i]->GetNode()->MarkDirty();
+        const Vector<Bone>& bones = models_[i]->GetSkeleton().GetBones();
+        for (unsigned j = 0; j < bones.Size(); ++j)
+        {
+            if (bones[j].node_)
+                bones[j].node_->GetWorldTransform();
+        }
+    }
+    if (measure)
+    {
+        stageTimes_[STAGE_BONE_TRANSFORMS] += timer.GetUSec(false);
+        stageAllocations_[STAGE_BONE_TRANSFORMS] += allocationCount - allocations;
+    }
+
+    // Skin matrices: the geometry update only has skinning dirty at this point
+    timer.Reset();
+    allocations = allocationCount;
+    for (unsigned i = 0; i < models_.Size(); ++i)
+        models_[i]->UpdateGeometry(frame);
+    if (measure)
+    {
+        stageTimes_[STAGE_SKINNING] += timer.GetUSec(false);
+        stageAllocations_[STAGE_SKINNING] += allocationCount - allocations;
+    }
+
+    // Morph application: change the morph weight, after which the geometry update only has morphs dirty
+    float morphWeight = Sin((float)frameNumber * 10.0f) * 0.5f + 0.5f;
+    for (unsigned i = 0; i < models_.Size(); ++i)
+        models_[i]->SetMorphWeight(0, morphWeight);
+    timer.Reset();
+    allocations = allocationCount;
+    for (unsigned i = 0; i < models_.Size(); ++i)
+        models_[i]->UpdateGeometry(frame);
+    if (measure)
+    {
+        stageTimes_[STAGE_MORPHS] += timer.GetUSec(false);
+        stageAllocations_[STAGE_MORPHS] += allocationCount - allocations;
+    }
+}
+
+void AnimationBenchmark::PrintResults()
+{
+    const Vector<SharedPtr<AnimationState> >& states = models_[0]->GetAnimationStates();
+    unsigned numBones = models_[0]->GetSkeleton().GetNumBones();
+
+    PrintLine(ToString("Animation benchmark: %u models, %u %s animation states, %u bones, %u frames", models_.Size(),
+        states.Size(), compiled_ ? "compiled" : "keyframed", numBones, numFrames_));
+    char tempBuffer[CONVERSION_BUFFER_LENGTH];
+    sprintf(tempBuffer, "%-24s %12s %12s %14s", "Stage", "ms/frame", "us/model", "allocs/frame");
+    PrintLine(String(tempBuffer));
+
+    long long totalTime = 0;
+    unsigned long long totalAllocations = 0;
+    for (unsigned i = 0; i < MAX_STAGES; ++i)
+    {
+        double msPerFrame = (double)stageTimes_[i] / 1000.0 / numFrames_;
+        double usPerModel = (double)stageTimes_[i] / numFrames_ / models_.Size();
+        double allocsPerFrame = (double)stageAllocations_[i] / numFrames_;
+        PrintLine(FormatRow(stageNames[i], msPerFrame, usPerModel, allocsPerFrame));
+        totalTime += stageTimes_[i];
+        totalAllocations += stageAllocations_[i];
+    }
+
+    PrintLine(FormatRow("Total", (double)totalTime / 1000.0 / numFrames_, (double)totalTime / numFrames_ / models_.Size(),
+        (double)totalAllocations / numFrames_));
+}
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+
+namespace Urho3D
+{
+
+class AnimatedModel;
+class Model;
+class Scene;
+
+}
+
+// All Urho3D classes reside in namespace Urho3D
+using namespace Urho3D;
+
+/// Animation benchmark.
+/// This sample demonstrates:
+///     - Running the engine in headless mode without a window or a main loop
+///     - Measuring the per-stage cost of skeletal animation: keyframe sampling, blending, bone node transforms,
+///       skin matrix calculation and vertex morphing
+///     - Counting heap allocations done by each stage
+/// Command line options: -models <count> -states <count> -frames <count> -compiled
+class AnimationBenchmark : public Application
+{
+    URHO3D_OBJECT(AnimationBenchmark, Application);
+
+public:
+    /// Construct.
+    AnimationBenchmark(Context* context);
+
+    /// Setup before engine initialization.
+    virtual void Setup();
+    /// Setup after engine initialization. Runs the benchmark and exits.
+    virtual void Start();
+
+private:
+    /// Benchmark stages.
+    enum Stage
+    {
+        STAGE_SAMPLING = 0,
+        STAGE_BLENDING,
+        STAGE_BONE_TRANSFORMS,
+        STAGE_SKINNING,
+        STAGE_MORPHS,
+        MAX_STAGES
+    };
+
+    /// Parse the benchmark options from the command line.
+    void ParseArguments();
+    /// Create a clone of the model with a synthetic vertex morph, since none of the bundled skinned models have one.
+    SharedPtr<Model> CreateMorphedModel(Model* source);
+    /// Construct the scene content.
+    void CreateScene();
+    /// Run one frame of all stages. Accumulate timings and allocation counts if measuring.
+    void RunFrame(unsigned frameNumber, bool measure);
+    /// Print the results.
+    void PrintResults();
+
+    /// Scene.
+    SharedPtr<Scene> scene_;
+    /// Animated models.
+    PODVector<AnimatedModel*> models_;
+    /// Number of animated models.
+    unsigned numModels_;
+    /// Number of animation states per model.
+    unsigned numStates_;
+    /// Number of measured frames.
+    unsigned numFrames_;
+    /// Compile the animations flag.
+    bool compiled_;
+    /// Accumulated time per stage in microseconds.
+    long long stageTimes_[MAX_STAGES];
+    /// Accumulated allocation count per stage.
+    unsigned long long stageAllocations_[MAX_STAGES];
+};
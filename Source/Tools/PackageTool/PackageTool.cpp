@@ -22,7 +22,10 @@
 
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Container/ArrayPtr.h>
+#include <Urho3D/Container/Sort.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Compression.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/PackageFile.h>
@@ -31,14 +34,15 @@
 #include <windows.h>
 #endif
 
-#include <LZ4/lz4.h>
-#include <LZ4/lz4hc.h>
-
 #include <Urho3D/DebugNew.h>
 
 using namespace Urho3D;
 
 static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+static const unsigned BENCHMARK_DECOMPRESS_ITERATIONS = 5;
+static const unsigned MAX_DICTIONARY_SIZE = 112640;
+static const unsigned DICTIONARY_SAMPLES_RATIO = 100;
+static const char* compressionFormatNames[] = { "LZ4", "Zstandard", 0 };
 
 struct FileEntry
 {
@@ -46,6 +50,8 @@ struct FileEntry
     unsigned offset_;
     unsigned size_;
     unsigned checksum_;
+    unsigned nameHash_;
+    unsigned nameOffset_;
 };
 
 SharedPtr<Context> context_(new Context());
@@ -54,8 +60,12 @@ String basePath_;
 Vector<FileEntry> entries_;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool directory_ = false;
+unsigned namesSize_ = 0;
+CompressionCodec codec_ = COMPRESSION_LZ4HC;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+PODVector<unsigned char> dictionary_;
 
 String ignoreExtensions_[] = {
     ".bak",
@@ -65,9 +75,16 @@ String ignoreExtensions_[] = {
 
 int main(int argc, char** argv);
 void Run(const Vector<String>& arguments);
+void ScanFiles(Vector<String>& fileNames, const String& dirName);
+void Benchmark(const String& dirName);
+unsigned GetDictionarySampleInterval(unsigned dataSize);
+void TrainPackageDictionary(const String& rootDir);
 void ProcessFile(const String& fileName, const String& rootDir);
 void WritePackageFile(const String& fileName, const String& rootDir);
 void WriteHeader(File& dest);
+void WriteEntries(File& dest);
+bool CompareEntries(const FileEntry& lhs, const FileEntry& rhs);
+bool IsSameContent(const FileEntry& entry, const unsigned char* data, unsigned size, const String& rootDir);
 
 int main(int argc, char** argv)
 {
@@ -90,8 +107,12 @@ void Run(const Vector<String>& arguments)
             "Usage: PackageTool <directory to process> <package name> [basepath] [options]\n"
             "\n"
             "Options:\n"
-            "-c      Enable package file LZ4 compression\n"
+            "-c      Enable package file LZ4 compression, using LZ4 high compression\n"
+            "-cf     Enable package file LZ4 compression, using LZ4 fast compression\n"
+            "-cm     Enable package file LZ4 compression, using maximum LZ4 high compression\n"
+            "-cz     Enable package file Zstandard compression, using a dictionary trained on the files (requires -2)\n"
             "-q      Enable quiet mode\n"
+            "-2      Write a version 2 package file, which has a sorted directory for fast opening and stores identical files only once\n"
             "\n"
             "Basepath is an optional prefix that will be added to the file entries.\n\n"
             "Alternative output usage: PackageTool <output option> <package name>\n"
@@ -99,6 +120,9 @@ void Run(const Vector<String>& arguments)
             "-i      Output package file information\n"
             "-l      Output file names (including their paths) contained in the package\n"
             "-L      Similar to -l but also output compression ratio (compressed package file only)\n"
+            "\n"
+            "Benchmark usage: PackageTool -b <directory to process>\n"
+            "Outputs the compression ratio and compression & decompression speed of each compression mode\n"
         );
 
     const String& dirName = arguments[0];
@@ -118,10 +142,30 @@ void Run(const Vector<String>& arguments)
                     {
                     case 'c':
                         compress_ = true;
+                        if (arguments[i].Length() > 2)
+                        {
+                            switch (arguments[i][2])
+                            {
+                            case 'f':
+                                codec_ = COMPRESSION_LZ4;
+                                break;
+                            case 'm':
+                                codec_ = COMPRESSION_LZ4HC_MAX;
+                                break;
+                            case 'z':
+                                codec_ = COMPRESSION_ZSTD;
+                                break;
+                            default:
+                                ErrorExit("Unrecognized compression mode");
+                            }
+                        }
                         break;
                     case 'q':
                         quiet_ = true;
                         break;
+                    case '2':
+                        directory_ = true;
+                        break;
                     default:
                         ErrorExit("Unrecognized option");
                     }
@@ -130,36 +174,22 @@ void Run(const Vector<String>& arguments)
         }
     }
 
+    // The original compressed package format implies LZ4 data, other formats are identified in the version 2 header
+    if (compress_ && !directory_ && GetCompressionFormat(codec_) != COMPRESSION_FORMAT_LZ4)
+        ErrorExit("The compression mode requires a version 2 package file");
+
     if (!isOutputMode)
     {
-        if (!quiet_)
-            PrintLine("Scanning directory " + dirName + " for files");
-
-        // Get the file list recursively
         Vector<String> fileNames;
-        fileSystem_->ScanDir(fileNames, dirName, "*.*", SCAN_FILES, true);
-        if (!fileNames.Size())
-            ErrorExit("No files found");
-
-        // Check for extensions to ignore
-        for (unsigned i = fileNames.Size() - 1; i < fileNames.Size(); --i)
-        {
-            String extension = GetExtension(fileNames[i]);
-            for (unsigned j = 0; j < ignoreExtensions_[j].Length(); ++j)
-            {
-                if (extension == ignoreExtensions_[j])
-                {
-                    fileNames.Erase(fileNames.Begin() + i);
-                    break;
-                }
-            }
-        }
+        ScanFiles(fileNames, dirName);
 
         for (unsigned i = 0; i < fileNames.Size(); ++i)
             ProcessFile(fileNames[i], dirName);
 
         WritePackageFile(packageName, dirName);
     }
+    else if (arguments[0][1] == 'b')
+        Benchmark(packageName);
     else
     {
         SharedPtr<PackageFile> packageFile(new PackageFile(context_, packageName));
@@ -172,6 +202,10 @@ void Run(const Vector<String>& arguments)
             PrintLine("Package size: " + String(packageFile->GetTotalSize()));
             PrintLine("Checksum: " + String(packageFile->GetChecksum()));
             PrintLine("Compressed: " + String(packageFile->IsCompressed() ? "yes" : "no"));
+            if (packageFile->IsCompressed())
+                PrintLine("Compression format: " + String(compressionFormatNames[packageFile->GetCompressionFormat()]));
+            if (packageFile->GetDictionary())
+                PrintLine("Dictionary size: " + String(packageFile->GetDictionary()->GetData().Size()));
             break;
         case 'L':
             if (!packageFile->IsCompressed())
@@ -181,17 +215,37 @@ void Run(const Vector<String>& arguments)
         case 'l':
             {
                 const HashMap<String, PackageEntry>& entries = packageFile->GetEntries();
-                for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End();)
+
+                // The file data ends where the data with the next larger offset starts. The entries are not in offset order,
+                // and in a version 2 package identical files share the same data, so sort the offsets for searching
+                PODVector<unsigned> offsets;
+                if (outputCompressionRatio)
+                {
+                    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+                        offsets.Push(i->second_.offset_);
+                    offsets.Push(packageFile->GetTotalSize() - sizeof(unsigned));
+                    Sort(offsets.Begin(), offsets.End());
+                }
+
+                for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
                 {
-                    HashMap<String, PackageEntry>::ConstIterator current = i++;
-                    String fileEntry(current->first_);
+                    String fileEntry(i->first_);
                     if (outputCompressionRatio)
                     {
-                        unsigned compressedSize =
-                            (i == entries.End() ? packageFile->GetTotalSize() - sizeof(unsigned) : i->second_.offset_) -
-                            current->second_.offset_;
-                        fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", current->second_.size_, compressedSize,
-                            compressedSize ? 1.f * current->second_.size_ / compressedSize : 0.f);
+                        unsigned first = 0;
+                        unsigned last = offsets.Size() - 1;
+                        while (first < last)
+                        {
+                            unsigned middle = (first + last) / 2;
+                            if (offsets[middle] <= i->second_.offset_)
+                                first = middle + 1;
+                            else
+                                last = middle;
+                        }
+
+                        unsigned compressedSize = offsets[first] - i->second_.offset_;
+                        fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", i->second_.size_, compressedSize,
+                            compressedSize ? 1.f * i->second_.size_ / compressedSize : 0.f);
                     }
                     PrintLine(fileEntry);
                 }
@@ -203,6 +257,191 @@ void Run(const Vector<String>& arguments)
     }
 }
 
+void ScanFiles(Vector<String>& fileNames, const String& dirName)
+{
+    if (!quiet_)
+        PrintLine("Scanning directory " + dirName + " for files");
+
+    // Get the file list recursively
+    fileSystem_->ScanDir(fileNames, dirName, "*.*", SCAN_FILES, true);
+    if (!fileNames.Size())
+        ErrorExit("No files found");
+
+    // Check for extensions to ignore
+    for (unsigned i = fileNames.Size() - 1; i < fileNames.Size(); --i)
+    {
+        String extension = GetExtension(fileNames[i]);
+        for (unsigned j = 0; j < ignoreExtensions_[j].Length(); ++j)
+        {
+            if (extension == ignoreExtensions_[j])
+            {
+                fileNames.Erase(fileNames.Begin() + i);
+                break;
+            }
+        }
+    }
+}
+
+void Benchmark(const String& dirName)
+{
+    // Needed for the high-resolution timer
+    SharedPtr<Time> time(new Time(context_));
+
+    Vector<String> fileNames;
+    ScanFiles(fileNames, dirName);
+
+    // Read all files to memory first, and split them to blocks the same way as when writing a compressed package
+    PODVector<unsigned char> data;
+    PODVector<unsigned> blockOffsets;
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        String fileFullPath = dirName + "/" + fileNames[i];
+        File srcFile(context_, fileFullPath);
+        if (!srcFile.IsOpen())
+            ErrorExit("Could not open file " + fileFullPath);
+
+        unsigned offset = data.Size();
+        unsigned dataSize = srcFile.GetSize();
+        if (!dataSize)
+            continue;
+
+        data.Resize(offset + dataSize);
+        if (srcFile.Read(&data[offset], dataSize) != dataSize)
+            ErrorExit("Could not read file " + fileFullPath);
+
+        for (unsigned pos = 0; pos < dataSize; pos += blockSize_)
+            blockOffsets.Push(offset + pos);
+    }
+    blockOffsets.Push(data.Size());
+
+    unsigned numBlocks = blockOffsets.Size() - 1;
+    float dataMB = data.Size() / 1048576.0f;
+    PrintLine("Files: " + String(fileNames.Size()) + " Blocks: " + String(numBlocks) + " Data size: " + String(data.Size()));
+
+    // Train the dictionary the same way as when writing a package, and include the training in the compression time
+    HiresTimer dictionaryTimer;
+    unsigned interval = GetDictionarySampleInterval(data.Size());
+    PODVector<unsigned char> samples;
+    PODVector<unsigned> sampleSizes;
+    for (unsigned i = 0; i < numBlocks; i += interval)
+    {
+        samples.Insert(samples.End(), &data[blockOffsets[i]], &data[0] + blockOffsets[i + 1]);
+        sampleSizes.Push(blockOffsets[i + 1] - blockOffsets[i]);
+    }
+    PODVector<unsigned char> dictionaryData;
+    if (!TrainCompressionDictionary(dictionaryData, samples.Size() ? &samples[0] : 0, sampleSizes, MAX_DICTIONARY_SIZE))
+        dictionaryData.Clear();
+    float dictionaryTime = dictionaryTimer.GetUSec(false) / 1000000.0f;
+    CompressionDictionary* dictionary = dictionaryData.Size() ? new CompressionDictionary(&dictionaryData[0], dictionaryData.Size()) : 0;
+    if (dictionary)
+        PrintLine("Dictionary size: " + String(dictionaryData.Size()));
+    else
+        PrintLine("Could not train a dictionary, the data is too small or too uniform");
+
+    const CompressionCodec codecs[] = { COMPRESSION_LZ4, COMPRESSION_LZ4HC, COMPRESSION_LZ4HC_MAX, COMPRESSION_ZSTD, COMPRESSION_ZSTD };
+    const bool useDictionary[] = { false, false, false, false, true };
+    const char* codecNames[] = { "LZ4 fast", "LZ4 HC", "LZ4 HC max", "Zstd", "Zstd dict" };
+
+    PODVector<unsigned char> packed(EstimateCompressBound(blockSize_) * numBlocks);
+    PODVector<unsigned char> unpacked(data.Size());
+    PODVector<unsigned> packedOffsets(numBlocks + 1);
+
+    for (unsigned i = 0; i < sizeof codecs / sizeof codecs[0]; ++i)
+    {
+        if (useDictionary[i] && !dictionary)
+            continue;
+
+        HiresTimer timer;
+        unsigned packedSize = 0;
+        for (unsigned j = 0; j < numBlocks; ++j)
+        {
+            packedOffsets[j] = packedSize;
+            unsigned blockPackedSize = CompressData(&packed[packedSize], &data[blockOffsets[j]], blockOffsets[j + 1] - blockOffsets[j],
+                codecs[i], useDictionary[i] ? dictionary : 0);
+            if (!blockPackedSize)
+                ErrorExit(String(codecNames[i]) + " compression failed at offset " + String(blockOffsets[j]));
+            packedSize += blockPackedSize;
+        }
+        packedOffsets[numBlocks] = packedSize;
+        float compressTime = timer.GetUSec(true) / 1000000.0f + (useDictionary[i] ? dictionaryTime : 0.f);
+
+        for (unsigned k = 0; k < BENCHMARK_DECOMPRESS_ITERATIONS; ++k)
+        {
+            for (unsigned j = 0; j < numBlocks; ++j)
+            {
+                DecompressBlock(&unpacked[blockOffsets[j]], blockOffsets[j + 1] - blockOffsets[j], &packed[packedOffsets[j]],
+                    packedOffsets[j + 1] - packedOffsets[j], GetCompressionFormat(codecs[i]), useDictionary[i] ? dictionary : 0);
+            }
+        }
+        float decompressTime = timer.GetUSec(false) / 1000000.0f / BENCHMARK_DECOMPRESS_ITERATIONS;
+
+        if (data.Size() && memcmp(&data[0], &unpacked[0], data.Size()))
+            ErrorExit(String(codecNames[i]) + " decompression produced wrong data");
+
+        // Include the 4-byte block headers and the dictionary in the packed size, as in a package file
+        unsigned totalPackedSize = packedSize + numBlocks * 4 + (useDictionary[i] ? dictionaryData.Size() : 0);
+        String line;
+        line.AppendWithFormat("%s\tout: %u\tratio: %f\tcompress MB/s: %f\tdecompress MB/s: %f", codecNames[i], totalPackedSize,
+            totalPackedSize ? 1.f * data.Size() / totalPackedSize : 0.f, compressTime > 0.f ? dataMB / compressTime : 0.f,
+            decompressTime > 0.f ? dataMB / decompressTime : 0.f);
+        PrintLine(line);
+    }
+
+    if (dictionary)
+        dictionary->ReleaseRef();
+}
+
+unsigned GetDictionarySampleInterval(unsigned dataSize)
+{
+    // The dictionary is trained on the blocks, as they are compressed separately. Training time grows with the sample size,
+    // so for a large amount of data use evenly spaced blocks up to about 100 times the dictionary size, as zstd recommends
+    return dataSize / (MAX_DICTIONARY_SIZE * DICTIONARY_SAMPLES_RATIO) + 1;
+}
+
+void TrainPackageDictionary(const String& rootDir)
+{
+    if (!quiet_)
+        PrintLine("Training compression dictionary");
+
+    unsigned totalDataSize = 0;
+    for (unsigned i = 0; i < entries_.Size(); ++i)
+        totalDataSize += entries_[i].size_;
+
+    unsigned interval = GetDictionarySampleInterval(totalDataSize);
+    unsigned blockIndex = 0;
+    PODVector<unsigned char> samples;
+    PODVector<unsigned> sampleSizes;
+    for (unsigned i = 0; i < entries_.Size(); ++i)
+    {
+        String fileFullPath = rootDir + "/" + entries_[i].name_;
+        File srcFile(context_, fileFullPath);
+        if (!srcFile.IsOpen())
+            ErrorExit("Could not open file " + fileFullPath);
+
+        for (unsigned pos = 0; pos < entries_[i].size_; pos += blockSize_, ++blockIndex)
+        {
+            if (blockIndex % interval)
+                continue;
+
+            unsigned size = Min(blockSize_, entries_[i].size_ - pos);
+            unsigned offset = samples.Size();
+            samples.Resize(offset + size);
+            srcFile.Seek(pos);
+            if (srcFile.Read(&samples[offset], size) != size)
+                ErrorExit("Could not read file " + fileFullPath);
+            sampleSizes.Push(size);
+        }
+    }
+
+    // Too little data to train on is not an error, the files are then compressed without a dictionary
+    if (!TrainCompressionDictionary(dictionary_, samples.Size() ? &samples[0] : 0, sampleSizes, MAX_DICTIONARY_SIZE))
+    {
+        dictionary_.Clear();
+        if (!quiet_)
+            PrintLine("Could not train a dictionary, compressing without one");
+    }
+}
+
 void ProcessFile(const String& fileName, const String& rootDir)
 {
     String fullPath = rootDir + "/" + fileName;
@@ -217,6 +456,8 @@ void ProcessFile(const String& fileName, const String& rootDir)
     newEntry.offset_ = 0; // Offset not yet known
     newEntry.size_ = file.GetSize();
     newEntry.checksum_ = 0; // Will be calculated later
+    newEntry.nameHash_ = StringHash(basePath_ + fileName).Value();
+    newEntry.nameOffset_ = 0;
     entries_.Push(newEntry);
 }
 
@@ -229,20 +470,31 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     if (!dest.Open(fileName, FILE_WRITE))
         ErrorExit("Could not open output file " + fileName);
 
-    // Write ID, number of files & placeholder for checksum
-    WriteHeader(dest);
-
-    for (unsigned i = 0; i < entries_.Size(); ++i)
+    // Sort the version 2 directory by name hash for binary search, and lay out the name table
+    if (directory_)
     {
-        // Write entry (correct offset is still unknown, will be filled in later)
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
+        Sort(entries_.Begin(), entries_.End(), CompareEntries);
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+        {
+            entries_[i].nameOffset_ = namesSize_;
+            namesSize_ += (basePath_ + entries_[i].name_).Length() + 1;
+        }
     }
 
+    if (compress_ && codec_ == COMPRESSION_ZSTD)
+        TrainPackageDictionary(rootDir);
+    CompressionDictionary* dictionary = dictionary_.Size() ? new CompressionDictionary(&dictionary_[0], dictionary_.Size()) : 0;
+
+    // Write ID, number of files & placeholder for checksum
+    WriteHeader(dest);
+    // Write entries (correct offsets are still unknown, will be filled in later)
+    WriteEntries(dest);
+
     unsigned totalDataSize = 0;
+    unsigned duplicateDataSize = 0;
     unsigned lastOffset;
+    // Indices of the entries with unique content by checksum, for finding duplicates
+    HashMap<unsigned, PODVector<unsigned> > contents;
 
     // Write file data, calculate checksums & correct offsets
     for (unsigned i = 0; i < entries_.Size(); ++i)
@@ -268,6 +520,26 @@ void WritePackageFile(const String& fileName, const String& rootDir)
             entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
         }
 
+        // In a version 2 package, identical files share the same data
+        if (directory_)
+        {
+            PODVector<unsigned>& candidates = contents[entries_[i].checksum_];
+            unsigned j = 0;
+            while (j < candidates.Size() && !IsSameContent(entries_[candidates[j]], &buffer[0], dataSize, rootDir))
+                ++j;
+
+            if (j < candidates.Size())
+            {
+                entries_[i].offset_ = entries_[candidates[j]].offset_;
+                duplicateDataSize += dataSize;
+                if (!quiet_)
+                    PrintLine(entries_[i].name_ + " same as " + entries_[candidates[j]].name_);
+                continue;
+            }
+
+            candidates.Push(i);
+        }
+
         if (!compress_)
         {
             if (!quiet_)
@@ -276,7 +548,7 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         }
         else
         {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[EstimateCompressBound(blockSize_)]);
 
             unsigned pos = 0;
 
@@ -286,9 +558,9 @@ void WritePackageFile(const String& fileName, const String& rootDir)
                 if (pos + unpackedSize > dataSize)
                     unpackedSize = dataSize - pos;
 
-                unsigned packedSize = (unsigned)LZ4_compress_HC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize, LZ4_compressBound(unpackedSize), 0);
+                unsigned packedSize = CompressData(compressBuffer.Get(), &buffer[pos], unpackedSize, codec_, dictionary);
                 if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + String(pos));
+                    ErrorExit("Compression failed for file " + entries_[i].name_ + " at offset " + String(pos));
 
                 dest.WriteUShort((unsigned short)unpackedSize);
                 dest.WriteUShort((unsigned short)packedSize);
@@ -308,6 +580,9 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         }
     }
 
+    if (dictionary)
+        dictionary->ReleaseRef();
+
     // Write package size to the end of file to allow finding it linked to an executable file
     unsigned currentSize = dest.GetSize();
     dest.WriteUInt(currentSize + sizeof(unsigned));
@@ -315,31 +590,97 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     // Write header again with correct offsets & checksums
     dest.Seek(0);
     WriteHeader(dest);
-
-    for (unsigned i = 0; i < entries_.Size(); ++i)
-    {
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
-    }
+    WriteEntries(dest);
 
     if (!quiet_)
     {
         PrintLine("Number of files: " + String(entries_.Size()));
         PrintLine("File data size: " + String(totalDataSize));
+        if (directory_)
+            PrintLine("Duplicate data size: " + String(duplicateDataSize));
         PrintLine("Package size: " + String(dest.GetSize()));
         PrintLine("Checksum: " + String(checksum_));
         PrintLine("Compressed: " + String(compress_ ? "yes" : "no"));
+        if (dictionary_.Size())
+            PrintLine("Dictionary size: " + String(dictionary_.Size()));
     }
 }
 
 void WriteHeader(File& dest)
 {
-    if (!compress_)
+    if (directory_)
+        dest.WriteFileID("UPK2");
+    else if (!compress_)
         dest.WriteFileID("UPAK");
     else
         dest.WriteFileID("ULZ4");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
+
+    if (directory_)
+    {
+        unsigned flags = compress_ ? PACKAGE_COMPRESSED | (GetCompressionFormat(codec_) << PACKAGE_FORMAT_SHIFT) : 0;
+        if (dictionary_.Size())
+            flags |= PACKAGE_DICTIONARY;
+        dest.WriteUInt(flags);
+        dest.WriteUInt(namesSize_);
+        if (dictionary_.Size())
+            dest.WriteUInt(dictionary_.Size());
+    }
+}
+
+void WriteEntries(File& dest)
+{
+    if (!directory_)
+    {
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+        {
+            dest.WriteString(basePath_ + entries_[i].name_);
+            dest.WriteUInt(entries_[i].offset_);
+            dest.WriteUInt(entries_[i].size_);
+            dest.WriteUInt(entries_[i].checksum_);
+        }
+    }
+    else
+    {
+        // Fixed-size directory entries followed by the name table and the compression dictionary
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+        {
+            dest.WriteUInt(entries_[i].offset_);
+            dest.WriteUInt(entries_[i].size_);
+            dest.WriteUInt(entries_[i].checksum_);
+            dest.WriteUInt(entries_[i].nameHash_);
+            dest.WriteUInt(entries_[i].nameOffset_);
+        }
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+            dest.WriteString(basePath_ + entries_[i].name_);
+        if (dictionary_.Size())
+            dest.Write(&dictionary_[0], dictionary_.Size());
+    }
+}
+
+bool CompareEntries(const FileEntry& lhs, const FileEntry& rhs)
+{
+    if (lhs.nameHash_ != rhs.nameHash_)
+        return lhs.nameHash_ < rhs.nameHash_;
+    else
+        return lhs.name_ < rhs.name_;
+}
+
+bool IsSameContent(const FileEntry& entry, const unsigned char* data, unsigned size, const String& rootDir)
+{
+    if (entry.size_ != size)
+        return false;
+
+    // Compare to the source file of an already written entry, as the checksum alone may collide
+    String fileFullPath = rootDir + "/" + entry.name_;
+    File srcFile(context_, fileFullPath);
+    if (!srcFile.IsOpen())
+        ErrorExit("Could not open file " + fileFullPath);
+
+    SharedArrayPtr<unsigned char> buffer(new unsigned char[entry.size_]);
+    if (srcFile.Read(&buffer[0], entry.size_) != entry.size_)
+        ErrorExit("Could not read file " + fileFullPath);
+
+    return !memcmp(&buffer[0], data, entry.size_);
 }
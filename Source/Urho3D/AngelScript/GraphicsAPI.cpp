@@ -149,6 +149,7 @@ static void RegisterSkeleton(asIScriptEngine* engine)
     engine->RegisterObjectProperty("Bone", "Quaternion initialRotation", offsetof(Bone, initialRotation_));
     engine->RegisterObjectProperty("Bone", "Vector3 initialScale", offsetof(Bone, initialScale_));
     engine->RegisterObjectProperty("Bone", "bool animated", offsetof(Bone, animated_));
+    engine->RegisterObjectProperty("Bone", "float animationLodDistance", offsetof(Bone, animationLodDistance_));
     engine->RegisterObjectProperty("Bone", "float radius", offsetof(Bone, radius_));
     engine->RegisterObjectProperty("Bone", "const BoundingBox boundingBox", offsetof(Bone, boundingBox_));
     engine->RegisterObjectMethod("Bone", "void set_node(Node@+)", asFUNCTION(BoneSetNode), asCALL_CDECL_OBJLAST);
@@ -1123,6 +1124,9 @@ static void RegisterAnimation(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Animation", "void RemoveTrigger(uint)", asMETHOD(Animation, RemoveTrigger), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void RemoveAllTriggers()", asMETHOD(Animation, RemoveAllTriggers), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "Animation@ Clone(const String&in cloneName = String()) const", asFUNCTION(AnimationClone), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Animation", "void Compile(float sampleRate = 30.0f)", asMETHOD(Animation, Compile), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "void RemoveCompiled()", asMETHOD(Animation, RemoveCompiled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "bool get_compiled() const", asMETHOD(Animation, IsCompiled), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void set_animationName(const String&in) const", asMETHOD(Animation, SetAnimationName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "const String& get_animationName() const", asMETHOD(Animation, GetAnimationName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void set_length(float)", asMETHOD(Animation, SetLength), asCALL_THISCALL);
@@ -1411,8 +1415,13 @@ static void RegisterAnimatedModel(asIScriptEngine* engine)
     engine->RegisterObjectMethod("AnimatedModel", "void set_model(Model@+)", asFUNCTION(AnimatedModelSetModel), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("AnimatedModel", "void set_animationLodBias(float)", asMETHOD(AnimatedModel, SetAnimationLodBias), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "float get_animationLodBias() const", asMETHOD(AnimatedModel, GetAnimationLodBias), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "void set_animationLodInterpolation(bool)", asMETHOD(AnimatedModel, SetAnimationLodInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "bool get_animationLodInterpolation() const", asMETHOD(AnimatedModel, GetAnimationLodInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "float get_animationLodDistance() const", asMETHOD(AnimatedModel, GetAnimationLodDistance), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "void set_updateInvisible(bool)", asMETHOD(AnimatedModel, SetUpdateInvisible), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "bool get_updateInvisible() const", asMETHOD(AnimatedModel, GetUpdateInvisible), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "void set_headlessMorphs(bool)", asMETHOD(AnimatedModel, SetHeadlessMorphs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "bool get_headlessMorphs() const", asMETHOD(AnimatedModel, GetHeadlessMorphs), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "Skeleton@+ get_skeleton()", asMETHOD(AnimatedModel, GetSkeleton), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "uint get_numAnimationStates() const", asMETHOD(AnimatedModel, GetNumAnimationStates), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "AnimationState@+ get_animationStates(const String&in) const", asMETHODPR(AnimatedModel, GetAnimationState, (const String&) const, AnimationState*), asCALL_THISCALL);
@@ -2001,6 +2010,8 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Renderer", "bool get_reuseShadowMaps() const", asMETHOD(Renderer, GetReuseShadowMaps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_dynamicInstancing(bool)", asMETHOD(Renderer, SetDynamicInstancing), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "bool get_dynamicInstancing() const", asMETHOD(Renderer, GetDynamicInstancing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_retainedInstancing(bool)", asMETHOD(Renderer, SetRetainedInstancing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_retainedInstancing() const", asMETHOD(Renderer, GetRetainedInstancing), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_minInstances(int)", asMETHOD(Renderer, SetMinInstances), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "int get_minInstances() const", asMETHOD(Renderer, GetMinInstances), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_numExtraInstancingBufferElements(int)", asMETHOD(Renderer, SetNumExtraInstancingBufferElements), asCALL_THISCALL);
@@ -2015,6 +2026,10 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Renderer", "float get_occluderSizeThreshold() const", asMETHOD(Renderer, GetOccluderSizeThreshold), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_threadedOcclusion(bool)", asMETHOD(Renderer, SetThreadedOcclusion), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "bool get_threadedOcclusion() const", asMETHOD(Renderer, GetThreadedOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_temporalOcclusion(bool)", asMETHOD(Renderer, SetTemporalOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_temporalOcclusion() const", asMETHOD(Renderer, GetTemporalOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_occluderRefreshInterval(int)", asMETHOD(Renderer, SetOccluderRefreshInterval), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "int get_occluderRefreshInterval() const", asMETHOD(Renderer, GetOccluderRefreshInterval), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_mobileShadowBiasMul(float)", asMETHOD(Renderer, SetMobileShadowBiasMul), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "float get_mobileShadowBiasMul() const", asMETHOD(Renderer, GetMobileShadowBiasMul), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_mobileShadowBiasAdd(float)", asMETHOD(Renderer, SetMobileShadowBiasAdd), asCALL_THISCALL);
@@ -2111,6 +2126,35 @@ static RayQueryResult OctreeRaycastSingle(const Ray& ray, RayQueryLevel level, f
     }
 }
 
+static CScriptArray* OctreeRaycastSingleBatch(CScriptArray* rays, RayQueryLevel level, float maxDistance, unsigned char drawableFlags, unsigned viewMask, Octree* ptr)
+{
+    PODVector<Ray> rayVector = ArrayToPODVector<Ray>(rays);
+    Vector<PODVector<RayQueryResult> > results(rayVector.Size());
+    PODVector<RayOctreeQuery*> queries(rayVector.Size());
+    for (unsigned i = 0; i < rayVector.Size(); ++i)
+        queries[i] = new RayOctreeQuery(results[i], rayVector[i], level, maxDistance, drawableFlags, viewMask);
+
+    ptr->RaycastSingle(queries);
+
+    // Return one result per ray, with null drawable and infinite distance for the rays that hit nothing
+    PODVector<RayQueryResult> result(rayVector.Size());
+    for (unsigned i = 0; i < rayVector.Size(); ++i)
+    {
+        if (!results[i].Empty())
+            result[i] = results[i][0];
+        else
+        {
+            result[i].position_ = Vector3::ZERO;
+            result[i].normal_ = Vector3::ZERO;
+            result[i].distance_ = M_INFINITY;
+            result[i].subObject_ = 0;
+        }
+        delete queries[i];
+    }
+
+    return VectorToArray<RayQueryResult>(result, "Array<RayQueryResult>");
+}
+
 static CScriptArray* OctreeGetDrawablesPoint(const Vector3& point, unsigned char drawableFlags, unsigned viewMask, Octree* ptr)
 {
     PODVector<Drawable*> result;
@@ -2187,6 +2231,7 @@ static void RegisterOctree(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Octree", "void RemoveManualDrawable(Drawable@+)", asMETHOD(Octree, RemoveManualDrawable), asCALL_THISCALL);
     engine->RegisterObjectMethod("Octree", "Array<RayQueryResult>@ Raycast(const Ray&in, RayQueryLevel level = RAY_TRIANGLE, float maxDistance = M_INFINITY, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK) const", asFUNCTION(OctreeRaycast), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Octree", "RayQueryResult RaycastSingle(const Ray&in, RayQueryLevel level = RAY_TRIANGLE, float maxDistance = M_INFINITY, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK) const", asFUNCTION(OctreeRaycastSingle), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Octree", "Array<RayQueryResult>@ RaycastSingle(Array<Ray>@+, RayQueryLevel level = RAY_TRIANGLE, float maxDistance = M_INFINITY, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK) const", asFUNCTION(OctreeRaycastSingleBatch), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Octree", "Array<Drawable@>@ GetDrawables(const Vector3&in, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK)", asFUNCTION(OctreeGetDrawablesPoint), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Octree", "Array<Drawable@>@ GetDrawables(const BoundingBox&in, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK)", asFUNCTION(OctreeGetDrawablesBox), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Octree", "Array<Drawable@>@ GetDrawables(const Frustum&in, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK)", asFUNCTION(OctreeGetDrawablesFrustum), asCALL_CDECL_OBJLAST);
@@ -2194,6 +2239,10 @@ static void RegisterOctree(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Octree", "Array<Drawable@>@ GetAllDrawables(uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK)", asFUNCTION(OctreeGetAllDrawables), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Octree", "const BoundingBox& get_worldBoundingBox() const", asMETHODPR(Octree, GetWorldBoundingBox, () const, const BoundingBox&), asCALL_THISCALL);
     engine->RegisterObjectMethod("Octree", "uint get_numLevels() const", asMETHOD(Octree, GetNumLevels), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Octree", "void set_dynamicTree(bool)", asMETHOD(Octree, SetDynamicTree), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Octree", "bool get_dynamicTree() const", asMETHOD(Octree, IsDynamicTree), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Octree", "void set_updateBudget(uint)", asMETHOD(Octree, SetUpdateBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Octree", "uint get_updateBudget() const", asMETHOD(Octree, GetUpdateBudget), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Octree@+ get_octree() const", asFUNCTION(SceneGetOctree), asCALL_CDECL_OBJLAST);
     engine->RegisterGlobalFunction("Octree@+ get_octree()", asFUNCTION(GetOctree), asCALL_CDECL);
 }
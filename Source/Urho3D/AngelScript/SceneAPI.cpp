@@ -412,6 +412,11 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "LoadMode get_asyncLoadMode() const", asMETHOD(Scene, GetAsyncLoadMode), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_asyncLoadingMs(int)", asMETHOD(Scene, SetAsyncLoadingMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "int get_asyncLoadingMs() const", asMETHOD(Scene, GetAsyncLoadingMs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_parallelUpdate(bool)", asMETHOD(Scene, SetParallelUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_parallelUpdate() const", asMETHOD(Scene, IsParallelUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_batchedTransformUpdate(bool)", asMETHOD(Scene, SetBatchedTransformUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_batchedTransformUpdate() const", asMETHOD(Scene, IsBatchedTransformUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void UpdateWorldTransforms()", asMETHOD(Scene, UpdateWorldTransforms), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "uint get_checksum() const", asMETHOD(Scene, GetChecksum), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "const String& get_fileName() const", asMETHOD(Scene, GetFileName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Array<PackageFile@>@ get_requiredPackageFiles() const", asFUNCTION(SceneGetRequiredPackageFiles), asCALL_CDECL_OBJLAST);
@@ -41,7 +41,7 @@ public:
     /// Destruct.
     ~Condition();
 
-    /// Set the condition. Will be automatically reset once a waiting thread wakes up.
+    /// Set the condition. Will be automatically reset once a waiting thread wakes up. If no thread is waiting, the next thread to wait returns immediately.
     void Set();
 
     /// Wait on the condition.
@@ -51,6 +51,8 @@ private:
 #ifndef _WIN32
     /// Mutex for the event, necessary for pthreads-based implementation.
     void* mutex_;
+    /// Set flag, necessary for pthreads-based implementation to not lose a set before the wait.
+    bool signaled_;
 #endif
     /// Operating system specific event.
     void* event_;
@@ -70,7 +70,10 @@ void EventReceiverGroup::EndSendEvent()
         for (unsigned i = receivers_.Size() - 1; i < receivers_.Size(); --i)
         {
             if (!receivers_[i])
+            {
                 receivers_.Erase(i);
+                typedHandlers_.Erase(i);
+            }
         }
 
         dirty_ = false;
@@ -80,22 +83,49 @@ void EventReceiverGroup::EndSendEvent()
 void EventReceiverGroup::Add(Object* object)
 {
     if (object)
+    {
         receivers_.Push(object);
+        typedHandlers_.Push(0);
+    }
 }
 
 void EventReceiverGroup::Remove(Object* object)
+{
+    PODVector<Object*>::Iterator i = receivers_.Find(object);
+    if (i != receivers_.End())
+        RemoveAt((unsigned)(i - receivers_.Begin()));
+}
+
+void EventReceiverGroup::AddTypedHandler(TypedEventHandler* handler)
+{
+    // The receiver is added in subscription order along with the ordinary receivers, so that typed and ordinary handlers get invoked in the order they subscribed
+    if (handler)
+    {
+        receivers_.Push(handler->GetReceiver());
+        typedHandlers_.Push(handler);
+    }
+}
+
+void EventReceiverGroup::RemoveTypedHandler(TypedEventHandler* handler)
+{
+    PODVector<TypedEventHandler*>::Iterator i = typedHandlers_.Find(handler);
+    if (i != typedHandlers_.End())
+        RemoveAt((unsigned)(i - typedHandlers_.Begin()));
+}
+
+void EventReceiverGroup::RemoveAt(unsigned index)
 {
     if (inSend_ > 0)
     {
-        PODVector<Object*>::Iterator i = receivers_.Find(object);
-        if (i != receivers_.End())
-        {
-            (*i) = 0;
-            dirty_ = true;
-        }
+        receivers_[index] = 0;
+        typedHandlers_[index] = 0;
+        dirty_ = true;
     }
     else
-        receivers_.Remove(object);
+    {
+        receivers_.Erase(index);
+        typedHandlers_.Erase(index);
+    }
 }
 
 void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo> >& attributes, StringHash objectType, const char* name)
@@ -149,6 +179,12 @@ Context::~Context()
     for (PODVector<VariantMap*>::Iterator i = eventDataMaps_.Begin(); i != eventDataMaps_.End(); ++i)
         delete *i;
     eventDataMaps_.Clear();
+    for (PODVector<VariantMap*>::Iterator i = typedEventDataMaps_.Begin(); i != typedEventDataMaps_.End(); ++i)
+        delete *i;
+    typedEventDataMaps_.Clear();
+    for (PODVector<HashSet<Object*>*>::Iterator i = typedEventReceiverSets_.Begin(); i != typedEventReceiverSets_.End(); ++i)
+        delete *i;
+    typedEventReceiverSets_.Clear();
 }
 
 SharedPtr<Object> Context::CreateObject(StringHash objectType)
@@ -233,6 +269,28 @@ VariantMap& Context::GetEventDataMap()
     return ret;
 }
 
+VariantMap& Context::GetTypedEventDataMap()
+{
+    unsigned nestingLevel = eventSenders_.Size();
+    while (typedEventDataMaps_.Size() < nestingLevel + 1)
+        typedEventDataMaps_.Push(new VariantMap());
+
+    VariantMap& ret = *typedEventDataMaps_[nestingLevel];
+    ret.Clear();
+    return ret;
+}
+
+HashSet<Object*>& Context::GetTypedEventReceiverSet()
+{
+    unsigned nestingLevel = eventSenders_.Size();
+    while (typedEventReceiverSets_.Size() < nestingLevel + 1)
+        typedEventReceiverSets_.Push(new HashSet<Object*>());
+
+    HashSet<Object*>& ret = *typedEventReceiverSets_[nestingLevel];
+    ret.Clear();
+    return ret;
+}
+
 #ifndef MINI_URHO
 bool Context::RequireSDL(unsigned int sdlFlags)
 {
@@ -410,6 +468,13 @@ void Context::RemoveEventSender(Object* sender)
     {
         for (HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
         {
+            // The typed handlers get deleted by their receivers, so detach them from the group being erased first
+            for (PODVector<TypedEventHandler*>::Iterator k = j->second_->typedHandlers_.Begin(); k != j->second_->typedHandlers_.End(); ++k)
+            {
+                if (*k)
+                    (*k)->group_ = 0;
+            }
+
             for (PODVector<Object*>::Iterator k = j->second_->receivers_.Begin(); k != j->second_->receivers_.End(); ++k)
             {
                 Object* receiver = *k;
@@ -421,6 +486,37 @@ void Context::RemoveEventSender(Object* sender)
     }
 }
 
+void Context::AddTypedEventHandler(TypedEventHandler* handler)
+{
+    Object* sender = handler->GetSender();
+    EventReceiverGroup* group;
+    if (sender)
+    {
+        SharedPtr<EventReceiverGroup>& specificGroup = specificEventReceivers_[sender][handler->GetEventType()];
+        if (!specificGroup)
+            specificGroup = new EventReceiverGroup();
+        group = specificGroup;
+    }
+    else
+        group = GetTypedEventReceivers(handler->GetTypedIndex(), handler->GetEventType());
+
+    handler->group_ = group;
+    group->AddTypedHandler(handler);
+}
+
+EventReceiverGroup* Context::CreateTypedEventReceivers(unsigned typedIndex, StringHash eventType)
+{
+    // The group is never removed from the event receivers, so the cached pointer stays valid
+    SharedPtr<EventReceiverGroup>& group = eventReceivers_[eventType];
+    if (!group)
+        group = new EventReceiverGroup();
+
+    while (typedEventReceivers_.Size() <= typedIndex)
+        typedEventReceivers_.Push(0);
+    typedEventReceivers_[typedIndex] = group;
+    return group;
+}
+
 void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
 {
     EventReceiverGroup* group = GetEventReceivers(eventType);
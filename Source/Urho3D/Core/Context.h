@@ -52,10 +52,21 @@ public:
     /// Remove receiver. Leave holes during send, which requires later cleanup.
     void Remove(Object* object);
 
-    /// Receivers. May contain holes during sending.
+    /// Add typed event handler.
+    void AddTypedHandler(TypedEventHandler* handler);
+
+    /// Remove typed event handler. Leave holes during send, which requires later cleanup.
+    void RemoveTypedHandler(TypedEventHandler* handler);
+
+    /// Receivers in subscription order. May contain holes during sending.
     PODVector<Object*> receivers_;
+    /// Typed event handlers of the receivers at the same index, or null for receivers with an ordinary event handler.
+    PODVector<TypedEventHandler*> typedHandlers_;
 
 private:
+    /// Remove receiver at index. Leave a hole during send, which requires later cleanup.
+    void RemoveAt(unsigned index);
+
     /// "In send" recursion counter.
     unsigned inSend_;
     /// Cleanup required flag.
@@ -197,6 +208,15 @@ public:
         return i != eventReceivers_.End() ? i->second_ : (EventReceiverGroup*)0;
     }
 
+    /// Return event receivers for an event type by the index of its typed payload struct. The receiver group is created if it does not exist.
+    EventReceiverGroup* GetTypedEventReceivers(unsigned typedIndex, StringHash eventType)
+    {
+        if (typedIndex < typedEventReceivers_.Size() && typedEventReceivers_[typedIndex])
+            return typedEventReceivers_[typedIndex];
+        else
+            return CreateTypedEventReceivers(typedIndex, eventType);
+    }
+
 private:
     /// Add event receiver.
     void AddEventReceiver(Object* receiver, StringHash eventType);
@@ -208,11 +228,19 @@ private:
     void RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType);
     /// Remove event receiver from non-specific events.
     void RemoveEventReceiver(Object* receiver, StringHash eventType);
+    /// Add typed event handler to the receiver group of its sender and event type.
+    void AddTypedEventHandler(TypedEventHandler* handler);
+    /// Create the receiver group for an event type and cache it by the index of its typed payload struct.
+    EventReceiverGroup* CreateTypedEventReceivers(unsigned typedIndex, StringHash eventType);
     /// Begin event send.
     void BeginSendEvent(Object* sender, StringHash eventType);
     /// End event send. Clean up event receivers removed in the meanwhile.
     void EndSendEvent();
 
+    /// Return a preallocated map for converting a typed event payload to event parameters at the current nesting level. Kept separate from GetEventDataMap(), which the receivers use for sending nested events.
+    VariantMap& GetTypedEventDataMap();
+    /// Return a preallocated set for the receivers already invoked by a typed event send at the current nesting level. The set keeps its freed nodes for reuse, so the send does not allocate once warmed up.
+    HashSet<Object*>& GetTypedEventReceiverSet();
     /// Set current event handler. Called by Object.
     void SetEventHandler(EventHandler* handler) { eventHandler_ = handler; }
 
@@ -228,10 +256,16 @@ private:
     HashMap<StringHash, SharedPtr<EventReceiverGroup> > eventReceivers_;
     /// Event receivers for specific senders' events.
     HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > > specificEventReceivers_;
+    /// Event receivers for non-specific events indexed by typed payload struct. The groups are also held by eventReceivers_.
+    PODVector<EventReceiverGroup*> typedEventReceivers_;
     /// Event sender stack.
     PODVector<Object*> eventSenders_;
     /// Event data stack.
     PODVector<VariantMap*> eventDataMaps_;
+    /// Typed event payload conversion stack.
+    PODVector<VariantMap*> typedEventDataMaps_;
+    /// Typed event invoked receiver set stack.
+    PODVector<HashSet<Object*>*> typedEventReceiverSets_;
     /// Active event handler. Not stored in a stack for performance reasons; is needed only in esoteric cases.
     EventHandler* eventHandler_;
     /// Object categories.
@@ -40,12 +40,40 @@ URHO3D_EVENT(E_UPDATE, Update)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the application-wide logic update event.
+struct UpdateEventData
+{
+    URHO3D_TYPED_EVENT(UpdateEventData, E_UPDATE)
+
+    /// Convert to event parameters.
+    void ToVariantMap(VariantMap& eventData) const { eventData[Update::P_TIMESTEP] = timeStep_; }
+    /// Convert from event parameters.
+    void FromVariantMap(VariantMap& eventData) { timeStep_ = eventData[Update::P_TIMESTEP].GetFloat(); }
+
+    /// Timestep in seconds.
+    float timeStep_;
+};
+
 /// Application-wide logic post-update event.
 URHO3D_EVENT(E_POSTUPDATE, PostUpdate)
 {
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the application-wide logic post-update event.
+struct PostUpdateEventData
+{
+    URHO3D_TYPED_EVENT(PostUpdateEventData, E_POSTUPDATE)
+
+    /// Convert to event parameters.
+    void ToVariantMap(VariantMap& eventData) const { eventData[PostUpdate::P_TIMESTEP] = timeStep_; }
+    /// Convert from event parameters.
+    void FromVariantMap(VariantMap& eventData) { timeStep_ = eventData[PostUpdate::P_TIMESTEP].GetFloat(); }
+
+    /// Timestep in seconds.
+    float timeStep_;
+};
+
 /// Render update event.
 URHO3D_EVENT(E_RENDERUPDATE, RenderUpdate)
 {
@@ -139,16 +139,18 @@ void Object::SubscribeToEvent(StringHash eventType, EventHandler* handler)
         return;
 
     handler->SetSenderAndEventType(0, eventType);
-    // Remove old event handler first
+    // Remove old event handler first. A typed handler is not tracked as a receiver, so add the receiver in that case
     EventHandler* previous;
     EventHandler* oldHandler = FindSpecificEventHandler(0, eventType, &previous);
-    if (oldHandler)
+    if (oldHandler && !oldHandler->IsTyped())
     {
         eventHandlers_.Erase(oldHandler, previous);
         eventHandlers_.InsertFront(handler);
     }
     else
     {
+        if (oldHandler)
+            eventHandlers_.Erase(oldHandler, previous);
         eventHandlers_.InsertFront(handler);
         context_->AddEventReceiver(this, eventType);
     }
@@ -164,21 +166,69 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler
     }
 
     handler->SetSenderAndEventType(sender, eventType);
-    // Remove old event handler first
+    // Remove old event handler first. A typed handler is not tracked as a receiver, so add the receiver in that case
     EventHandler* previous;
     EventHandler* oldHandler = FindSpecificEventHandler(sender, eventType, &previous);
-    if (oldHandler)
+    if (oldHandler && !oldHandler->IsTyped())
     {
         eventHandlers_.Erase(oldHandler, previous);
         eventHandlers_.InsertFront(handler);
     }
     else
     {
+        if (oldHandler)
+            eventHandlers_.Erase(oldHandler, previous);
         eventHandlers_.InsertFront(handler);
         context_->AddEventReceiver(this, sender, eventType);
     }
 }
 
+void Object::SubscribeToEvent(TypedEventHandler* handler)
+{
+    if (!handler)
+        return;
+
+    StringHash eventType = handler->GetEventType();
+    handler->SetSenderAndEventType(0, eventType);
+    // Remove old event handler first
+    EventHandler* previous;
+    EventHandler* oldHandler = FindSpecificEventHandler(0, eventType, &previous);
+    if (oldHandler)
+    {
+        if (!oldHandler->IsTyped())
+            context_->RemoveEventReceiver(this, eventType);
+        eventHandlers_.Erase(oldHandler, previous);
+    }
+
+    eventHandlers_.InsertFront(handler);
+    context_->AddTypedEventHandler(handler);
+}
+
+void Object::SubscribeToEvent(Object* sender, TypedEventHandler* handler)
+{
+    // If a null sender was specified, the event can not be subscribed to. Delete the handler in that case
+    if (!sender || !handler)
+    {
+        delete handler;
+        return;
+    }
+
+    StringHash eventType = handler->GetEventType();
+    handler->SetSenderAndEventType(sender, eventType);
+    // Remove old event handler first
+    EventHandler* previous;
+    EventHandler* oldHandler = FindSpecificEventHandler(sender, eventType, &previous);
+    if (oldHandler)
+    {
+        if (!oldHandler->IsTyped())
+            context_->RemoveEventReceiver(this, sender, eventType);
+        eventHandlers_.Erase(oldHandler, previous);
+    }
+
+    eventHandlers_.InsertFront(handler);
+    context_->AddTypedEventHandler(handler);
+}
+
 #if URHO3D_CXX11
 void Object::SubscribeToEvent(StringHash eventType, const std::function<void(StringHash, VariantMap&)>& function, void* userData/*=0*/)
 {
@@ -323,7 +373,16 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
             if (!receiver)
                 continue;
 
-            receiver->OnEvent(this, eventType, eventData);
+            // Typed handlers get the payload converted from the event parameters
+            TypedEventHandler* handler = group->typedHandlers_[i];
+            if (handler)
+            {
+                context->SetEventHandler(handler);
+                handler->Invoke(eventData);
+                context->SetEventHandler(0);
+            }
+            else
+                receiver->OnEvent(this, eventType, eventData);
 
             // If self has been destroyed as a result of event handling, exit
             if (self.Expired())
@@ -354,7 +413,15 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
                 if (!receiver)
                     continue;
 
-                receiver->OnEvent(this, eventType, eventData);
+                TypedEventHandler* handler = group->typedHandlers_[i];
+                if (handler)
+                {
+                    context->SetEventHandler(handler);
+                    handler->Invoke(eventData);
+                    context->SetEventHandler(0);
+                }
+                else
+                    receiver->OnEvent(this, eventType, eventData);
 
                 if (self.Expired())
                 {
@@ -374,7 +441,15 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
                 if (!receiver || processed.Contains(receiver))
                     continue;
 
-                receiver->OnEvent(this, eventType, eventData);
+                TypedEventHandler* handler = group->typedHandlers_[i];
+                if (handler)
+                {
+                    context->SetEventHandler(handler);
+                    handler->Invoke(eventData);
+                    context->SetEventHandler(0);
+                }
+                else
+                    receiver->OnEvent(this, eventType, eventData);
 
                 if (self.Expired())
                 {
@@ -391,6 +466,106 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     context->EndSendEvent();
 }
 
+void Object::SendTypedEvent(StringHash eventType, unsigned typedIndex, const void* data, TypedEventConverter converter)
+{
+    if (!Thread::IsMainThread())
+    {
+        URHO3D_LOGERROR("Sending events is only supported from the main thread");
+        return;
+    }
+
+    // Make a weak pointer to self to check for destruction during event handling
+    WeakPtr<Object> self(this);
+    Context* context = context_;
+    // The payload is converted to event parameters only when the first receiver without a typed handler is reached
+    VariantMap* eventData = 0;
+
+    context->BeginSendEvent(this, eventType);
+    HashSet<Object*>& processed = context->GetTypedEventReceiverSet();
+
+    // Check first the specific event receivers
+    SharedPtr<EventReceiverGroup> group(context->GetEventReceivers(this, eventType));
+    if (group)
+    {
+        group->BeginSendEvent();
+
+        const unsigned numReceivers = group->receivers_.Size();
+        for (unsigned i = 0; i < numReceivers; ++i)
+        {
+            Object* receiver = group->receivers_[i];
+            if (!receiver)
+                continue;
+
+            TypedEventHandler* handler = group->typedHandlers_[i];
+            if (handler)
+            {
+                context->SetEventHandler(handler);
+                handler->InvokeTyped(data);
+                context->SetEventHandler(0);
+            }
+            else
+            {
+                if (!eventData)
+                {
+                    eventData = &context->GetTypedEventDataMap();
+                    converter(data, *eventData);
+                }
+                receiver->OnEvent(this, eventType, *eventData);
+            }
+
+            if (self.Expired())
+            {
+                group->EndSendEvent();
+                context->EndSendEvent();
+                return;
+            }
+
+            processed.Insert(receiver);
+        }
+
+        group->EndSendEvent();
+    }
+
+    // Then the non-specific receivers. Their group is cached by the payload index, so no lookup is needed
+    group = context->GetTypedEventReceivers(typedIndex, eventType);
+    group->BeginSendEvent();
+
+    const unsigned numReceivers = group->receivers_.Size();
+    for (unsigned i = 0; i < numReceivers; ++i)
+    {
+        Object* receiver = group->receivers_[i];
+        if (!receiver || (!processed.Empty() && processed.Contains(receiver)))
+            continue;
+
+        TypedEventHandler* handler = group->typedHandlers_[i];
+        if (handler)
+        {
+            context->SetEventHandler(handler);
+            handler->InvokeTyped(data);
+            context->SetEventHandler(0);
+        }
+        else
+        {
+            if (!eventData)
+            {
+                eventData = &context->GetTypedEventDataMap();
+                converter(data, *eventData);
+            }
+            receiver->OnEvent(this, eventType, *eventData);
+        }
+
+        if (self.Expired())
+        {
+            group->EndSendEvent();
+            context->EndSendEvent();
+            return;
+        }
+    }
+
+    group->EndSendEvent();
+    context->EndSendEvent();
+}
+
 VariantMap& Object::GetEventDataMap() const
 {
     return context_->GetEventDataMap();
@@ -526,6 +701,11 @@ void Object::RemoveEventSender(Object* sender)
     }
 }
 
+TypedEventHandler::~TypedEventHandler()
+{
+    if (group_)
+        group_->RemoveTypedHandler(this);
+}
 
 Urho3D::StringHash EventNameRegistrar::RegisterEventName(const char* eventName)
 {
@@ -546,4 +726,10 @@ HashMap<StringHash, String>& EventNameRegistrar::GetEventNameMap()
     return eventNames_;
 }
 
+unsigned EventNameRegistrar::RegisterTypedEvent()
+{
+    static unsigned numTypedEvents = 0;
+    return numTypedEvents++;
+}
+
 }
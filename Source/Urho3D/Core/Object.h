@@ -33,6 +33,11 @@ namespace Urho3D
 
 class Context;
 class EventHandler;
+class EventReceiverGroup;
+class TypedEventHandler;
+
+/// Function for converting a typed event payload to event parameters.
+typedef void (*TypedEventConverter)(const void* data, VariantMap& eventData);
 
 /// Type info.
 class URHO3D_API TypeInfo
@@ -110,6 +115,10 @@ public:
     void SubscribeToEvent(StringHash eventType, EventHandler* handler);
     /// Subscribe to a specific sender's event.
     void SubscribeToEvent(Object* sender, StringHash eventType, EventHandler* handler);
+    /// Subscribe to an event that can be sent by any sender with a typed handler. The event type is that of the handler's payload struct.
+    void SubscribeToEvent(TypedEventHandler* handler);
+    /// Subscribe to a specific sender's event with a typed handler. The event type is that of the handler's payload struct.
+    void SubscribeToEvent(Object* sender, TypedEventHandler* handler);
 #ifdef URHO3D_CXX11
     /// Subscribe to an event that can be sent by any sender.
     void SubscribeToEvent(StringHash eventType, const std::function<void(StringHash, VariantMap&)>& function, void* userData=0);
@@ -130,6 +139,11 @@ public:
     void SendEvent(StringHash eventType);
     /// Send event with parameters to all subscribers.
     void SendEvent(StringHash eventType, VariantMap& eventData);
+    /// Send event with a typed payload struct to all subscribers. Typed handlers are called directly with the payload, which is converted to event parameters only if there are other subscribers.
+    template <class T> void SendTypedEvent(const T& data)
+    {
+        SendTypedEvent(T::GetEventTypeStatic(), T::GetTypedEventIndexStatic(), &data, &T::ToVariantMapStatic);
+    }
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap() const;
 #if URHO3D_CXX11
@@ -180,6 +194,8 @@ private:
     EventHandler* FindSpecificEventHandler(Object* sender, StringHash eventType, EventHandler** previous = 0) const;
     /// Remove event handlers related to a specific sender.
     void RemoveEventSender(Object* sender);
+    /// Send event with a typed payload to all subscribers.
+    void SendTypedEvent(StringHash eventType, unsigned typedIndex, const void* data, TypedEventConverter converter);
 
     /// Event handlers. Sender is null for non-specific handlers.
     LinkedList<EventHandler> eventHandlers_;
@@ -261,6 +277,8 @@ public:
     virtual void Invoke(VariantMap& eventData) = 0;
     /// Return a unique copy of the event handler.
     virtual EventHandler* Clone() const = 0;
+    /// Return whether is a typed event handler.
+    virtual bool IsTyped() const { return false; }
 
     /// Return event receiver.
     Object* GetReceiver() const { return receiver_; }
@@ -349,11 +367,93 @@ private:
 };
 #endif
 
+/// Base class for typed event handlers, which receive the event's payload struct directly instead of event parameters.
+class URHO3D_API TypedEventHandler : public EventHandler
+{
+    friend class Context;
+
+public:
+    /// Construct with receiver, event type, payload struct index and userdata.
+    TypedEventHandler(Object* receiver, StringHash eventType, unsigned typedIndex, void* userData = 0) :
+        EventHandler(receiver, userData),
+        group_(0),
+        typedIndex_(typedIndex)
+    {
+        eventType_ = eventType;
+    }
+
+    /// Destruct. Remove from the event receiver group.
+    virtual ~TypedEventHandler();
+
+    /// Invoke event handler function with the payload struct.
+    virtual void InvokeTyped(const void* data) = 0;
+    /// Return whether is a typed event handler.
+    virtual bool IsTyped() const { return true; }
+
+    /// Return payload struct index.
+    unsigned GetTypedIndex() const { return typedIndex_; }
+
+private:
+    /// Event receiver group the handler is in.
+    EventReceiverGroup* group_;
+    /// Payload struct index.
+    unsigned typedIndex_;
+};
+
+/// Template implementation of the typed event handler invoke helper (stores a function pointer of specific class and payload struct.)
+template <class T, class U> class TypedEventHandlerImpl : public TypedEventHandler
+{
+public:
+    typedef void (T::*HandlerFunctionPtr)(const U&);
+
+    /// Construct with receiver and function pointers and userdata.
+    TypedEventHandlerImpl(T* receiver, HandlerFunctionPtr function, void* userData = 0) :
+        TypedEventHandler(receiver, U::GetEventTypeStatic(), U::GetTypedEventIndexStatic(), userData),
+        function_(function)
+    {
+        assert(receiver_);
+        assert(function_);
+    }
+
+    /// Invoke event handler function, converting the payload struct from the event parameters.
+    virtual void Invoke(VariantMap& eventData)
+    {
+        U data;
+        data.FromVariantMap(eventData);
+        InvokeTyped(&data);
+    }
+
+    /// Invoke event handler function with the payload struct.
+    virtual void InvokeTyped(const void* data)
+    {
+        T* receiver = static_cast<T*>(receiver_);
+        (receiver->*function_)(*static_cast<const U*>(data));
+    }
+
+    /// Return a unique copy of the event handler.
+    virtual EventHandler* Clone() const
+    {
+        return new TypedEventHandlerImpl(static_cast<T*>(receiver_), function_, userData_);
+    }
+
+private:
+    /// Class-specific pointer to handler function.
+    HandlerFunctionPtr function_;
+};
+
+/// Construct a typed event handler, deducing the payload struct from the handler function.
+template <class T, class U> TypedEventHandler* MakeTypedEventHandler(T* receiver, void (T::*function)(const U&), void* userData = 0)
+{
+    return new TypedEventHandlerImpl<T, U>(receiver, function, userData);
+}
+
 /// Register event names.
 struct URHO3D_API EventNameRegistrar
 {
     /// Register an event name for hash reverse mapping.
     static StringHash RegisterEventName(const char* eventName);
+    /// Allocate an index for a typed event payload struct.
+    static unsigned RegisterTypedEvent();
     /// Return Event name or empty string if not found.
     static const String& GetEventName(StringHash eventID);
     /// Return Event name map.
@@ -368,5 +468,12 @@ struct URHO3D_API EventNameRegistrar
 #define URHO3D_HANDLER(className, function) (new Urho3D::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
 #define URHO3D_HANDLER_USERDATA(className, function, userData) (new Urho3D::EventHandlerImpl<className>(this, &className::function, userData))
+/// Convenience macro to construct a TypedEventHandler that points to a receiver object and its member function taking a typed event payload struct.
+#define URHO3D_TYPED_HANDLER(className, function) (Urho3D::MakeTypedEventHandler<className>(this, &className::function))
+/// Declare a struct as the typed payload of an event. The struct must also define ToVariantMap(VariantMap&) const and FromVariantMap(VariantMap&) for converting to and from the event parameters.
+#define URHO3D_TYPED_EVENT(typeName, eventID) \
+    static Urho3D::StringHash GetEventTypeStatic() { return eventID; } \
+    static unsigned GetTypedEventIndexStatic() { static const unsigned index = Urho3D::EventNameRegistrar::RegisterTypedEvent(); return index; } \
+    static void ToVariantMapStatic(const void* data, Urho3D::VariantMap& eventData) { static_cast<const typeName*>(data)->ToVariantMap(eventData); }
 
 }
@@ -23,6 +23,9 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../Engine/EngineEvents.h"
+#include "../IO/File.h"
+#include "../IO/Log.h"
 
 #include <cstdio>
 
@@ -31,17 +34,48 @@
 namespace Urho3D
 {
 
+/// Capture ring buffer size in events, per thread.
+static const unsigned CAPTURE_BUFFER_EVENTS = 65536;
+/// Default number of frames to capture from the console.
+static const unsigned DEFAULT_CAPTURE_FRAMES = 60;
+
+static void AppendTraceEvent(String& dest, const char* name, unsigned threadIndex, long long startTime, long long duration)
+{
+    String escapedName(name);
+    escapedName.Replace("\\", "\\\\");
+    escapedName.Replace("\"", "\\\"");
+
+    char line[128];
+    sprintf(line, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%lld,\"dur\":%lld},\n", threadIndex, startTime, duration);
+    dest += "{\"name\":\"" + escapedName + String(line);
+}
+
+static void AppendThreadName(String& dest, const char* name, unsigned threadIndex)
+{
+    char line[128];
+    sprintf(line, "\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"", threadIndex);
+    dest += "{\"name\":\"thread_name\",\"ph\":\"M\"," + String(line) + String(name) + "\"}},\n";
+}
+
 Profiler::Profiler(Context* context) :
     Object(context),
     current_(0),
     root_(0),
-    intervalFrames_(0)
+    intervalFrames_(0),
+    numThreads_(0),
+    captureFrames_(0),
+    capturing_(false)
 {
     current_ = root_ = new ProfilerBlock(0, "RunFrame");
+
+    SubscribeToEvent(E_CONSOLECOMMAND, URHO3D_HANDLER(Profiler, HandleConsoleCommand));
 }
 
 Profiler::~Profiler()
 {
+    for (unsigned i = 0; i < numThreads_; ++i)
+        delete threads_[i];
+
     delete root_;
     root_ = 0;
 }
@@ -61,12 +95,74 @@ void Profiler::EndFrame()
     ++intervalFrames_;
     root_->EndFrame();
     current_ = root_;
+
+    // Collect the other threads' frames. Blocks still in progress will be accounted to the next frame
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        MutexLock lock(thread->mutex_);
+
+        ProfilerBlock* root = thread->root_;
+        root->time_ = 0;
+        for (PODVector<ProfilerBlock*>::ConstIterator j = root->children_.Begin(); j != root->children_.End(); ++j)
+            root->time_ += (*j)->time_;
+        root->maxTime_ = root->time_;
+        root->count_ = root->time_ ? 1 : 0;
+        root->EndFrame();
+    }
+
+    if (capturing_ && captureFrames_ && !--captureFrames_)
+        EndCapture();
 }
 
 void Profiler::BeginInterval()
 {
     root_->BeginInterval();
     intervalFrames_ = 0;
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        MutexLock lock(threads_[i]->mutex_);
+        threads_[i]->root_->BeginInterval();
+    }
+}
+
+void Profiler::BeginCapture(unsigned frames, const String& fileName)
+{
+    if (capturing_)
+        EndCapture();
+
+    MutexLock lock(threadsMutex_);
+
+    events_.Reset(CAPTURE_BUFFER_EVENTS);
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        MutexLock threadLock(threads_[i]->mutex_);
+        threads_[i]->events_.Reset(CAPTURE_BUFFER_EVENTS);
+    }
+
+    captureFileName_ = fileName;
+    captureFrames_ = frames;
+    captureTimer_.Reset();
+    capturing_ = true;
+
+    URHO3D_LOGINFO("Began profiler capture to " + fileName);
+}
+
+void Profiler::EndCapture()
+{
+    if (!capturing_)
+        return;
+
+    capturing_ = false;
+    SaveCapture(captureFileName_);
+
+    events_.Reset(0);
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        MutexLock lock(threads_[i]->mutex_);
+        threads_[i]->events_.Reset(0);
+    }
 }
 
 const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxDepth) const
@@ -86,9 +182,132 @@ const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxD
 
     PrintData(root_, output, 0, maxDepth, showUnused, showTotal);
 
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        MutexLock lock(threads_[i]->mutex_);
+        PrintData(threads_[i]->root_, output, 0, maxDepth, showUnused, showTotal);
+    }
+
     return output;
 }
 
+ProfilerThread* Profiler::GetThread()
+{
+    ThreadID id = Thread::GetCurrentThreadID();
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        if (threads_[i]->id_ == id)
+            return threads_[i];
+    }
+
+    MutexLock lock(threadsMutex_);
+    if (numThreads_ >= MAX_PROFILER_THREADS)
+        return 0;
+
+    // Publish the entry only after it has been fully constructed
+    threads_[numThreads_] = new ProfilerThread(id, ("Thread" + String(numThreads_ + 1)).CString());
+    if (capturing_)
+        threads_[numThreads_]->events_.Reset(CAPTURE_BUFFER_EVENTS);
+    ++numThreads_;
+    return threads_[numThreads_ - 1];
+}
+
+void Profiler::BeginThreadBlock(const char* name)
+{
+    ProfilerThread* thread = GetThread();
+    if (!thread)
+        return;
+
+    MutexLock lock(thread->mutex_);
+    thread->current_ = thread->current_->GetChild(name);
+    thread->current_->Begin();
+}
+
+void Profiler::EndThreadBlock()
+{
+    ProfilerThread* thread = GetThread();
+    if (!thread)
+        return;
+
+    MutexLock lock(thread->mutex_);
+    if (thread->current_ != thread->root_)
+    {
+        if (capturing_)
+            RecordEvent(thread->events_, thread->current_);
+        thread->current_->End();
+        thread->current_ = thread->current_->parent_;
+    }
+}
+
+void Profiler::RecordEvent(ProfilerEventBuffer& buffer, ProfilerBlock* block)
+{
+    long long duration = block->timer_.GetUSec(false);
+    buffer.Record(block->name_, captureTimer_.GetUSec(false) - duration, duration);
+}
+
+bool Profiler::SaveCapture(const String& fileName)
+{
+    String output("{\"traceEvents\":[\n");
+
+    AppendThreadName(output, "Main", 0);
+    for (unsigned i = 0; i < events_.GetSize(); ++i)
+    {
+        const ProfilerEvent& event = events_.GetEvent(i);
+        AppendTraceEvent(output, event.name_, 0, event.startTime_, event.duration_);
+    }
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        MutexLock lock(thread->mutex_);
+
+        AppendThreadName(output, thread->root_->name_, i + 1);
+        for (unsigned j = 0; j < thread->events_.GetSize(); ++j)
+        {
+            const ProfilerEvent& event = thread->events_.GetEvent(j);
+            AppendTraceEvent(output, event.name_, i + 1, event.startTime_, event.duration_);
+        }
+    }
+
+    // Remove the trailing comma
+    output.Resize(output.Length() - 2);
+    output += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    File file(context_, fileName, FILE_WRITE);
+    if (!file.IsOpen() || file.Write(output.CString(), output.Length()) != output.Length())
+    {
+        URHO3D_LOGERROR("Failed to save profiler capture to " + fileName);
+        return false;
+    }
+
+    URHO3D_LOGINFO("Saved profiler capture to " + fileName);
+    return true;
+}
+
+void Profiler::HandleConsoleCommand(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ConsoleCommand;
+
+    if (eventData[P_ID].GetString() != GetTypeName())
+        return;
+
+    // Commands: "capture [frames] [filename]" and "endcapture"
+    Vector<String> arguments = eventData[P_COMMAND].GetString().Split(' ');
+    if (arguments.Empty())
+        return;
+
+    if (arguments[0] == "capture")
+    {
+        unsigned frames = arguments.Size() > 1 ? ToUInt(arguments[1]) : DEFAULT_CAPTURE_FRAMES;
+        String fileName = arguments.Size() > 2 ? arguments[2] : GetTypeName() + "Capture.json";
+        BeginCapture(frames, fileName);
+    }
+    else if (arguments[0] == "endcapture")
+        EndCapture();
+    else
+        URHO3D_LOGERROR("Unknown profiler command " + arguments[0]);
+}
+
 void Profiler::PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused,
     bool showTotal) const
 {
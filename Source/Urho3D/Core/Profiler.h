@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/Str.h"
+#include "../Core/Mutex.h"
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 
@@ -168,6 +169,107 @@ public:
     unsigned totalCount_;
 };
 
+/// Profiling block timeline event recorded during a capture.
+struct ProfilerEvent
+{
+    /// Block name.
+    const char* name_;
+    /// Start time in microseconds since the capture began.
+    long long startTime_;
+    /// Duration in microseconds.
+    long long duration_;
+};
+
+/// Ring buffer of profiling block timeline events. When full, the oldest events are overwritten.
+class URHO3D_API ProfilerEventBuffer
+{
+public:
+    /// Construct.
+    ProfilerEventBuffer() :
+        next_(0),
+        size_(0)
+    {
+    }
+
+    /// Clear and set capacity. Zero capacity frees the buffer and disables recording.
+    void Reset(unsigned capacity)
+    {
+        if (capacity)
+            events_.Resize(capacity);
+        else
+            events_.Clear();
+        events_.Compact();
+        next_ = 0;
+        size_ = 0;
+    }
+
+    /// Record an event.
+    void Record(const char* name, long long startTime, long long duration)
+    {
+        if (events_.Empty())
+            return;
+
+        ProfilerEvent& event = events_[next_];
+        event.name_ = name;
+        event.startTime_ = startTime;
+        event.duration_ = duration;
+        if (++next_ == events_.Size())
+            next_ = 0;
+        if (size_ < events_.Size())
+            ++size_;
+    }
+
+    /// Return number of recorded events.
+    unsigned GetSize() const { return size_; }
+
+    /// Return recorded event by index, oldest first.
+    const ProfilerEvent& GetEvent(unsigned index) const
+    {
+        unsigned capacity = events_.Size();
+        return events_[(next_ + capacity - size_ + index) % capacity];
+    }
+
+private:
+    /// Event storage.
+    PODVector<ProfilerEvent> events_;
+    /// Next index to write.
+    unsigned next_;
+    /// Number of recorded events.
+    unsigned size_;
+};
+
+/// Maximum number of threads besides the main thread that can record profiling data.
+static const unsigned MAX_PROFILER_THREADS = 64;
+
+/// Profiling block tree of a thread other than the main thread.
+struct ProfilerThread
+{
+    /// Construct with thread ID and root block name.
+    ProfilerThread(ThreadID id, const char* name) :
+        id_(id),
+        root_(new ProfilerBlock(0, name)),
+        current_(root_)
+    {
+    }
+
+    /// Destruct. Free the block tree.
+    ~ProfilerThread()
+    {
+        delete root_;
+    }
+
+    /// Thread ID.
+    ThreadID id_;
+    /// Root block. Its time is the sum of the top-level blocks on each frame.
+    ProfilerBlock* root_;
+    /// Current block.
+    ProfilerBlock* current_;
+    /// Timeline events during a capture.
+    ProfilerEventBuffer events_;
+    /// Mutex for the block tree. Only the owning thread records, so it is contended only while the main thread collects the frame.
+    Mutex mutex_;
+};
+
 /// Hierarchical performance profiler subsystem.
 class URHO3D_API Profiler : public Object
 {
@@ -179,12 +281,14 @@ public:
     /// Destruct.
     virtual ~Profiler();
 
-    /// Begin timing a profiling block.
+    /// Begin timing a profiling block. Other threads than the main thread record into their own block trees.
     void BeginBlock(const char* name)
     {
-        // Profiler supports only the main thread currently
         if (!Thread::IsMainThread())
+        {
+            BeginThreadBlock(name);
             return;
+        }
 
         current_ = current_->GetChild(name);
         current_->Begin();
@@ -194,8 +298,13 @@ public:
     void EndBlock()
     {
         if (!Thread::IsMainThread())
+        {
+            EndThreadBlock();
             return;
+        }
 
+        if (capturing_)
+            RecordEvent(events_, current_);
         current_->End();
         if (current_->parent_)
             current_ = current_->parent_;
@@ -207,17 +316,39 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Begin capturing timestamped profiling blocks from all threads for a number of frames, after which the capture is saved as Chrome trace event JSON to the file. Zero frames captures until EndCapture() is called.
+    void BeginCapture(unsigned frames, const String& fileName);
+    /// End the capture and save it.
+    void EndCapture();
 
     /// Return profiling data as text output. This method is not thread-safe.
     const String& PrintData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
+    /// Return whether a capture is in progress.
+    bool IsCapturing() const { return capturing_; }
     /// Return the current profiling block.
     const ProfilerBlock* GetCurrentBlock() { return current_; }
     /// Return the root profiling block.
     const ProfilerBlock* GetRootBlock() { return root_; }
+    /// Return number of other threads than the main thread that have recorded profiling data.
+    unsigned GetNumThreads() const { return numThreads_; }
+    /// Return the root profiling block of another thread than the main thread by index. The thread may still be recording into the block tree.
+    const ProfilerBlock* GetThreadRootBlock(unsigned index) const { return index < numThreads_ ? threads_[index]->root_ : 0; }
 
 protected:
     /// Return profiling data as text output for a specified profiling block.
     void PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
+    /// Record a block that is about to end into a capture buffer.
+    void RecordEvent(ProfilerEventBuffer& buffer, ProfilerBlock* block);
+    /// Save the capture as Chrome trace event JSON. Return true if successful.
+    bool SaveCapture(const String& fileName);
+    /// Handle a console command.
+    void HandleConsoleCommand(StringHash eventType, VariantMap& eventData);
+    /// Return the calling thread's block tree, registering it on first use. Return null if too many threads.
+    ProfilerThread* GetThread();
+    /// Begin timing a profiling block in another thread than the main thread.
+    void BeginThreadBlock(const char* name);
+    /// End timing the current profiling block in another thread than the main thread.
+    void EndThreadBlock();
 
     /// Current profiling block.
     ProfilerBlock* current_;
@@ -225,6 +356,22 @@ protected:
     ProfilerBlock* root_;
     /// Frames in the current interval.
     unsigned intervalFrames_;
+    /// Block trees of other threads than the main thread. Entries are only appended, so that the threads can search them without locking.
+    ProfilerThread* threads_[MAX_PROFILER_THREADS];
+    /// Number of registered threads.
+    volatile unsigned numThreads_;
+    /// Mutex for registering threads.
+    Mutex threadsMutex_;
+    /// Main thread timeline events during a capture.
+    ProfilerEventBuffer events_;
+    /// Capture timer.
+    HiresTimer captureTimer_;
+    /// Capture file name.
+    String captureFileName_;
+    /// Frames left to capture, or zero if not limited.
+    unsigned captureFrames_;
+    /// Capture in progress flag.
+    volatile bool capturing_;
 };
 
 /// Helper class for automatically beginning and ending a profiling block
@@ -38,13 +38,15 @@ public:
     /// Construct.
     WorkerThread(WorkQueue* owner, unsigned index) :
         owner_(owner),
-        index_(index)
+        index_(index),
+        threadID_(0)
     {
     }
 
     /// Process work items until stopped.
     virtual void ThreadFunction()
     {
+        threadID_ = GetCurrentThreadID();
         // Init FPU state first
         InitFPU();
         owner_->ProcessItems(index_);
@@ -52,12 +54,33 @@ public:
 
     /// Return thread index.
     unsigned GetIndex() const { return index_; }
+    /// Return operating system thread ID. Valid once the thread has started executing.
+    ThreadID GetThreadID() const { return threadID_; }
 
 private:
     /// Work queue.
     WorkQueue* owner_;
     /// Thread index.
     unsigned index_;
+    /// Operating system thread ID.
+    ThreadID threadID_;
+};
+
+/// Prioritized work item queue owned by one thread. Other threads steal from it when their own queue runs dry.
+struct WorkerQueue : public RefCounted
+{
+    /// Construct.
+    WorkerQueue() :
+        numItems_(0)
+    {
+    }
+
+    /// Work items, highest priority first.
+    List<WorkItem*> items_;
+    /// Number of work items. Modified only under the mutex, but may be read without it to check for an empty queue.
+    volatile unsigned numItems_;
+    /// Queue mutex. Only contended when another thread is stealing.
+    Mutex mutex_;
 };
 
 WorkQueue::WorkQueue(Context* context) :
@@ -65,11 +88,16 @@ WorkQueue::WorkQueue(Context* context) :
     shutDown_(false),
     pausing_(false),
     paused_(false),
+    dependentsQueued_(false),
     completing_(false),
     tolerance_(10),
     lastSize_(0),
-    maxNonThreadedWorkMs_(5)
+    maxNonThreadedWorkMs_(5),
+    nextQueue_(0)
 {
+    // The main thread queue always exists, so that work can be completed also without worker threads
+    queues_.Push(SharedPtr<WorkerQueue>(new WorkerQueue()));
+
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -94,6 +122,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // Create all queues before any thread starts, as the threads steal from each other's queues
+    for (unsigned i = 0; i < numThreads; ++i)
+        queues_.Push(SharedPtr<WorkerQueue>(new WorkerQueue()));
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -123,6 +155,11 @@ SharedPtr<WorkItem> WorkQueue::GetFreeItem()
 }
 
 void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
+{
+    AddWorkItem(item, PODVector<WorkItem*>());
+}
+
+void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item, const PODVector<WorkItem*>& dependencies)
 {
     if (!item)
     {
@@ -137,37 +174,46 @@ void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
+    item->dependentsReleased_ = false;
+    item->dependents_.Clear();
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
-
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
+    if (!dependencies.Empty())
     {
-        bool inserted = false;
+        // Hold one extra count while registering, so that dependencies completing meanwhile can not queue the item early
+        item->pendingDependencies_ = dependencies.Size() + 1;
+        unsigned alreadyCompleted = 1;
 
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
+        for (PODVector<WorkItem*>::ConstIterator i = dependencies.Begin(); i != dependencies.End(); ++i)
         {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                inserted = true;
-                break;
-            }
+            WorkItem* dependency = *i;
+            MutexLock lock(dependency->dependencyMutex_);
+            if (dependency->dependentsReleased_)
+                ++alreadyCompleted;
+            else
+                dependency->dependents_.Push(item);
         }
 
-        if (!inserted)
-            queue_.Push(item);
+        MutexLock lock(item->dependencyMutex_);
+        item->pendingDependencies_ -= alreadyCompleted;
+        // Still waiting: the last dependency to complete will queue the item
+        if (item->pendingDependencies_)
+            return;
     }
+    else
+        item->pendingDependencies_ = 0;
 
+    // Distribute the items round-robin to the worker threads' own queues. Without threads, the main thread queue is used
+    unsigned queueIndex = 0;
     if (threads_.Size())
     {
-        queueMutex_.Release();
-        paused_ = false;
+        queueIndex = nextQueue_ % threads_.Size() + 1;
+        ++nextQueue_;
     }
+
+    QueueItem(item, queueIndex);
+
+    if (threads_.Size())
+        Resume();
 }
 
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
@@ -175,44 +221,44 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
     if (!item)
         return false;
 
-    MutexLock lock(queueMutex_);
+    List<SharedPtr<WorkItem> >::Iterator k = workItems_.Find(item);
+    if (k == workItems_.End())
+        return false;
 
     // Can only remove successfully if the item was not yet taken by threads for execution
-    List<WorkItem*>::Iterator i = queue_.Find(item.Get());
-    if (i != queue_.End())
+    bool removed = false;
+    for (unsigned i = 0; i < queues_.Size() && !removed; ++i)
     {
-        List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
-        if (j != workItems_.End())
+        WorkerQueue* queue = queues_[i];
+        MutexLock lock(queue->mutex_);
+
+        List<WorkItem*>::Iterator j = queue->items_.Find(item.Get());
+        if (j != queue->items_.End())
         {
-            queue_.Erase(i);
-            ReturnToPool(item);
-            workItems_.Erase(j);
-            return true;
+            queue->items_.Erase(j);
+            --queue->numItems_;
+            removed = true;
         }
     }
 
-    return false;
+    if (!removed)
+        return false;
+
+    // Items waiting on the removed item must not wait forever
+    ReleaseDependents(item, 0);
+    ReturnToPool(*k);
+    workItems_.Erase(k);
+    return true;
 }
 
 unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
     for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
     {
-        List<WorkItem*>::Iterator j = queue_.Find(i->Get());
-        if (j != queue_.End())
-        {
-            List<SharedPtr<WorkItem> >::Iterator k = workItems_.Find(*i);
-            if (k != workItems_.End())
-            {
-                queue_.Erase(j);
-                ReturnToPool(*k);
-                workItems_.Erase(k);
-                ++removed;
-            }
-        }
+        if (RemoveWorkItem(*i))
+            ++removed;
     }
 
     return removed;
@@ -224,7 +270,7 @@ void WorkQueue::Pause()
     {
         pausing_ = true;
 
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
 
         pausing_ = false;
@@ -235,7 +281,7 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
+        pauseMutex_.Release();
         paused_ = false;
     }
 }
@@ -249,47 +295,66 @@ void WorkQueue::Complete(unsigned priority)
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
-        {
-            queueMutex_.Acquire();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
-                break;
-            }
-        }
-
-        // Wait for threaded work to complete
+        // Take work items also in the main thread until no high-priority items anymore, then wait for threaded work to complete
         while (!IsCompleted(priority))
         {
+            WorkItem* item = PopItem(0, priority);
+            if (item)
+                ExecuteItem(item, 0);
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (!HasQueuedItems())
             Pause();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
+        while (WorkItem* item = PopItem(0, priority))
+            ExecuteItem(item, 0);
+    }
+
+    PurgeCompleted(priority);
+    completing_ = false;
+}
+
+void WorkQueue::Complete(const Vector<SharedPtr<WorkItem> >& items)
+{
+    if (items.Empty())
+        return;
+
+    unsigned priority = M_MAX_UNSIGNED;
+    for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
+        priority = Min(priority, (*i)->priority_);
+
+    completing_ = true;
+
+    if (threads_.Size())
+        Resume();
+
+    while (!IsCompleted(items))
+    {
+        WorkItem* item = PopItem(0, priority);
+        if (item)
+            ExecuteItem(item, 0);
+        else if (threads_.Empty())
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            URHO3D_LOGERROR("Work item group can not be completed, as some of its items were not queued");
+            break;
         }
     }
 
-    PurgeCompleted(priority);
+    if (threads_.Size() && !HasQueuedItems())
+        Pause();
+
+    // Purge only the group's own items, as other groups may still be waiting on theirs
+    for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
+    {
+        List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(*i);
+        if (j != workItems_.End() && (*j)->completed_)
+            PurgeItem(j);
+    }
+
     completing_ = false;
 }
 
@@ -304,41 +369,175 @@ bool WorkQueue::IsCompleted(unsigned priority) const
     return true;
 }
 
-void WorkQueue::ProcessItems(unsigned threadIndex)
+unsigned WorkQueue::GetThreadIndex() const
+{
+    if (Thread::IsMainThread())
+        return 0;
+
+    ThreadID id = Thread::GetCurrentThreadID();
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+    {
+        if (threads_[i]->GetThreadID() == id)
+            return threads_[i]->GetIndex();
+    }
+
+    return 0;
+}
+
+bool WorkQueue::IsCompleted(const Vector<SharedPtr<WorkItem> >& items) const
 {
-    bool wasActive = false;
+    for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
+    {
+        if (!(*i)->completed_)
+            return false;
+    }
+
+    return true;
+}
 
+void WorkQueue::ProcessItems(unsigned threadIndex)
+{
     for (;;)
     {
         if (shutDown_)
             return;
 
-        if (pausing_ && !wasActive)
+        if (pausing_)
             Time::Sleep(0);
+        else if (paused_)
+        {
+            // Block until the main thread resumes the workers
+            pauseMutex_.Acquire();
+            pauseMutex_.Release();
+        }
         else
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty())
-            {
-                wasActive = true;
-
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
-            }
+            WorkItem* item = PopItem(threadIndex, 0);
+            if (item)
+                ExecuteItem(item, threadIndex);
             else
-            {
-                wasActive = false;
-
-                queueMutex_.Release();
                 Time::Sleep(0);
-            }
         }
     }
 }
 
+void WorkQueue::QueueItem(WorkItem* item, unsigned queueIndex)
+{
+    WorkerQueue* queue = queues_[queueIndex];
+    MutexLock lock(queue->mutex_);
+
+    ++queue->numItems_;
+
+    // Find position for new item
+    List<WorkItem*>& items = queue->items_;
+    for (List<WorkItem*>::Iterator i = items.Begin(); i != items.End(); ++i)
+    {
+        if ((*i)->priority_ <= item->priority_)
+        {
+            items.Insert(i, item);
+            return;
+        }
+    }
+
+    items.Push(item);
+}
+
+WorkItem* WorkQueue::PopItem(unsigned threadIndex, unsigned priority)
+{
+    unsigned numQueues = queues_.Size();
+
+    for (unsigned i = 0; i < numQueues; ++i)
+    {
+        WorkerQueue* queue = queues_[(threadIndex + i) % numQueues];
+        // Peek at the item count without locking first, to not disturb the owner of an empty queue
+        if (!queue->numItems_)
+            continue;
+
+        // Always wait for the own queue, but skip a busy queue when stealing
+        if (!i)
+            queue->mutex_.Acquire();
+        else if (!queue->mutex_.TryAcquire())
+            continue;
+
+        if (!queue->items_.Empty() && queue->items_.Front()->priority_ >= priority)
+        {
+            WorkItem* item = queue->items_.Front();
+            queue->items_.PopFront();
+            --queue->numItems_;
+            queue->mutex_.Release();
+            return item;
+        }
+
+        queue->mutex_.Release();
+    }
+
+    return 0;
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    {
+        URHO3D_PROFILE(ExecuteWorkItem);
+        item->workFunction_(item, threadIndex);
+    }
+
+    ReleaseDependents(item, threadIndex);
+}
+
+void WorkQueue::ReleaseDependents(WorkItem* item, unsigned threadIndex)
+{
+    PODVector<WorkItem*> dependents;
+
+    {
+        MutexLock lock(item->dependencyMutex_);
+        // No more dependents can be registered after this
+        item->dependentsReleased_ = true;
+        dependents.Swap(item->dependents_);
+    }
+
+    bool queued = false;
+    for (PODVector<WorkItem*>::Iterator i = dependents.Begin(); i != dependents.End(); ++i)
+    {
+        WorkItem* dependent = *i;
+        bool ready;
+        {
+            MutexLock lock(dependent->dependencyMutex_);
+            ready = --dependent->pendingDependencies_ == 0;
+        }
+
+        // Queue to the completing thread for cache locality. Other threads will steal it if this thread is busy
+        if (ready)
+        {
+            QueueItem(dependent, threadIndex);
+            queued = true;
+        }
+    }
+
+    // Resume the workers like AddWorkItem() does. Only the main thread holds the pause mutex, so a worker thread leaves the
+    // resuming to the main thread at the next frame, in case the workers have been paused meanwhile
+    if (queued && threads_.Size())
+    {
+        if (Thread::IsMainThread())
+            Resume();
+        else
+            dependentsQueued_ = true;
+    }
+
+    // Mark completed only now, as the item may be destroyed by its owner as soon as it sees the flag
+    item->completed_ = true;
+}
+
+bool WorkQueue::HasQueuedItems() const
+{
+    for (unsigned i = 0; i < queues_.Size(); ++i)
+    {
+        if (queues_[i]->numItems_)
+            return true;
+    }
+
+    return false;
+}
+
 void WorkQueue::PurgeCompleted(unsigned priority)
 {
     // Purge completed work items and send completion events. Do not signal items lower than priority threshold,
@@ -347,24 +546,27 @@ void WorkQueue::PurgeCompleted(unsigned priority)
     for (List<SharedPtr<WorkItem> >::Iterator i = workItems_.Begin(); i != workItems_.End();)
     {
         if ((*i)->completed_ && (*i)->priority_ >= priority)
-        {
-            if ((*i)->sendEvent_)
-            {
-                using namespace WorkItemCompleted;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_ITEM] = i->Get();
-                SendEvent(E_WORKITEMCOMPLETED, eventData);
-            }
-
-            ReturnToPool(*i);
-            i = workItems_.Erase(i);
-        }
+            i = PurgeItem(i);
         else
             ++i;
     }
 }
 
+List<SharedPtr<WorkItem> >::Iterator WorkQueue::PurgeItem(List<SharedPtr<WorkItem> >::Iterator i)
+{
+    if ((*i)->sendEvent_)
+    {
+        using namespace WorkItemCompleted;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_ITEM] = i->Get();
+        SendEvent(E_WORKITEMCOMPLETED, eventData);
+    }
+
+    ReturnToPool(*i);
+    return workItems_.Erase(i);
+}
+
 void WorkQueue::PurgePool()
 {
     unsigned currentSize = poolItems_.Size();
@@ -393,6 +595,9 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->priority_ = M_MAX_UNSIGNED;
         item->sendEvent_ = false;
         item->completed_ = false;
+        item->pendingDependencies_ = 0;
+        item->dependentsReleased_ = false;
+        item->dependents_.Clear();
 
         poolItems_.Push(item);
     }
@@ -401,24 +606,79 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && HasQueuedItems())
     {
         URHO3D_PROFILE(CompleteWorkNonthreaded);
 
         HiresTimer timer;
 
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = PopItem(0, 0);
+            if (!item)
+                break;
+            ExecuteItem(item, 0);
         }
     }
 
+    // Resume the workers if dependent items were released in a worker thread, possibly while paused
+    if (dependentsQueued_)
+    {
+        dependentsQueued_ = false;
+        if (HasQueuedItems())
+            Resume();
+    }
+
     // Complete and signal items down to the lowest priority
     PurgeCompleted(0);
     PurgePool();
 }
 
+TaskGroup::TaskGroup(WorkQueue* queue, unsigned priority) :
+    queue_(queue),
+    priority_(priority),
+    threadIndex_(queue->GetThreadIndex())
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    Wait();
+}
+
+void TaskGroup::Submit(const SharedPtr<WorkItem>& item)
+{
+    item->priority_ = priority_;
+    items_.Push(item);
+
+    // The main thread owns the work item bookkeeping. Worker threads queue nested tasks directly to their own queue
+    if (Thread::IsMainThread())
+        queue_->AddWorkItem(item);
+    else
+    {
+        item->completed_ = false;
+        queue_->QueueItem(item, threadIndex_);
+    }
+}
+
+void TaskGroup::Wait()
+{
+    if (items_.Empty())
+        return;
+
+    if (Thread::IsMainThread())
+        queue_->Complete(items_);
+    else
+    {
+        while (!queue_->IsCompleted(items_))
+        {
+            WorkItem* item = queue_->PopItem(threadIndex_, 0);
+            if (item)
+                queue_->ExecuteItem(item, threadIndex_);
+        }
+    }
+
+    items_.Clear();
+}
+
 }
@@ -36,11 +36,13 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+struct WorkerQueue;
 
 /// Work queue item.
 struct WorkItem : public RefCounted
 {
     friend class WorkQueue;
+    friend class TaskGroup;
 
 public:
     // Construct
@@ -48,7 +50,9 @@ public:
         priority_(0),
         sendEvent_(false),
         completed_(false),
-        pooled_(false)
+        pooled_(false),
+        pendingDependencies_(0),
+        dependentsReleased_(false)
     {
     }
 
@@ -69,6 +73,14 @@ public:
 
 private:
     bool pooled_;
+    /// Number of dependencies that have not yet completed. The item is queued for execution once this reaches zero.
+    unsigned pendingDependencies_;
+    /// Items waiting for this item to complete.
+    PODVector<WorkItem*> dependents_;
+    /// Whether the waiting items have already been released. After this no more dependents can be added.
+    bool dependentsReleased_;
+    /// Mutex for the dependency bookkeeping.
+    Mutex dependencyMutex_;
 };
 
 /// Work queue subsystem for multithreading.
@@ -77,6 +89,7 @@ class URHO3D_API WorkQueue : public Object
     URHO3D_OBJECT(WorkQueue, Object);
 
     friend class WorkerThread;
+    friend class TaskGroup;
 
 public:
     /// Construct.
@@ -90,16 +103,20 @@ public:
     SharedPtr<WorkItem> GetFreeItem();
     /// Add a work item and resume worker threads.
     void AddWorkItem(SharedPtr<WorkItem> item);
+    /// Add a work item which may only start once all the dependencies have completed. The dependencies must already have been added to the queue and not yet purged.
+    void AddWorkItem(SharedPtr<WorkItem> item, const PODVector<WorkItem*>& dependencies);
     /// Remove a work item before it has started executing. Return true if successfully removed.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items);
-    /// Pause worker threads.
+    /// Pause worker threads. Adding a work item resumes them, as does an item whose dependencies complete. When the last dependency completes in a worker thread, the workers are resumed at the next frame.
     void Pause();
     /// Resume worker threads.
     void Resume();
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
+    /// Finish a group of work items. Main thread will also execute queued work which has at least the priority of the group's least important item.
+    void Complete(const Vector<SharedPtr<WorkItem> >& items);
 
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
@@ -107,11 +124,18 @@ public:
     /// Set how many milliseconds maximum per frame to spend on low-priority work, when there are no worker threads.
     void SetNonThreadedWorkMs(int ms) { maxNonThreadedWorkMs_ = Max(ms, 1); }
 
+    /// Call a functor for the index range [begin, end) split into chunks of at least grainSize, one chunk per thread. The functor is called as functor(chunkBegin, chunkEnd, threadIndex) from several threads at once. Can also be called from within a work function.
+    template <class T> void ParallelFor(unsigned begin, unsigned end, unsigned grainSize, const T& functor);
+
     /// Return number of worker threads.
     unsigned GetNumThreads() const { return threads_.Size(); }
+    /// Return the calling thread's index, 0 for the main thread or any thread not owned by the work queue.
+    unsigned GetThreadIndex() const;
 
     /// Return whether all work with at least the specified priority is finished.
     bool IsCompleted(unsigned priority) const;
+    /// Return whether all work items of a group are finished.
+    bool IsCompleted(const Vector<SharedPtr<WorkItem> >& items) const;
     /// Return whether the queue is currently completing work in the main thread.
     bool IsCompleting() const { return completing_; }
 
@@ -124,8 +148,20 @@ public:
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Insert a work item into a thread's queue according to its priority.
+    void QueueItem(WorkItem* item, unsigned queueIndex);
+    /// Take a work item which has at least the specified priority, first from the thread's own queue, then by stealing from the other threads' queues. Return null if none found.
+    WorkItem* PopItem(unsigned threadIndex, unsigned priority);
+    /// Execute a work item, mark it completed and queue any dependent items that became ready.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Decrement the dependency count of the items waiting on a work item and queue the ones that became ready.
+    void ReleaseDependents(WorkItem* item, unsigned threadIndex);
+    /// Return whether any thread's queue has work items.
+    bool HasQueuedItems() const;
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
+    /// Purge a completed work item and send its completion event if necessary. Return iterator to the next item.
+    List<SharedPtr<WorkItem> >::Iterator PurgeItem(List<SharedPtr<WorkItem> >::Iterator i);
     /// Purge the pool to reduce allocation where its unneeded.
     void PurgePool();
     /// Return a work item to the pool.
@@ -139,16 +175,18 @@ private:
     List<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
-    List<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Per-thread prioritized work item queues, index 0 belonging to the main thread. Pointers are guaranteed to be valid (point to workItems.)
+    Vector<SharedPtr<WorkerQueue> > queues_;
+    /// Mutex held by the main thread while the worker threads are paused.
+    Mutex pauseMutex_;
     /// Shutting down flag.
     volatile bool shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
+    /// Pausing flag. Indicates the worker threads should not contend for the pause mutex.
     volatile bool pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag. Indicates the pause mutex being locked to prevent worker threads using up CPU time.
+    volatile bool paused_;
+    /// Flag for dependent items having been queued by a worker thread, which can not resume the workers by itself.
+    volatile bool dependentsQueued_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -157,6 +195,114 @@ private:
     unsigned lastSize_;
     /// Maximum milliseconds per frame to spend on low-priority work, when there are no worker threads.
     int maxNonThreadedWorkMs_;
+    /// Next worker thread queue to distribute submitted work items to.
+    unsigned nextQueue_;
+};
+
+/// Work item which owns a copy of a functor and calls it with the thread index.
+template <class T> struct FunctorWorkItem : public WorkItem
+{
+    /// Construct.
+    FunctorWorkItem(const T& functor) :
+        functor_(functor)
+    {
+        workFunction_ = Execute;
+    }
+
+    /// Work function.
+    static void Execute(const WorkItem* item, unsigned threadIndex)
+    {
+        static_cast<const FunctorWorkItem<T>*>(item)->functor_(threadIndex);
+    }
+
+    /// Functor.
+    mutable T functor_;
+};
+
+/// Functor adapter which calls a range functor for one chunk of a parallel for.
+template <class T> struct ParallelForChunk
+{
+    /// Construct.
+    ParallelForChunk(const T& functor, unsigned begin, unsigned end) :
+        functor_(functor),
+        begin_(begin),
+        end_(end)
+    {
+    }
+
+    /// Call the range functor for the chunk.
+    void operator ()(unsigned threadIndex) const { functor_(begin_, end_, threadIndex); }
+
+    /// Range functor.
+    const T& functor_;
+    /// Chunk start index.
+    unsigned begin_;
+    /// Chunk end index.
+    unsigned end_;
 };
 
+/// Group of tasks that are waited on together. Can be used both from the main thread and from within work functions, in which case the tasks are queued to the calling worker thread and it helps to execute queued work while waiting.
+class URHO3D_API TaskGroup
+{
+public:
+    /// Construct. The priority applies only to tasks run from the main thread.
+    TaskGroup(WorkQueue* queue, unsigned priority = M_MAX_UNSIGNED);
+    /// Destruct. Wait for the remaining tasks to complete.
+    ~TaskGroup();
+
+    /// Run a task. The functor is copied and called as functor(threadIndex).
+    template <class T> void Run(const T& functor) { Submit(SharedPtr<WorkItem>(new FunctorWorkItem<T>(functor))); }
+    /// Wait for all tasks to complete. The calling thread executes queued work while waiting.
+    void Wait();
+
+    /// Return the work queue.
+    WorkQueue* GetWorkQueue() const { return queue_; }
+    /// Return index of the thread that created the group.
+    unsigned GetThreadIndex() const { return threadIndex_; }
+    /// Return number of tasks that have not been waited on yet.
+    unsigned GetNumTasks() const { return items_.Size(); }
+
+private:
+    /// Prevent copy construction.
+    TaskGroup(const TaskGroup& rhs);
+    /// Prevent assignment.
+    TaskGroup& operator =(const TaskGroup& rhs);
+
+    /// Queue a work item to the creating thread.
+    void Submit(const SharedPtr<WorkItem>& item);
+
+    /// Work queue.
+    WorkQueue* queue_;
+    /// Tasks not yet waited on.
+    Vector<SharedPtr<WorkItem> > items_;
+    /// Priority of the tasks.
+    unsigned priority_;
+    /// Index of the creating thread.
+    unsigned threadIndex_;
+};
+
+template <class T> void WorkQueue::ParallelFor(unsigned begin, unsigned end, unsigned grainSize, const T& functor)
+{
+    if (begin >= end)
+        return;
+
+    // One chunk for each worker thread and the calling thread, but not smaller than the grain size
+    unsigned count = end - begin;
+    unsigned numChunks = threads_.Size() + 1;
+    unsigned chunkSize = Max((count + numChunks - 1) / numChunks, Max(grainSize, 1U));
+    if (chunkSize >= count)
+    {
+        functor(begin, end, GetThreadIndex());
+        return;
+    }
+
+    TaskGroup group(this);
+    for (unsigned chunkBegin = begin + chunkSize; chunkBegin < end; chunkBegin += chunkSize)
+        group.Run(ParallelForChunk<T>(functor, chunkBegin, Min(chunkBegin + chunkSize, end)));
+
+    // Process the first chunk in the calling thread while the others run
+    functor(begin, begin + chunkSize, group.GetThreadIndex());
+    group.Wait();
+}
+
 }
@@ -312,6 +312,9 @@ bool Engine::Initialize(const VariantMap& parameters)
         context_->RegisterSubsystem(new EventProfiler(context_));
         EventProfiler::SetActive(true);
     }
+
+    if (HasParameter(parameters, EP_PROFILER_CAPTURE))
+        GetSubsystem<Profiler>()->BeginCapture(GetParameter(parameters, EP_PROFILER_CAPTURE).GetUInt(), "ProfilerCapture.json");
 #endif
     frameTimer_.Reset();
 
@@ -688,14 +691,19 @@ void Engine::Update()
     URHO3D_PROFILE(Update);
 
     // Logic update event
-    using namespace Update;
+    UpdateEventData update;
+    update.timeStep_ = timeStep_;
+    SendTypedEvent(update);
+
+    // Logic post-update event
+    PostUpdateEventData postUpdate;
+    postUpdate.timeStep_ = timeStep_;
+    SendTypedEvent(postUpdate);
+
+    using namespace RenderUpdate;
 
     VariantMap& eventData = GetEventDataMap();
     eventData[P_TIMESTEP] = timeStep_;
-    SendEvent(E_UPDATE, eventData);
-
-    // Logic post-update event
-    SendEvent(E_POSTUPDATE, eventData);
 
     // Rendering update event
     SendEvent(E_RENDERUPDATE, eventData);
@@ -925,6 +933,11 @@ VariantMap Engine::ParseParameters(const Vector<String>& arguments)
                 ret[EP_DUMP_SHADERS] = value;
                 ++i;
             }
+            else if (argument == "profilecapture" && !value.Empty())
+            {
+                ret[EP_PROFILER_CAPTURE] = ToUInt(value);
+                ++i;
+            }
             else if (argument == "mq" && !value.Empty())
             {
                 ret[EP_MATERIAL_QUALITY] = ToInt(value);
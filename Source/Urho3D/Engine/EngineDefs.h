@@ -46,6 +46,7 @@ static const String EP_MONITOR = "Monitor";
 static const String EP_MULTI_SAMPLE = "MultiSample";
 static const String EP_ORIENTATIONS = "Orientations";
 static const String EP_PACKAGE_CACHE_DIR = "PackageCacheDir";
+static const String EP_PROFILER_CAPTURE = "ProfilerCapture";
 static const String EP_RENDER_PATH = "RenderPath";
 static const String EP_REFRESH_RATE = "RefreshRate";
 static const String EP_RESOURCE_PACKAGES = "ResourcePackages";
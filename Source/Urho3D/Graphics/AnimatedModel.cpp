@@ -76,6 +76,8 @@ AnimatedModel::AnimatedModel(Context* context) :
     animationLodTimer_(-1.0f),
     animationLodDistance_(0.0f),
     updateInvisible_(false),
+    animationLodInterpolation_(false),
+    headlessMorphs_(false),
     animationDirty_(false),
     animationOrderDirty_(false),
     morphsDirty_(false),
@@ -116,6 +118,8 @@ void AnimatedModel::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Animation LOD Bias", GetAnimationLodBias, SetAnimationLodBias, float, 1.0f, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Animation LOD Interpolation", GetAnimationLodInterpolation, SetAnimationLodInterpolation, bool,
+        false, AM_DEFAULT);
     URHO3D_COPY_BASE_ATTRIBUTES(Drawable);
     URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Bone Animation Enabled", GetBonesEnabledAttr, SetBonesEnabledAttr, VariantVector,
         Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
@@ -240,6 +244,7 @@ void AnimatedModel::Update(const FrameInfo& frame)
             {
                 animationLodTimer_ = -1.0f;
                 forceAnimationUpdate_ = true;
+                lodPoses_.Clear();
             }
             return;
         }
@@ -257,6 +262,21 @@ void AnimatedModel::Update(const FrameInfo& frame)
         UpdateBoneBoundingBox();
 }
 
+bool AnimatedModel::IsUpdateDeferrable(const FrameInfo& frame) const
+{
+    // Only an animation update of a model that has been animated before can be postponed. Do not count updates that
+    // would return early due to invisibility or the animation LOD timer against the budget
+    if (!isMaster_ || !animationDirty_ || animationOrderDirty_ || forceAnimationUpdate_ || animationLodTimer_ < 0.0f)
+        return false;
+    if (frame.camera_ && abs((int)frame.frameNumber_ - (int)viewFrameNumber_) > 1 && !updateInvisible_)
+        return false;
+    if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f && animationLodTimer_ + animationLodBias_ *
+        frame.timeStep_ * ANIMATION_LOD_BASESCALE < animationLodDistance_)
+        return false;
+
+    return true;
+}
+
 void AnimatedModel::UpdateBatches(const FrameInfo& frame)
 {
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
@@ -397,6 +417,7 @@ void AnimatedModel::SetModel(Model* model, bool createBones)
 
         // Reserve space for skinning matrices
         skinMatrices_.Resize(skeleton_.GetNumBones());
+        lodPoses_.Clear();
         SetGeometryBoneMappings();
 
         // Enable skinning in batches
@@ -543,6 +564,14 @@ void AnimatedModel::SetAnimationLodBias(float bias)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetAnimationLodInterpolation(bool enable)
+{
+    animationLodInterpolation_ = enable;
+    lodPoses_.Clear();
+    skinningDirty_ = true;
+    MarkNetworkUpdate();
+}
+
 void AnimatedModel::SetUpdateInvisible(bool enable)
 {
     updateInvisible_ = enable;
@@ -717,9 +746,11 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
                     // If compatible, just copy the values and retain the old node and animated status
                     Node* boneNode = destBones[i].node_;
                     bool animated = destBones[i].animated_;
+                    float animationLodDistance = destBones[i].animationLodDistance_;
                     destBones[i] = srcBones[i];
                     destBones[i].node_ = boneNode;
                     destBones[i].animated_ = animated;
+                    destBones[i].animationLodDistance_ = animationLodDistance;
                 }
                 else
                 {
@@ -1265,11 +1296,23 @@ void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
             if (animationLodTimer_ >= animationLodDistance_)
                 animationLodTimer_ = fmodf(animationLodTimer_, animationLodDistance_);
             else
+            {
+                // Advance the skinning towards the last animation update meanwhile
+                if (!lodPoses_.Empty())
+                    skinningDirty_ = true;
                 return;
+            }
         }
         else
-            animationLodTimer_ = 0.0f;
+        {
+            // Stagger the following updates by component ID so that models entering view at the same time do not
+            // update on the same frames
+            float phase = (float)((GetID() * 2654435761U) >> 16) / 65536.0f;
+            animationLodTimer_ = phase * animationLodDistance_;
+        }
     }
+    else if (animationLodTimer_ < 0.0f)
+        animationLodTimer_ = 0.0f;
 
     ApplyAnimation();
 }
@@ -1291,11 +1334,21 @@ void AnimatedModel::ApplyAnimation()
         for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
             (*i)->Apply();
 
-        // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
-        node_->MarkDirty();
+        // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now,
+        // starting from the root bones: the model's own node did not move, so its listeners need not be notified. This runs
+        // in worker threads during the octree update, and the bone listeners are either drawables or defer their work
+        const Vector<Bone>& bones = skeleton_.GetBones();
+        for (unsigned i = 0; i < bones.Size(); ++i)
+        {
+            if (bones[i].parentIndex_ == i && bones[i].node_)
+                bones[i].node_->MarkDirty();
+        }
 
         // Calculate new bone bounding box
         UpdateBoneBoundingBox();
+
+        if (animationLodInterpolation_)
+            StoreLodPose();
     }
 
     animationDirty_ = false;
@@ -1308,8 +1361,35 @@ void AnimatedModel::UpdateSkinning()
     // Use model's world transform in case a bone is missing
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
 
+    // Interpolate between the model-space bone transforms of the last two animation updates, by the progress of the animation
+    // LOD timer towards the next update. Rotations are interpolated as quaternions, so that the bones stay rigid
+    if (!lodPoses_.Empty() && lodPoses_.Size() == bones.Size() * 2)
+    {
+        float t = animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f ?
+            Clamp(animationLodTimer_ / animationLodDistance_, 0.0f, 1.0f) : 1.0f;
+        const AnimationLodPose* previous = &lodPoses_[0];
+        const AnimationLodPose* current = &lodPoses_[bones.Size()];
+
+        for (unsigned i = 0; i < bones.Size(); ++i)
+        {
+            if (bones[i].node_)
+            {
+                Matrix3x4 boneTransform(previous[i].position_.Lerp(current[i].position_, t),
+                    previous[i].rotation_.Nlerp(current[i].rotation_, t, true), previous[i].scale_.Lerp(current[i].scale_, t));
+                skinMatrices_[i] = worldTransform * boneTransform * bones[i].offsetMatrix_;
+            }
+            else
+                skinMatrices_[i] = worldTransform;
+
+            if (geometrySkinMatrices_.Size())
+            {
+                for (unsigned j = 0; j < geometrySkinMatrixPtrs_[i].Size(); ++j)
+                    *geometrySkinMatrixPtrs_[i][j] = skinMatrices_[i];
+            }
+        }
+    }
     // Skinning with global matrices only
-    if (!geometrySkinMatrices_.Size())
+    else if (!geometrySkinMatrices_.Size())
     {
         for (unsigned i = 0; i < bones.Size(); ++i)
         {
@@ -1340,10 +1420,38 @@ void AnimatedModel::UpdateSkinning()
     skinningDirty_ = false;
 }
 
+void AnimatedModel::StoreLodPose()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    Matrix3x4 inverseWorldTransform = node_->GetWorldTransform().Inverse();
+    unsigned numBones = bones.Size();
+
+    // The first update fills both poses. Afterward the last pose becomes the previous
+    bool valid = lodPoses_.Size() == numBones * 2;
+    lodPoses_.Resize(numBones * 2);
+    if (valid)
+    {
+        for (unsigned i = 0; i < numBones; ++i)
+            lodPoses_[i] = lodPoses_[numBones + i];
+    }
+
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        const Bone& bone = bones[i];
+        AnimationLodPose& pose = lodPoses_[numBones + i];
+        if (bone.node_)
+            (inverseWorldTransform * bone.node_->GetWorldTransform()).Decompose(pose.position_, pose.rotation_, pose.scale_);
+        if (!valid)
+            lodPoses_[i] = pose;
+    }
+
+    skinningDirty_ = true;
+}
+
 void AnimatedModel::UpdateMorphs()
 {
-    Graphics* graphics = GetSubsystem<Graphics>();
-    if (!graphics)
+    // Morph vertex buffers are always shadowed, so morphs can be applied also in headless mode, but only do so if requested
+    if (!headlessMorphs_ && !GetSubsystem<Graphics>())
         return;
 
     if (morphs_.Size())
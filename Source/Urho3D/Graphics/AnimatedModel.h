@@ -32,6 +32,17 @@ namespace Urho3D
 class Animation;
 class AnimationState;
 
+/// Model-space bone transform stored for animation LOD interpolation.
+struct AnimationLodPose
+{
+    /// Position.
+    Vector3 position_;
+    /// Rotation.
+    Quaternion rotation_;
+    /// Scale.
+    Vector3 scale_;
+};
+
 /// Animated model component.
 class URHO3D_API AnimatedModel : public StaticModel
 {
@@ -59,6 +70,8 @@ public:
     virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results);
     /// Update before octree reinsertion. Is called from a worker thread.
     virtual void Update(const FrameInfo& frame);
+    /// Return whether the update evaluates animation and can be postponed when the octree update budget is exceeded.
+    virtual bool IsUpdateDeferrable(const FrameInfo& frame) const;
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     virtual void UpdateBatches(const FrameInfo& frame);
     /// Prepare geometry for rendering. Called from a worker thread if possible (no GPU update.)
@@ -86,8 +99,12 @@ public:
     void RemoveAllAnimationStates();
     /// Set animation LOD bias.
     void SetAnimationLodBias(float bias);
+    /// Set whether to interpolate the skinning between animation updates that are skipped due to animation LOD. Trades one update interval of latency for smooth motion.
+    void SetAnimationLodInterpolation(bool enable);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
+    /// Set whether to apply vertex morphs also when there is no Graphics subsystem, for example for CPU-side vertex data access on a headless server. Default false.
+    void SetHeadlessMorphs(bool enable) { headlessMorphs_ = enable; }
     /// Set vertex morph weight by index.
     void SetMorphWeight(unsigned index, float weight);
     /// Set vertex morph weight by name.
@@ -120,6 +137,15 @@ public:
     /// Return animation LOD bias.
     float GetAnimationLodBias() const { return animationLodBias_; }
 
+    /// Return whether to interpolate the skinning between animation updates skipped due to animation LOD.
+    bool GetAnimationLodInterpolation() const { return animationLodInterpolation_; }
+
+    /// Return whether vertex morphs are applied also when there is no Graphics subsystem.
+    bool GetHeadlessMorphs() const { return headlessMorphs_; }
+
+    /// Return animation LOD distance, the minimum of all LOD view distances last frame.
+    float GetAnimationLodDistance() const { return animationLodDistance_; }
+
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
@@ -201,6 +227,8 @@ private:
     void UpdateAnimation(const FrameInfo& frame);
     /// Recalculate skinning.
     void UpdateSkinning();
+    /// Store the model-space skinning pose after an animation update for interpolation.
+    void StoreLodPose();
     /// Reapply all vertex morphs.
     void UpdateMorphs();
     /// Apply a vertex morph.
@@ -225,6 +253,8 @@ private:
     Vector<PODVector<Matrix3x4> > geometrySkinMatrices_;
     /// Subgeometry skinning matrix pointers, if more bones than skinning shader can manage.
     Vector<PODVector<Matrix3x4*> > geometrySkinMatrixPtrs_;
+    /// Model-space bone transforms of the previous and the last animation update, used for animation LOD interpolation.
+    PODVector<AnimationLodPose> lodPoses_;
     /// Bounding box calculated from bones.
     BoundingBox boneBoundingBox_;
     /// Attribute buffer.
@@ -241,6 +271,10 @@ private:
     float animationLodDistance_;
     /// Update animation when invisible flag.
     bool updateInvisible_;
+    /// Animation LOD interpolation flag.
+    bool animationLodInterpolation_;
+    /// Apply vertex morphs without Graphics subsystem flag.
+    bool headlessMorphs_;
     /// Animation dirty flag.
     bool animationDirty_;
     /// Animation order dirty flag.
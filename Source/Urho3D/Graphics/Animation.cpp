@@ -34,6 +34,10 @@
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -49,6 +53,216 @@ inline bool CompareKeyFrames(AnimationKeyFrame& lhs, AnimationKeyFrame& rhs)
     return lhs.time_ < rhs.time_;
 }
 
+static const float ROTATION_QUANTIZE_SCALE = 32767.0f;
+
+/// Sample a track's keyframes at time position. After the last keyframe, either hold it, or when looped, interpolate back towards the first keyframe like AnimationState does.
+static void SampleKeyFrames(const AnimationTrack& track, float time, float length, bool looped, unsigned& index, Vector3& position,
+    Quaternion& rotation, Vector3& scale)
+{
+    track.GetKeyFrameIndex(time, index);
+    const AnimationKeyFrame& keyFrame = track.keyFrames_[index];
+    position = keyFrame.position_;
+    rotation = keyFrame.rotation_;
+    scale = keyFrame.scale_;
+
+    unsigned nextIndex = index + 1;
+    if (nextIndex >= track.keyFrames_.Size())
+    {
+        if (!looped || track.keyFrames_.Size() < 2)
+            return;
+        nextIndex = 0;
+    }
+
+    const AnimationKeyFrame& nextKeyFrame = track.keyFrames_[nextIndex];
+    float timeInterval = nextKeyFrame.time_ - keyFrame.time_;
+    if (timeInterval < 0.0f)
+        timeInterval += length;
+    float t = timeInterval > 0.0f ? Clamp((time - keyFrame.time_) / timeInterval, 0.0f, 1.0f) : 1.0f;
+    position = position.Lerp(nextKeyFrame.position_, t);
+    rotation = rotation.Slerp(nextKeyFrame.rotation_, t);
+    scale = scale.Lerp(nextKeyFrame.scale_, t);
+}
+
+static inline short QuantizeRotation(float value)
+{
+    return (short)Clamp(RoundToInt(value * ROTATION_QUANTIZE_SCALE), -32767, 32767);
+}
+
+/// Allocate compiled component arrays for the channels in use and fill them with identity transforms, which remain in the padding and in tracks without keyframes.
+static void InitializeCompiledFrames(PODVector<float>& positions, PODVector<short>& rotations, PODVector<float>& scales,
+    unsigned char channelMask, unsigned numFrames, unsigned stride)
+{
+    if (channelMask & CHANNEL_POSITION)
+    {
+        positions.Resize(numFrames * 3 * stride);
+        for (unsigned i = 0; i < positions.Size(); ++i)
+            positions[i] = 0.0f;
+    }
+    if (channelMask & CHANNEL_ROTATION)
+    {
+        rotations.Resize(numFrames * 4 * stride);
+        for (unsigned i = 0; i < rotations.Size(); ++i)
+            rotations[i] = (i / stride) % 4 == 0 ? (short)ROTATION_QUANTIZE_SCALE : (short)0;
+    }
+    if (channelMask & CHANNEL_SCALE)
+    {
+        scales.Resize(numFrames * 3 * stride);
+        for (unsigned i = 0; i < scales.Size(); ++i)
+            scales[i] = 1.0f;
+    }
+}
+
+/// Write a track's sampled transform to a frame of the compiled component arrays. The rotation is flipped to the same hemisphere as the previous frame's, so that playback can interpolate without checking.
+static void WriteCompiledFrame(PODVector<float>& positions, PODVector<short>& rotations, PODVector<float>& scales, unsigned frame,
+    unsigned stride, unsigned track, const Vector3& position, Quaternion rotation, const Vector3& scale,
+    Quaternion& previousRotation, bool hasPrevious)
+{
+    if (!positions.Empty())
+    {
+        float* dest = &positions[frame * 3 * stride + track];
+        dest[0] = position.x_;
+        dest[stride] = position.y_;
+        dest[2 * stride] = position.z_;
+    }
+    if (!rotations.Empty())
+    {
+        rotation = rotation.Normalized();
+        if (hasPrevious && rotation.DotProduct(previousRotation) < 0.0f)
+            rotation = -rotation;
+        previousRotation = rotation;
+
+        short* dest = &rotations[frame * 4 * stride + track];
+        dest[0] = QuantizeRotation(rotation.w_);
+        dest[stride] = QuantizeRotation(rotation.x_);
+        dest[2 * stride] = QuantizeRotation(rotation.y_);
+        dest[3 * stride] = QuantizeRotation(rotation.z_);
+    }
+    if (!scales.Empty())
+    {
+        float* dest = &scales[frame * 3 * stride + track];
+        dest[0] = scale.x_;
+        dest[stride] = scale.y_;
+        dest[2 * stride] = scale.z_;
+    }
+}
+
+#ifdef URHO3D_SSE
+static inline __m128 LoadQuantized(const short* src)
+{
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+static inline void LerpComponents(const float* a, const float* b, float* dest, unsigned count, unsigned stride, float t)
+{
+    __m128 tv = _mm_set1_ps(t);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        __m128 va = _mm_loadu_ps(a + i * stride);
+        __m128 vb = _mm_loadu_ps(b + i * stride);
+        _mm_storeu_ps(dest + i * stride, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), tv)));
+    }
+}
+
+static inline void NlerpRotations(const short* a, const short* b, float* dest, unsigned stride, float t)
+{
+    __m128 tv = _mm_set1_ps(t);
+    __m128 c[4];
+    __m128 lengthSquared = _mm_setzero_ps();
+    for (unsigned j = 0; j < 4; ++j)
+    {
+        __m128 va = LoadQuantized(a + j * stride);
+        __m128 vb = LoadQuantized(b + j * stride);
+        c[j] = _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), tv));
+        lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(c[j], c[j]));
+    }
+    __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSquared));
+    for (unsigned j = 0; j < 4; ++j)
+        _mm_storeu_ps(dest + j * stride, _mm_mul_ps(c[j], invLength));
+}
+#else
+static inline void LerpComponents(const float* a, const float* b, float* dest, unsigned count, unsigned stride, float t)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        for (unsigned j = 0; j < 4; ++j)
+            dest[i * stride + j] = a[i * stride + j] + (b[i * stride + j] - a[i * stride + j]) * t;
+    }
+}
+
+static inline void NlerpRotations(const short* a, const short* b, float* dest, unsigned stride, float t)
+{
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        float c[4];
+        float lengthSquared = 0.0f;
+        for (unsigned j = 0; j < 4; ++j)
+        {
+            float va = (float)a[j * stride + i];
+            float vb = (float)b[j * stride + i];
+            c[j] = va + (vb - va) * t;
+            lengthSquared += c[j] * c[j];
+        }
+        float invLength = 1.0f / sqrtf(lengthSquared);
+        for (unsigned j = 0; j < 4; ++j)
+            dest[j * stride + i] = c[j] * invLength;
+    }
+}
+#endif
+
+void CompiledAnimation::Sample(float time, float* dest, bool looped, const unsigned char* groupMask) const
+{
+    if (!numFrames_ || !stride_)
+        return;
+
+    float frame = Clamp(time * frameRate_, 0.0f, (float)(numFrames_ - 1));
+    unsigned index = Min((unsigned)frame, numFrames_ - 1);
+    unsigned nextIndex = Min(index + 1, numFrames_ - 1);
+    float t = frame - (float)index;
+
+    // When looped, the frames from the loop frame onward come from the loop tail, which interpolates towards the first keyframes
+    bool loopTail = looped && index >= loopFrame_;
+    const PODVector<float>& positions = loopTail ? loopPositions_ : positions_;
+    const PODVector<short>& rotations = loopTail ? loopRotations_ : rotations_;
+    const PODVector<float>& scales = loopTail ? loopScales_ : scales_;
+    if (loopTail)
+    {
+        index -= loopFrame_;
+        nextIndex -= loopFrame_;
+    }
+
+    const float* positionsA = positions.Empty() ? 0 : &positions[index * 3 * stride_];
+    const float* positionsB = positions.Empty() ? 0 : &positions[nextIndex * 3 * stride_];
+    const short* rotationsA = rotations.Empty() ? 0 : &rotations[index * 4 * stride_];
+    const short* rotationsB = rotations.Empty() ? 0 : &rotations[nextIndex * 4 * stride_];
+    const float* scalesA = scales.Empty() ? 0 : &scales[index * 3 * stride_];
+    const float* scalesB = scales.Empty() ? 0 : &scales[nextIndex * 3 * stride_];
+
+    // Sample four tracks at a time, skipping the groups the mask excludes
+    for (unsigned i = 0; i < stride_; i += 4)
+    {
+        if (groupMask && !groupMask[i >> 2])
+            continue;
+
+        // Positions and scales are plain linear interpolation
+        if (positionsA)
+            LerpComponents(positionsA + i, positionsB + i, dest + i, 3, stride_, t);
+        if (scalesA)
+            LerpComponents(scalesA + i, scalesB + i, dest + 7 * stride_ + i, 3, stride_, t);
+        // Rotations are normalized linear interpolation. Compiling ensures consecutive frames are in the same hemisphere, and
+        // normalizing also removes the quantization scale
+        if (rotationsA)
+            NlerpRotations(rotationsA + i, rotationsB + i, dest + 3 * stride_ + i, stride_, t);
+    }
+}
+
+unsigned CompiledAnimation::GetMemoryUse() const
+{
+    return sizeof(CompiledAnimation) + tracks_.Size() * sizeof(const AnimationTrack*) + (positions_.Size() +
+        loopPositions_.Size() + scales_.Size() + loopScales_.Size()) * sizeof(float) + (rotations_.Size() +
+        loopRotations_.Size()) * sizeof(short);
+}
+
 void AnimationTrack::SetKeyFrame(unsigned index, const AnimationKeyFrame& keyFrame)
 {
     if (index < keyFrames_.Size())
@@ -165,9 +379,10 @@ bool Animation::BeginLoad(Deserializer& source)
         }
     }
 
-    // Optionally read triggers from an XML file
+    // Optionally read triggers and compile parameters from an XML file
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     String xmlName = ReplaceExtension(GetName(), ".xml");
+    float compileSampleRate = 0.0f;
 
     SharedPtr<XMLFile> file(cache->GetTempResource<XMLFile>(xmlName, false));
     if (file)
@@ -181,14 +396,21 @@ bool Animation::BeginLoad(Deserializer& source)
                 AddTrigger(triggerElem.GetFloat("time"), false, triggerElem.GetVariant());
         }
 
+        XMLElement compileElem = rootElem.GetChild("compile");
+        if (compileElem)
+            compileSampleRate = compileElem.HasAttribute("samplerate") ? compileElem.GetFloat("samplerate") :
+                DEFAULT_ANIMATION_SAMPLE_RATE;
+
         LoadMetadataFromXML(rootElem);
 
         memoryUse += triggers_.Size() * sizeof(AnimationTriggerPoint);
         SetMemoryUse(memoryUse);
+        if (compileSampleRate > 0.0f)
+            Compile(compileSampleRate);
         return true;
     }
 
-    // Optionally read triggers from a JSON file
+    // Optionally read triggers and compile parameters from a JSON file
     String jsonName = ReplaceExtension(GetName(), ".json");
 
     SharedPtr<JSONFile> jsonFile(cache->GetTempResource<JSONFile>(jsonName, false));
@@ -211,11 +433,20 @@ bool Animation::BeginLoad(Deserializer& source)
             }
         }
 
+        const JSONValue& compileValue = rootVal.Get("compile");
+        if (compileValue.IsObject())
+        {
+            JSONValue sampleRateValue = compileValue.Get("sampleRate");
+            compileSampleRate = sampleRateValue.IsNull() ? DEFAULT_ANIMATION_SAMPLE_RATE : sampleRateValue.GetFloat();
+        }
+
         const JSONArray& metadataArray = rootVal.Get("metadata").GetArray();
         LoadMetadataFromJSON(metadataArray);
 
         memoryUse += triggers_.Size() * sizeof(AnimationTriggerPoint);
         SetMemoryUse(memoryUse);
+        if (compileSampleRate > 0.0f)
+            Compile(compileSampleRate);
         return true;
     }
 
@@ -292,6 +523,7 @@ void Animation::SetAnimationName(const String& name)
 void Animation::SetLength(float length)
 {
     length_ = Max(length, 0.0f);
+    RemoveCompiled();
 }
 
 AnimationTrack* Animation::CreateTrack(const String& name)
@@ -305,6 +537,7 @@ AnimationTrack* Animation::CreateTrack(const String& name)
     AnimationTrack& newTrack = tracks_[nameHash];
     newTrack.name_ = name;
     newTrack.nameHash_ = nameHash;
+    RemoveCompiled();
     return &newTrack;
 }
 
@@ -313,6 +546,7 @@ bool Animation::RemoveTrack(const String& name)
     HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Find(StringHash(name));
     if (i != tracks_.End())
     {
+        RemoveCompiled();
         tracks_.Erase(i);
         return true;
     }
@@ -322,6 +556,7 @@ bool Animation::RemoveTrack(const String& name)
 
 void Animation::RemoveAllTracks()
 {
+    RemoveCompiled();
     tracks_.Clear();
 }
 
@@ -378,11 +613,102 @@ SharedPtr<Animation> Animation::Clone(const String& cloneName) const
     ret->tracks_ = tracks_;
     ret->triggers_ = triggers_;
     ret->CopyMetadata(*this);
-    ret->SetMemoryUse(GetMemoryUse());
+    ret->SetMemoryUse(compiled_ ? GetMemoryUse() - compiled_->GetMemoryUse() : GetMemoryUse());
+    // The compiled data refers to the tracks, so compile the clone separately
+    if (compiled_)
+        ret->Compile(compiled_->sampleRate_);
 
     return ret;
 }
 
+void Animation::Compile(float sampleRate)
+{
+    URHO3D_PROFILE(CompileAnimation);
+
+    RemoveCompiled();
+
+    SharedPtr<CompiledAnimation> compiled(new CompiledAnimation());
+    compiled->sampleRate_ = Max(sampleRate, 1.0f);
+    compiled->numFrames_ = length_ > 0.0f ? (unsigned)ceilf(length_ * compiled->sampleRate_) + 1 : 1;
+    compiled->frameRate_ = compiled->numFrames_ > 1 ? (float)(compiled->numFrames_ - 1) / length_ : 0.0f;
+    compiled->stride_ = (tracks_.Size() + 3) & ~3;
+
+    for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+    {
+        compiled->tracks_.Push(&i->second_);
+        compiled->channelMask_ |= i->second_.channelMask_;
+    }
+
+    unsigned numFrames = compiled->numFrames_;
+    unsigned stride = compiled->stride_;
+
+    // Looped playback interpolates from the last keyframe of a track back to its first, while non-looped playback holds the
+    // last keyframe. The frames after the earliest last keyframe that is before the end are therefore compiled also separately
+    // for looped playback
+    compiled->loopFrame_ = numFrames;
+    for (unsigned i = 0; i < compiled->tracks_.Size(); ++i)
+    {
+        const Vector<AnimationKeyFrame>& keyFrames = compiled->tracks_[i]->keyFrames_;
+        if (keyFrames.Size() > 1 && keyFrames.Back().time_ < length_)
+            compiled->loopFrame_ = Min(compiled->loopFrame_, (unsigned)(keyFrames.Back().time_ * compiled->frameRate_));
+    }
+    unsigned loopFrame = compiled->loopFrame_;
+
+    InitializeCompiledFrames(compiled->positions_, compiled->rotations_, compiled->scales_, compiled->channelMask_, numFrames,
+        stride);
+    if (loopFrame < numFrames)
+    {
+        InitializeCompiledFrames(compiled->loopPositions_, compiled->loopRotations_, compiled->loopScales_,
+            compiled->channelMask_, numFrames - loopFrame, stride);
+    }
+
+    for (unsigned i = 0; i < compiled->tracks_.Size(); ++i)
+    {
+        const AnimationTrack& track = *compiled->tracks_[i];
+        if (track.keyFrames_.Empty())
+            continue;
+
+        unsigned keyFrameIndex = 0;
+        unsigned loopKeyFrameIndex = 0;
+        Quaternion previousRotation;
+        Quaternion previousLoopRotation;
+        Vector3 position;
+        Quaternion rotation;
+        Vector3 scale;
+
+        for (unsigned j = 0; j < numFrames; ++j)
+        {
+            float time = j < numFrames - 1 ? (float)j / compiled->frameRate_ : length_;
+
+            if (j >= loopFrame)
+            {
+                // Continue the loop tail from the same hemisphere as the frame before it
+                if (j == loopFrame)
+                    previousLoopRotation = previousRotation;
+                SampleKeyFrames(track, time, length_, true, loopKeyFrameIndex, position, rotation, scale);
+                WriteCompiledFrame(compiled->loopPositions_, compiled->loopRotations_, compiled->loopScales_, j - loopFrame,
+                    stride, i, position, rotation, scale, previousLoopRotation, j > 0);
+            }
+
+            SampleKeyFrames(track, time, length_, false, keyFrameIndex, position, rotation, scale);
+            WriteCompiledFrame(compiled->positions_, compiled->rotations_, compiled->scales_, j, stride, i, position, rotation,
+                scale, previousRotation, j > 0);
+        }
+    }
+
+    compiled_ = compiled;
+    SetMemoryUse(GetMemoryUse() + compiled_->GetMemoryUse());
+}
+
+void Animation::RemoveCompiled()
+{
+    if (compiled_)
+    {
+        SetMemoryUse(GetMemoryUse() - compiled_->GetMemoryUse());
+        compiled_.Reset();
+    }
+}
+
 AnimationTrack* Animation::GetTrack(unsigned index)
 {
     if (index >= GetNumTracks())
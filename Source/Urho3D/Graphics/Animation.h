@@ -106,6 +106,56 @@ static const unsigned char CHANNEL_POSITION = 0x1;
 static const unsigned char CHANNEL_ROTATION = 0x2;
 static const unsigned char CHANNEL_SCALE = 0x4;
 
+static const float DEFAULT_ANIMATION_SAMPLE_RATE = 30.0f;
+static const unsigned COMPILED_ANIMATION_COMPONENTS = 10;
+
+/// Compiled skeletal animation for fast playback. The tracks are resampled at a constant rate so that no keyframe search is needed. Each frame is stored as structure of arrays: one array per channel component, holding the values of all tracks. Rotations are quantized to 16 bits per component.
+struct URHO3D_API CompiledAnimation : public RefCounted
+{
+    /// Construct.
+    CompiledAnimation() :
+        sampleRate_(0.0f),
+        frameRate_(0.0f),
+        numFrames_(0),
+        loopFrame_(0),
+        stride_(0),
+        channelMask_(0)
+    {
+    }
+
+    /// Sample tracks at time position, optionally as looped playback. Writes the position x, y, z, rotation w, x, y, z and scale x, y, z component arrays, stride_ floats each, to dest. Arrays of channels no track has are left untouched. If a group mask of stride_ / 4 bytes is given, only the groups of four tracks with a nonzero byte are sampled.
+    void Sample(float time, float* dest, bool looped = false, const unsigned char* groupMask = 0) const;
+    /// Return memory use in bytes.
+    unsigned GetMemoryUse() const;
+
+    /// Requested sample rate.
+    float sampleRate_;
+    /// Actual frames per second, adjusted so that the last frame falls on the end of the animation.
+    float frameRate_;
+    /// Number of frames.
+    unsigned numFrames_;
+    /// First frame of the loop tail. Equal to the number of frames if looped playback needs no separate frames.
+    unsigned loopFrame_;
+    /// Length of each component array. Number of tracks rounded up to a multiple of 4.
+    unsigned stride_;
+    /// Combined channel mask of all tracks.
+    unsigned char channelMask_;
+    /// Source tracks in compiled order.
+    PODVector<const AnimationTrack*> tracks_;
+    /// Positions, 3 component arrays per frame. Empty if no track has position.
+    PODVector<float> positions_;
+    /// Quantized rotations, 4 component arrays per frame. Empty if no track has rotation.
+    PODVector<short> rotations_;
+    /// Scales, 3 component arrays per frame. Empty if no track has scale.
+    PODVector<float> scales_;
+    /// Positions of the loop tail frames, which interpolate from the last keyframes back to the first.
+    PODVector<float> loopPositions_;
+    /// Quantized rotations of the loop tail frames.
+    PODVector<short> loopRotations_;
+    /// Scales of the loop tail frames.
+    PODVector<float> loopScales_;
+};
+
 /// Skeletal animation resource.
 class URHO3D_API Animation : public ResourceWithMetadata
 {
@@ -148,6 +198,10 @@ public:
     void SetNumTriggers(unsigned num);
     /// Clone the animation.
     SharedPtr<Animation> Clone(const String& cloneName = String::EMPTY) const;
+    /// Compile the tracks into the constant rate sampled format for faster playback. Needs to be called again after modifying keyframes.
+    void Compile(float sampleRate = DEFAULT_ANIMATION_SAMPLE_RATE);
+    /// Remove the compiled data. Playback will use the keyframes again.
+    void RemoveCompiled();
 
     /// Return animation name.
     const String& GetAnimationName() const { return animationName_; }
@@ -181,6 +235,12 @@ public:
     /// Return a trigger point by index.
     AnimationTriggerPoint* GetTrigger(unsigned index);
 
+    /// Return compiled data, or null if not compiled.
+    CompiledAnimation* GetCompiled() const { return compiled_; }
+
+    /// Return whether is compiled.
+    bool IsCompiled() const { return compiled_.NotNull(); }
+
 private:
     /// Animation name.
     String animationName_;
@@ -192,6 +252,8 @@ private:
     HashMap<StringHash, AnimationTrack> tracks_;
     /// Animation trigger points.
     Vector<AnimationTriggerPoint> triggers_;
+    /// Compiled data.
+    SharedPtr<CompiledAnimation> compiled_;
 };
 
 }
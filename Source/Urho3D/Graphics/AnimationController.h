@@ -32,6 +32,7 @@ namespace Urho3D
 class AnimatedModel;
 class Animation;
 struct Bone;
+struct ScenePostUpdateEventData;
 
 /// Control data for an animation.
 struct URHO3D_API AnimationControl
@@ -200,7 +201,7 @@ private:
     /// Find the internal index and animation state of an animation.
     void FindAnimation(const String& name, unsigned& index, AnimationState*& state) const;
     /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleScenePostUpdate(const ScenePostUpdateEventData& eventData);
 
     /// Animation control structures.
     Vector<AnimationControl> animations_;
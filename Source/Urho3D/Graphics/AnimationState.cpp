@@ -33,11 +33,20 @@
 namespace Urho3D
 {
 
+/// Return whether a track is applied to a model, which is not the case for zero effective weight, a bone with animation disabled or a bone beyond its animation LOD distance.
+static inline bool IsTrackApplied(const AnimationStateTrack& stateTrack, float weight, float lodDistance)
+{
+    const Bone* bone = stateTrack.bone_;
+    return !Equals(weight, 0.0f) && bone->animated_ && !(bone->animationLodDistance_ > 0.0f && lodDistance >
+        bone->animationLodDistance_);
+}
+
 AnimationStateTrack::AnimationStateTrack() :
     track_(0),
     bone_(0),
     weight_(1.0f),
-    keyFrame_(0)
+    keyFrame_(0),
+    compiledIndex_(M_MAX_UNSIGNED)
 {
 }
 
@@ -128,6 +137,7 @@ void AnimationState::SetStartBone(Bone* startBone)
 
     const HashMap<StringHash, AnimationTrack>& tracks = animation_->GetTracks();
     stateTracks_.Clear();
+    compiled_.Reset();
 
     if (!startBone->node_)
         return;
@@ -450,6 +460,10 @@ void AnimationState::Apply()
     if (!animation_ || !IsEnabled())
         return;
 
+    CompiledAnimation* compiled = animation_->GetCompiled();
+    if (compiled)
+        SampleCompiled(compiled);
+
     if (model_)
         ApplyToModel();
     else
@@ -458,16 +472,14 @@ void AnimationState::Apply()
 
 void AnimationState::ApplyToModel()
 {
+    float lodDistance = model_->GetAnimationLodDistance();
+
     for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
     {
         AnimationStateTrack& stateTrack = *i;
         float finalWeight = weight_ * stateTrack.weight_;
-
-        // Do not apply if zero effective weight or the bone has animation disabled
-        if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_)
-            continue;
-            
-        ApplyTrack(stateTrack, finalWeight, true);
+        if (IsTrackApplied(stateTrack, finalWeight, lodDistance))
+            ApplyTrack(stateTrack, finalWeight, true);
     }
 }
 
@@ -478,61 +490,123 @@ void AnimationState::ApplyToNodes()
         ApplyTrack(*i, 1.0f, false);
 }
 
-void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent)
+void AnimationState::SampleCompiled(CompiledAnimation* compiled)
 {
-    const AnimationTrack* track = stateTrack.track_;
-    Node* node = stateTrack.node_;
+    // Resolve the compiled track indices when the animation has been (re)compiled or the tracks have changed
+    if (compiled_.Get() != compiled)
+    {
+        compiled_ = compiled;
+        compiledSamples_.Resize(compiled->stride_ * COMPILED_ANIMATION_COMPONENTS);
 
-    if (track->keyFrames_.Empty() || !node)
-        return;
+        for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
+        {
+            i->compiledIndex_ = M_MAX_UNSIGNED;
+            for (unsigned j = 0; j < compiled->tracks_.Size(); ++j)
+            {
+                if (compiled->tracks_[j] == i->track_)
+                {
+                    i->compiledIndex_ = j;
+                    break;
+                }
+            }
+        }
+    }
 
-    unsigned& frame = stateTrack.keyFrame_;
-    track->GetKeyFrameIndex(time_, frame);
+    // An animation without tracks has nothing to sample
+    if (!compiled->stride_)
+        return;
 
-    // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
-    unsigned nextFrame = frame + 1;
-    bool interpolate = true;
-    if (nextFrame >= track->keyFrames_.Size())
+    // Sample only the groups of four tracks containing a track that will be applied, so that bones beyond their animation
+    // LOD distance are not sampled either
+    compiledGroupMask_.Resize(compiled->stride_ >> 2);
+    memset(&compiledGroupMask_[0], 0, compiledGroupMask_.Size());
+    float lodDistance = model_ ? model_->GetAnimationLodDistance() : 0.0f;
+    bool sample = false;
+    for (Vector<AnimationStateTrack>::ConstIterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
     {
-        if (!looped_)
+        if (i->compiledIndex_ != M_MAX_UNSIGNED && i->node_ && (!model_ || IsTrackApplied(*i, weight_ * i->weight_, lodDistance)))
         {
-            nextFrame = frame;
-            interpolate = false;
+            compiledGroupMask_[i->compiledIndex_ >> 2] = 1;
+            sample = true;
         }
-        else
-            nextFrame = 0;
     }
 
-    const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
+    if (sample)
+        compiled->Sample(time_, &compiledSamples_[0], looped_, &compiledGroupMask_[0]);
+}
+
+void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent)
+{
+    const AnimationTrack* track = stateTrack.track_;
+    Node* node = stateTrack.node_;
+
+    if (track->keyFrames_.Empty() || !node)
+        return;
+
     unsigned char channelMask = track->channelMask_;
 
     Vector3 newPosition;
     Quaternion newRotation;
     Vector3 newScale;
 
-    if (interpolate)
+    // When the animation is compiled, the track has already been sampled
+    if (stateTrack.compiledIndex_ != M_MAX_UNSIGNED && compiled_)
     {
-        const AnimationKeyFrame* nextKeyFrame = &track->keyFrames_[nextFrame];
-        float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
-        if (timeInterval < 0.0f)
-            timeInterval += animation_->GetLength();
-        float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
+        unsigned stride = compiled_->stride_;
+        const float* samples = &compiledSamples_[stateTrack.compiledIndex_];
 
         if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+            newPosition = Vector3(samples[0], samples[stride], samples[2 * stride]);
         if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+            newRotation = Quaternion(samples[3 * stride], samples[4 * stride], samples[5 * stride], samples[6 * stride]);
         if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+            newScale = Vector3(samples[7 * stride], samples[8 * stride], samples[9 * stride]);
     }
     else
     {
-        if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_;
-        if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_;
-        if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_;
+        unsigned& frame = stateTrack.keyFrame_;
+        track->GetKeyFrameIndex(time_, frame);
+
+        // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
+        unsigned nextFrame = frame + 1;
+        bool interpolate = true;
+        if (nextFrame >= track->keyFrames_.Size())
+        {
+            if (!looped_)
+            {
+                nextFrame = frame;
+                interpolate = false;
+            }
+            else
+                nextFrame = 0;
+        }
+
+        const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
+
+        if (interpolate)
+        {
+            const AnimationKeyFrame* nextKeyFrame = &track->keyFrames_[nextFrame];
+            float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
+            if (timeInterval < 0.0f)
+                timeInterval += animation_->GetLength();
+            float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
+
+            if (channelMask & CHANNEL_POSITION)
+                newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+            if (channelMask & CHANNEL_ROTATION)
+                newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+            if (channelMask & CHANNEL_SCALE)
+                newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+        }
+        else
+        {
+            if (channelMask & CHANNEL_POSITION)
+                newPosition = keyFrame->position_;
+            if (channelMask & CHANNEL_ROTATION)
+                newRotation = keyFrame->rotation_;
+            if (channelMask & CHANNEL_SCALE)
+                newScale = keyFrame->scale_;
+        }
     }
     
     if (blendingMode_ == ABM_ADDITIVE) // not ABM_LERP
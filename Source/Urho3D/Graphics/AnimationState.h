@@ -35,6 +35,7 @@ class Serializer;
 class Skeleton;
 struct AnimationTrack;
 struct Bone;
+struct CompiledAnimation;
 
 /// %Animation blending mode.
 enum AnimationBlendMode
@@ -63,6 +64,8 @@ struct AnimationStateTrack
     float weight_;
     /// Last key frame.
     unsigned keyFrame_;
+    /// Track index in the compiled animation, or M_MAX_UNSIGNED if not resolved.
+    unsigned compiledIndex_;
 };
 
 /// %Animation instance.
@@ -150,6 +153,8 @@ private:
     void ApplyToModel();
     /// Apply animation to a scene node hierarchy.
     void ApplyToNodes();
+    /// Sample all tracks of a compiled animation at the current time position in one batch.
+    void SampleCompiled(CompiledAnimation* compiled);
     /// Apply track.
     void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
 
@@ -163,6 +168,12 @@ private:
     Bone* startBone_;
     /// Per-track data.
     Vector<AnimationStateTrack> stateTracks_;
+    /// Compiled animation that the track indices are resolved for.
+    WeakPtr<CompiledAnimation> compiled_;
+    /// Compiled animation samples of all tracks at the current time position.
+    PODVector<float> compiledSamples_;
+    /// Compiled animation groups of four tracks to sample, excluding the groups with no applied track.
+    PODVector<unsigned char> compiledGroupMask_;
     /// Looped flag.
     bool looped_;
     /// Blending weight.
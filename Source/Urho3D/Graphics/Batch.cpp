@@ -40,34 +40,36 @@
 namespace Urho3D
 {
 
-inline bool CompareBatchesState(Batch* lhs, Batch* rhs)
+/// State sort key bit for non-base batches, which are drawn after the base batches.
+static const unsigned long long SORT_NONBASE_FLAG = 0x8000000000000000ULL;
+/// Number of ID fields in the state sort key.
+static const unsigned NUM_SORT_FIELDS = 5;
+/// Widths of the state sort key ID fields from most to least significant: pixel shader, vertex shader, light queue, material
+/// and geometry. IDs beyond the field width wrap around, which only weakens the state grouping.
+static const unsigned sortFieldBits[] = { 12, 12, 9, 15, 15 };
+/// Bit positions of the state sort key ID fields.
+static const unsigned sortFieldShifts[] = { 51, 39, 30, 15, 0 };
+/// Batch count below which an insertion sort is used instead of the radix sort.
+static const unsigned MIN_RADIX_SORT_BATCHES = 32;
+/// Maximum number of unchanged instances between two changed ranges of a retained instancing buffer for uploading them together.
+static const unsigned INSTANCING_UPLOAD_MERGE_DISTANCE = 64;
+
+inline unsigned long long GetSortField(unsigned id, unsigned field)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->sortKey_ != rhs->sortKey_)
-        return lhs->sortKey_ < rhs->sortKey_;
-    else
-        return lhs->distance_ < rhs->distance_;
+    return ((unsigned long long)(id & ((1u << sortFieldBits[field]) - 1))) << sortFieldShifts[field];
 }
 
-inline bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
+inline unsigned GetSortFieldID(unsigned long long sortKey, unsigned field)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    return (unsigned)(sortKey >> sortFieldShifts[field]) & ((1u << sortFieldBits[field]) - 1);
 }
 
-inline bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
+/// Return an unsigned key which sorts in the same order as the float value.
+inline unsigned GetFloatSortKey(float value)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ > rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    unsigned bits;
+    memcpy(&bits, &value, sizeof bits);
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
 }
 
 inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
@@ -75,9 +77,81 @@ inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceD
     return lhs.distance_ < rhs.distance_;
 }
 
-inline bool CompareBatchGroupOrder(BatchGroup* lhs, BatchGroup* rhs)
+/// Sort batches or batch groups by 64-bit keys, keeping the existing order of batches with equal keys. Sorting is least
+/// significant byte first, and bytes that are the same in all keys are skipped.
+template <class T> static void RadixSortBatches(PODVector<T*>& batches, PODVector<unsigned long long>& keys,
+    PODVector<T*>& tempBatches, PODVector<unsigned long long>& tempKeys)
 {
-    return lhs->renderOrder_ < rhs->renderOrder_;
+    unsigned numBatches = batches.Size();
+    if (numBatches < 2)
+        return;
+
+    if (numBatches < MIN_RADIX_SORT_BATCHES)
+    {
+        for (unsigned i = 1; i < numBatches; ++i)
+        {
+            unsigned long long key = keys[i];
+            T* batch = batches[i];
+            unsigned j = i;
+            for (; j > 0 && keys[j - 1] > key; --j)
+            {
+                keys[j] = keys[j - 1];
+                batches[j] = batches[j - 1];
+            }
+            keys[j] = key;
+            batches[j] = batch;
+        }
+        return;
+    }
+
+    unsigned counts[8][256];
+    memset(counts, 0, sizeof counts);
+    for (unsigned i = 0; i < numBatches; ++i)
+    {
+        unsigned long long key = keys[i];
+        for (unsigned j = 0; j < 8; ++j)
+            ++counts[j][(key >> (j * 8)) & 0xff];
+    }
+
+    tempBatches.Resize(numBatches);
+    tempKeys.Resize(numBatches);
+    T** srcBatches = batches.Buffer();
+    unsigned long long* srcKeys = keys.Buffer();
+    T** destBatches = tempBatches.Buffer();
+    unsigned long long* destKeys = tempKeys.Buffer();
+
+    for (unsigned j = 0; j < 8; ++j)
+    {
+        unsigned shift = j * 8;
+        unsigned* digitCounts = counts[j];
+        if (digitCounts[(srcKeys[0] >> shift) & 0xff] == numBatches)
+            continue;
+
+        unsigned offset = 0;
+        for (unsigned k = 0; k < 256; ++k)
+        {
+            unsigned count = digitCounts[k];
+            digitCounts[k] = offset;
+            offset += count;
+        }
+
+        for (unsigned i = 0; i < numBatches; ++i)
+        {
+            unsigned long long key = srcKeys[i];
+            unsigned dest = digitCounts[(key >> shift) & 0xff]++;
+            destKeys[dest] = key;
+            destBatches[dest] = srcBatches[i];
+        }
+
+        Swap(srcBatches, destBatches);
+        Swap(srcKeys, destKeys);
+    }
+
+    if (srcBatches != batches.Buffer())
+    {
+        memcpy(batches.Buffer(), srcBatches, numBatches * sizeof(T*));
+        memcpy(keys.Buffer(), srcKeys, numBatches * sizeof(unsigned long long));
+    }
 }
 
 void CalculateShadowMatrix(Matrix4& dest, LightBatchQueue* queue, unsigned split, Renderer* renderer)
@@ -161,18 +235,13 @@ void CalculateSpotMatrix(Matrix4& dest, Light* light)
 
 void Batch::CalculateSortKey()
 {
-    unsigned shaderID = (unsigned)(
-        ((*((unsigned*)&vertexShader_) / sizeof(ShaderVariation)) + (*((unsigned*)&pixelShader_) / sizeof(ShaderVariation))) &
-        0x7fff);
-    if (!isBase_)
-        shaderID |= 0x8000;
-
-    unsigned lightQueueID = (unsigned)((*((unsigned*)&lightQueue_) / sizeof(LightBatchQueue)) & 0xffff);
-    unsigned materialID = (unsigned)((*((unsigned*)&material_) / sizeof(Material)) & 0xffff);
-    unsigned geometryID = (unsigned)((*((unsigned*)&geometry_) / sizeof(Geometry)) & 0xffff);
-
-    sortKey_ = (((unsigned long long)shaderID) << 48) | (((unsigned long long)lightQueueID) << 32) |
-               (((unsigned long long)materialID) << 16) | geometryID;
+    // Use the dense sort IDs offset by one, so that a missing object gets ID zero
+    sortKey_ = (isBase_ ? 0 : SORT_NONBASE_FLAG) |
+        GetSortField(pixelShader_ ? pixelShader_->GetSortID() + 1 : 0, 0) |
+        GetSortField(vertexShader_ ? vertexShader_->GetSortID() + 1 : 0, 1) |
+        GetSortField(lightQueue_ ? lightQueue_->sortID_ : 0, 2) |
+        GetSortField(material_ ? material_->GetSortID() + 1 : 0, 3) |
+        GetSortField(geometry_ ? geometry_->GetSortID() + 1 : 0, 4);
 }
 
 void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const
@@ -665,6 +734,44 @@ void BatchGroup::SetInstancingData(void* lockedData, unsigned stride, unsigned&
     freeIndex += instances_.Size();
 }
 
+Pair<unsigned, unsigned> BatchGroup::UpdateRetainedInstancingData(unsigned char* shadowData, unsigned stride)
+{
+    unsigned firstChanged = M_MAX_UNSIGNED;
+    unsigned lastChanged = 0;
+    unsigned char* buffer = shadowData + startIndex_ * stride;
+    const unsigned extraSize = stride - sizeof(Matrix3x4);
+
+    for (unsigned i = 0; i < instances_.Size(); ++i)
+    {
+        const InstanceData& instance = instances_[i];
+        bool changed = false;
+
+        if (memcmp(buffer, instance.worldTransform_, sizeof(Matrix3x4)))
+        {
+            memcpy(buffer, instance.worldTransform_, sizeof(Matrix3x4));
+            changed = true;
+        }
+        if (instance.instancingData_ && memcmp(buffer + sizeof(Matrix3x4), instance.instancingData_, extraSize))
+        {
+            memcpy(buffer + sizeof(Matrix3x4), instance.instancingData_, extraSize);
+            changed = true;
+        }
+
+        if (changed)
+        {
+            firstChanged = Min(firstChanged, i);
+            lastChanged = i + 1;
+        }
+
+        buffer += stride;
+    }
+
+    if (firstChanged == M_MAX_UNSIGNED)
+        return MakePair(0U, 0U);
+    else
+        return MakePair(startIndex_ + firstChanged, startIndex_ + lastChanged);
+}
+
 void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
 {
     Graphics* graphics = view->GetGraphics();
@@ -673,7 +780,7 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
     if (instances_.Size() && !geometry_->IsEmpty())
     {
         // Draw as individual objects if instancing not supported or could not fill the instancing buffer
-        VertexBuffer* instanceBuffer = renderer->GetInstancingBuffer();
+        VertexBuffer* instanceBuffer = view->GetInstancingBuffer();
         if (!instanceBuffer || geometryType_ != GEOM_INSTANCED || startIndex_ == M_MAX_UNSIGNED)
         {
             Batch::Prepare(view, camera, false, allowDepthWrite);
@@ -717,30 +824,61 @@ unsigned BatchGroupKey::ToHash() const
                       (size_t)material_ / sizeof(Material) + (size_t)geometry_ / sizeof(Geometry)) + renderOrder_;
 }
 
-void BatchQueue::Clear(int maxSortedInstances)
+void BatchQueue::Clear(int maxSortedInstances, bool retainGroups)
 {
     batches_.Clear();
     sortedBatches_.Clear();
-    batchGroups_.Clear();
     maxSortedInstances_ = (unsigned)maxSortedInstances;
+
+    if (!retainGroups)
+    {
+        batchGroups_.Clear();
+        return;
+    }
+
+    // Groups that stayed empty during the last frame are removed, which also frees their instancing buffer slots
+    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End();)
+    {
+        if (i->second_.instances_.Empty())
+            i = batchGroups_.Erase(i);
+        else
+        {
+            i->second_.instances_.Clear();
+            ++i;
+        }
+    }
 }
 
 void BatchQueue::SortBackToFront()
 {
     sortedBatches_.Resize(batches_.Size());
+    sortKeys_.Resize(batches_.Size());
 
+    // Sort by state first, so that batches at equal distance stay in state order after the stable distance sort
     for (unsigned i = 0; i < batches_.Size(); ++i)
+    {
         sortedBatches_[i] = &batches_[i];
+        sortKeys_[i] = batches_[i].sortKey_;
+    }
+    RadixSortBatches(sortedBatches_, sortKeys_, tempSortedBatches_, tempSortKeys_);
 
-    Sort(sortedBatches_.Begin(), sortedBatches_.End(), CompareBatchesBackToFront);
+    for (unsigned i = 0; i < sortedBatches_.Size(); ++i)
+    {
+        Batch* batch = sortedBatches_[i];
+        sortKeys_[i] = ((unsigned long long)batch->renderOrder_ << 32) | ~GetFloatSortKey(batch->distance_);
+    }
+    RadixSortBatches(sortedBatches_, sortKeys_, tempSortedBatches_, tempSortKeys_);
 
     sortedBatchGroups_.Resize(batchGroups_.Size());
-    
+    sortKeys_.Resize(batchGroups_.Size());
+
     unsigned index = 0;
     for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    {
+        sortKeys_[index] = i->second_.renderOrder_;
         sortedBatchGroups_[index++] = &i->second_;
-    
-    Sort(sortedBatchGroups_.Begin(), sortedBatchGroups_.End(), CompareBatchGroupOrder);
+    }
+    RadixSortBatches(sortedBatchGroups_, sortKeys_, tempSortedBatchGroups_, tempSortKeys_);
 }
 
 void BatchQueue::SortFrontToBack()
@@ -776,73 +914,166 @@ void BatchQueue::SortFrontToBack()
     for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
         sortedBatchGroups_[index++] = &i->second_;
 
-    SortFrontToBack2Pass(reinterpret_cast<PODVector<Batch*>& >(sortedBatchGroups_));
+    SortFrontToBack2Pass(sortedBatchGroups_, tempSortedBatchGroups_);
 }
 
 void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
 {
+    SortFrontToBack2Pass(batches, tempSortedBatches_);
+}
+
+template <class T> void BatchQueue::SortFrontToBack2Pass(PODVector<T*>& batches, PODVector<T*>& tempBatches)
+{
+    unsigned numBatches = batches.Size();
+    sortKeys_.Resize(numBatches);
+
     // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant. The 2-pass
-    // method is also time consuming, so just sort with state having priority
+    // method is also time consuming, so just sort with state having priority and distance as the tiebreaker
 #ifdef GL_ES_VERSION_2_0
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
+    for (unsigned i = 0; i < numBatches; ++i)
+        sortKeys_[i] = GetFloatSortKey(batches[i]->distance_);
+    RadixSortBatches(batches, sortKeys_, tempBatches, tempSortKeys_);
+
+    for (unsigned i = 0; i < numBatches; ++i)
+        sortKeys_[i] = batches[i]->sortKey_;
+    RadixSortBatches(batches, sortKeys_, tempBatches, tempSortKeys_);
 #else
-    // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    Sort(batches.Begin(), batches.End(), CompareBatchesFrontToBack);
+    // For desktop, first sort by distance and remap the sort key IDs in order of first appearance, so that the state
+    // groups containing the closest batches are drawn first
+    for (unsigned i = 0; i < numBatches; ++i)
+    {
+        T* batch = batches[i];
+        sortKeys_[i] = ((unsigned long long)batch->renderOrder_ << 32) | GetFloatSortKey(batch->distance_);
+    }
+    RadixSortBatches(batches, sortKeys_, tempBatches, tempSortKeys_);
 
-    unsigned freeShaderID = 0;
-    unsigned short freeMaterialID = 0;
-    unsigned short freeGeometryID = 0;
+    PODVector<unsigned>* remappings[NUM_SORT_FIELDS] =
+    {
+        &pixelShaderRemapping_, &vertexShaderRemapping_, &lightQueueRemapping_, &materialRemapping_, &geometryRemapping_
+    };
+    unsigned freeIDs[NUM_SORT_FIELDS] = { 0 };
 
-    for (PODVector<Batch*>::Iterator i = batches.Begin(); i != batches.End(); ++i)
+    for (unsigned i = 0; i < numBatches; ++i)
     {
-        Batch* batch = *i;
+        unsigned long long sortKey = batches[i]->sortKey_;
+        unsigned long long remappedKey = sortKey & SORT_NONBASE_FLAG;
 
-        unsigned shaderID = (unsigned)(batch->sortKey_ >> 32);
-        HashMap<unsigned, unsigned>::ConstIterator j = shaderRemapping_.Find(shaderID);
-        if (j != shaderRemapping_.End())
-            shaderID = j->second_;
-        else
+        for (unsigned j = 0; j < NUM_SORT_FIELDS; ++j)
         {
-            shaderID = shaderRemapping_[shaderID] = freeShaderID | (shaderID & 0x80000000);
-            ++freeShaderID;
+            PODVector<unsigned>& remapping = *remappings[j];
+            unsigned id = GetSortFieldID(sortKey, j);
+            if (id >= remapping.Size())
+            {
+                unsigned oldSize = remapping.Size();
+                remapping.Resize(id + 1);
+                for (unsigned k = oldSize; k <= id; ++k)
+                    remapping[k] = M_MAX_UNSIGNED;
+            }
+
+            unsigned& remappedID = remapping[id];
+            if (remappedID == M_MAX_UNSIGNED)
+                remappedID = freeIDs[j]++;
+            remappedKey |= GetSortField(remappedID, j);
         }
 
-        unsigned short materialID = (unsigned short)(batch->sortKey_ & 0xffff0000);
-        HashMap<unsigned short, unsigned short>::ConstIterator k = materialRemapping_.Find(materialID);
-        if (k != materialRemapping_.End())
-            materialID = k->second_;
-        else
+        sortKeys_[i] = remappedKey;
+    }
+
+    // Reset the used remapping entries for the next sort
+    for (unsigned i = 0; i < numBatches; ++i)
+    {
+        unsigned long long sortKey = batches[i]->sortKey_;
+        for (unsigned j = 0; j < NUM_SORT_FIELDS; ++j)
+            (*remappings[j])[GetSortFieldID(sortKey, j)] = M_MAX_UNSIGNED;
+    }
+
+    // Finally sort again with the remapped IDs. The stable sort keeps the distance order within each state
+    RadixSortBatches(batches, sortKeys_, tempBatches, tempSortKeys_);
+#endif
+
+    for (unsigned i = 0; i < numBatches; ++i)
+        sortKeys_[i] = batches[i]->renderOrder_;
+    RadixSortBatches(batches, sortKeys_, tempBatches, tempSortKeys_);
+}
+
+void BatchQueue::SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex)
+{
+    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+        i->second_.SetInstancingData(lockedData, stride, freeIndex);
+}
+
+unsigned BatchQueue::ReserveInstancingSlots(unsigned& freeIndex, unsigned bufferSize, bool repack)
+{
+    unsigned numMissing = 0;
+
+    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    {
+        BatchGroup& group = i->second_;
+        // Do not use up buffer space if not going to draw as instanced
+        if (group.geometryType_ != GEOM_INSTANCED)
         {
-            materialID = materialRemapping_[materialID] = freeMaterialID;
-            ++freeMaterialID;
+            group.startIndex_ = M_MAX_UNSIGNED;
+            group.numReservedInstances_ = 0;
+            continue;
         }
 
-        unsigned short geometryID = (unsigned short)(batch->sortKey_ & 0xffff);
-        HashMap<unsigned short, unsigned short>::ConstIterator l = geometryRemapping_.Find(geometryID);
-        if (l != geometryRemapping_.End())
-            geometryID = l->second_;
+        unsigned numInstances = group.instances_.Size();
+        if (!repack && group.startIndex_ != M_MAX_UNSIGNED && numInstances <= group.numReservedInstances_)
+            continue;
+
+        // Reserve some headroom so that a slowly growing group does not need new slots each frame
+        unsigned numReserved = numInstances + numInstances / 4;
+        if (freeIndex + numReserved <= bufferSize)
+        {
+            group.startIndex_ = freeIndex;
+            group.numReservedInstances_ = numReserved;
+            freeIndex += numReserved;
+        }
         else
         {
-            geometryID = geometryRemapping_[geometryID] = freeGeometryID;
-            ++freeGeometryID;
+            group.startIndex_ = M_MAX_UNSIGNED;
+            group.numReservedInstances_ = 0;
+            numMissing += numReserved;
         }
-
-        batch->sortKey_ = (((unsigned long long)shaderID) << 32) | (((unsigned long long)materialID) << 16) | geometryID;
     }
 
-    shaderRemapping_.Clear();
-    materialRemapping_.Clear();
-    geometryRemapping_.Clear();
-
-    // Finally sort again with the rewritten ID's
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
-#endif
+    return numMissing;
 }
 
-void BatchQueue::SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex)
+void BatchQueue::UpdateRetainedInstancingData(VertexBuffer* buffer, unsigned& dirtyStart, unsigned& dirtyEnd)
 {
+    unsigned char* shadowData = buffer->GetShadowData();
+    const unsigned stride = buffer->GetVertexSize();
+
     for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
-        i->second_.SetInstancingData(lockedData, stride, freeIndex);
+    {
+        BatchGroup& group = i->second_;
+        if (group.startIndex_ == M_MAX_UNSIGNED)
+            continue;
+
+        Pair<unsigned, unsigned> range = group.UpdateRetainedInstancingData(shadowData, stride);
+        if (range.first_ == range.second_)
+            continue;
+
+        // Merge nearby changed ranges to reduce the number of uploads, otherwise upload the pending range now
+        if (dirtyStart == dirtyEnd)
+        {
+            dirtyStart = range.first_;
+            dirtyEnd = range.second_;
+        }
+        else if (range.first_ <= dirtyEnd + INSTANCING_UPLOAD_MERGE_DISTANCE &&
+                 range.second_ + INSTANCING_UPLOAD_MERGE_DISTANCE >= dirtyStart)
+        {
+            dirtyStart = Min(dirtyStart, range.first_);
+            dirtyEnd = Max(dirtyEnd, range.second_);
+        }
+        else
+        {
+            buffer->SetDataRange(shadowData + dirtyStart * stride, dirtyStart, dirtyEnd - dirtyStart);
+            dirtyStart = range.first_;
+            dirtyEnd = range.second_;
+        }
+    }
 }
 
 void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const
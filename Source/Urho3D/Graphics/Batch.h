@@ -71,7 +71,7 @@ struct Batch
     {
     }
 
-    /// Calculate state sorting key, which consists of base pass flag, light, pass and geometry.
+    /// Calculate state sorting key, which consists of base pass flag and the sort IDs of shaders, light, material and geometry.
     void CalculateSortKey();
     /// Prepare for rendering.
     void Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const;
@@ -141,14 +141,16 @@ struct BatchGroup : public Batch
 {
     /// Construct with defaults.
     BatchGroup() :
-        startIndex_(M_MAX_UNSIGNED)
+        startIndex_(M_MAX_UNSIGNED),
+        numReservedInstances_(0)
     {
     }
 
     /// Construct from a batch.
     BatchGroup(const Batch& batch) :
         Batch(batch),
-        startIndex_(M_MAX_UNSIGNED)
+        startIndex_(M_MAX_UNSIGNED),
+        numReservedInstances_(0)
     {
     }
 
@@ -173,6 +175,8 @@ struct BatchGroup : public Batch
 
     /// Pre-set the instance data. Buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
+    /// Write the instance data to its reserved slots in a retained instancing buffer, skipping instances whose data has not changed. Return the changed instance range, which is empty if nothing changed.
+    Pair<unsigned, unsigned> UpdateRetainedInstancingData(unsigned char* shadowData, unsigned stride);
     /// Prepare and draw.
     void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
 
@@ -180,6 +184,8 @@ struct BatchGroup : public Batch
     PODVector<InstanceData> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
+    /// Number of instance slots reserved in a retained instancing buffer.
+    unsigned numReservedInstances_;
 };
 
 /// Instanced draw call grouping key.
@@ -236,16 +242,22 @@ struct BatchGroupKey
 struct BatchQueue
 {
 public:
-    /// Clear for new frame by clearing all groups and batches.
-    void Clear(int maxSortedInstances);
+    /// Clear for new frame by clearing all groups and batches. When retaining groups, the groups used during the last frame are kept with their instancing buffer slots and only emptied.
+    void Clear(int maxSortedInstances, bool retainGroups = false);
     /// Sort non-instanced draw calls back to front.
     void SortBackToFront();
     /// Sort instanced and non-instanced draw calls front to back.
     void SortFrontToBack();
     /// Sort batches front to back while also maintaining state sorting.
     void SortFrontToBack2Pass(PODVector<Batch*>& batches);
+    /// Sort batches or batch groups front to back while also maintaining state sorting, using a scratch buffer of the same type.
+    template <class T> void SortFrontToBack2Pass(PODVector<T*>& batches, PODVector<T*>& tempBatches);
     /// Pre-set instance data of all groups. The vertex buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
+    /// Reserve retained instancing buffer slots for the groups that do not fit their previous slots. Return the number of slots still needed if the buffer end would be exceeded. When repacking, all slots are reserved anew.
+    unsigned ReserveInstancingSlots(unsigned& freeIndex, unsigned bufferSize, bool repack);
+    /// Write the changed instance data of all groups to a retained instancing buffer. Changed ranges are merged into the pending dirty range, which is uploaded when the next change is not close to it.
+    void UpdateRetainedInstancingData(VertexBuffer* buffer, unsigned& dirtyStart, unsigned& dirtyEnd);
     /// Draw.
     void Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const;
     /// Return the combined amount of instances.
@@ -256,12 +268,24 @@ public:
 
     /// Instanced draw calls.
     HashMap<BatchGroupKey, BatchGroup> batchGroups_;
-    /// Shader remapping table for 2-pass state and distance sort.
-    HashMap<unsigned, unsigned> shaderRemapping_;
-    /// Material remapping table for 2-pass state and distance sort.
-    HashMap<unsigned short, unsigned short> materialRemapping_;
-    /// Geometry remapping table for 2-pass state and distance sort.
-    HashMap<unsigned short, unsigned short> geometryRemapping_;
+    /// Pixel shader sort ID remapping table for 2-pass state and distance sort.
+    PODVector<unsigned> pixelShaderRemapping_;
+    /// Vertex shader sort ID remapping table for 2-pass state and distance sort.
+    PODVector<unsigned> vertexShaderRemapping_;
+    /// Light queue sort ID remapping table for 2-pass state and distance sort.
+    PODVector<unsigned> lightQueueRemapping_;
+    /// Material sort ID remapping table for 2-pass state and distance sort.
+    PODVector<unsigned> materialRemapping_;
+    /// Geometry sort ID remapping table for 2-pass state and distance sort.
+    PODVector<unsigned> geometryRemapping_;
+    /// Radix sort keys.
+    PODVector<unsigned long long> sortKeys_;
+    /// Radix sort key scratch buffer.
+    PODVector<unsigned long long> tempSortKeys_;
+    /// Radix sort batch scratch buffer.
+    PODVector<Batch*> tempSortedBatches_;
+    /// Radix sort batch group scratch buffer.
+    PODVector<BatchGroup*> tempSortedBatchGroups_;
 
     /// Unsorted non-instanced draw calls.
     PODVector<Batch> batches_;
@@ -301,6 +325,8 @@ struct ShadowBatchQueue
 /// Queue for light related draw calls.
 struct LightBatchQueue
 {
+    /// Dense ID for draw call sorting, unique within the view. Zero is reserved for batches without a light queue.
+    unsigned sortID_;
     /// Per-pixel light.
     Light* light_;
     /// Light negative flag.
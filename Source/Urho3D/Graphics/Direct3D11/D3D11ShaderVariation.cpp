@@ -58,35 +58,13 @@ void ShaderVariation::OnDeviceLost()
 
 bool ShaderVariation::Create()
 {
-    Release();
-
-    if (!graphics_)
+    // Use the bytecode loaded or compiled by Prepare() if available
+    if (prepared_)
+        prepared_ = false;
+    else if (!Prepare())
         return false;
 
-    if (!owner_)
-    {
-        compilerOutput_ = "Owner shader has expired";
-        return false;
-    }
-
-    // Check for up-to-date bytecode on disk
-    String path, name, extension;
-    SplitPath(owner_->GetName(), path, name, extension);
-    extension = type_ == VS ? ".vs4" : ".ps4";
-
-    String binaryShaderName = graphics_->GetShaderCacheDir() + name + "_" + StringHash(defines_).ToString() + extension;
-
-    if (!LoadByteCode(binaryShaderName))
-    {
-        // Compile shader if don't have valid bytecode
-        if (!Compile())
-            return false;
-        // Save the bytecode after successful compile, but not if the source is from a package
-        if (owner_->GetTimeStamp())
-            SaveByteCode(binaryShaderName);
-    }
-
-    // Then create shader from the bytecode
+    // Create shader from the bytecode
     ID3D11Device* device = graphics_->GetImpl()->GetDevice();
     if (type_ == VS)
     {
@@ -120,6 +98,40 @@ bool ShaderVariation::Create()
     return object_.ptr_ != 0;
 }
 
+bool ShaderVariation::Prepare()
+{
+    Release();
+
+    if (!graphics_)
+        return false;
+
+    if (!owner_)
+    {
+        compilerOutput_ = "Owner shader has expired";
+        return false;
+    }
+
+    // Check for up-to-date bytecode on disk
+    String path, name, extension;
+    SplitPath(owner_->GetName(), path, name, extension);
+    extension = type_ == VS ? ".vs4" : ".ps4";
+
+    String binaryShaderName = graphics_->GetShaderCacheDir() + name + "_" + StringHash(defines_).ToString() + extension;
+
+    if (!LoadByteCode(binaryShaderName))
+    {
+        // Compile shader if don't have valid bytecode
+        if (!Compile())
+            return false;
+        // Save the bytecode after successful compile, but not if the source is from a package
+        if (owner_->GetTimeStamp())
+            SaveByteCode(binaryShaderName);
+    }
+
+    prepared_ = true;
+    return true;
+}
+
 void ShaderVariation::Release()
 {
     if (object_.ptr_)
@@ -152,6 +164,7 @@ void ShaderVariation::Release()
     parameters_.Clear();
     byteCode_.Clear();
     elementHash_ = 0;
+    prepared_ = false;
 }
 
 void ShaderVariation::SetDefines(const String& defines)
@@ -91,6 +91,9 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     updateQueued_(false),
     zoneDirty_(false),
     octant_(0),
+    octantIndex_(0),
+    treeNode_(M_MAX_UNSIGNED),
+    unoccludedIndex_(0),
     zone_(0),
     viewMask_(DEFAULT_VIEWMASK),
     lightMask_(DEFAULT_LIGHTMASK),
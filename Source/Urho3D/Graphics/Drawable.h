@@ -110,7 +110,7 @@ class URHO3D_API Drawable : public Component
 
     friend class Octant;
     friend class Octree;
-    friend void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend struct UpdateDrawablesWork;
 
 public:
     /// Construct.
@@ -126,6 +126,8 @@ public:
     virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results);
     /// Update before octree reinsertion. Is called from a worker thread
     virtual void Update(const FrameInfo& frame) { }
+    /// Return whether the update is expensive and can be postponed to a later frame when the octree update budget is exceeded. Is called from the main thread.
+    virtual bool IsUpdateDeferrable(const FrameInfo& frame) const { return false; }
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     virtual void UpdateBatches(const FrameInfo& frame);
     /// Prepare geometry for rendering.
@@ -344,6 +346,12 @@ protected:
     bool zoneDirty_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octant's drawable list.
+    unsigned octantIndex_;
+    /// Leaf node index in the octree's dynamic tree, or M_MAX_UNSIGNED if not in the tree.
+    unsigned treeNode_;
+    /// Index in the octree's individually tested list in dynamic tree mode, when not in the dynamic tree.
+    unsigned unoccludedIndex_;
     /// Current zone.
     Zone* zone_;
     /// View mask.
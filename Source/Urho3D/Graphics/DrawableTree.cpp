@@ -0,0 +1,484 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Graphics/DebugRenderer.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/DrawableTree.h"
+#include "../Graphics/OctreeQuery.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Leaf bounding box enlargement relative to the drawable's half size.
+static const float TREE_MARGIN_FACTOR = 0.25f;
+/// Minimum leaf bounding box enlargement in world units.
+static const float TREE_MIN_MARGIN = 0.1f;
+
+static inline BoundingBox MergeBoxes(const BoundingBox& lhs, const BoundingBox& rhs)
+{
+    return BoundingBox(VectorMin(lhs.min_, rhs.min_), VectorMax(lhs.max_, rhs.max_));
+}
+
+static inline float SurfaceArea(const BoundingBox& box)
+{
+    Vector3 size = box.Size();
+    return size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_;
+}
+
+DrawableTree::DrawableTree() :
+    root_(M_MAX_UNSIGNED),
+    freeList_(M_MAX_UNSIGNED),
+    numDrawables_(0)
+{
+}
+
+unsigned DrawableTree::Insert(Drawable* drawable, const BoundingBox& box)
+{
+    unsigned leaf = AllocateNode();
+    DrawableTreeNode& node = nodes_[leaf];
+    Vector3 margin = box.HalfSize() * TREE_MARGIN_FACTOR + Vector3::ONE * TREE_MIN_MARGIN;
+    node.box_ = BoundingBox(box.min_ - margin, box.max_ + margin);
+    node.drawable_ = drawable;
+    node.height_ = 0;
+
+    InsertLeaf(leaf);
+    ++numDrawables_;
+    return leaf;
+}
+
+void DrawableTree::Remove(unsigned node)
+{
+    RemoveLeaf(node);
+    FreeNode(node);
+    --numDrawables_;
+}
+
+bool DrawableTree::Move(unsigned node, const BoundingBox& box)
+{
+    if (nodes_[node].box_.IsInside(box) == INSIDE)
+        return false;
+
+    RemoveLeaf(node);
+    Vector3 margin = box.HalfSize() * TREE_MARGIN_FACTOR + Vector3::ONE * TREE_MIN_MARGIN;
+    nodes_[node].box_ = BoundingBox(box.min_ - margin, box.max_ + margin);
+    InsertLeaf(node);
+    return true;
+}
+
+void DrawableTree::Clear()
+{
+    nodes_.Clear();
+    root_ = M_MAX_UNSIGNED;
+    freeList_ = M_MAX_UNSIGNED;
+    numDrawables_ = 0;
+}
+
+void DrawableTree::GetDrawables(OctreeQuery& query) const
+{
+    if (root_ != M_MAX_UNSIGNED)
+        GetDrawablesInternal(root_, query, false);
+}
+
+void DrawableTree::Raycast(RayOctreeQuery& query) const
+{
+    if (root_ != M_MAX_UNSIGNED)
+        RaycastInternal(root_, query);
+}
+
+void DrawableTree::GetDrawablesOnly(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    if (root_ != M_MAX_UNSIGNED)
+        GetDrawablesOnlyInternal(root_, query, drawables);
+}
+
+void DrawableTree::Raycast(RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates) const
+{
+    if (root_ != M_MAX_UNSIGNED)
+        RaycastInternal(root_, queries, mask, candidates);
+}
+
+void DrawableTree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const
+{
+    if (!debug || root_ == M_MAX_UNSIGNED)
+        return;
+
+    PODVector<unsigned> stack;
+    stack.Push(root_);
+
+    while (!stack.Empty())
+    {
+        const DrawableTreeNode& node = nodes_[stack.Back()];
+        stack.Pop();
+
+        if (!debug->IsInside(node.box_))
+            continue;
+
+        if (node.drawable_)
+            debug->AddBoundingBox(node.box_, Color(0.25f, 0.25f, 0.25f), depthTest);
+        else
+        {
+            debug->AddBoundingBox(node.box_, Color(0.5f, 0.5f, 0.5f), depthTest);
+            stack.Push(node.child1_);
+            stack.Push(node.child2_);
+        }
+    }
+}
+
+unsigned DrawableTree::AllocateNode()
+{
+    unsigned index;
+    if (freeList_ != M_MAX_UNSIGNED)
+    {
+        index = freeList_;
+        freeList_ = nodes_[index].parent_;
+    }
+    else
+    {
+        index = nodes_.Size();
+        nodes_.Resize(index + 1);
+    }
+
+    DrawableTreeNode& node = nodes_[index];
+    node.drawable_ = 0;
+    node.parent_ = M_MAX_UNSIGNED;
+    node.child1_ = M_MAX_UNSIGNED;
+    node.child2_ = M_MAX_UNSIGNED;
+    node.height_ = 0;
+    return index;
+}
+
+void DrawableTree::FreeNode(unsigned node)
+{
+    nodes_[node].drawable_ = 0;
+    nodes_[node].height_ = -1;
+    nodes_[node].parent_ = freeList_;
+    freeList_ = node;
+}
+
+void DrawableTree::InsertLeaf(unsigned leaf)
+{
+    if (root_ == M_MAX_UNSIGNED)
+    {
+        root_ = leaf;
+        nodes_[leaf].parent_ = M_MAX_UNSIGNED;
+        return;
+    }
+
+    // Descend to the sibling which gives the least surface area increase, counting the increase inherited by the ancestors
+    BoundingBox leafBox = nodes_[leaf].box_;
+    unsigned index = root_;
+    while (!nodes_[index].drawable_)
+    {
+        const DrawableTreeNode& node = nodes_[index];
+        float area = SurfaceArea(node.box_);
+        float combinedArea = SurfaceArea(MergeBoxes(node.box_, leafBox));
+
+        // Cost of creating a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+        // Minimum cost of pushing the leaf further down
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        const DrawableTreeNode& child1 = nodes_[node.child1_];
+        float cost1 = SurfaceArea(MergeBoxes(child1.box_, leafBox)) + inheritanceCost;
+        if (!child1.drawable_)
+            cost1 -= SurfaceArea(child1.box_);
+
+        const DrawableTreeNode& child2 = nodes_[node.child2_];
+        float cost2 = SurfaceArea(MergeBoxes(child2.box_, leafBox)) + inheritanceCost;
+        if (!child2.drawable_)
+            cost2 -= SurfaceArea(child2.box_);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? node.child1_ : node.child2_;
+    }
+
+    // Create a new parent for the sibling and the leaf
+    unsigned sibling = index;
+    unsigned newParent = AllocateNode();
+    unsigned oldParent = nodes_[sibling].parent_;
+    DrawableTreeNode& parent = nodes_[newParent];
+    parent.parent_ = oldParent;
+    parent.box_ = MergeBoxes(leafBox, nodes_[sibling].box_);
+    parent.height_ = nodes_[sibling].height_ + 1;
+    parent.child1_ = sibling;
+    parent.child2_ = leaf;
+
+    if (oldParent != M_MAX_UNSIGNED)
+    {
+        if (nodes_[oldParent].child1_ == sibling)
+            nodes_[oldParent].child1_ = newParent;
+        else
+            nodes_[oldParent].child2_ = newParent;
+    }
+    else
+        root_ = newParent;
+
+    nodes_[sibling].parent_ = newParent;
+    nodes_[leaf].parent_ = newParent;
+
+    Refit(newParent);
+}
+
+void DrawableTree::RemoveLeaf(unsigned leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = M_MAX_UNSIGNED;
+        return;
+    }
+
+    // Replace the parent with the sibling
+    unsigned parent = nodes_[leaf].parent_;
+    unsigned grandParent = nodes_[parent].parent_;
+    unsigned sibling = nodes_[parent].child1_ == leaf ? nodes_[parent].child2_ : nodes_[parent].child1_;
+
+    nodes_[sibling].parent_ = grandParent;
+    FreeNode(parent);
+
+    if (grandParent != M_MAX_UNSIGNED)
+    {
+        if (nodes_[grandParent].child1_ == parent)
+            nodes_[grandParent].child1_ = sibling;
+        else
+            nodes_[grandParent].child2_ = sibling;
+
+        Refit(grandParent);
+    }
+    else
+        root_ = sibling;
+}
+
+void DrawableTree::Refit(unsigned index)
+{
+    while (index != M_MAX_UNSIGNED)
+    {
+        index = Balance(index);
+
+        DrawableTreeNode& node = nodes_[index];
+        const DrawableTreeNode& child1 = nodes_[node.child1_];
+        const DrawableTreeNode& child2 = nodes_[node.child2_];
+        node.height_ = 1 + Max(child1.height_, child2.height_);
+        node.box_ = MergeBoxes(child1.box_, child2.box_);
+
+        index = node.parent_;
+    }
+}
+
+unsigned DrawableTree::Balance(unsigned iA)
+{
+    DrawableTreeNode& a = nodes_[iA];
+    if (a.drawable_ || a.height_ < 2)
+        return iA;
+
+    unsigned iB = a.child1_;
+    unsigned iC = a.child2_;
+    DrawableTreeNode& b = nodes_[iB];
+    DrawableTreeNode& c = nodes_[iC];
+    int balance = c.height_ - b.height_;
+
+    // Rotate C up
+    if (balance > 1)
+    {
+        unsigned iF = c.child1_;
+        unsigned iG = c.child2_;
+        DrawableTreeNode& f = nodes_[iF];
+        DrawableTreeNode& g = nodes_[iG];
+
+        c.child1_ = iA;
+        c.parent_ = a.parent_;
+        a.parent_ = iC;
+
+        if (c.parent_ != M_MAX_UNSIGNED)
+        {
+            if (nodes_[c.parent_].child1_ == iA)
+                nodes_[c.parent_].child1_ = iC;
+            else
+                nodes_[c.parent_].child2_ = iC;
+        }
+        else
+            root_ = iC;
+
+        if (f.height_ > g.height_)
+        {
+            c.child2_ = iF;
+            a.child2_ = iG;
+            g.parent_ = iA;
+            a.box_ = MergeBoxes(b.box_, g.box_);
+            c.box_ = MergeBoxes(a.box_, f.box_);
+            a.height_ = 1 + Max(b.height_, g.height_);
+            c.height_ = 1 + Max(a.height_, f.height_);
+        }
+        else
+        {
+            c.child2_ = iG;
+            a.child2_ = iF;
+            f.parent_ = iA;
+            a.box_ = MergeBoxes(b.box_, f.box_);
+            c.box_ = MergeBoxes(a.box_, g.box_);
+            a.height_ = 1 + Max(b.height_, f.height_);
+            c.height_ = 1 + Max(a.height_, g.height_);
+        }
+
+        return iC;
+    }
+
+    // Rotate B up
+    if (balance < -1)
+    {
+        unsigned iD = b.child1_;
+        unsigned iE = b.child2_;
+        DrawableTreeNode& d = nodes_[iD];
+        DrawableTreeNode& e = nodes_[iE];
+
+        b.child1_ = iA;
+        b.parent_ = a.parent_;
+        a.parent_ = iB;
+
+        if (b.parent_ != M_MAX_UNSIGNED)
+        {
+            if (nodes_[b.parent_].child1_ == iA)
+                nodes_[b.parent_].child1_ = iB;
+            else
+                nodes_[b.parent_].child2_ = iB;
+        }
+        else
+            root_ = iB;
+
+        if (d.height_ > e.height_)
+        {
+            b.child2_ = iD;
+            a.child1_ = iE;
+            e.parent_ = iA;
+            a.box_ = MergeBoxes(c.box_, e.box_);
+            b.box_ = MergeBoxes(a.box_, d.box_);
+            a.height_ = 1 + Max(c.height_, e.height_);
+            b.height_ = 1 + Max(a.height_, d.height_);
+        }
+        else
+        {
+            b.child2_ = iE;
+            a.child1_ = iD;
+            d.parent_ = iA;
+            a.box_ = MergeBoxes(c.box_, d.box_);
+            b.box_ = MergeBoxes(a.box_, e.box_);
+            a.height_ = 1 + Max(c.height_, d.height_);
+            b.height_ = 1 + Max(a.height_, e.height_);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+void DrawableTree::GetDrawablesInternal(unsigned index, OctreeQuery& query, bool inside) const
+{
+    const DrawableTreeNode& node = nodes_[index];
+
+    Intersection res = query.TestOctant(node.box_, inside);
+    if (res == OUTSIDE)
+        return;
+    else if (res == INSIDE)
+        inside = true;
+
+    if (node.drawable_)
+    {
+        Drawable* drawable = node.drawable_;
+        query.TestDrawables(&drawable, &drawable + 1, inside);
+    }
+    else
+    {
+        GetDrawablesInternal(node.child1_, query, inside);
+        GetDrawablesInternal(node.child2_, query, inside);
+    }
+}
+
+void DrawableTree::RaycastInternal(unsigned index, RayOctreeQuery& query) const
+{
+    const DrawableTreeNode& node = nodes_[index];
+
+    if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+        return;
+
+    if (node.drawable_)
+    {
+        Drawable* drawable = node.drawable_;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawable->ProcessRayQuery(query, query.result_);
+    }
+    else
+    {
+        RaycastInternal(node.child1_, query);
+        RaycastInternal(node.child2_, query);
+    }
+}
+
+void DrawableTree::RaycastInternal(unsigned index, RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates) const
+{
+    const DrawableTreeNode& node = nodes_[index];
+
+    // Drop the rays that miss the node
+    unsigned hitMask = 0;
+    for (unsigned i = 0, remaining = mask; remaining; ++i, remaining >>= 1)
+    {
+        if ((remaining & 1) && queries[i]->ray_.HitDistance(node.box_) < queries[i]->maxDistance_)
+            hitMask |= 1u << i;
+    }
+    if (!hitMask)
+        return;
+
+    if (node.drawable_)
+        ProcessRayPacket(node.drawable_, queries, hitMask, candidates);
+    else
+    {
+        RaycastInternal(node.child1_, queries, hitMask, candidates);
+        RaycastInternal(node.child2_, queries, hitMask, candidates);
+    }
+}
+
+void DrawableTree::GetDrawablesOnlyInternal(unsigned index, RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    const DrawableTreeNode& node = nodes_[index];
+
+    if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+        return;
+
+    if (node.drawable_)
+    {
+        Drawable* drawable = node.drawable_;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawables.Push(drawable);
+    }
+    else
+    {
+        GetDrawablesOnlyInternal(node.child1_, query, drawables);
+        GetDrawablesOnlyInternal(node.child2_, query, drawables);
+    }
+}
+
+}
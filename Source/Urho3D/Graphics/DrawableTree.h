@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+class DebugRenderer;
+class Drawable;
+class OctreeQuery;
+class RayOctreeQuery;
+
+/// Node of a drawable bounding volume tree.
+struct DrawableTreeNode
+{
+    /// Bounding box. For leaves this is the drawable's bounding box enlarged by a margin.
+    BoundingBox box_;
+    /// Drawable, or null for internal nodes.
+    Drawable* drawable_;
+    /// Parent node index, or the next free node index if the node is unused.
+    unsigned parent_;
+    /// First child node index.
+    unsigned child1_;
+    /// Second child node index.
+    unsigned child2_;
+    /// Height in the tree, 0 for leaves.
+    int height_;
+};
+
+/// Dynamic bounding volume tree of drawables. Leaves hold enlarged bounding boxes, so that small movements do not require restructuring the tree.
+class URHO3D_API DrawableTree
+{
+public:
+    /// Construct.
+    DrawableTree();
+
+    /// Insert a drawable with its world bounding box. Return the leaf node index.
+    unsigned Insert(Drawable* drawable, const BoundingBox& box);
+    /// Remove a drawable by leaf node index.
+    void Remove(unsigned node);
+    /// Update a drawable's world bounding box by leaf node index. The leaf is reinserted only if the box has moved outside its enlarged box. Return true if reinserted.
+    bool Move(unsigned node, const BoundingBox& box);
+    /// Remove all drawables.
+    void Clear();
+
+    /// Return drawables by a query.
+    void GetDrawables(OctreeQuery& query) const;
+    /// Return drawables by a ray query.
+    void Raycast(RayOctreeQuery& query) const;
+    /// Return drawables whose enlarged bounding box is hit by a ray query, without performing the actual ray test.
+    void GetDrawablesOnly(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return drawables by a packet of ray queries selected by a bit mask. If candidates is non-null, the drawables are only collected per query for a closest hit test.
+    void Raycast(RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates) const;
+    /// Draw the node bounding boxes to the debug graphics.
+    void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const;
+
+    /// Return number of drawables.
+    unsigned GetNumDrawables() const { return numDrawables_; }
+    /// Return height of the tree.
+    int GetHeight() const { return root_ != M_MAX_UNSIGNED ? nodes_[root_].height_ : 0; }
+
+private:
+    /// Allocate a node.
+    unsigned AllocateNode();
+    /// Return a node to the free list.
+    void FreeNode(unsigned node);
+    /// Insert a leaf, choosing the sibling by the least surface area increase.
+    void InsertLeaf(unsigned leaf);
+    /// Detach a leaf from the tree.
+    void RemoveLeaf(unsigned leaf);
+    /// Recalculate the bounding boxes and heights from a node up to the root, rebalancing on the way.
+    void Refit(unsigned node);
+    /// Rotate a node's taller child up if the children's heights differ by more than one. Return the node now at the position.
+    unsigned Balance(unsigned node);
+    /// Return drawables by a query from a node, called internally.
+    void GetDrawablesInternal(unsigned node, OctreeQuery& query, bool inside) const;
+    /// Return drawables by a ray query from a node, called internally.
+    void RaycastInternal(unsigned node, RayOctreeQuery& query) const;
+    /// Return drawables hit by a ray query from a node, called internally.
+    void GetDrawablesOnlyInternal(unsigned node, RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return drawables by a packet of ray queries from a node, called internally.
+    void RaycastInternal(unsigned node, RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates) const;
+
+    /// Nodes.
+    PODVector<DrawableTreeNode> nodes_;
+    /// Root node index.
+    unsigned root_;
+    /// First free node index.
+    unsigned freeList_;
+    /// Number of drawables.
+    unsigned numDrawables_;
+};
+
+}
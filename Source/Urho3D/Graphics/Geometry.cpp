@@ -25,6 +25,7 @@
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/IndexBuffer.h"
+#include "../Graphics/SortIDAllocator.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../IO/Log.h"
 #include "../Math/Ray.h"
@@ -34,6 +35,9 @@
 namespace Urho3D
 {
 
+/// Sort ID allocator for geometries.
+static SortIDAllocator sortIDs;
+
 Geometry::Geometry(Context* context) :
     Object(context),
     primitiveType_(TRIANGLE_LIST),
@@ -43,13 +47,15 @@ Geometry::Geometry(Context* context) :
     vertexCount_(0),
     rawVertexSize_(0),
     rawIndexSize_(0),
-    lodDistance_(0.0f)
+    lodDistance_(0.0f),
+    sortID_(sortIDs.Allocate())
 {
     SetNumVertexBuffers(1);
 }
 
 Geometry::~Geometry()
 {
+    sortIDs.Free(sortID_);
 }
 
 bool Geometry::SetNumVertexBuffers(unsigned num)
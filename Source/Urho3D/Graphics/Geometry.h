@@ -97,6 +97,9 @@ public:
     /// Return LOD distance.
     float GetLodDistance() const { return lodDistance_; }
 
+    /// Return dense ID for draw call sorting.
+    unsigned GetSortID() const { return sortID_; }
+
     /// Return buffers' combined hash value for state sorting.
     unsigned short GetBufferHash() const;
     /// Return raw vertex and index data for CPU operations, or null pointers if not available. Will return data of the first vertex buffer if override data not set.
@@ -129,6 +132,8 @@ private:
     unsigned vertexCount_;
     /// LOD distance.
     float lodDistance_;
+    /// Dense ID for draw call sorting.
+    unsigned sortID_;
     /// Raw vertex data elements.
     PODVector<VertexElement> rawElements_;
     /// Raw vertex data override.
@@ -51,6 +51,7 @@
 #include "../Graphics/Zone.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_syswm.h>
@@ -263,6 +264,24 @@ void Graphics::SetShaderCacheDir(const String& path)
         shaderCacheDir_ = AddTrailingSlash(trimmedPath);
 }
 
+ShaderVariation* Graphics::GetShader(ShaderType type, const String& name, const ShaderDefineMask& defines) const
+{
+    if (lastShaderName_ != name || !lastShader_)
+    {
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+        String fullShaderName = shaderPath_ + name + shaderExtension_;
+        // Try to reduce repeated error log prints because of missing shaders
+        if (lastShaderName_ == name && !cache->Exists(fullShaderName))
+            return 0;
+
+        lastShader_ = cache->GetResource<Shader>(fullShaderName);
+        lastShaderName_ = name;
+    }
+
+    return lastShader_ ? lastShader_->GetVariation(type, defines) : (ShaderVariation*)0;
+}
+
 void Graphics::AddGPUObject(GPUObject* object)
 {
     MutexLock lock(gpuObjectMutex_);
@@ -58,6 +58,7 @@ class Vector4;
 class VertexBuffer;
 class VertexDeclaration;
 
+struct ShaderDefineMask;
 struct ShaderParameter;
 
 /// CPU-side scratch buffer for vertex data updates.
@@ -249,7 +250,7 @@ public:
     void EndDumpShaders();
     /// Precache shader variations from an XML file generated with BeginDumpShaders().
     void PrecacheShaders(Deserializer& source);
-    /// Set shader cache directory, Direct3D only. This can either be an absolute path or a path within the resource system.
+    /// Set shader cache directory for Direct3D shader bytecode and desktop OpenGL program binaries. This can either be an absolute path or a path within the resource system.
     void SetShaderCacheDir(const String& path);
 
     /// Return whether rendering initialized.
@@ -380,6 +381,8 @@ public:
     ShaderVariation* GetShader(ShaderType type, const String& name, const String& defines = String::EMPTY) const;
     /// Return a shader variation by name and defines.
     ShaderVariation* GetShader(ShaderType type, const char* name, const char* defines) const;
+    /// Return a shader variation by name and interned define set.
+    ShaderVariation* GetShader(ShaderType type, const String& name, const ShaderDefineMask& defines) const;
     /// Return current vertex buffer by index.
     VertexBuffer* GetVertexBuffer(unsigned index) const;
 
@@ -480,7 +483,7 @@ public:
     /// Return whether a custom clipping plane is in use.
     bool GetUseClipPlane() const { return useClipPlane_; }
 
-    /// Return shader cache directory, Direct3D only.
+    /// Return shader cache directory.
     const String& GetShaderCacheDir() const { return shaderCacheDir_; }
 
     /// Return current rendertarget width and height.
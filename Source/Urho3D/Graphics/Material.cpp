@@ -28,6 +28,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/Renderer.h"
+#include "../Graphics/SortIDAllocator.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Texture2D.h"
 #include "../Graphics/Texture2DArray.h"
@@ -50,6 +51,9 @@ namespace Urho3D
 
 extern const char* wrapModeNames[];
 
+/// Sort ID allocator for materials.
+static SortIDAllocator sortIDs;
+
 static const char* textureUnitNames[] =
 {
     "diffuse",
@@ -209,6 +213,7 @@ Material::Material(Context* context) :
     Resource(context),
     auxViewFrameNumber_(0),
     shaderParameterHash_(0),
+    sortID_(sortIDs.Allocate()),
     alphaToCoverage_(false),
     lineAntiAlias_(false),
     occlusion_(true),
@@ -221,6 +226,7 @@ Material::Material(Context* context) :
 
 Material::~Material()
 {
+    sortIDs.Free(sortID_);
 }
 
 void Material::RegisterObject(Context* context)
@@ -255,6 +255,9 @@ public:
     /// Return shader parameter hash value. Used as an optimization to avoid setting shader parameters unnecessarily.
     unsigned GetShaderParameterHash() const { return shaderParameterHash_; }
 
+    /// Return dense ID for draw call sorting.
+    unsigned GetSortID() const { return sortID_; }
+
     /// Return name for texture unit.
     static String GetTextureUnitName(TextureUnit unit);
     /// Parse a shader parameter value from a string. Retunrs either a bool, a float, or a 2 to 4-component vector.
@@ -307,6 +310,8 @@ private:
     unsigned auxViewFrameNumber_;
     /// Shader parameter hash value.
     unsigned shaderParameterHash_;
+    /// Dense ID for draw call sorting.
+    unsigned sortID_;
     /// Alpha-to-coverage flag.
     bool alphaToCoverage_;
     /// Line antialiasing flag.
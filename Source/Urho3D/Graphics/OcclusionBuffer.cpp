@@ -28,6 +28,10 @@
 #include "../Graphics/OcclusionBuffer.h"
 #include "../IO/Log.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -39,23 +43,249 @@ static const unsigned CLIPMASK_Y_POS = 0x4;
 static const unsigned CLIPMASK_Y_NEG = 0x8;
 static const unsigned CLIPMASK_Z_POS = 0x10;
 static const unsigned CLIPMASK_Z_NEG = 0x20;
+static const float REPROJECTION_TOLERANCE = 0.01f;
+
+/// Occlusion batch setup functor for WorkQueue::ParallelFor.
+struct SetupOcclusionBatchesWork
+{
+    /// Construct.
+    SetupOcclusionBatchesWork(OcclusionBuffer* buffer, const PODVector<OcclusionBatch>& batches) :
+        buffer_(buffer),
+        batches_(batches)
+    {
+    }
+
+    /// Set up the triangles of a range of batches.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        for (unsigned i = begin; i < end; ++i)
+            buffer_->DrawBatch(batches_[i], threadIndex);
+    }
+
+    /// Occlusion buffer.
+    OcclusionBuffer* buffer_;
+    /// Batches.
+    const PODVector<OcclusionBatch>& batches_;
+};
 
-void DrawOcclusionBatchWork(const WorkItem* item, unsigned threadIndex)
+/// Occlusion tile rasterization functor for WorkQueue::ParallelFor.
+struct DrawOcclusionTilesWork
 {
-    OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
-    OcclusionBatch& batch = *reinterpret_cast<OcclusionBatch*>(item->start_);
-    buffer->DrawBatch(batch, threadIndex);
+    /// Construct.
+    DrawOcclusionTilesWork(OcclusionBuffer* buffer) :
+        buffer_(buffer)
+    {
+    }
+
+    /// Rasterize a range of tiles.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        for (unsigned i = begin; i < end; ++i)
+            buffer_->DrawTile(i);
+    }
+
+    /// Occlusion buffer.
+    OcclusionBuffer* buffer_;
+};
+
+#ifdef URHO3D_SSE
+static inline float HorizontalMin(__m128 v)
+{
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
 }
 
+static inline float HorizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+#endif
+
+/// Projects bounding boxes to occlusion buffer pixel rectangles, with the transform set up once for testing many boxes.
+class OcclusionBoxProjector
+{
+public:
+    /// Construct.
+    OcclusionBoxProjector(const Matrix4& viewProj, float scaleX, float scaleY, float offsetX, float offsetY, int width, int height) :
+#ifndef URHO3D_SSE
+        viewProj_(viewProj),
+        scaleX_(scaleX),
+        scaleY_(scaleY),
+        offsetX_(offsetX),
+        offsetY_(offsetY),
+#endif
+        width_(width),
+        height_(height)
+    {
+#ifdef URHO3D_SSE
+        const float* m = viewProj.Data();
+        for (unsigned i = 0; i < 16; ++i)
+            matrix_[i] = _mm_set1_ps(m[i]);
+        scaleX_ = _mm_set1_ps(scaleX);
+        scaleY_ = _mm_set1_ps(scaleY);
+        offsetX_ = _mm_set1_ps(offsetX);
+        offsetY_ = _mm_set1_ps(offsetY);
+#endif
+    }
+
+    /// Project a bounding box into a clipped pixel rectangle and minimum depth. Return false if the box must be assumed visible.
+    bool Project(const BoundingBox& box, IntRect& rect, int& z) const
+    {
+        float minX, maxX, minY, maxY, minZ;
+
+#ifdef URHO3D_SSE
+        // Transform the corners to projection space, the four minimum Z corners in one register and the four maximum Z corners in another
+        __m128 x = _mm_setr_ps(box.min_.x_, box.max_.x_, box.min_.x_, box.max_.x_);
+        __m128 y = _mm_setr_ps(box.min_.y_, box.min_.y_, box.max_.y_, box.max_.y_);
+        __m128 z0 = _mm_set1_ps(box.min_.z_);
+        __m128 z1 = _mm_set1_ps(box.max_.z_);
+        __m128 clip0[4];
+        __m128 clip1[4];
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            const __m128* row = matrix_ + i * 4;
+            __m128 xy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[0], x), _mm_mul_ps(row[1], y)), row[3]);
+            clip0[i] = _mm_add_ps(xy, _mm_mul_ps(row[2], z0));
+            clip1[i] = _mm_add_ps(xy, _mm_mul_ps(row[2], z1));
+        }
+
+        // Apply a far clip relative bias. If any of the corners cross the near plane, assume visible
+        __m128 bias = _mm_set1_ps(OCCLUSION_RELATIVE_BIAS);
+        clip0[2] = _mm_sub_ps(clip0[2], bias);
+        clip1[2] = _mm_sub_ps(clip1[2], bias);
+        __m128 zero = _mm_setzero_ps();
+        if (_mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(clip0[2], zero), _mm_cmple_ps(clip1[2], zero))))
+            return false;
+
+        // Transform to screen space
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 invW0 = _mm_div_ps(one, clip0[3]);
+        __m128 invW1 = _mm_div_ps(one, clip1[3]);
+        __m128 x0 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip0[0], invW0), scaleX_), offsetX_);
+        __m128 x1 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip1[0], invW1), scaleX_), offsetX_);
+        __m128 y0 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip0[1], invW0), scaleY_), offsetY_);
+        __m128 y1 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip1[1], invW1), scaleY_), offsetY_);
+        __m128 depth = _mm_min_ps(_mm_mul_ps(clip0[2], invW0), _mm_mul_ps(clip1[2], invW1));
+
+        minX = HorizontalMin(_mm_min_ps(x0, x1));
+        maxX = HorizontalMax(_mm_max_ps(x0, x1));
+        minY = HorizontalMin(_mm_min_ps(y0, y1));
+        maxY = HorizontalMax(_mm_max_ps(y0, y1));
+        minZ = HorizontalMin(depth) * OCCLUSION_Z_SCALE;
+#else
+        Vector3 corners[8] =
+        {
+            box.min_,
+            Vector3(box.max_.x_, box.min_.y_, box.min_.z_),
+            Vector3(box.min_.x_, box.max_.y_, box.min_.z_),
+            Vector3(box.max_.x_, box.max_.y_, box.min_.z_),
+            Vector3(box.min_.x_, box.min_.y_, box.max_.z_),
+            Vector3(box.max_.x_, box.min_.y_, box.max_.z_),
+            Vector3(box.min_.x_, box.max_.y_, box.max_.z_),
+            box.max_
+        };
+
+        minX = minY = minZ = M_INFINITY;
+        maxX = maxY = -M_INFINITY;
+
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            Vector4 vertex = viewProj_ * Vector4(corners[i], 1.0f);
+
+            // Apply a far clip relative bias. If any of the corners cross the near plane, assume visible
+            vertex.z_ -= OCCLUSION_RELATIVE_BIAS;
+            if (vertex.z_ <= 0.0f)
+                return false;
+
+            // Transform to screen space
+            float invW = 1.0f / vertex.w_;
+            float projectedX = invW * vertex.x_ * scaleX_ + offsetX_;
+            float projectedY = invW * vertex.y_ * scaleY_ + offsetY_;
+            float projectedZ = invW * vertex.z_ * OCCLUSION_Z_SCALE;
+
+            if (projectedX < minX) minX = projectedX;
+            if (projectedX > maxX) maxX = projectedX;
+            if (projectedY < minY) minY = projectedY;
+            if (projectedY > maxY) maxY = projectedY;
+            if (projectedZ < minZ) minZ = projectedZ;
+        }
+#endif
+
+        // Expand the bounding box 1 pixel in each direction to be conservative and correct rasterization offset
+        rect = IntRect(
+            (int)(minX - 1.5f), (int)(minY - 1.5f),
+            (int)(maxX + 0.5f), (int)(maxY + 0.5f)
+        );
+
+        // If the rect is outside, let frustum culling handle
+        if (rect.right_ < 0 || rect.bottom_ < 0)
+            return false;
+        if (rect.left_ >= width_ || rect.top_ >= height_)
+            return false;
+
+        // Clipping of rect
+        if (rect.left_ < 0)
+            rect.left_ = 0;
+        if (rect.top_ < 0)
+            rect.top_ = 0;
+        if (rect.right_ >= width_)
+            rect.right_ = width_ - 1;
+        if (rect.bottom_ >= height_)
+            rect.bottom_ = height_ - 1;
+
+        // Convert depth to integer and apply final bias
+        z = (int)(minZ + 0.5f) - OCCLUSION_FIXED_BIAS;
+        return true;
+    }
+
+private:
+#ifdef URHO3D_SSE
+    /// View-projection matrix elements, each replicated to all lanes.
+    __m128 matrix_[16];
+    /// Viewport X scale.
+    __m128 scaleX_;
+    /// Viewport Y scale.
+    __m128 scaleY_;
+    /// Viewport X offset.
+    __m128 offsetX_;
+    /// Viewport Y offset.
+    __m128 offsetY_;
+#else
+    /// View-projection matrix.
+    Matrix4 viewProj_;
+    /// Viewport X scale.
+    float scaleX_;
+    /// Viewport Y scale.
+    float scaleY_;
+    /// Viewport X offset.
+    float offsetX_;
+    /// Viewport Y offset.
+    float offsetY_;
+#endif
+    /// Buffer width.
+    int width_;
+    /// Buffer height.
+    int height_;
+};
+
 OcclusionBuffer::OcclusionBuffer(Context* context) :
     Object(context),
     width_(0),
     height_(0),
+    tileWidth_(0),
+    numTilesX_(0),
+    numTilesY_(0),
     numTriangles_(0),
     maxTriangles_(OCCLUSION_DEFAULT_MAX_TRIANGLES),
     cullMode_(CULL_CCW),
     depthHierarchyDirty_(true),
     reverseCulling_(false),
+    threaded_(false),
+    historyValid_(false),
+    frameNumber_(0),
     nearClip_(0.0f),
     farClip_(0.0f)
 {
@@ -70,8 +300,13 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
     // Force the height to an even amount of pixels for better mip generation
     if (height & 1)
         ++height;
+    // The rasterizer processes 8 pixel wide spans, so force a minimum width
+    if (width > 0 && width < OCCLUSION_MIN_SIZE)
+        width = OCCLUSION_MIN_SIZE;
 
-    if (width == width_ && height == height_)
+    unsigned numThreadBuffers = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
+
+    if (width == width_ && height == height_ && numThreadBuffers == buffers_.Size())
         return true;
 
     if (width <= 0 || height <= 0)
@@ -85,19 +320,29 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
 
     width_ = width;
     height_ = height;
-
-    // Build work buffers for threading
-    unsigned numThreadBuffers = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
+    threaded_ = threaded;
+    data_ = new int[width * height];
+    pixelFrames_.Reset();
+    historyData_.Reset();
+    historyFrames_.Reset();
+    historyValid_ = false;
+
+    // Build triangle setup buffers for threading
     buffers_.Resize(numThreadBuffers);
     for (unsigned i = 0; i < numThreadBuffers; ++i)
     {
-        // Reserve extra memory in case 3D clipping is not exact
-        OcclusionBufferData& buffer = buffers_[i];
-        buffer.dataWithSafety_ = new int[width * (height + 2) + 2];
-        buffer.data_ = buffer.dataWithSafety_.Get() + width + 1;
-        buffer.used_ = false;
+        buffers_[i].triangles_.Clear();
+        buffers_[i].numDrawnTriangles_ = 0;
     }
 
+    // Build the tiles. The tile width is a multiple of the span width so that spans never cross tiles
+    tileWidth_ = Min(width_, OCCLUSION_TILE_WIDTH);
+    numTilesX_ = width_ / tileWidth_;
+    numTilesY_ = (height_ + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+    tileTriangles_.Clear();
+    tileTriangles_.Resize((unsigned)(numTilesX_ * numTilesY_));
+    tileMaxDepths_.Resize((unsigned)(numTilesX_ * numTilesY_));
+
     mipBuffers_.Clear();
 
     // Build buffers for mip levels
@@ -113,8 +358,10 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
     }
 
     URHO3D_LOGDEBUG("Set occlusion buffer size " + String(width_) + "x" + String(height_) + " with " +
-             String(mipBuffers_.Size()) + " mip levels and " + String(numThreadBuffers) + " thread buffers");
+             String(mipBuffers_.Size()) + " mip levels, " + String(tileTriangles_.Size()) + " tiles and " +
+             String(numThreadBuffers) + " thread buffers");
 
+    Clear();
     CalculateViewport();
     return true;
 }
@@ -160,14 +407,135 @@ void OcclusionBuffer::Clear()
 {
     Reset();
 
-    // Only clear the main thread buffer. Rest are cleared on-demand when drawing the first batch
-    ClearBuffer(0);
-    for (unsigned i = 1; i < buffers_.Size(); ++i)
-        buffers_[i].used_ = false;
+    if (!data_)
+        return;
+
+    int fillValue = (int)OCCLUSION_Z_SCALE;
+
+    int* dest = data_.Get();
+    int count = width_ * height_;
+    while (count--)
+        *dest++ = fillValue;
+
+    for (unsigned i = 0; i < tileMaxDepths_.Size(); ++i)
+        tileMaxDepths_[i] = fillValue;
 
     depthHierarchyDirty_ = true;
 }
 
+bool OcclusionBuffer::Reproject(unsigned maxAge)
+{
+    if (!data_)
+        return false;
+
+    ++frameNumber_;
+
+    // History can be used only if it was drawn with frame numbers and the same projection
+    bool usable = historyValid_ && pixelFrames_ && historyProjection_.Equals(projection_);
+    historyValid_ = false;
+    if (!pixelFrames_)
+    {
+        pixelFrames_ = new unsigned[width_ * height_];
+        historyData_ = new int[width_ * height_];
+        historyFrames_ = new unsigned[width_ * height_];
+    }
+    if (!usable)
+    {
+        Clear();
+        return false;
+    }
+
+    URHO3D_PROFILE(ReprojectOcclusion);
+
+    // Keep the previous frame's pixels aside and start from a cleared buffer
+    Swap(data_, historyData_);
+    Swap(pixelFrames_, historyFrames_);
+    Clear();
+
+    // Each source pixel is treated as a one pixel cell around its sample point. Transform the cell center and the half pixel
+    // steps separately, as the transform is linear until the perspective divide
+    Matrix4 reprojection = viewProj_ * historyViewProj_.Inverse();
+    Vector4 halfStepX = reprojection * Vector4(0.5f / scaleX_, 0.0f, 0.0f, 0.0f);
+    Vector4 halfStepY = reprojection * Vector4(0.0f, 0.5f / scaleY_, 0.0f, 0.0f);
+    int fillValue = (int)OCCLUSION_Z_SCALE;
+
+    for (int y = 0; y < height_; ++y)
+    {
+        const int* src = historyData_.Get() + y * width_;
+        const unsigned* srcFrames = historyFrames_.Get() + y * width_;
+
+        for (int x = 0; x < width_; ++x)
+        {
+            if (src[x] >= fillValue || frameNumber_ - srcFrames[x] > maxAge)
+                continue;
+
+            // Use the farthest depth of the pixel and its covered neighbours, as the surface may slope across the cell
+            int depth = src[x];
+            if (x > 0 && src[x - 1] < fillValue)
+                depth = Max(depth, src[x - 1]);
+            if (x < width_ - 1 && src[x + 1] < fillValue)
+                depth = Max(depth, src[x + 1]);
+            if (y > 0 && src[x - width_] < fillValue)
+                depth = Max(depth, src[x - width_]);
+            if (y < height_ - 1 && src[x + width_] < fillValue)
+                depth = Max(depth, src[x + width_]);
+
+            float sampleX = (float)(x + 1);
+            float sampleY = (float)(y + 1);
+            Vector4 center = reprojection * Vector4((sampleX - offsetX_) / scaleX_, (sampleY - offsetY_) / scaleY_,
+                (float)depth / OCCLUSION_Z_SCALE, 1.0f);
+
+            Vector4 corners[4] =
+            {
+                center - halfStepX - halfStepY,
+                center + halfStepX - halfStepY,
+                center - halfStepX + halfStepY,
+                center + halfStepX + halfStepY
+            };
+
+            Vector3 projected[4];
+            bool behind = false;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                if (corners[i].w_ <= 0.0f || corners[i].z_ < 0.0f)
+                {
+                    behind = true;
+                    break;
+                }
+                projected[i] = ViewportTransform(corners[i]);
+            }
+            if (behind)
+                continue;
+
+            // Fill the pixels whose sample points are enclosed by the reprojected cell
+            int left = Max(CeilToInt(Max(projected[0].x_, projected[2].x_) - REPROJECTION_TOLERANCE) - 1, 0);
+            int right = Min(FloorToInt(Min(projected[1].x_, projected[3].x_) + REPROJECTION_TOLERANCE) - 1, width_ - 1);
+            int top = Max(CeilToInt(Max(projected[0].y_, projected[1].y_) - REPROJECTION_TOLERANCE) - 1, 0);
+            int bottom = Min(FloorToInt(Min(projected[2].y_, projected[3].y_) + REPROJECTION_TOLERANCE) - 1, height_ - 1);
+            float maxZ = Max(Max(projected[0].z_, projected[1].z_), Max(projected[2].z_, projected[3].z_));
+            int z = CeilToInt(maxZ);
+            if (z >= fillValue)
+                continue;
+
+            for (int py = top; py <= bottom; ++py)
+            {
+                int* dest = data_.Get() + py * width_;
+                unsigned* destFrames = pixelFrames_.Get() + py * width_;
+                for (int px = left; px <= right; ++px)
+                {
+                    if (z < dest[px])
+                    {
+                        dest[px] = z;
+                        destFrames[px] = srcFrames[x];
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart,
     unsigned vertexCount)
 {
@@ -206,32 +574,34 @@ bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexDat
 
 void OcclusionBuffer::DrawTriangles()
 {
-    if (buffers_.Size() == 1)
-    {
-        // Not threaded
-        for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
-            DrawBatch(*i, 0);
-
-        depthHierarchyDirty_ = true;
-    }
-    else if (buffers_.Size() > 1)
+    if (data_ && batches_.Size())
     {
-        // Threaded
-        WorkQueue* queue = GetSubsystem<WorkQueue>();
-
-        for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
+        // Set up the triangles, then sort them into screen tiles and rasterize each tile independently
+        if (threaded_)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = DrawOcclusionBatchWork;
-            item->aux_ = this;
-            item->start_ = &(*i);
-            queue->AddWorkItem(item);
+            WorkQueue* queue = GetSubsystem<WorkQueue>();
+            queue->ParallelFor(0, batches_.Size(), 1, SetupOcclusionBatchesWork(this, batches_));
+            BinTriangles();
+            queue->ParallelFor(0, tileTriangles_.Size(), 1, DrawOcclusionTilesWork(this));
+        }
+        else
+        {
+            for (PODVector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
+                DrawBatch(*i, 0);
+            BinTriangles();
+            for (unsigned i = 0; i < tileTriangles_.Size(); ++i)
+                DrawTile(i);
         }
 
-        queue->Complete(M_MAX_UNSIGNED);
+        for (Vector<OcclusionBufferData>::Iterator i = buffers_.Begin(); i != buffers_.End(); ++i)
+        {
+            numTriangles_ += i->numDrawnTriangles_;
+            i->numDrawnTriangles_ = 0;
+            i->triangles_.Clear();
+        }
+        for (Vector<PODVector<const OcclusionTriangle*> >::Iterator i = tileTriangles_.Begin(); i != tileTriangles_.End(); ++i)
+            i->Clear();
 
-        MergeBuffers();
         depthHierarchyDirty_ = true;
     }
 
@@ -240,7 +610,7 @@ void OcclusionBuffer::DrawTriangles()
 
 void OcclusionBuffer::BuildDepthHierarchy()
 {
-    if (buffers_.Empty() || !depthHierarchyDirty_)
+    if (!data_ || !depthHierarchyDirty_)
         return;
 
     URHO3D_PROFILE(BuildDepthHierarchy);
@@ -252,7 +622,7 @@ void OcclusionBuffer::BuildDepthHierarchy()
     {
         for (int y = 0; y < height; ++y)
         {
-            int* src = buffers_[0].data_ + (y * 2) * width_;
+            int* src = data_.Get() + (y * 2) * width_;
             DepthValue* dest = mipBuffers_[0].Get() + y * width;
             DepthValue* end = dest + width;
 
@@ -333,6 +703,11 @@ void OcclusionBuffer::BuildDepthHierarchy()
     }
 
     depthHierarchyDirty_ = false;
+
+    // Remember the view for reprojecting the depth on the next frame
+    historyProjection_ = projection_;
+    historyViewProj_ = viewProj_;
+    historyValid_ = true;
 }
 
 void OcclusionBuffer::ResetUseTimer()
@@ -342,127 +717,29 @@ void OcclusionBuffer::ResetUseTimer()
 
 bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
 {
-    if (buffers_.Empty())
+    if (!data_)
         return true;
 
-    // Transform corners to projection space
-    Vector4 vertices[8];
-    vertices[0] = ModelTransform(viewProj_, worldSpaceBox.min_);
-    vertices[1] = ModelTransform(viewProj_, Vector3(worldSpaceBox.max_.x_, worldSpaceBox.min_.y_, worldSpaceBox.min_.z_));
-    vertices[2] = ModelTransform(viewProj_, Vector3(worldSpaceBox.min_.x_, worldSpaceBox.max_.y_, worldSpaceBox.min_.z_));
-    vertices[3] = ModelTransform(viewProj_, Vector3(worldSpaceBox.max_.x_, worldSpaceBox.max_.y_, worldSpaceBox.min_.z_));
-    vertices[4] = ModelTransform(viewProj_, Vector3(worldSpaceBox.min_.x_, worldSpaceBox.min_.y_, worldSpaceBox.max_.z_));
-    vertices[5] = ModelTransform(viewProj_, Vector3(worldSpaceBox.max_.x_, worldSpaceBox.min_.y_, worldSpaceBox.max_.z_));
-    vertices[6] = ModelTransform(viewProj_, Vector3(worldSpaceBox.min_.x_, worldSpaceBox.max_.y_, worldSpaceBox.max_.z_));
-    vertices[7] = ModelTransform(viewProj_, worldSpaceBox.max_);
-
-    // Apply a far clip relative bias
-    for (unsigned i = 0; i < 8; ++i)
-        vertices[i].z_ -= OCCLUSION_RELATIVE_BIAS;
-
-    // Transform to screen space. If any of the corners cross the near plane, assume visible
-    float minX, maxX, minY, maxY, minZ;
-
-    if (vertices[0].z_ <= 0.0f)
-        return true;
-
-    Vector3 projected = ViewportTransform(vertices[0]);
-    minX = maxX = projected.x_;
-    minY = maxY = projected.y_;
-    minZ = projected.z_;
-
-    // Project the rest
-    for (unsigned i = 1; i < 8; ++i)
-    {
-        if (vertices[i].z_ <= 0.0f)
-            return true;
-
-        projected = ViewportTransform(vertices[i]);
-
-        if (projected.x_ < minX) minX = projected.x_;
-        if (projected.x_ > maxX) maxX = projected.x_;
-        if (projected.y_ < minY) minY = projected.y_;
-        if (projected.y_ > maxY) maxY = projected.y_;
-        if (projected.z_ < minZ) minZ = projected.z_;
-    }
-
-    // Expand the bounding box 1 pixel in each direction to be conservative and correct rasterization offset
-    IntRect rect(
-        (int)(minX - 1.5f), (int)(minY - 1.5f),
-        (int)(maxX + 0.5f), (int)(maxY + 0.5f)
-    );
-
-    // If the rect is outside, let frustum culling handle
-    if (rect.right_ < 0 || rect.bottom_ < 0)
-        return true;
-    if (rect.left_ >= width_ || rect.top_ >= height_)
-        return true;
-
-    // Clipping of rect
-    if (rect.left_ < 0)
-        rect.left_ = 0;
-    if (rect.top_ < 0)
-        rect.top_ = 0;
-    if (rect.right_ >= width_)
-        rect.right_ = width_ - 1;
-    if (rect.bottom_ >= height_)
-        rect.bottom_ = height_ - 1;
-
-    // Convert depth to integer and apply final bias
-    int z = (int)(minZ + 0.5f) - OCCLUSION_FIXED_BIAS;
-
-    if (!depthHierarchyDirty_)
-    {
-        // Start from lowest mip level and check if a conclusive result can be found
-        for (int i = mipBuffers_.Size() - 1; i >= 0; --i)
-        {
-            int shift = i + 1;
-            int width = width_ >> shift;
-            int left = rect.left_ >> shift;
-            int right = rect.right_ >> shift;
-
-            DepthValue* buffer = mipBuffers_[i].Get();
-            DepthValue* row = buffer + (rect.top_ >> shift) * width;
-            DepthValue* endRow = buffer + (rect.bottom_ >> shift) * width;
-            bool allOccluded = true;
-
-            while (row <= endRow)
-            {
-                DepthValue* src = row + left;
-                DepthValue* end = row + right;
-                while (src <= end)
-                {
-                    if (z <= src->min_)
-                        return true;
-                    if (z <= src->max_)
-                        allOccluded = false;
-                    ++src;
-                }
-                row += width;
-            }
-
-            if (allOccluded)
-                return false;
-        }
-    }
+    OcclusionBoxProjector projector(viewProj_, scaleX_, scaleY_, offsetX_, offsetY_, width_, height_);
+    IntRect rect;
+    int z;
+    return !projector.Project(worldSpaceBox, rect, z) || IsRectVisible(rect, z);
+}
 
-    // If no conclusive result, finally check the pixel-level data
-    int* row = buffers_[0].data_ + rect.top_ * width_;
-    int* endRow = buffers_[0].data_ + rect.bottom_ * width_;
-    while (row <= endRow)
+void OcclusionBuffer::IsVisible(const BoundingBox* worldSpaceBoxes, unsigned numBoxes, bool* results) const
+{
+    if (!data_)
     {
-        int* src = row + rect.left_;
-        int* end = row + rect.right_;
-        while (src <= end)
-        {
-            if (z <= *src)
-                return true;
-            ++src;
-        }
-        row += width_;
+        for (unsigned i = 0; i < numBoxes; ++i)
+            results[i] = true;
+        return;
     }
 
-    return false;
+    OcclusionBoxProjector projector(viewProj_, scaleX_, scaleY_, offsetX_, offsetY_, width_, height_);
+    IntRect rect;
+    int z;
+    for (unsigned i = 0; i < numBoxes; ++i)
+        results[i] = !projector.Project(worldSpaceBoxes[i], rect, z) || IsRectVisible(rect, z);
 }
 
 unsigned OcclusionBuffer::GetUseTimer()
@@ -470,15 +747,9 @@ unsigned OcclusionBuffer::GetUseTimer()
     return useTimer_.GetMSec(false);
 }
 
-
 void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadIndex)
 {
-    // If buffer not yet used, clear it
-    if (threadIndex > 0 && !buffers_[threadIndex].used_)
-    {
-        ClearBuffer(threadIndex);
-        buffers_[threadIndex].used_ = true;
-    }
+    URHO3D_PROFILE(DrawOcclusionBatch);
 
     Matrix4 modelViewProj = viewProj_ * batch.model_;
 
@@ -550,6 +821,170 @@ void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadInde
     }
 }
 
+void OcclusionBuffer::DrawTile(unsigned tileIndex)
+{
+    const PODVector<const OcclusionTriangle*>& triangles = tileTriangles_[tileIndex];
+    if (triangles.Empty())
+        return;
+
+    int tileLeft = (int)(tileIndex % numTilesX_) * tileWidth_;
+    int tileTop = (int)(tileIndex / numTilesX_) * OCCLUSION_TILE_HEIGHT;
+    int tileRight = tileLeft + tileWidth_ - 1;
+    int tileBottom = Min(tileTop + OCCLUSION_TILE_HEIGHT, height_) - 1;
+    int& tileMaxDepth = tileMaxDepths_[tileIndex];
+
+#ifdef URHO3D_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 spanOffsets0 = _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f);
+    const __m128 spanOffsets1 = _mm_setr_ps(5.0f, 6.0f, 7.0f, 8.0f);
+    const __m128i frameNumber = _mm_set1_epi32((int)frameNumber_);
+#endif
+
+    for (PODVector<const OcclusionTriangle*>::ConstIterator i = triangles.Begin(); i != triangles.End(); ++i)
+    {
+        const OcclusionTriangle& triangle = **i;
+
+        // If every pixel of the tile is already at least as close as the nearest point of the triangle, it cannot contribute
+        if ((int)triangle.minZ_ >= tileMaxDepth)
+            continue;
+
+        // Spans are aligned to 8 pixels and the tile width is a multiple of 8, so they never cross the tile edge
+        int left = Max(triangle.left_, tileLeft) & ~7;
+        int right = Min(triangle.right_, tileRight);
+        int top = Max(triangle.top_, tileTop);
+        int bottom = Min(triangle.bottom_, tileBottom);
+
+#ifdef URHO3D_SSE
+        const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA_[0]);
+        const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA_[1]);
+        const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA_[2]);
+        const __m128 depthA = _mm_set1_ps(triangle.depthA_);
+        const __m128 minZ = _mm_set1_ps(triangle.minZ_);
+        const __m128 maxZ = _mm_set1_ps(triangle.maxZ_);
+#endif
+
+        for (int y = top; y <= bottom; ++y)
+        {
+            // Pixels are sampled at their bottom right corner
+            float sampleY = (float)(y + 1);
+            float edgeRow0 = triangle.edgeB_[0] * sampleY + triangle.edgeC_[0];
+            float edgeRow1 = triangle.edgeB_[1] * sampleY + triangle.edgeC_[1];
+            float edgeRow2 = triangle.edgeB_[2] * sampleY + triangle.edgeC_[2];
+            float depthRow = triangle.depthB_ * sampleY + triangle.depthC_;
+            int* row = data_.Get() + y * width_;
+            unsigned* frameRow = pixelFrames_ ? pixelFrames_.Get() + y * width_ : 0;
+            bool entered = false;
+
+#ifdef URHO3D_SSE
+            const __m128 edgeRowVec0 = _mm_set1_ps(edgeRow0);
+            const __m128 edgeRowVec1 = _mm_set1_ps(edgeRow1);
+            const __m128 edgeRowVec2 = _mm_set1_ps(edgeRow2);
+            const __m128 depthRowVec = _mm_set1_ps(depthRow);
+
+            for (int x = left; x <= right; x += 8)
+            {
+                __m128 spanX = _mm_set1_ps((float)x);
+                __m128 sampleX0 = _mm_add_ps(spanX, spanOffsets0);
+                __m128 sampleX1 = _mm_add_ps(spanX, spanOffsets1);
+
+                __m128 inside0 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, sampleX0), edgeRowVec0), zero);
+                __m128 inside1 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, sampleX1), edgeRowVec0), zero);
+                inside0 = _mm_and_ps(inside0, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, sampleX0), edgeRowVec1), zero));
+                inside1 = _mm_and_ps(inside1, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, sampleX1), edgeRowVec1), zero));
+                inside0 = _mm_and_ps(inside0, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, sampleX0), edgeRowVec2), zero));
+                inside1 = _mm_and_ps(inside1, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, sampleX1), edgeRowVec2), zero));
+
+                // The covered pixels of a row are contiguous, so stop at the first empty span after a covered one
+                if (!_mm_movemask_ps(_mm_or_ps(inside0, inside1)))
+                {
+                    if (entered)
+                        break;
+                    continue;
+                }
+                entered = true;
+
+                // Interpolate depth, clamp to the vertex depth range so that extrapolation can not bring occluders nearer
+                __m128 depth0 = _mm_add_ps(_mm_mul_ps(depthA, sampleX0), depthRowVec);
+                __m128 depth1 = _mm_add_ps(_mm_mul_ps(depthA, sampleX1), depthRowVec);
+                __m128i z0 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(depth0, minZ), maxZ));
+                __m128i z1 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(depth1, minZ), maxZ));
+
+                __m128i* dest = reinterpret_cast<__m128i*>(row + x);
+                __m128i old0 = _mm_loadu_si128(dest);
+                __m128i old1 = _mm_loadu_si128(dest + 1);
+                __m128i write0 = _mm_and_si128(_mm_cmplt_epi32(z0, old0), _mm_castps_si128(inside0));
+                __m128i write1 = _mm_and_si128(_mm_cmplt_epi32(z1, old1), _mm_castps_si128(inside1));
+                _mm_storeu_si128(dest, _mm_or_si128(_mm_and_si128(write0, z0), _mm_andnot_si128(write0, old0)));
+                _mm_storeu_si128(dest + 1, _mm_or_si128(_mm_and_si128(write1, z1), _mm_andnot_si128(write1, old1)));
+
+                if (frameRow)
+                {
+                    __m128i* destFrames = reinterpret_cast<__m128i*>(frameRow + x);
+                    __m128i oldFrames0 = _mm_loadu_si128(destFrames);
+                    __m128i oldFrames1 = _mm_loadu_si128(destFrames + 1);
+                    _mm_storeu_si128(destFrames, _mm_or_si128(_mm_and_si128(write0, frameNumber), _mm_andnot_si128(write0, oldFrames0)));
+                    _mm_storeu_si128(destFrames + 1, _mm_or_si128(_mm_and_si128(write1, frameNumber),
+                        _mm_andnot_si128(write1, oldFrames1)));
+                }
+            }
+#else
+            for (int x = left; x <= right; x += 8)
+            {
+                bool spanInside = false;
+
+                for (int j = 0; j < 8; ++j)
+                {
+                    float sampleX = (float)(x + j + 1);
+                    if (triangle.edgeA_[0] * sampleX + edgeRow0 < 0.0f || triangle.edgeA_[1] * sampleX + edgeRow1 < 0.0f ||
+                        triangle.edgeA_[2] * sampleX + edgeRow2 < 0.0f)
+                        continue;
+
+                    spanInside = true;
+                    int z = (int)Clamp(triangle.depthA_ * sampleX + depthRow, triangle.minZ_, triangle.maxZ_);
+                    if (z < row[x + j])
+                    {
+                        row[x + j] = z;
+                        if (frameRow)
+                            frameRow[x + j] = frameNumber_;
+                    }
+                }
+
+                // The covered pixels of a row are contiguous, so stop at the first empty span after a covered one
+                if (!spanInside)
+                {
+                    if (entered)
+                        break;
+                    continue;
+                }
+                entered = true;
+            }
+#endif
+        }
+
+        // If the triangle covers the whole tile, the depth at the tile corners bounds every pixel of the tile from above
+        float cornerX[2] = { (float)(tileLeft + 1), (float)(tileRight + 1) };
+        float cornerY[2] = { (float)(tileTop + 1), (float)(tileBottom + 1) };
+        bool covered = true;
+        float maxDepth = -M_INFINITY;
+        for (unsigned j = 0; j < 4 && covered; ++j)
+        {
+            float sampleX = cornerX[j & 1];
+            float sampleY = cornerY[j >> 1];
+            for (unsigned k = 0; k < 3; ++k)
+            {
+                if (triangle.edgeA_[k] * sampleX + triangle.edgeB_[k] * sampleY + triangle.edgeC_[k] < 0.0f)
+                {
+                    covered = false;
+                    break;
+                }
+            }
+            maxDepth = Max(maxDepth, triangle.depthA_ * sampleX + triangle.depthB_ * sampleY + triangle.depthC_);
+        }
+        if (covered)
+            tileMaxDepth = Min(tileMaxDepth, (int)Min(maxDepth, triangle.maxZ_) + 1);
+    }
+}
+
 inline Vector4 OcclusionBuffer::ModelTransform(const Matrix4& transform, const Vector3& vertex) const
 {
     return Vector4(
@@ -643,7 +1078,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
         bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
         if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
         {
-            DrawTriangle2D(projected, clockwise, threadIndex);
+            SetupTriangle(projected, threadIndex);
             drawOk = true;
         }
     }
@@ -681,7 +1116,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
                 bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
                 if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
                 {
-                    DrawTriangle2D(projected, clockwise, threadIndex);
+                    SetupTriangle(projected, threadIndex);
                     drawOk = true;
                 }
             }
@@ -689,7 +1124,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
     }
 
     if (drawOk)
-        ++numTriangles_;
+        ++buffers_[threadIndex].numDrawnTriangles_;
 }
 
 void OcclusionBuffer::ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles)
@@ -762,273 +1197,145 @@ void OcclusionBuffer::ClipVertices(const Vector4& plane, Vector4* vertices, bool
     }
 }
 
-// Code based on Chris Hecker's Perspective Texture Mapping series in the Game Developer magazine
-// Also available online at http://chrishecker.com/Miscellaneous_Technical_Articles
-
-/// %Gradients of a software rasterized triangle.
-struct Gradients
+void OcclusionBuffer::SetupTriangle(const Vector3* vertices, unsigned threadIndex)
 {
-    /// Construct from vertices.
-    Gradients(const Vector3* vertices)
-    {
-        float invdX = 1.0f / (((vertices[1].x_ - vertices[2].x_) *
-                               (vertices[0].y_ - vertices[2].y_)) -
-                              ((vertices[0].x_ - vertices[2].x_) *
-                               (vertices[1].y_ - vertices[2].y_)));
-
-        float invdY = -invdX;
-
-        dInvZdX_ = invdX * (((vertices[1].z_ - vertices[2].z_) * (vertices[0].y_ - vertices[2].y_)) -
-                            ((vertices[0].z_ - vertices[2].z_) * (vertices[1].y_ - vertices[2].y_)));
-
-        dInvZdY_ = invdY * (((vertices[1].z_ - vertices[2].z_) * (vertices[0].x_ - vertices[2].x_)) -
-                            ((vertices[0].z_ - vertices[2].z_) * (vertices[1].x_ - vertices[2].x_)));
+    // Find the pixels whose sample points may be covered. Pixels are sampled at their bottom right corner
+    float minX = Min(Min(vertices[0].x_, vertices[1].x_), vertices[2].x_);
+    float maxX = Max(Max(vertices[0].x_, vertices[1].x_), vertices[2].x_);
+    float minY = Min(Min(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+    float maxY = Max(Max(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+
+    int left = Max(CeilToInt(minX) - 1, 0);
+    int right = Min(FloorToInt(maxX) - 1, width_ - 1);
+    int top = Max(CeilToInt(minY) - 1, 0);
+    int bottom = Min(FloorToInt(maxY) - 1, height_ - 1);
+    if (left > right || top > bottom)
+        return;
 
-        dInvZdXInt_ = (int)dInvZdX_;
-    }
+    OcclusionTriangle triangle;
 
-    /// Integer horizontal gradient.
-    int dInvZdXInt_;
-    /// Horizontal gradient.
-    float dInvZdX_;
-    /// Vertical gradient.
-    float dInvZdY_;
-};
-
-/// %Edge of a software rasterized triangle.
-struct Edge
-{
-    /// Construct from gradients and top & bottom vertices.
-    Edge(const Gradients& gradients, const Vector3& top, const Vector3& bottom, int topY)
+    // Build the edge functions
+    for (unsigned i = 0; i < 3; ++i)
     {
-        float height = (bottom.y_ - top.y_);
-        float slope = (height != 0.0f) ? (bottom.x_ - top.x_) / height : 0.0f;
-        float yPreStep = (float)(topY + 1) - top.y_;
-        float xPreStep = slope * yPreStep;
-
-        x_ = (int)((xPreStep + top.x_) * OCCLUSION_X_SCALE + 0.5f);
-        xStep_ = (int)(slope * OCCLUSION_X_SCALE + 0.5f);
-        invZ_ = (int)(top.z_ + xPreStep * gradients.dInvZdX_ + yPreStep * gradients.dInvZdY_ + 0.5f);
-        invZStep_ = (int)(slope * gradients.dInvZdX_ + gradients.dInvZdY_ + 0.5f);
+        const Vector3& start = vertices[i];
+        const Vector3& end = vertices[i < 2 ? i + 1 : 0];
+        triangle.edgeA_[i] = start.y_ - end.y_;
+        triangle.edgeB_[i] = end.x_ - start.x_;
+        triangle.edgeC_[i] = start.x_ * end.y_ - start.y_ * end.x_;
     }
 
-    /// X coordinate.
-    int x_;
-    /// X coordinate step.
-    int xStep_;
-    /// Inverse Z.
-    int invZ_;
-    /// Inverse Z step.
-    int invZStep_;
-};
-
-void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex)
-{
-    int top, middle, bottom;
-    bool middleIsRight;
-
-    // Sort vertices in Y-direction
-    if (vertices[0].y_ < vertices[1].y_)
+    // Orient the edges so that the inside is positive regardless of winding. Reject degenerate triangles
+    float area = triangle.edgeA_[0] * vertices[2].x_ + triangle.edgeB_[0] * vertices[2].y_ + triangle.edgeC_[0];
+    if (area == 0.0f)
+        return;
+    if (area < 0.0f)
     {
-        if (vertices[2].y_ < vertices[0].y_)
+        for (unsigned i = 0; i < 3; ++i)
         {
-            top = 2;
-            middle = 0;
-            bottom = 1;
-            middleIsRight = true;
-        }
-        else
-        {
-            top = 0;
-            if (vertices[1].y_ < vertices[2].y_)
-            {
-                middle = 1;
-                bottom = 2;
-                middleIsRight = true;
-            }
-            else
-            {
-                middle = 2;
-                bottom = 1;
-                middleIsRight = false;
-            }
+            triangle.edgeA_[i] = -triangle.edgeA_[i];
+            triangle.edgeB_[i] = -triangle.edgeB_[i];
+            triangle.edgeC_[i] = -triangle.edgeC_[i];
         }
     }
-    else
-    {
-        if (vertices[2].y_ < vertices[1].y_)
-        {
-            top = 2;
-            middle = 1;
-            bottom = 0;
-            middleIsRight = false;
-        }
-        else
-        {
-            top = 1;
-            if (vertices[0].y_ < vertices[2].y_)
-            {
-                middle = 0;
-                bottom = 2;
-                middleIsRight = false;
-            }
-            else
-            {
-                middle = 2;
-                bottom = 0;
-                middleIsRight = true;
-            }
-        }
-    }
-
-    int topY = (int)vertices[top].y_;
-    int middleY = (int)vertices[middle].y_;
-    int bottomY = (int)vertices[bottom].y_;
-
-    // Check for degenerate triangle
-    if (topY == bottomY)
-        return;
-
-    // Reverse middleIsRight test if triangle is counterclockwise
-    if (!clockwise)
-        middleIsRight = !middleIsRight;
 
-    Gradients gradients(vertices);
-    Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-    Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
-    Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
+    // Build the depth plane
+    float dX1 = vertices[1].x_ - vertices[0].x_;
+    float dY1 = vertices[1].y_ - vertices[0].y_;
+    float dZ1 = vertices[1].z_ - vertices[0].z_;
+    float dX2 = vertices[2].x_ - vertices[0].x_;
+    float dY2 = vertices[2].y_ - vertices[0].y_;
+    float dZ2 = vertices[2].z_ - vertices[0].z_;
+    float invDet = 1.0f / (dX1 * dY2 - dX2 * dY1);
+    triangle.depthA_ = (dZ1 * dY2 - dZ2 * dY1) * invDet;
+    triangle.depthB_ = (dZ2 * dX1 - dZ1 * dX2) * invDet;
+    triangle.depthC_ = vertices[0].z_ - triangle.depthA_ * vertices[0].x_ - triangle.depthB_ * vertices[0].y_;
+    triangle.minZ_ = Min(Min(vertices[0].z_, vertices[1].z_), vertices[2].z_);
+    triangle.maxZ_ = Max(Max(vertices[0].z_, vertices[1].z_), vertices[2].z_);
+
+    triangle.left_ = left;
+    triangle.top_ = top;
+    triangle.right_ = right;
+    triangle.bottom_ = bottom;
+
+    buffers_[threadIndex].triangles_.Push(triangle);
+}
 
-    int* bufferData = buffers_[threadIndex].data_;
+void OcclusionBuffer::BinTriangles()
+{
+    URHO3D_PROFILE(BinOcclusionTriangles);
 
-    if (middleIsRight)
+    for (Vector<OcclusionBufferData>::ConstIterator i = buffers_.Begin(); i != buffers_.End(); ++i)
     {
-        // Top half
-        int* row = bufferData + topY * width_;
-        int* endRow = bufferData + middleY * width_;
-        while (row < endRow)
+        for (PODVector<OcclusionTriangle>::ConstIterator j = i->triangles_.Begin(); j != i->triangles_.End(); ++j)
         {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (topToMiddle.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            topToMiddle.x_ += topToMiddle.xStep_;
-            row += width_;
-        }
+            int tileLeft = j->left_ / tileWidth_;
+            int tileRight = j->right_ / tileWidth_;
+            int tileTop = j->top_ / OCCLUSION_TILE_HEIGHT;
+            int tileBottom = j->bottom_ / OCCLUSION_TILE_HEIGHT;
 
-        // Bottom half
-        row = bufferData + middleY * width_;
-        endRow = bufferData + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (middleToBottom.x_ >> 16);
-            while (dest < end)
+            for (int y = tileTop; y <= tileBottom; ++y)
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                for (int x = tileLeft; x <= tileRight; ++x)
+                    tileTriangles_[y * numTilesX_ + x].Push(&(*j));
             }
-
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            middleToBottom.x_ += middleToBottom.xStep_;
-            row += width_;
         }
     }
-    else
+}
+
+bool OcclusionBuffer::IsRectVisible(const IntRect& rect, int z) const
+{
+    if (!depthHierarchyDirty_)
     {
-        // Top half
-        int* row = bufferData + topY * width_;
-        int* endRow = bufferData + middleY * width_;
-        while (row < endRow)
+        // Start from lowest mip level and check if a conclusive result can be found
+        for (int i = mipBuffers_.Size() - 1; i >= 0; --i)
         {
-            int invZ = topToMiddle.invZ_;
-            int* dest = row + (topToMiddle.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
+            int shift = i + 1;
+            int width = width_ >> shift;
+            int left = rect.left_ >> shift;
+            int right = rect.right_ >> shift;
 
-            topToMiddle.x_ += topToMiddle.xStep_;
-            topToMiddle.invZ_ += topToMiddle.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
-        }
+            DepthValue* buffer = mipBuffers_[i].Get();
+            DepthValue* row = buffer + (rect.top_ >> shift) * width;
+            DepthValue* endRow = buffer + (rect.bottom_ >> shift) * width;
+            bool allOccluded = true;
 
-        // Bottom half
-        row = bufferData + middleY * width_;
-        endRow = bufferData + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = middleToBottom.invZ_;
-            int* dest = row + (middleToBottom.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
+            while (row <= endRow)
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                DepthValue* src = row + left;
+                DepthValue* end = row + right;
+                while (src <= end)
+                {
+                    if (z <= src->min_)
+                        return true;
+                    if (z <= src->max_)
+                        allOccluded = false;
+                    ++src;
+                }
+                row += width;
             }
 
-            middleToBottom.x_ += middleToBottom.xStep_;
-            middleToBottom.invZ_ += middleToBottom.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
+            if (allOccluded)
+                return false;
         }
     }
-}
 
-void OcclusionBuffer::MergeBuffers()
-{
-    URHO3D_PROFILE(MergeBuffers);
-
-    for (unsigned i = 1; i < buffers_.Size(); ++i)
+    // If no conclusive result, finally check the pixel-level data
+    int* row = data_.Get() + rect.top_ * width_;
+    int* endRow = data_.Get() + rect.bottom_ * width_;
+    while (row <= endRow)
     {
-        if (!buffers_[i].used_)
-            continue;
-
-        int* src = buffers_[i].data_;
-        int* dest = buffers_[0].data_;
-        int count = width_ * height_;
-
-        while (count--)
+        int* src = row + rect.left_;
+        int* end = row + rect.right_;
+        while (src <= end)
         {
-            // If thread buffer's depth value is closer, overwrite the original
-            if (*src < *dest)
-                *dest = *src;
+            if (z <= *src)
+                return true;
             ++src;
-            ++dest;
         }
+        row += width_;
     }
-}
 
-void OcclusionBuffer::ClearBuffer(unsigned threadIndex)
-{
-    if (threadIndex >= buffers_.Size())
-        return;
-
-    int* dest = buffers_[threadIndex].data_;
-    int count = width_ * height_;
-    int fillValue = (int)OCCLUSION_Z_SCALE;
-
-    while (count--)
-        *dest++ = fillValue;
+    return false;
 }
 
 }
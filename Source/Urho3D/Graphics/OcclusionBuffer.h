@@ -36,8 +36,6 @@ class Camera;
 class IndexBuffer;
 class IntRect;
 class VertexBuffer;
-struct Edge;
-struct Gradients;
 
 /// Occlusion hierarchy depth value.
 struct DepthValue
@@ -48,15 +46,42 @@ struct DepthValue
     int max_;
 };
 
+/// Occluder triangle set up for tile-binned rasterization.
+struct OcclusionTriangle
+{
+    /// Edge function X coefficients. A pixel is inside when all edge functions are non-negative at its sample point.
+    float edgeA_[3];
+    /// Edge function Y coefficients.
+    float edgeB_[3];
+    /// Edge function constants.
+    float edgeC_[3];
+    /// Depth plane X coefficient.
+    float depthA_;
+    /// Depth plane Y coefficient.
+    float depthB_;
+    /// Depth plane constant.
+    float depthC_;
+    /// Minimum vertex depth.
+    float minZ_;
+    /// Maximum vertex depth.
+    float maxZ_;
+    /// Bounding rectangle left pixel.
+    int left_;
+    /// Bounding rectangle top pixel.
+    int top_;
+    /// Bounding rectangle right pixel, inclusive.
+    int right_;
+    /// Bounding rectangle bottom pixel, inclusive.
+    int bottom_;
+};
+
 /// Per-thread occlusion buffer data.
 struct OcclusionBufferData
 {
-    /// Full buffer data with safety padding.
-    SharedArrayPtr<int> dataWithSafety_;
-    /// Buffer data.
-    int* data_;
-    /// Use flag.
-    bool used_;
+    /// Triangles set up by this thread.
+    PODVector<OcclusionTriangle> triangles_;
+    /// Number of source triangles that produced visible triangles.
+    unsigned numDrawnTriangles_;
 };
 
 /// Stored occlusion render job.
@@ -84,6 +109,8 @@ static const float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static const int OCCLUSION_FIXED_BIAS = 16;
 static const float OCCLUSION_X_SCALE = 65536.0f;
 static const float OCCLUSION_Z_SCALE = 16777216.0f;
+static const int OCCLUSION_TILE_WIDTH = 64;
+static const int OCCLUSION_TILE_HEIGHT = 16;
 
 /// Software renderer for occlusion.
 class URHO3D_API OcclusionBuffer : public Object
@@ -108,6 +135,8 @@ public:
     void Reset();
     /// Clear the buffer.
     void Clear();
+    /// Clear the buffer and fill it with the depth drawn in previous frames, reprojected to the current view. Only pixels drawn at most maxAge frames ago are kept. Return false if there was no usable history, in which case the buffer is just cleared.
+    bool Reproject(unsigned maxAge);
     /// Submit a triangle mesh to the buffer using non-indexed geometry. Return true if did not overflow the allowed triangle count.
     bool AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
     /// Submit a triangle mesh to the buffer using indexed geometry. Return true if did not overflow the allowed triangle count.
@@ -121,7 +150,7 @@ public:
     void ResetUseTimer();
 
     /// Return highest level depth values.
-    int* GetBuffer() const { return buffers_.Size() ? buffers_[0].data_ : (int*)0; }
+    int* GetBuffer() const { return data_.Get(); }
 
     /// Return view transform matrix.
     const Matrix3x4& GetView() const { return view_; }
@@ -145,15 +174,19 @@ public:
     CullMode GetCullMode() const { return cullMode_; }
 
     /// Return whether is using threads to speed up rendering.
-    bool IsThreaded() const { return buffers_.Size() > 1; }
+    bool IsThreaded() const { return threaded_; }
 
     /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
+    /// Test an array of bounding boxes for visibility and write one result per box. For best performance, build depth hierarchy first.
+    void IsVisible(const BoundingBox* worldSpaceBoxes, unsigned numBoxes, bool* results) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
 
     /// Draw a batch. Called internally.
     void DrawBatch(const OcclusionBatch& batch, unsigned threadIndex);
+    /// Rasterize the triangles binned to a tile. Called internally.
+    void DrawTile(unsigned tileIndex);
 
 private:
     /// Apply modelview transform to vertex.
@@ -170,15 +203,27 @@ private:
     void DrawTriangle(Vector4* vertices, unsigned threadIndex);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
-    /// Clear a thread work buffer.
-    void ClearBuffer(unsigned threadIndex);
-    /// Merge thread work buffers into the first buffer.
-    void MergeBuffers();
-
-    /// Highest-level buffer data per thread.
+    /// Set up a clipped triangle for rasterization.
+    void SetupTriangle(const Vector3* vertices, unsigned threadIndex);
+    /// Sort the set up triangles into the tiles they overlap.
+    void BinTriangles();
+    /// Test a clipped pixel rectangle at a depth for visibility.
+    bool IsRectVisible(const IntRect& rect, int z) const;
+
+    /// Highest-level buffer data.
+    SharedArrayPtr<int> data_;
+    /// Triangle setup data per thread.
     Vector<OcclusionBufferData> buffers_;
+    /// Triangles binned per tile.
+    Vector<PODVector<const OcclusionTriangle*> > tileTriangles_;
+    /// Conservative maximum depth per tile, used to reject occluder triangles that are behind already drawn ones.
+    PODVector<int> tileMaxDepths_;
+    /// Frame number at which each pixel was last drawn. Allocated on first reprojection.
+    SharedArrayPtr<unsigned> pixelFrames_;
+    /// Previous frame's buffer data, used during reprojection.
+    SharedArrayPtr<int> historyData_;
+    /// Previous frame's pixel frame numbers, used during reprojection.
+    SharedArrayPtr<unsigned> historyFrames_;
     /// Reduced size depth buffers.
     Vector<SharedArrayPtr<DepthValue> > mipBuffers_;
     /// Submitted render jobs.
@@ -187,6 +232,12 @@ private:
     int width_;
     /// Buffer height.
     int height_;
+    /// Tile width in pixels.
+    int tileWidth_;
+    /// Number of tiles horizontally.
+    int numTilesX_;
+    /// Number of tiles vertically.
+    int numTilesY_;
     /// Number of rendered triangles.
     unsigned numTriangles_;
     /// Maximum number of triangles.
@@ -197,12 +248,22 @@ private:
     bool depthHierarchyDirty_;
     /// Culling reverse flag.
     bool reverseCulling_;
+    /// Threaded rendering flag.
+    bool threaded_;
+    /// Depth hierarchy of a previous frame is available for reprojection flag.
+    bool historyValid_;
+    /// Frame number for reprojection.
+    unsigned frameNumber_;
     /// View transform matrix.
     Matrix3x4 view_;
     /// Projection matrix.
     Matrix4 projection_;
     /// Combined view and projection matrix.
     Matrix4 viewProj_;
+    /// Projection matrix of the previous frame's depth hierarchy.
+    Matrix4 historyProjection_;
+    /// Combined view and projection matrix of the previous frame's depth hierarchy.
+    Matrix4 historyViewProj_;
     /// Last used timer.
     Timer useTimer_;
     /// Near clip distance.
@@ -27,6 +27,7 @@
 #include "../Core/Profiler.h"
 #include "../Core/Thread.h"
 #include "../Core/WorkQueue.h"
+#include "../Graphics/AnimatedModel.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Octree.h"
@@ -45,35 +46,134 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+/// Number of ray queries traversed together in a batched raycast, one bit each in the packet mask.
+static const unsigned RAY_PACKET_SIZE = 32;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
+/// %Drawable update functor for WorkQueue::ParallelFor.
+struct UpdateDrawablesWork
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
+    /// Construct.
+    UpdateDrawablesWork(Drawable** drawables, const FrameInfo& frame) :
+        drawables_(drawables),
+        frame_(frame)
+    {
+    }
 
-    while (start != end)
+    /// Update a range of drawables.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
     {
-        Drawable* drawable = *start;
-        if (drawable)
-            drawable->Update(frame);
-        ++start;
+        for (unsigned i = begin; i < end; ++i)
+        {
+            Drawable* drawable = drawables_[i];
+            if (drawable)
+                drawable->Update(frame_);
+        }
     }
-}
+
+    /// Drawables.
+    Drawable** drawables_;
+    /// Frame info.
+    const FrameInfo& frame_;
+};
 
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
 }
 
+/// Perform the closest hit test of a ray query for the candidate drawables, in order of increasing bounding box hit distance.
+static void RaycastClosest(RayOctreeQuery& query, const PODVector<Drawable*>& drawables, PODVector<Pair<float, Drawable*> >& hits)
+{
+    hits.Resize(drawables.Size());
+    for (unsigned i = 0; i < drawables.Size(); ++i)
+        hits[i] = MakePair(query.ray_.HitDistance(drawables[i]->GetWorldBoundingBox()), drawables[i]);
+
+    Sort(hits.Begin(), hits.End());
+
+    // Do the actual test according to the query, and early-out as possible
+    float closestHit = M_INFINITY;
+    for (PODVector<Pair<float, Drawable*> >::Iterator i = hits.Begin(); i != hits.End(); ++i)
+    {
+        if (i->first_ < Min(closestHit, query.maxDistance_))
+        {
+            unsigned oldSize = query.result_.Size();
+            i->second_->ProcessRayQuery(query, query.result_);
+            if (query.result_.Size() > oldSize)
+                closestHit = Min(closestHit, query.result_.Back().distance_);
+        }
+        else
+            break;
+    }
+
+    if (query.result_.Size() > 1)
+    {
+        Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
+        query.result_.Resize(1);
+    }
+}
+
+/// Ray query packet functor for WorkQueue::ParallelFor.
+struct RaycastPacketsWork
+{
+    /// Construct.
+    RaycastPacketsWork(const Octree* octree, RayOctreeQuery* const* queries, unsigned numQueries, bool single) :
+        octree_(octree),
+        queries_(const_cast<RayOctreeQuery**>(queries)),
+        numQueries_(numQueries),
+        single_(single)
+    {
+    }
+
+    /// Process a range of packets.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        PODVector<Drawable*> candidates[RAY_PACKET_SIZE];
+        PODVector<Pair<float, Drawable*> > hits;
+
+        for (unsigned i = begin; i < end; ++i)
+        {
+            RayOctreeQuery** packet = queries_ + i * RAY_PACKET_SIZE;
+            unsigned packetSize = Min(numQueries_ - i * RAY_PACKET_SIZE, RAY_PACKET_SIZE);
+
+            for (unsigned j = 0; j < packetSize; ++j)
+                packet[j]->result_.Clear();
+
+            octree_->RaycastPacket(packet, packetSize, single_ ? candidates : 0);
+
+            for (unsigned j = 0; j < packetSize; ++j)
+            {
+                RayOctreeQuery& query = *packet[j];
+                if (single_)
+                {
+                    RaycastClosest(query, candidates[j], hits);
+                    candidates[j].Clear();
+                }
+                else
+                    Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
+            }
+        }
+    }
+
+    /// Octree.
+    const Octree* octree_;
+    /// Ray queries.
+    RayOctreeQuery** queries_;
+    /// Number of ray queries.
+    unsigned numQueries_;
+    /// Closest hit only flag.
+    bool single_;
+};
+
 Octant::Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* root, unsigned index) :
     level_(level),
     numDrawables_(0),
     parent_(parent),
     root_(root),
-    index_(index)
+    index_(index),
+    drawableBoundsDirty_(true),
+    childBoundsDirty_(false)
 {
     Initialize(box);
 
@@ -89,6 +189,7 @@ Octant::~Octant()
         for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
         {
             (*i)->SetOctant(root_);
+            (*i)->octantIndex_ = root_->drawables_.Size();
             root_->drawables_.Push(*i);
             root_->QueueUpdate(*i);
         }
@@ -137,6 +238,13 @@ void Octant::DeleteChild(unsigned index)
 
 void Octant::InsertDrawable(Drawable* drawable)
 {
+    // In dynamic tree mode all drawables are kept in the root octant
+    if (this == root_ && root_->dynamicTree_)
+    {
+        root_->InsertTreeDrawable(drawable);
+        return;
+    }
+
     const BoundingBox& box = drawable->GetWorldBoundingBox();
 
     // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
@@ -153,9 +261,10 @@ void Octant::InsertDrawable(Drawable* drawable)
         if (oldOctant != this)
         {
             // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+            unsigned oldIndex = drawable->octantIndex_;
             AddDrawable(drawable);
             if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+                oldOctant->RemoveDrawableAt(oldIndex, false);
         }
     }
     else
@@ -169,6 +278,28 @@ void Octant::InsertDrawable(Drawable* drawable)
     }
 }
 
+void Octant::RemoveDrawable(Drawable* drawable, bool resetOctant)
+{
+    if (drawable->octant_ == this)
+        RemoveDrawableAt(drawable->octantIndex_, resetOctant);
+}
+
+void Octant::RemoveDrawableAt(unsigned index, bool resetOctant)
+{
+    // Move the last drawable to the removed one's place, so that removal does not depend on the number of drawables
+    Drawable* drawable = drawables_[index];
+    drawables_.EraseSwap(index);
+    if (index < drawables_.Size())
+        drawables_[index]->octantIndex_ = index;
+
+    if (this == root_ && root_->dynamicTree_)
+        root_->RemoveTreeDrawable(drawable);
+    if (resetOctant)
+        drawable->SetOctant(0);
+    MarkDrawableBoundsDirty();
+    DecDrawableCount();
+}
+
 bool Octant::CheckDrawableFit(const BoundingBox& box) const
 {
     Vector3 boxSize = box.Size();
@@ -248,7 +379,11 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         Drawable** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        // Use the packed bounds if they are up to date, to avoid touching the drawables that are culled
+        if (!inside && !drawableBoundsDirty_)
+            query.TestDrawableBounds(start, end, &drawableBounds_[0]);
+        else
+            query.TestDrawables(start, end, inside);
     }
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
@@ -258,6 +393,47 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     }
 }
 
+void Octant::UpdateDrawableBounds()
+{
+    if (drawableBoundsDirty_)
+    {
+        drawableBoundsDirty_ = false;
+
+        unsigned numDrawables = drawables_.Size();
+        drawableBounds_.Resize(((numDrawables + 3) >> 2) * 24);
+        if (numDrawables)
+        {
+            // Pad the last group so that the unused lanes hold valid numbers
+            memset(&drawableBounds_[drawableBounds_.Size() - 24], 0, 24 * sizeof(float));
+
+            for (unsigned i = 0; i < numDrawables; ++i)
+            {
+                const BoundingBox& box = drawables_[i]->GetWorldBoundingBox();
+                Vector3 center = box.Center();
+                Vector3 halfSize = box.HalfSize();
+                float* dest = &drawableBounds_[(i >> 2) * 24 + (i & 3)];
+                dest[0] = center.x_;
+                dest[4] = center.y_;
+                dest[8] = center.z_;
+                dest[12] = halfSize.x_;
+                dest[16] = halfSize.y_;
+                dest[20] = halfSize.z_;
+            }
+        }
+    }
+
+    if (childBoundsDirty_)
+    {
+        childBoundsDirty_ = false;
+
+        for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+        {
+            if (children_[i])
+                children_[i]->UpdateDrawableBounds();
+        }
+    }
+}
+
 void Octant::GetDrawablesInternal(RayOctreeQuery& query) const
 {
     float octantDist = query.ray_.HitDistance(cullingBox_);
@@ -312,10 +488,34 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
     }
 }
 
+void Octant::GetDrawablesInternal(RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates) const
+{
+    // Drop the rays that miss the octant
+    unsigned hitMask = 0;
+    for (unsigned i = 0, remaining = mask; remaining; ++i, remaining >>= 1)
+    {
+        if ((remaining & 1) && queries[i]->ray_.HitDistance(cullingBox_) < queries[i]->maxDistance_)
+            hitMask |= 1u << i;
+    }
+    if (!hitMask)
+        return;
+
+    for (PODVector<Drawable*>::ConstIterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+        ProcessRayPacket(*i, queries, hitMask, candidates);
+
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        if (children_[i])
+            children_[i]->GetDrawablesInternal(queries, hitMask, candidates);
+    }
+}
+
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, 0, this),
-    numLevels_(DEFAULT_OCTREE_LEVELS)
+    numLevels_(DEFAULT_OCTREE_LEVELS),
+    updateBudget_(0),
+    dynamicTree_(false)
 {
     // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
     // to allow raycasts and animation update
@@ -340,6 +540,8 @@ void Octree::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE("Bounding Box Min", Vector3, worldBoundingBox_.min_, defaultBoundsMin, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Bounding Box Max", Vector3, worldBoundingBox_.max_, defaultBoundsMax, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Number of Levels", int, numLevels_, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Dynamic Tree", IsDynamicTree, SetDynamicTree, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Update Budget", GetUpdateBudget, SetUpdateBudget, unsigned, 0, AM_DEFAULT);
 }
 
 void Octree::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
@@ -355,7 +557,10 @@ void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     {
         URHO3D_PROFILE(OctreeDrawDebug);
 
-        Octant::DrawDebugGeometry(debug, depthTest);
+        if (dynamicTree_)
+            tree_.DrawDebugGeometry(debug, depthTest);
+        else
+            Octant::DrawDebugGeometry(debug, depthTest);
     }
 }
 
@@ -372,6 +577,50 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
     numLevels_ = Max(numLevels, 1U);
 }
 
+void Octree::SetDynamicTree(bool enable)
+{
+    if (enable == dynamicTree_)
+        return;
+
+    // Move all drawables to the root
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+        DeleteChild(i);
+
+    dynamicTree_ = enable;
+
+    if (enable)
+    {
+        for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            const BoundingBox& box = drawable->GetWorldBoundingBox();
+            if (drawable->IsOccludee() && box.Defined())
+                drawable->treeNode_ = tree_.Insert(drawable, box);
+            else
+                AddUnoccludedDrawable(drawable);
+        }
+    }
+    else
+    {
+        tree_.Clear();
+        unoccludedDrawables_.Clear();
+
+        // Reinsert to the octants on the next update
+        for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            drawable->treeNode_ = M_MAX_UNSIGNED;
+            if (!drawable->updateQueued_)
+                QueueUpdate(drawable);
+        }
+    }
+}
+
+void Octree::SetUpdateBudget(unsigned budget)
+{
+    updateBudget_ = budget;
+}
+
 void Octree::Update(const FrameInfo& frame)
 {
     if (!Thread::IsMainThread())
@@ -389,32 +638,42 @@ void Octree::Update(const FrameInfo& frame)
         // (for example physics objects) should not perform non-threadsafe work when marked dirty
         Scene* scene = GetScene();
         WorkQueue* queue = GetSubsystem<WorkQueue>();
-        scene->BeginThreadedUpdate();
-
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
+        PODVector<Drawable*>* updates = &drawableUpdates_;
 
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        // Postpone the deferrable updates exceeding the budget. They are queued first for the next frame, so that the
+        // updates proceed in round-robin order. The postponed drawables are still reinserted below
+        if (updateBudget_)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
+            budgetedDrawableUpdates_.Clear();
+            unsigned numDeferrable = 0;
+            for (PODVector<Drawable*>::ConstIterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+            {
+                Drawable* drawable = *i;
+                if (drawable && drawable->IsUpdateDeferrable(frame) && ++numDeferrable > updateBudget_)
+                    postponedDrawableUpdates_.Push(drawable);
+                else
+                    budgetedDrawableUpdates_.Push(drawable);
+            }
+            updates = &budgetedDrawableUpdates_;
+        }
 
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
+        scene->BeginThreadedUpdate();
 
-            start = end;
+        // Resolve the parent node transforms first. Drawables in sibling nodes, such as a crowd of animated models under one
+        // moving node, would otherwise race on recalculating the shared dirty parent in the worker threads
+        if (scene->IsThreadedUpdate())
+        {
+            for (PODVector<Drawable*>::ConstIterator i = updates->Begin(); i != updates->End(); ++i)
+            {
+                Node* node = *i ? (*i)->GetNode() : 0;
+                Node* parent = node ? node->GetParent() : 0;
+                if (parent)
+                    parent->GetWorldTransform();
+            }
         }
 
-        queue->Complete(M_MAX_UNSIGNED);
+        if (!updates->Empty())
+            queue->ParallelFor(0, updates->Size(), 1, UpdateDrawablesWork(&updates->At(0), frame));
         scene->EndThreadedUpdate();
     }
 
@@ -464,6 +723,12 @@ void Octree::Update(const FrameInfo& frame)
             // Skip if no octant or does not belong to this octree anymore
             if (!octant || octant->GetRoot() != this)
                 continue;
+            // In dynamic tree mode update the tree leaf, which is restructured only if the drawable left its enlarged bounds
+            if (dynamicTree_)
+            {
+                InsertTreeDrawable(drawable);
+                continue;
+            }
             // Skip if still fits the current octant
             if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
                 continue;
@@ -483,6 +748,26 @@ void Octree::Update(const FrameInfo& frame)
     }
 
     drawableUpdates_.Clear();
+
+    // Queue the postponed updates for the next frame
+    if (!postponedDrawableUpdates_.Empty())
+    {
+        for (PODVector<Drawable*>::ConstIterator i = postponedDrawableUpdates_.Begin(); i != postponedDrawableUpdates_.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            if (drawable->GetOctant() && !drawable->updateQueued_)
+                QueueUpdate(drawable);
+        }
+
+        postponedDrawableUpdates_.Clear();
+    }
+
+    // Refresh the packed drawable bounds used by the queries
+    if (!dynamicTree_)
+    {
+        URHO3D_PROFILE(UpdateDrawableBounds);
+        UpdateDrawableBounds();
+    }
 }
 
 void Octree::AddManualDrawable(Drawable* drawable)
@@ -490,7 +775,10 @@ void Octree::AddManualDrawable(Drawable* drawable)
     if (!drawable || drawable->GetOctant())
         return;
 
-    AddDrawable(drawable);
+    if (dynamicTree_)
+        InsertTreeDrawable(drawable);
+    else
+        AddDrawable(drawable);
 }
 
 void Octree::RemoveManualDrawable(Drawable* drawable)
@@ -506,7 +794,18 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+
+    if (dynamicTree_)
+    {
+        tree_.GetDrawables(query);
+        if (!unoccludedDrawables_.Empty())
+        {
+            Drawable** start = const_cast<Drawable**>(&unoccludedDrawables_[0]);
+            query.TestDrawables(start, start + unoccludedDrawables_.Size(), false);
+        }
+    }
+    else
+        GetDrawablesInternal(query, false);
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -514,7 +813,20 @@ void Octree::Raycast(RayOctreeQuery& query) const
     URHO3D_PROFILE(Raycast);
 
     query.result_.Clear();
-    GetDrawablesInternal(query);
+
+    if (dynamicTree_)
+    {
+        tree_.Raycast(query);
+        for (PODVector<Drawable*>::ConstIterator i = unoccludedDrawables_.Begin(); i != unoccludedDrawables_.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                drawable->ProcessRayQuery(query, query.result_);
+        }
+    }
+    else
+        GetDrawablesInternal(query);
+
     Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
 }
 
@@ -524,38 +836,85 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
     query.result_.Clear();
     rayQueryDrawables_.Clear();
-    GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
-    // Sort by increasing hit distance to AABB
-    for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
+    if (dynamicTree_)
     {
-        Drawable* drawable = *i;
-        drawable->SetSortValue(query.ray_.HitDistance(drawable->GetWorldBoundingBox()));
+        tree_.GetDrawablesOnly(query, rayQueryDrawables_);
+        for (PODVector<Drawable*>::ConstIterator i = unoccludedDrawables_.Begin(); i != unoccludedDrawables_.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                rayQueryDrawables_.Push(drawable);
+        }
     }
+    else
+        GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
-    Sort(rayQueryDrawables_.Begin(), rayQueryDrawables_.End(), CompareDrawables);
+    RaycastClosest(query, rayQueryDrawables_, rayQueryHits_);
+}
 
-    // Then do the actual test according to the query, and early-out as possible
-    float closestHit = M_INFINITY;
-    for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
+void Octree::Raycast(const PODVector<RayOctreeQuery*>& queries) const
+{
+    URHO3D_PROFILE(RaycastBatch);
+
+    ResolveRayQueryDrawables();
+
+    unsigned numPackets = (queries.Size() + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+    GetSubsystem<WorkQueue>()->ParallelFor(0, numPackets, 1, RaycastPacketsWork(this, queries.Begin().ptr_, queries.Size(),
+        false));
+}
+
+void Octree::RaycastSingle(const PODVector<RayOctreeQuery*>& queries) const
+{
+    URHO3D_PROFILE(RaycastBatch);
+
+    ResolveRayQueryDrawables();
+
+    unsigned numPackets = (queries.Size() + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+    GetSubsystem<WorkQueue>()->ParallelFor(0, numPackets, 1, RaycastPacketsWork(this, queries.Begin().ptr_, queries.Size(),
+        true));
+}
+
+void Octree::ResolveRayQueryDrawables() const
+{
+    // Outside Update() every drawable whose bounding box or node transform is dirty has been queued for update, so those are
+    // the only drawables that ray queries could lazily recalculate
+    for (PODVector<Drawable*>::ConstIterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
     {
         Drawable* drawable = *i;
-        if (drawable->GetSortValue() < Min(closestHit, query.maxDistance_))
+        if (!drawable)
+            continue;
+
+        drawable->GetWorldBoundingBox();
+        Node* node = drawable->GetNode();
+        if (node)
+            node->GetWorldTransform();
+
+        // Animated models test the rays also against their bone nodes
+        if (drawable->IsInstanceOf<AnimatedModel>())
         {
-            unsigned oldSize = query.result_.Size();
-            drawable->ProcessRayQuery(query, query.result_);
-            if (query.result_.Size() > oldSize)
-                closestHit = Min(closestHit, query.result_.Back().distance_);
+            const Vector<Bone>& bones = static_cast<AnimatedModel*>(drawable)->GetSkeleton().GetBones();
+            for (Vector<Bone>::ConstIterator j = bones.Begin(); j != bones.End(); ++j)
+            {
+                if (j->node_)
+                    j->node_->GetWorldTransform();
+            }
         }
-        else
-            break;
     }
+}
 
-    if (query.result_.Size() > 1)
+void Octree::RaycastPacket(RayOctreeQuery** queries, unsigned numQueries, PODVector<Drawable*>* candidates) const
+{
+    unsigned mask = numQueries < RAY_PACKET_SIZE ? (1u << numQueries) - 1 : M_MAX_UNSIGNED;
+
+    if (dynamicTree_)
     {
-        Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
-        query.result_.Resize(1);
+        tree_.Raycast(queries, mask, candidates);
+        for (PODVector<Drawable*>::ConstIterator i = unoccludedDrawables_.Begin(); i != unoccludedDrawables_.End(); ++i)
+            ProcessRayPacket(*i, queries, mask, candidates);
     }
+    else
+        GetDrawablesInternal(queries, mask, candidates);
 }
 
 void Octree::QueueUpdate(Drawable* drawable)
@@ -565,9 +924,13 @@ void Octree::QueueUpdate(Drawable* drawable)
     {
         MutexLock lock(octreeMutex_);
         threadedDrawableUpdates_.Push(drawable);
+        drawable->GetOctant()->MarkDrawableBoundsDirty();
     }
     else
+    {
         drawableUpdates_.Push(drawable);
+        drawable->GetOctant()->MarkDrawableBoundsDirty();
+    }
 
     drawable->updateQueued_ = true;
 }
@@ -577,6 +940,7 @@ void Octree::CancelUpdate(Drawable* drawable)
     // This doesn't have to take into account scene being in threaded update, because it is called only
     // when removing a drawable from octree, which should only ever happen from the main thread.
     drawableUpdates_.Remove(drawable);
+    postponedDrawableUpdates_.Remove(drawable);
     drawable->updateQueued_ = false;
 }
 
@@ -586,6 +950,70 @@ void Octree::DrawDebugGeometry(bool depthTest)
     DrawDebugGeometry(debug, depthTest);
 }
 
+void Octree::InsertTreeDrawable(Drawable* drawable)
+{
+    // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+    Octant* oldOctant = drawable->octant_;
+    bool added = oldOctant != this;
+    if (added)
+    {
+        unsigned oldIndex = drawable->octantIndex_;
+        AddDrawable(drawable);
+        if (oldOctant)
+            oldOctant->RemoveDrawableAt(oldIndex, false);
+    }
+
+    // Drawables already in the root and without a tree leaf are in the individually tested list
+    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    if (drawable->IsOccludee() && box.Defined())
+    {
+        if (drawable->treeNode_ != M_MAX_UNSIGNED)
+            tree_.Move(drawable->treeNode_, box);
+        else
+        {
+            if (!added)
+                RemoveUnoccludedDrawable(drawable);
+            drawable->treeNode_ = tree_.Insert(drawable, box);
+        }
+    }
+    else if (drawable->treeNode_ != M_MAX_UNSIGNED)
+    {
+        tree_.Remove(drawable->treeNode_);
+        drawable->treeNode_ = M_MAX_UNSIGNED;
+        AddUnoccludedDrawable(drawable);
+    }
+    else if (added)
+        AddUnoccludedDrawable(drawable);
+}
+
+void Octree::RemoveTreeDrawable(Drawable* drawable)
+{
+    if (drawable->treeNode_ != M_MAX_UNSIGNED)
+    {
+        tree_.Remove(drawable->treeNode_);
+        drawable->treeNode_ = M_MAX_UNSIGNED;
+    }
+    else
+        RemoveUnoccludedDrawable(drawable);
+}
+
+void Octree::AddUnoccludedDrawable(Drawable* drawable)
+{
+    drawable->unoccludedIndex_ = unoccludedDrawables_.Size();
+    unoccludedDrawables_.Push(drawable);
+}
+
+void Octree::RemoveUnoccludedDrawable(Drawable* drawable)
+{
+    unsigned index = drawable->unoccludedIndex_;
+    if (index >= unoccludedDrawables_.Size() || unoccludedDrawables_[index] != drawable)
+        return;
+
+    unoccludedDrawables_.EraseSwap(index);
+    if (index < unoccludedDrawables_.Size())
+        unoccludedDrawables_[index]->unoccludedIndex_ = index;
+}
+
 void Octree::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
 {
     // When running in headless mode, update the Octree manually during the RenderUpdate event
@@ -25,6 +25,7 @@
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
 #include "../Graphics/Drawable.h"
+#include "../Graphics/DrawableTree.h"
 #include "../Graphics/OctreeQuery.h"
 
 namespace Urho3D
@@ -57,19 +58,23 @@ public:
     void AddDrawable(Drawable* drawable)
     {
         drawable->SetOctant(this);
+        drawable->octantIndex_ = drawables_.Size();
         drawables_.Push(drawable);
         IncDrawableCount();
+        MarkDrawableBoundsDirty();
     }
 
     /// Remove a drawable object from this octant.
-    void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
+    void RemoveDrawable(Drawable* drawable, bool resetOctant = true);
+    /// Remove a drawable object from this octant by its index in the drawable list. Used when the drawable has already been added to another octant.
+    void RemoveDrawableAt(unsigned index, bool resetOctant = true);
+
+    /// Mark the packed drawable bounds out of date, so that queries test the drawables individually until the next octree update.
+    void MarkDrawableBoundsDirty()
     {
-        if (drawables_.Remove(drawable))
-        {
-            if (resetOctant)
-                drawable->SetOctant(0);
-            DecDrawableCount();
-        }
+        drawableBoundsDirty_ = true;
+        for (Octant* octant = parent_; octant && !octant->childBoundsDirty_; octant = octant->parent_)
+            octant->childBoundsDirty_ = true;
     }
 
     /// Return world-space bounding box.
@@ -107,6 +112,10 @@ protected:
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return drawable objects by a packet of ray queries selected by a bit mask, called internally. If candidates is non-null, the drawables are only collected per query for a closest hit test.
+    void GetDrawablesInternal(RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates) const;
+    /// Update out of date packed drawable bounds recursively.
+    void UpdateDrawableBounds();
 
     /// Increase drawable object count recursively.
     void IncDrawableCount()
@@ -138,6 +147,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// Drawable world bounding box centers and half sizes, packed in groups of four drawables as X, Y and Z center and X, Y and Z half size components.
+    PODVector<float> drawableBounds_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS];
     /// World bounding box center.
@@ -154,12 +165,17 @@ protected:
     Octree* root_;
     /// Octant index relative to its siblings or ROOT_INDEX for root octant
     unsigned index_;
+    /// Packed drawable bounds out of date flag.
+    bool drawableBoundsDirty_;
+    /// Packed drawable bounds out of date in a child octant flag.
+    bool childBoundsDirty_;
 };
 
 /// %Octree component. Should be added only to the root scene node
 class URHO3D_API Octree : public Component, public Octant
 {
-    friend void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend class Octant;
+    friend struct RaycastPacketsWork;
 
     URHO3D_OBJECT(Octree, Component);
 
@@ -178,6 +194,10 @@ public:
 
     /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
     void SetSize(const BoundingBox& box, unsigned numLevels);
+    /// Set whether to index the drawables in a dynamic bounding volume tree instead of the octants. Suits scenes with many fast-moving drawables, as the tree is only restructured when a drawable leaves its enlarged bounds.
+    void SetDynamicTree(bool enable);
+    /// Set maximum number of deferrable drawable updates, such as animated model animation updates, per frame. The updates exceeding the budget are postponed to the following frames in round-robin order. 0 (default) is unlimited.
+    void SetUpdateBudget(unsigned budget);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -191,10 +211,20 @@ public:
     void Raycast(RayOctreeQuery& query) const;
     /// Return the closest drawable object by a ray query.
     void RaycastSingle(RayOctreeQuery& query) const;
+    /// Return drawable objects by several ray queries. The octree is traversed once per packet of adjacent queries and the packets are spread over the worker threads, so rays with nearby origins and similar directions should be adjacent.
+    void Raycast(const PODVector<RayOctreeQuery*>& queries) const;
+    /// Return the closest drawable object for each of several ray queries. Traversed in packets over the worker threads like Raycast().
+    void RaycastSingle(const PODVector<RayOctreeQuery*>& queries) const;
 
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
 
+    /// Return whether drawables are indexed in a dynamic bounding volume tree.
+    bool IsDynamicTree() const { return dynamicTree_; }
+
+    /// Return maximum number of deferrable drawable updates per frame.
+    unsigned GetUpdateBudget() const { return updateBudget_; }
+
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
     /// Cancel drawable object's update.
@@ -205,17 +235,43 @@ public:
 private:
     /// Handle render update in case of headless execution.
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    /// Resolve the dirty world bounding boxes and transforms of drawables queued for update, which batched ray queries would otherwise recalculate from several worker threads.
+    void ResolveRayQueryDrawables() const;
+    /// Return drawable objects by a packet of ray queries, or collect the closest hit candidates if candidates is non-null.
+    void RaycastPacket(RayOctreeQuery** queries, unsigned numQueries, PODVector<Drawable*>* candidates) const;
+    /// Insert a drawable to the root and update its dynamic tree leaf.
+    void InsertTreeDrawable(Drawable* drawable);
+    /// Remove a drawable's dynamic tree leaf.
+    void RemoveTreeDrawable(Drawable* drawable);
+    /// Add a drawable to the individually tested list of dynamic tree mode.
+    void AddUnoccludedDrawable(Drawable* drawable);
+    /// Remove a drawable from the individually tested list of dynamic tree mode.
+    void RemoveUnoccludedDrawable(Drawable* drawable);
 
     /// Drawable objects that require update.
     PODVector<Drawable*> drawableUpdates_;
     /// Drawable objects that were inserted during threaded update phase.
     PODVector<Drawable*> threadedDrawableUpdates_;
+    /// Drawable objects to update this frame when the update budget is in use.
+    PODVector<Drawable*> budgetedDrawableUpdates_;
+    /// Drawable objects whose update was postponed due to the update budget.
+    PODVector<Drawable*> postponedDrawableUpdates_;
     /// Mutex for octree reinsertions.
     Mutex octreeMutex_;
     /// Ray query temporary list of drawables.
     mutable PODVector<Drawable*> rayQueryDrawables_;
+    /// Ray query temporary list of drawables sorted by bounding box hit distance.
+    mutable PODVector<Pair<float, Drawable*> > rayQueryHits_;
+    /// Dynamic bounding volume tree of occludee drawables.
+    DrawableTree tree_;
+    /// Drawables tested individually in dynamic tree mode: non-occludees, so that tree node occlusion does not hide them, and drawables without a defined bounding box.
+    PODVector<Drawable*> unoccludedDrawables_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Maximum number of deferrable drawable updates per frame.
+    unsigned updateBudget_;
+    /// Dynamic tree mode flag.
+    bool dynamicTree_;
 };
 
 }
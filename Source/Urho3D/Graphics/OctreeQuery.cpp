@@ -24,6 +24,10 @@
 
 #include "../Graphics/OctreeQuery.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -117,6 +121,113 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawableBounds(Drawable** start, Drawable** end, const float* bounds)
+{
+#ifdef URHO3D_SSE
+    __m128 normalX[NUM_FRUSTUM_PLANES];
+    __m128 normalY[NUM_FRUSTUM_PLANES];
+    __m128 normalZ[NUM_FRUSTUM_PLANES];
+    __m128 absNormalX[NUM_FRUSTUM_PLANES];
+    __m128 absNormalY[NUM_FRUSTUM_PLANES];
+    __m128 absNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 d[NUM_FRUSTUM_PLANES];
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = frustum_.planes_[i];
+        normalX[i] = _mm_set1_ps(plane.normal_.x_);
+        normalY[i] = _mm_set1_ps(plane.normal_.y_);
+        normalZ[i] = _mm_set1_ps(plane.normal_.z_);
+        absNormalX[i] = _mm_set1_ps(plane.absNormal_.x_);
+        absNormalY[i] = _mm_set1_ps(plane.absNormal_.y_);
+        absNormalZ[i] = _mm_set1_ps(plane.absNormal_.z_);
+        d[i] = _mm_set1_ps(plane.d_);
+    }
+    const __m128 zero = _mm_setzero_ps();
+#endif
+
+    Drawable* inside[4];
+
+    for (; start < end; start += 4, bounds += 24)
+    {
+        unsigned count = Min((unsigned)(end - start), 4U);
+        unsigned insideMask;
+
+#ifdef URHO3D_SSE
+        __m128 centerX = _mm_loadu_ps(bounds);
+        __m128 centerY = _mm_loadu_ps(bounds + 4);
+        __m128 centerZ = _mm_loadu_ps(bounds + 8);
+        __m128 halfSizeX = _mm_loadu_ps(bounds + 12);
+        __m128 halfSizeY = _mm_loadu_ps(bounds + 16);
+        __m128 halfSizeZ = _mm_loadu_ps(bounds + 20);
+        __m128 outside = zero;
+
+        // Outside if the center is further behind any plane than the box extends towards it
+        for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[i], centerX), _mm_mul_ps(normalY[i], centerY)),
+                _mm_add_ps(_mm_mul_ps(normalZ[i], centerZ), d[i]));
+            __m128 extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[i], halfSizeX), _mm_mul_ps(absNormalY[i], halfSizeY)),
+                _mm_mul_ps(absNormalZ[i], halfSizeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, extent), zero));
+        }
+
+        insideMask = ~(unsigned)_mm_movemask_ps(outside) & 0xf;
+#else
+        insideMask = 0;
+        for (unsigned j = 0; j < count; ++j)
+        {
+            Vector3 center(bounds[j], bounds[j + 4], bounds[j + 8]);
+            Vector3 halfSize(bounds[j + 12], bounds[j + 16], bounds[j + 20]);
+            bool outside = false;
+
+            for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+            {
+                const Plane& plane = frustum_.planes_[i];
+                if (plane.Distance(center) < -plane.absNormal_.DotProduct(halfSize))
+                {
+                    outside = true;
+                    break;
+                }
+            }
+
+            if (!outside)
+                insideMask |= 1 << j;
+        }
+#endif
+
+        unsigned numInside = 0;
+        for (unsigned j = 0; j < count; ++j)
+        {
+            if (insideMask & (1 << j))
+                inside[numInside++] = start[j];
+        }
+
+        if (numInside)
+            TestDrawables(inside, inside + numInside, true);
+    }
+}
+
+
+void ProcessRayPacket(Drawable* drawable, RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates)
+{
+    unsigned char drawableFlags = drawable->GetDrawableFlags();
+    unsigned viewMask = drawable->GetViewMask();
+
+    for (unsigned i = 0; mask; ++i, mask >>= 1)
+    {
+        if (!(mask & 1))
+            continue;
+
+        RayOctreeQuery& query = *queries[i];
+        if ((drawableFlags & query.drawableFlags_) && (viewMask & query.viewMask_))
+        {
+            if (candidates)
+                candidates[i].Push(drawable);
+            else
+                drawable->ProcessRayQuery(query, query.result_);
+        }
+    }
+}
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
@@ -55,6 +55,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables of an octant that is not fully inside, using the octant's packed world bounding boxes (see Octant::drawableBounds_.) By default tests the drawables individually.
+    virtual void TestDrawableBounds(Drawable** start, Drawable** end, const float* bounds) { TestDrawables(start, end, false); }
 
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -149,6 +151,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Intersection test for drawables using packed world bounding boxes, four at a time. The drawables inside are passed on to TestDrawables() as inside, so that subclasses only need to filter them.
+    virtual void TestDrawableBounds(Drawable** start, Drawable** end, const float* bounds);
 
     /// Frustum.
     Frustum frustum_;
@@ -256,6 +260,9 @@ private:
     RayOctreeQuery& operator =(const RayOctreeQuery& rhs);
 };
 
+/// Test a drawable against the ray queries of a packet selected by a bit mask. The ray queries are processed immediately, or if candidates is non-null, the drawable is collected per query for a closest hit test.
+URHO3D_API void ProcessRayPacket(Drawable* drawable, RayOctreeQuery** queries, unsigned mask, PODVector<Drawable*>* candidates);
+
 class URHO3D_API AllContentOctreeQuery : public OctreeQuery
 {
 public:
@@ -1065,8 +1065,33 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
     if (vs == vertexShader_ && ps == pixelShader_)
         return;
 
+    // If the shaders are not yet compiled, try to load the linked program from the program binary cache first,
+    // in which case compiling them can be skipped altogether
+    bool cachedProgram = false;
+#ifndef GL_ES_VERSION_2_0
+    if (vs && ps && impl_->programBinarySupport_ && (!vs->GetGPUObjectName() || !ps->GetGPUObjectName()))
+    {
+        Pair<ShaderVariation*, ShaderVariation*> combination(vs, ps);
+        ShaderProgramMap::Iterator i = impl_->shaderPrograms_.Find(combination);
+        if (i != impl_->shaderPrograms_.End())
+            cachedProgram = i->second_->GetGPUObjectName() != 0;
+        else if (vs->GetCompilerOutput().Empty() && ps->GetCompilerOutput().Empty())
+        {
+            URHO3D_PROFILE(LoadProgramBinary);
+
+            SharedPtr<ShaderProgram> newProgram(new ShaderProgram(this, vs, ps));
+            if (newProgram->LoadBinary())
+            {
+                URHO3D_LOGDEBUG("Loaded program binary for vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+                impl_->shaderPrograms_[combination] = newProgram;
+                cachedProgram = true;
+            }
+        }
+    }
+#endif
+
     // Compile the shaders now if not yet compiled. If already attempted, do not retry
-    if (vs && !vs->GetGPUObjectName())
+    if (vs && !vs->GetGPUObjectName() && !cachedProgram)
     {
         if (vs->GetCompilerOutput().Empty())
         {
@@ -1085,7 +1110,7 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
             vs = 0;
     }
 
-    if (ps && !ps->GetGPUObjectName())
+    if (ps && !ps->GetGPUObjectName() && !cachedProgram)
     {
         if (ps->GetCompilerOutput().Empty())
         {
@@ -1145,6 +1170,10 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
                 // Note: Link() calls glUseProgram() to set the texture sampler uniforms,
                 // so it is not necessary to call it again
                 impl_->shaderProgram_ = newProgram;
+#ifndef GL_ES_VERSION_2_0
+                if (impl_->programBinarySupport_)
+                    newProgram->SaveBinary();
+#endif
             }
             else
             {
@@ -2803,6 +2832,16 @@ void Graphics::CheckFeatureSupport()
     if (numSupportedRTs >= 4)
         deferredSupport_ = true;
 
+    // Check for program binary support. Check the function pointers instead of the extension, as GLEW may fail to detect
+    // extensions from a GL3 context. Some drivers expose the functions, but no formats
+    int numProgramBinaryFormats = 0;
+    if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numProgramBinaryFormats);
+    impl_->programBinarySupport_ = numProgramBinaryFormats > 0;
+    // Program binaries are only valid for the exact driver that produced them
+    impl_->driverID_ = String((const char*)glGetString(GL_VENDOR)) + " " + String((const char*)glGetString(GL_RENDERER)) + " " +
+        String((const char*)glGetString(GL_VERSION));
+
 #if defined(__APPLE__) && !defined(IOS) && !defined(TVOS)
     // On macOS check for an Intel driver and use shadow map RGBA dummy color textures, because mixing
     // depth-only FBO rendering and backbuffer rendering will bug, resulting in a black screen in full
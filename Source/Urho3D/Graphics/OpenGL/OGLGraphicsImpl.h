@@ -110,6 +110,10 @@ public:
 
     /// Return the GL Context.
     const SDL_GLContext& GetGLContext() { return context_; }
+    /// Return whether linked program binaries can be retrieved and reloaded.
+    bool GetProgramBinarySupport() const { return programBinarySupport_; }
+    /// Return the driver identification string used to key the program binary cache.
+    const String& GetDriverID() const { return driverID_; }
 
 private:
     /// SDL OpenGL context.
@@ -156,12 +160,16 @@ private:
     ShaderProgram* shaderProgram_;
     /// Linked shader programs.
     ShaderProgramMap shaderPrograms_;
+    /// Driver identification string for the program binary cache.
+    String driverID_;
     /// Need FBO commit flag.
     bool fboDirty_;
     /// Need vertex attribute pointer update flag.
     bool vertexBuffersDirty_;
     /// sRGB write mode flag.
     bool sRGBWrite_;
+    /// Program binary support flag.
+    bool programBinarySupport_;
 };
 
 }
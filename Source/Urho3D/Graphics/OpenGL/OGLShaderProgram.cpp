@@ -22,12 +22,17 @@
 
 #include "../../Precompiled.h"
 
+#include "../../Core/Context.h"
 #include "../../Graphics/ConstantBuffer.h"
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/Shader.h"
 #include "../../Graphics/ShaderProgram.h"
 #include "../../Graphics/ShaderVariation.h"
+#include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
+#include "../../Resource/ResourceCache.h"
 
 #include "../../DebugNew.h"
 
@@ -130,6 +135,11 @@ bool ShaderProgram::Link()
 
     glAttachShader(object_.name_, vertexShader_->GetGPUObjectName());
     glAttachShader(object_.name_, pixelShader_->GetGPUObjectName());
+#ifndef GL_ES_VERSION_2_0
+    // Some drivers only retain the program binary when asked before linking
+    if (graphics_->GetImpl()->GetProgramBinarySupport())
+        glProgramParameteri(object_.name_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
     glLinkProgram(object_.name_);
 
     int linked, length;
@@ -149,6 +159,140 @@ bool ShaderProgram::Link()
     if (!object_.name_)
         return false;
 
+    ExamineProgram();
+    return true;
+}
+
+bool ShaderProgram::LoadBinary()
+{
+#ifndef GL_ES_VERSION_2_0
+    Release();
+
+    String key, fileName;
+    if (!GetBinaryKey(key, fileName))
+        return false;
+
+    FileSystem* fileSystem = graphics_->GetSubsystem<FileSystem>();
+    if (!fileSystem->FileExists(fileName))
+        return false;
+
+    SharedPtr<File> file(new File(graphics_->GetContext(), fileName));
+    if (!file->IsOpen() || file->ReadFileID() != "UGLP")
+        return false;
+
+    // The stored key must match exactly, so that a changed driver or shader source or a hash collision is never accepted
+    if (file->ReadString() != key)
+        return false;
+
+    unsigned format = file->ReadUInt();
+    unsigned dataSize = file->ReadUInt();
+    if (!dataSize || dataSize > file->GetSize() - file->GetPosition())
+        return false;
+
+    SharedArrayPtr<unsigned char> data(new unsigned char[dataSize]);
+    if (file->Read(data.Get(), dataSize) != dataSize)
+        return false;
+
+    object_.name_ = glCreateProgram();
+    if (!object_.name_)
+        return false;
+
+    glProgramBinary(object_.name_, format, data.Get(), (GLsizei)dataSize);
+
+    // The driver may reject the binary, for example after a driver update. In that case the caller falls back to compiling
+    int linked;
+    glGetProgramiv(object_.name_, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        URHO3D_LOGDEBUG("Program binary " + fileName + " was rejected by the driver");
+        glDeleteProgram(object_.name_);
+        object_.name_ = 0;
+        return false;
+    }
+
+    linkerOutput_.Clear();
+    ExamineProgram();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::SaveBinary()
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!object_.name_)
+        return false;
+
+    String key, fileName;
+    if (!GetBinaryKey(key, fileName))
+        return false;
+
+    int dataSize = 0;
+    glGetProgramiv(object_.name_, GL_PROGRAM_BINARY_LENGTH, &dataSize);
+    if (dataSize <= 0)
+        return false;
+
+    SharedArrayPtr<unsigned char> data(new unsigned char[dataSize]);
+    GLenum format = 0;
+    GLsizei outLength = 0;
+    glGetProgramBinary(object_.name_, (GLsizei)dataSize, &outLength, &format, data.Get());
+    if (outLength <= 0)
+        return false;
+
+    FileSystem* fileSystem = graphics_->GetSubsystem<FileSystem>();
+    String path = GetPath(fileName);
+    if (!fileSystem->DirExists(path) && !fileSystem->CreateDir(path))
+        return false;
+
+    SharedPtr<File> file(new File(graphics_->GetContext(), fileName, FILE_WRITE));
+    if (!file->IsOpen())
+        return false;
+
+    file->WriteFileID("UGLP");
+    file->WriteString(key);
+    file->WriteUInt(format);
+    file->WriteUInt((unsigned)outLength);
+    file->Write(data.Get(), (unsigned)outLength);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::GetBinaryKey(String& key, String& fileName) const
+{
+    if (!graphics_ || !graphics_->GetImpl()->GetProgramBinarySupport() || !vertexShader_ || !pixelShader_)
+        return false;
+
+    Shader* vsOwner = vertexShader_->GetOwner();
+    Shader* psOwner = pixelShader_->GetOwner();
+    const String& cacheDir = graphics_->GetShaderCacheDir();
+    if (!vsOwner || !psOwner || cacheDir.Empty())
+        return false;
+
+    // Key by the driver, the shader sources and everything else that goes into the final shader code
+    key = graphics_->GetImpl()->GetDriverID() + "\n" +
+        vertexShader_->GetFullName() + " " + StringHash(vsOwner->GetSourceCode(VS)).ToString() + "\n" +
+        pixelShader_->GetFullName() + " " + StringHash(psOwner->GetSourceCode(PS)).ToString() + "\n" +
+        String(Graphics::GetMaxBones()) + " " + String(Graphics::GetGL3Support());
+
+    // The shader cache directory may either be an absolute path or a path within the resource system
+    String path = cacheDir;
+    if (!IsAbsolutePath(path))
+    {
+        const Vector<String>& resourceDirs = graphics_->GetSubsystem<ResourceCache>()->GetResourceDirs();
+        if (resourceDirs.Empty())
+            return false;
+        path = resourceDirs[0] + path;
+    }
+
+    fileName = path + "Programs/" + StringHash(key).ToString() + ".glp";
+    return true;
+}
+
+void ShaderProgram::ExamineProgram()
+{
     const int MAX_NAME_LENGTH = 256;
     char nameBuffer[MAX_NAME_LENGTH];
     int attributeCount, uniformCount, elementCount, nameLength;
@@ -320,8 +464,6 @@ bool ShaderProgram::Link()
     // Rehash the parameter & vertex attributes maps to ensure minimal load factor
     vertexAttributes_.Rehash(NextPowerOfTwo(vertexAttributes_.Size()));
     shaderParameters_.Rehash(NextPowerOfTwo(shaderParameters_.Size()));
-
-    return true;
 }
 
 ShaderVariation* ShaderProgram::GetVertexShader() const
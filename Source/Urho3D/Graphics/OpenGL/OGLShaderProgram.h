@@ -50,6 +50,10 @@ public:
 
     /// Link the shaders and examine the uniforms and samplers used. Return true if successful.
     bool Link();
+    /// Create the program from the program binary cache without compiling the shaders, and examine the uniforms and samplers used. Return true if successful.
+    bool LoadBinary();
+    /// Save the linked program to the program binary cache. Return true if successful.
+    bool SaveBinary();
 
     /// Return the vertex shader.
     ShaderVariation* GetVertexShader() const;
@@ -87,6 +91,11 @@ public:
     static void ClearGlobalParameterSource(ShaderParameterGroup group);
 
 private:
+    /// Examine the vertex attributes, uniforms and samplers of the linked program.
+    void ExamineProgram();
+    /// Return the program binary cache key and file name. Return false if the program binary cache is not in use.
+    bool GetBinaryKey(String& key, String& fileName) const;
+
     /// Vertex shader.
     WeakPtr<ShaderVariation> vertexShader_;
     /// Pixel shader.
@@ -56,42 +56,56 @@ void ShaderVariation::OnDeviceLost()
 
 void ShaderVariation::Release()
 {
-    if (object_.name_)
+    if (!graphics_)
     {
-        if (!graphics_)
-            return;
+        compilerOutput_.Clear();
+        preparedCode_.Clear();
+        preparedCode_.Compact();
+        prepared_ = false;
+        return;
+    }
 
-        if (!graphics_->IsDeviceLost())
+    if (!graphics_->IsDeviceLost())
+    {
+        if (type_ == VS)
         {
-            if (type_ == VS)
-            {
-                if (graphics_->GetVertexShader() == this)
-                    graphics_->SetShaders(0, 0);
-            }
-            else
-            {
-                if (graphics_->GetPixelShader() == this)
-                    graphics_->SetShaders(0, 0);
-            }
-
-            glDeleteShader(object_.name_);
+            if (graphics_->GetVertexShader() == this)
+                graphics_->SetShaders(0, 0);
+        }
+        else
+        {
+            if (graphics_->GetPixelShader() == this)
+                graphics_->SetShaders(0, 0);
         }
 
-        object_.name_ = 0;
-        graphics_->CleanupShaderPrograms(this);
+        if (object_.name_)
+            glDeleteShader(object_.name_);
     }
 
+    object_.name_ = 0;
+    // Shader programs loaded from the program binary cache may refer to this variation even if it was never compiled
+    graphics_->CleanupShaderPrograms(this);
     compilerOutput_.Clear();
+    preparedCode_.Clear();
+    preparedCode_.Compact();
+    prepared_ = false;
 }
 
 bool ShaderVariation::Create()
 {
+    // Release() discards the code assembled by Prepare(), so take it first
+    String shaderCode;
+    if (prepared_)
+        shaderCode.Swap(preparedCode_);
+
     Release();
 
-    if (!owner_)
+    if (shaderCode.Empty())
     {
-        compilerOutput_ = "Owner shader has expired";
-        return false;
+        if (!Prepare())
+            return false;
+        shaderCode.Swap(preparedCode_);
+        prepared_ = false;
     }
 
     object_.name_ = glCreateShader(type_ == VS ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
@@ -101,6 +115,35 @@ bool ShaderVariation::Create()
         return false;
     }
 
+    const char* shaderCStr = shaderCode.CString();
+    glShaderSource(object_.name_, 1, &shaderCStr, 0);
+    glCompileShader(object_.name_);
+
+    int compiled, length;
+    glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
+        compilerOutput_.Resize((unsigned)length);
+        int outLength;
+        glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
+        glDeleteShader(object_.name_);
+        object_.name_ = 0;
+    }
+    else
+        compilerOutput_.Clear();
+
+    return object_.name_ != 0;
+}
+
+bool ShaderVariation::Prepare()
+{
+    if (!owner_)
+    {
+        compilerOutput_ = "Owner shader has expired";
+        return false;
+    }
+
     const String& originalShaderCode = owner_->GetSourceCode(type_);
     String shaderCode;
 
@@ -166,25 +209,9 @@ bool ShaderVariation::Create()
     else
         shaderCode += originalShaderCode;
 
-    const char* shaderCStr = shaderCode.CString();
-    glShaderSource(object_.name_, 1, &shaderCStr, 0);
-    glCompileShader(object_.name_);
-
-    int compiled, length;
-    glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
-    if (!compiled)
-    {
-        glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
-        compilerOutput_.Resize((unsigned)length);
-        int outLength;
-        glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
-        glDeleteShader(object_.name_);
-        object_.name_ = 0;
-    }
-    else
-        compilerOutput_.Clear();
-
-    return object_.name_ != 0;
+    preparedCode_.Swap(shaderCode);
+    prepared_ = true;
+    return true;
 }
 
 void ShaderVariation::SetDefines(const String& defines)
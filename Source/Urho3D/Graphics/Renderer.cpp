@@ -36,6 +36,7 @@
 #include "../Graphics/Octree.h"
 #include "../Graphics/Renderer.h"
 #include "../Graphics/RenderPath.h"
+#include "../Graphics/ShaderDefines.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Texture2D.h"
@@ -296,9 +297,13 @@ Renderer::Renderer(Context* context) :
     drawShadows_(true),
     reuseShadowMaps_(true),
     dynamicInstancing_(true),
+    retainedInstancing_(false),
     numExtraInstancingBufferElements_(0),
     threadedOcclusion_(false),
+    temporalOcclusion_(false),
+    occluderRefreshInterval_(4),
     shadersDirty_(true),
+    internedDefinesValid_(false),
     initialized_(false),
     resetViews_(false)
 {
@@ -499,6 +504,11 @@ void Renderer::SetDynamicInstancing(bool enable)
     dynamicInstancing_ = enable;
 }
 
+void Renderer::SetRetainedInstancing(bool enable)
+{
+    retainedInstancing_ = enable;
+}
+
 void Renderer::SetNumExtraInstancingBufferElements(int elements)
 {
     if (numExtraInstancingBufferElements_ != elements)
@@ -527,6 +537,7 @@ void Renderer::SetOcclusionBufferSize(int size)
 {
     occlusionBufferSize_ = Max(size, 1);
     occlusionBuffers_.Clear();
+    temporalOcclusionBuffers_.Clear();
 }
 
 void Renderer::SetMobileShadowBiasMul(float mul)
@@ -555,9 +566,24 @@ void Renderer::SetThreadedOcclusion(bool enable)
     {
         threadedOcclusion_ = enable;
         occlusionBuffers_.Clear();
+        temporalOcclusionBuffers_.Clear();
+    }
+}
+
+void Renderer::SetTemporalOcclusion(bool enable)
+{
+    if (enable != temporalOcclusion_)
+    {
+        temporalOcclusion_ = enable;
+        temporalOcclusionBuffers_.Clear();
     }
 }
 
+void Renderer::SetOccluderRefreshInterval(int frames)
+{
+    occluderRefreshInterval_ = Max(frames, 1);
+}
+
 void Renderer::ReloadShaders()
 {
     shadersDirty_ = true;
@@ -1119,17 +1145,31 @@ RenderSurface* Renderer::GetDepthStencil(int width, int height, int multiSample,
 
 OcclusionBuffer* Renderer::GetOcclusionBuffer(Camera* camera)
 {
-    assert(numOcclusionBuffers_ <= occlusionBuffers_.Size());
-    if (numOcclusionBuffers_ == occlusionBuffers_.Size())
+    OcclusionBuffer* buffer;
+
+    if (temporalOcclusion_)
     {
-        SharedPtr<OcclusionBuffer> newBuffer(new OcclusionBuffer(context_));
-        occlusionBuffers_.Push(newBuffer);
+        // Keep a buffer per camera so that its depth can be reprojected on the next frame
+        SharedPtr<OcclusionBuffer>& temporalBuffer = temporalOcclusionBuffers_[camera];
+        if (!temporalBuffer)
+            temporalBuffer = new OcclusionBuffer(context_);
+        buffer = temporalBuffer;
+    }
+    else
+    {
+        assert(numOcclusionBuffers_ <= occlusionBuffers_.Size());
+        if (numOcclusionBuffers_ == occlusionBuffers_.Size())
+        {
+            SharedPtr<OcclusionBuffer> newBuffer(new OcclusionBuffer(context_));
+            occlusionBuffers_.Push(newBuffer);
+        }
+
+        buffer = occlusionBuffers_[numOcclusionBuffers_++];
     }
 
     int width = occlusionBufferSize_;
     int height = (int)((float)occlusionBufferSize_ / camera->GetAspectRatio() + 0.5f);
 
-    OcclusionBuffer* buffer = occlusionBuffers_[numOcclusionBuffers_++];
     buffer->SetSize(width, height, threadedOcclusion_);
     buffer->SetView(camera);
     buffer->ResetUseTimer();
@@ -1569,6 +1609,18 @@ void Renderer::RemoveUnusedBuffers()
         }
     }
 
+    for (HashMap<Camera*, SharedPtr<OcclusionBuffer> >::Iterator i = temporalOcclusionBuffers_.Begin();
+         i != temporalOcclusionBuffers_.End();)
+    {
+        if (i->second_->GetUseTimer() > MAX_BUFFER_AGE)
+        {
+            URHO3D_LOGDEBUG("Removed unused temporal occlusion buffer");
+            i = temporalOcclusionBuffers_.Erase(i);
+        }
+        else
+            ++i;
+    }
+
     for (HashMap<long long, Vector<SharedPtr<Texture> > >::Iterator i = screenBuffers_.Begin(); i != screenBuffers_.End();)
     {
         HashMap<long long, Vector<SharedPtr<Texture> > >::Iterator current = i++;
@@ -1662,6 +1714,25 @@ void Renderer::LoadShaders()
             deferredLightPSVariations_[i] += "ORTHO ";
     }
 
+    // Intern the forward rendering variation defines, including the shadow defines for the current shadow quality
+    String shadowVariations = GetShadowVariations();
+    internedDefinesValid_ = true;
+    for (unsigned i = 0; i < MAX_GEOMETRYTYPES; ++i)
+        internedDefinesValid_ &= ShaderDefines::Intern(geometryVSVariations[i], geometryVSDefines_[i]);
+    for (unsigned i = 0; i < MAX_LIGHT_VS_VARIATIONS; ++i)
+        internedDefinesValid_ &= ShaderDefines::Intern(lightVSVariations[i], lightVSDefines_[i]);
+    for (unsigned i = 0; i < MAX_VERTEXLIGHT_VS_VARIATIONS; ++i)
+        internedDefinesValid_ &= ShaderDefines::Intern(vertexLightVSVariations[i], vertexLightVSDefines_[i]);
+    for (unsigned i = 0; i < MAX_LIGHT_PS_VARIATIONS; ++i)
+    {
+        String defines = lightPSVariations[i];
+        if (i & LPS_SHADOW)
+            defines += shadowVariations;
+        internedDefinesValid_ &= ShaderDefines::Intern(defines, lightPSDefines_[i]);
+    }
+    for (unsigned i = 0; i < 2; ++i)
+        internedDefinesValid_ &= ShaderDefines::Intern(heightFogVariations[i], heightFogDefines_[i]);
+
     shadersDirty_ = false;
 }
 
@@ -1702,6 +1773,14 @@ void Renderer::LoadPassShaders(Pass* pass, Vector<SharedPtr<ShaderVariation> >&
         psDefines += "VSM_SHADOW ";
     }
 
+    // Intern the pass defines so that the variations can be combined and queried without string operations.
+    // Fall back to strings if the intern table is full
+    ShaderDefineMask vsMask;
+    ShaderDefineMask psMask;
+    bool useMasks = internedDefinesValid_ && ShaderDefines::Intern(vsDefines, vsMask) && ShaderDefines::Intern(psDefines, psMask);
+    const String& vsName = pass->GetVertexShader();
+    const String& psName = pass->GetPixelShader();
+
     if (pass->GetLightingMode() == LIGHTING_PERPIXEL)
     {
         // Load forward pixel lit variations
@@ -1713,22 +1792,26 @@ void Renderer::LoadPassShaders(Pass* pass, Vector<SharedPtr<ShaderVariation> >&
             unsigned g = j / MAX_LIGHT_VS_VARIATIONS;
             unsigned l = j % MAX_LIGHT_VS_VARIATIONS;
 
-            vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(),
-                vsDefines + lightVSVariations[l] + geometryVSVariations[g]);
+            if (useMasks)
+                vertexShaders[j] = graphics_->GetShader(VS, vsName, vsMask | lightVSDefines_[l] | geometryVSDefines_[g]);
+            else
+                vertexShaders[j] = graphics_->GetShader(VS, vsName, vsDefines + lightVSVariations[l] + geometryVSVariations[g]);
         }
         for (unsigned j = 0; j < MAX_LIGHT_PS_VARIATIONS * 2; ++j)
         {
             unsigned l = j % MAX_LIGHT_PS_VARIATIONS;
             unsigned h = j / MAX_LIGHT_PS_VARIATIONS;
 
-            if (l & LPS_SHADOW)
+            if (useMasks)
+                pixelShaders[j] = graphics_->GetShader(PS, psName, psMask | lightPSDefines_[l] | heightFogDefines_[h]);
+            else if (l & LPS_SHADOW)
             {
-                pixelShaders[j] = graphics_->GetShader(PS, pass->GetPixelShader(),
+                pixelShaders[j] = graphics_->GetShader(PS, psName,
                     psDefines + lightPSVariations[l] + GetShadowVariations() +
                     heightFogVariations[h]);
             }
             else
-                pixelShaders[j] = graphics_->GetShader(PS, pass->GetPixelShader(),
+                pixelShaders[j] = graphics_->GetShader(PS, psName,
                     psDefines + lightPSVariations[l] + heightFogVariations[h]);
         }
     }
@@ -1742,8 +1825,10 @@ void Renderer::LoadPassShaders(Pass* pass, Vector<SharedPtr<ShaderVariation> >&
             {
                 unsigned g = j / MAX_VERTEXLIGHT_VS_VARIATIONS;
                 unsigned l = j % MAX_VERTEXLIGHT_VS_VARIATIONS;
-                vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(),
-                    vsDefines + vertexLightVSVariations[l] + geometryVSVariations[g]);
+                if (useMasks)
+                    vertexShaders[j] = graphics_->GetShader(VS, vsName, vsMask | vertexLightVSDefines_[l] | geometryVSDefines_[g]);
+                else
+                    vertexShaders[j] = graphics_->GetShader(VS, vsName, vsDefines + vertexLightVSVariations[l] + geometryVSVariations[g]);
             }
         }
         else
@@ -1751,16 +1836,20 @@ void Renderer::LoadPassShaders(Pass* pass, Vector<SharedPtr<ShaderVariation> >&
             vertexShaders.Resize(MAX_GEOMETRYTYPES);
             for (unsigned j = 0; j < MAX_GEOMETRYTYPES; ++j)
             {
-                vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(),
-                    vsDefines + geometryVSVariations[j]);
+                if (useMasks)
+                    vertexShaders[j] = graphics_->GetShader(VS, vsName, vsMask | geometryVSDefines_[j]);
+                else
+                    vertexShaders[j] = graphics_->GetShader(VS, vsName, vsDefines + geometryVSVariations[j]);
             }
         }
 
         pixelShaders.Resize(2);
         for (unsigned j = 0; j < 2; ++j)
         {
-            pixelShaders[j] =
-                graphics_->GetShader(PS, pass->GetPixelShader(), psDefines + heightFogVariations[j]);
+            if (useMasks)
+                pixelShaders[j] = graphics_->GetShader(PS, psName, psMask | heightFogDefines_[j]);
+            else
+                pixelShaders[j] = graphics_->GetShader(PS, psName, psDefines + heightFogVariations[j]);
         }
     }
 
@@ -1934,6 +2023,7 @@ void Renderer::ResetShadowMaps()
 void Renderer::ResetBuffers()
 {
     occlusionBuffers_.Clear();
+    temporalOcclusionBuffers_.Clear();
     screenBuffers_.Clear();
     screenBufferAllocations_.Clear();
 }
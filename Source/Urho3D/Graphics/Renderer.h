@@ -26,6 +26,7 @@
 #include "../Core/Mutex.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Drawable.h"
+#include "../Graphics/ShaderDefines.h"
 #include "../Graphics/Viewport.h"
 #include "../Math/Color.h"
 
@@ -225,6 +226,8 @@ public:
     void SetDynamicInstancing(bool enable);
     /// Set number of extra instancing buffer elements. Default is 0. Extra 4-vectors are available through TEXCOORD7 and further.
     void SetNumExtraInstancingBufferElements(int elements);
+    /// Set retained instancing on/off. When on, views keep their instanced batch groups and a private instancing buffer between frames, and only upload the instance data that changed. The group membership of the visible batches is still rebuilt each frame. Default is false.
+    void SetRetainedInstancing(bool enable);
     /// Set minimum number of instances required in a batch group to render as instanced.
     void SetMinInstances(int instances);
     /// Set maximum number of sorted instances per batch group. If exceeded, instances are rendered unsorted.
@@ -237,6 +240,10 @@ public:
     void SetOccluderSizeThreshold(float screenSize);
     /// Set whether to thread occluder rendering. Default false.
     void SetThreadedOcclusion(bool enable);
+    /// Set temporal occlusion on/off. When on, each camera keeps its occlusion buffer, the previous frame's depth is reprojected to the new view and only part of the occluders are redrawn each frame. Default false.
+    void SetTemporalOcclusion(bool enable);
+    /// Set in how many frames all occluders are redrawn when using temporal occlusion. Reprojected depth older than this is discarded. Default 4.
+    void SetOccluderRefreshInterval(int frames);
     /// Set shadow depth bias multiplier for mobile platforms to counteract possible worse shadow map precision. Default 1.0 (no effect.)
     void SetMobileShadowBiasMul(float mul);
     /// Set shadow depth bias addition for mobile platforms to counteract possible worse shadow map precision. Default 0.0 (no effect.)
@@ -307,6 +314,9 @@ public:
     /// Return number of extra instancing buffer elements.
     int GetNumExtraInstancingBufferElements() const { return numExtraInstancingBufferElements_; };
 
+    /// Return whether retained instancing is in use.
+    bool GetRetainedInstancing() const { return retainedInstancing_ && dynamicInstancing_; }
+
     /// Return minimum number of instances required in a batch group to render as instanced.
     int GetMinInstances() const { return minInstances_; }
 
@@ -325,6 +335,12 @@ public:
     /// Return whether occlusion rendering is threaded.
     bool GetThreadedOcclusion() const { return threadedOcclusion_; }
 
+    /// Return whether temporal occlusion is in use.
+    bool GetTemporalOcclusion() const { return temporalOcclusion_; }
+
+    /// Return occluder refresh interval for temporal occlusion.
+    int GetOccluderRefreshInterval() const { return occluderRefreshInterval_; }
+
     /// Return shadow depth bias multiplier for mobile platforms.
     float GetMobileShadowBiasMul() const { return mobileShadowBiasMul_; }
 
@@ -499,6 +515,8 @@ private:
     Vector<SharedPtr<Node> > shadowCameraNodes_;
     /// Reusable occlusion buffers.
     Vector<SharedPtr<OcclusionBuffer> > occlusionBuffers_;
+    /// Occlusion buffers kept per camera for temporal occlusion.
+    HashMap<Camera*, SharedPtr<OcclusionBuffer> > temporalOcclusionBuffers_;
     /// Shadow maps by resolution.
     HashMap<int, Vector<SharedPtr<Texture2D> > > shadowMaps_;
     /// Shadow map dummy color buffers by resolution.
@@ -533,6 +551,16 @@ private:
     Mutex rendererMutex_;
     /// Current variation names for deferred light volume shaders.
     Vector<String> deferredLightPSVariations_;
+    /// Interned define sets of the geometry type vertex shader variations.
+    ShaderDefineMask geometryVSDefines_[MAX_GEOMETRYTYPES];
+    /// Interned define sets of the per-pixel light vertex shader variations.
+    ShaderDefineMask lightVSDefines_[MAX_LIGHT_VS_VARIATIONS];
+    /// Interned define sets of the vertex light vertex shader variations.
+    ShaderDefineMask vertexLightVSDefines_[MAX_VERTEXLIGHT_VS_VARIATIONS];
+    /// Interned define sets of the per-pixel light pixel shader variations, including the current shadow defines.
+    ShaderDefineMask lightPSDefines_[MAX_LIGHT_PS_VARIATIONS];
+    /// Interned define sets of the height fog pixel shader variations.
+    ShaderDefineMask heightFogDefines_[2];
     /// Frame info for rendering.
     FrameInfo frame_;
     /// Texture anisotropy level.
@@ -593,12 +621,20 @@ private:
     bool reuseShadowMaps_;
     /// Dynamic instancing flag.
     bool dynamicInstancing_;
+    /// Retained instancing flag.
+    bool retainedInstancing_;
     /// Number of extra instancing data elements.
     int numExtraInstancingBufferElements_;
     /// Threaded occlusion rendering flag.
     bool threadedOcclusion_;
+    /// Temporal occlusion flag.
+    bool temporalOcclusion_;
+    /// Occluder refresh interval in frames for temporal occlusion.
+    int occluderRefreshInterval_;
     /// Shaders need reloading flag.
     bool shadersDirty_;
+    /// Whether the interned variation define sets are valid. If not, shader variations are queried with define strings.
+    bool internedDefinesValid_;
     /// Initialized flag.
     bool initialized_;
     /// Flag for views needing reset.
@@ -157,6 +157,19 @@ ShaderVariation* Shader::GetVariation(ShaderType type, const char* defines)
     return i->second_;
 }
 
+ShaderVariation* Shader::GetVariation(ShaderType type, const ShaderDefineMask& defines)
+{
+    HashMap<ShaderDefineMask, ShaderVariation*>& variations(type == VS ? vsMaskVariations_ : psMaskVariations_);
+    HashMap<ShaderDefineMask, ShaderVariation*>::Iterator i = variations.Find(defines);
+    if (i != variations.End())
+        return i->second_;
+
+    // Not queried with this define set yet. Go through the define string, so that the variation is shared with string queries
+    ShaderVariation* variation = GetVariation(type, ShaderDefines::ToString(defines));
+    variations[defines] = variation;
+    return variation;
+}
+
 bool Shader::ProcessSource(String& code, Deserializer& source)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/ArrayPtr.h"
+#include "../Graphics/ShaderDefines.h"
 #include "../Resource/Resource.h"
 
 namespace Urho3D
@@ -52,6 +53,8 @@ public:
     ShaderVariation* GetVariation(ShaderType type, const String& defines);
     /// Return a variation with defines. Separate multiple defines with spaces.
     ShaderVariation* GetVariation(ShaderType type, const char* defines);
+    /// Return a variation with an interned define set. Faster than the string versions, as the defines need not be hashed or normalized.
+    ShaderVariation* GetVariation(ShaderType type, const ShaderDefineMask& defines);
 
     /// Return either vertex or pixel shader source code.
     const String& GetSourceCode(ShaderType type) const { return type == VS ? vsSourceCode_ : psSourceCode_; }
@@ -75,6 +78,10 @@ private:
     HashMap<StringHash, SharedPtr<ShaderVariation> > vsVariations_;
     /// Pixel shader variations.
     HashMap<StringHash, SharedPtr<ShaderVariation> > psVariations_;
+    /// Vertex shader variations by interned define set.
+    HashMap<ShaderDefineMask, ShaderVariation*> vsMaskVariations_;
+    /// Pixel shader variations by interned define set.
+    HashMap<ShaderDefineMask, ShaderVariation*> psMaskVariations_;
     /// Source code timestamp.
     unsigned timeStamp_;
     /// Number of unique variations so far.
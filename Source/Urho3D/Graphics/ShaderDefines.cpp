@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/HashMap.h"
+#include "../Container/Sort.h"
+#include "../Core/Mutex.h"
+#include "../Graphics/ShaderDefines.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Mutex for interning from the worker threads.
+static Mutex internMutex;
+/// Interned define indices by name.
+static HashMap<String, unsigned> defineIndices;
+/// Interned define names by index.
+static Vector<String> defineNames;
+
+bool ShaderDefines::Intern(const String& defines, ShaderDefineMask& dest)
+{
+    Vector<String> defineVec = defines.ToUpper().Split(' ');
+    ShaderDefineMask mask;
+
+    MutexLock lock(internMutex);
+
+    for (unsigned i = 0; i < defineVec.Size(); ++i)
+    {
+        HashMap<String, unsigned>::ConstIterator j = defineIndices.Find(defineVec[i]);
+        if (j != defineIndices.End())
+            mask.Set(j->second_);
+        else
+        {
+            if (defineNames.Size() >= MAX_SHADER_DEFINES)
+                return false;
+
+            unsigned index = defineNames.Size();
+            defineIndices[defineVec[i]] = index;
+            defineNames.Push(defineVec[i]);
+            mask.Set(index);
+        }
+    }
+
+    dest = mask;
+    return true;
+}
+
+String ShaderDefines::ToString(const ShaderDefineMask& defines)
+{
+    Vector<String> defineVec;
+
+    {
+        MutexLock lock(internMutex);
+
+        for (unsigned i = 0; i < defineNames.Size(); ++i)
+        {
+            if (defines.IsSet(i))
+                defineVec.Push(defineNames[i]);
+        }
+    }
+
+    // Sort the same way as Shader::NormalizeDefines() so that both resolve to the same variation
+    Sort(defineVec.Begin(), defineVec.End());
+    return String::Joined(defineVec, " ");
+}
+
+}
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Str.h"
+
+namespace Urho3D
+{
+
+/// Maximum number of distinct shader defines that can be interned.
+static const unsigned MAX_SHADER_DEFINES = 128;
+
+/// Compact key of a set of interned shader defines, with one bit per define.
+struct URHO3D_API ShaderDefineMask
+{
+    /// Construct an empty set.
+    ShaderDefineMask()
+    {
+        bits_[0] = bits_[1] = 0;
+    }
+
+    /// Test for equality with another define set.
+    bool operator ==(const ShaderDefineMask& rhs) const { return bits_[0] == rhs.bits_[0] && bits_[1] == rhs.bits_[1]; }
+
+    /// Test for inequality with another define set.
+    bool operator !=(const ShaderDefineMask& rhs) const { return !(*this == rhs); }
+
+    /// Return the union with another define set.
+    ShaderDefineMask operator |(const ShaderDefineMask& rhs) const
+    {
+        ShaderDefineMask ret(*this);
+        ret |= rhs;
+        return ret;
+    }
+
+    /// Add the defines of another define set.
+    ShaderDefineMask& operator |=(const ShaderDefineMask& rhs)
+    {
+        bits_[0] |= rhs.bits_[0];
+        bits_[1] |= rhs.bits_[1];
+        return *this;
+    }
+
+    /// Add a define by interned index.
+    void Set(unsigned index) { bits_[index >> 6] |= 1ULL << (index & 63); }
+
+    /// Return whether contains a define by interned index.
+    bool IsSet(unsigned index) const { return (bits_[index >> 6] & (1ULL << (index & 63))) != 0; }
+
+    /// Return whether the set is empty.
+    bool Empty() const { return !bits_[0] && !bits_[1]; }
+
+    /// Return hash value for HashSet & HashMap.
+    unsigned ToHash() const
+    {
+        unsigned long long combined = bits_[0] ^ (bits_[1] * 0x9e3779b97f4a7c15ULL);
+        return (unsigned)(combined ^ (combined >> 32));
+    }
+
+    /// Define bits.
+    unsigned long long bits_[2];
+};
+
+/// Interning of shader define strings into compact define set keys. Thread-safe.
+class URHO3D_API ShaderDefines
+{
+public:
+    /// Intern space-separated defines into a define set. Return false if the defines do not fit into the intern table, in which case they need to be handled as a string.
+    static bool Intern(const String& defines, ShaderDefineMask& dest);
+    /// Return the normalized define string of a define set: uppercase, sorted and separated by spaces.
+    static String ToString(const ShaderDefineMask& defines);
+};
+
+}
@@ -22,6 +22,7 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsImpl.h"
 #include "../Graphics/ShaderPrecache.h"
@@ -35,6 +36,26 @@
 namespace Urho3D
 {
 
+/// Work function for preparing shader variations on the worker threads.
+struct PrepareShadersWork
+{
+    /// Construct.
+    PrepareShadersWork(ShaderVariation** variations) :
+        variations_(variations)
+    {
+    }
+
+    /// Prepare a range of shader variations.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        for (unsigned i = begin; i < end; ++i)
+            variations_[i]->Prepare();
+    }
+
+    /// Shader variations.
+    ShaderVariation** variations_;
+};
+
 ShaderPrecache::ShaderPrecache(Context* context, const String& fileName) :
     Object(context),
     fileName_(fileName),
@@ -111,6 +132,8 @@ void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
     XMLFile xmlFile(graphics->GetContext());
     xmlFile.Load(source);
 
+    // Look up all the listed shader variations first. This loads the shader resources and is done on the main thread
+    PODVector<ShaderVariation*> combinations;
     XMLElement shader = xmlFile.GetRoot().GetChild("shader");
     while (shader)
     {
@@ -130,14 +153,48 @@ void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
         }
 #endif
 
-        ShaderVariation* vs = graphics->GetShader(VS, shader.GetAttribute("vs"), vsDefines);
-        ShaderVariation* ps = graphics->GetShader(PS, shader.GetAttribute("ps"), psDefines);
-        // Set the shaders active to actually compile them
-        graphics->SetShaders(vs, ps);
+        combinations.Push(graphics->GetShader(VS, shader.GetAttribute("vs"), vsDefines));
+        combinations.Push(graphics->GetShader(PS, shader.GetAttribute("ps"), psDefines));
 
         shader = shader.GetNext("shader");
     }
 
+    // Assemble the source code (OpenGL) or load or compile the bytecode (Direct3D) of the variations not yet created
+    // on the worker threads, so that only the final GPU side work remains for the main thread
+    PODVector<ShaderVariation*> variations;
+    HashSet<ShaderVariation*> processed;
+    for (unsigned i = 0; i < combinations.Size(); ++i)
+    {
+        ShaderVariation* variation = combinations[i];
+        if (!variation)
+            continue;
+        bool exists;
+        processed.Insert(variation, exists);
+        if (exists)
+            continue;
+
+#ifdef URHO3D_OPENGL
+        if (!variation->GetGPUObjectName() && variation->GetCompilerOutput().Empty())
+#else
+        if (!variation->GetGPUObject() && variation->GetCompilerOutput().Empty())
+#endif
+            variations.Push(variation);
+    }
+
+    if (variations.Size())
+    {
+        PrepareShadersWork work(&variations[0]);
+        WorkQueue* queue = graphics->GetSubsystem<WorkQueue>();
+        if (queue)
+            queue->ParallelFor(0, variations.Size(), 1, work);
+        else
+            work(0, variations.Size(), 0);
+    }
+
+    // Set the shaders active to actually compile them
+    for (unsigned i = 0; i < combinations.Size(); i += 2)
+        graphics->SetShaders(combinations[i], combinations[i + 1]);
+
     URHO3D_LOGDEBUG("End precaching shaders");
 }
 
@@ -25,17 +25,23 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Shader.h"
 #include "../Graphics/ShaderVariation.h"
+#include "../Graphics/SortIDAllocator.h"
 
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+/// Sort ID allocators for vertex and pixel shaders.
+static SortIDAllocator sortIDs[2];
+
 ShaderVariation::ShaderVariation(Shader* owner, ShaderType type) :
     GPUObject(owner->GetSubsystem<Graphics>()),
     owner_(owner),
     type_(type),
-    elementHash_(0)
+    elementHash_(0),
+    sortID_(sortIDs[type].Allocate()),
+    prepared_(false)
 {
     for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
         useTextureUnit_[i] = false;
@@ -46,6 +52,7 @@ ShaderVariation::ShaderVariation(Shader* owner, ShaderType type) :
 ShaderVariation::~ShaderVariation()
 {
     Release();
+    sortIDs[type_].Free(sortID_);
 }
 
 void ShaderVariation::SetName(const String& name)
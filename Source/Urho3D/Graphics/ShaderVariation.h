@@ -90,6 +90,8 @@ public:
 
     /// Compile the shader. Return true if successful.
     bool Create();
+    /// Do the CPU side work of Create() in advance: assemble the source code on OpenGL, or load or compile the bytecode on Direct3D. Does not access the GPU, so may be called from a worker thread while the shader is not in use. Return true if successful.
+    bool Prepare();
     /// Set name.
     void SetName(const String& name);
     /// Set defines.
@@ -119,6 +121,9 @@ public:
     /// Return vertex element hash.
     unsigned long long GetElementHash() const { return elementHash_; }
 
+    /// Return dense ID for draw call sorting. Vertex and pixel shaders are numbered separately.
+    unsigned GetSortID() const { return sortID_; }
+
     /// Return shader bytecode. Stored persistently on Direct3D11 only.
     const PODVector<unsigned char>& GetByteCode() const { return byteCode_; }
 
@@ -155,6 +160,8 @@ private:
     ShaderType type_;
     /// Vertex element hash for vertex shaders. Zero for pixel shaders. Note that hashing is different than vertex buffers.
     unsigned long long elementHash_;
+    /// Dense ID for draw call sorting.
+    unsigned sortID_;
     /// Shader parameters.
     HashMap<StringHash, ShaderParameter> parameters_;
     /// Texture unit use flags.
@@ -171,6 +178,10 @@ private:
     String definesClipPlane_;
     /// Shader compile error string.
     String compilerOutput_;
+    /// Source code assembled by Prepare(). Used only on OpenGL.
+    String preparedCode_;
+    /// Prepare() called since the last release flag.
+    bool prepared_;
 };
 
 }
@@ -46,6 +46,7 @@ struct Bone
         initialRotation_(Quaternion::IDENTITY),
         initialScale_(Vector3::ONE),
         animated_(true),
+        animationLodDistance_(0.0f),
         collisionMask_(0),
         radius_(0.0f)
     {
@@ -67,6 +68,8 @@ struct Bone
     Matrix3x4 offsetMatrix_;
     /// Animation enable flag.
     bool animated_;
+    /// Animation LOD distance from which on the bone stays in its reset pose. 0 animates at all distances.
+    float animationLodDistance_;
     /// Supported collision types.
     unsigned char collisionMask_;
     /// Radius.
@@ -65,6 +65,8 @@ static const Vector3* directions[] =
     &Vector3::BACK
 };
 
+static const unsigned OCCLUSION_TEST_BATCH_SIZE = 64;
+
 /// %Frustum octree query for shadowcasters.
 class ShadowCasterOctreeQuery : public FrustumOctreeQuery
 {
@@ -180,12 +182,34 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
     bool cameraZoneOverride = view->cameraZoneOverride_;
     PerThreadSceneResult& result = view->sceneResults_[threadIndex];
 
+    BoundingBox boxes[OCCLUSION_TEST_BATCH_SIZE];
+    bool visible[OCCLUSION_TEST_BATCH_SIZE];
+
     while (start != end)
     {
-        Drawable* drawable = *start++;
+        unsigned count = Min((unsigned)(end - start), OCCLUSION_TEST_BATCH_SIZE);
 
-        if (!buffer || !drawable->IsOccludee() || buffer->IsVisible(drawable->GetWorldBoundingBox()))
+        // Test the occludees against the occlusion buffer in batches
+        if (buffer)
         {
+            unsigned numBoxes = 0;
+            for (unsigned i = 0; i < count; ++i)
+            {
+                if (start[i]->IsOccludee())
+                    boxes[numBoxes++] = start[i]->GetWorldBoundingBox();
+            }
+            buffer->IsVisible(boxes, numBoxes, visible);
+        }
+
+        Drawable** batchEnd = start + count;
+        unsigned boxIndex = 0;
+
+        for (; start != batchEnd; ++start)
+        {
+            Drawable* drawable = *start;
+            if (buffer && drawable->IsOccludee() && !visible[boxIndex++])
+                continue;
+
             drawable->UpdateBatches(view->frame_);
             // If draw distance non-zero, update and check it
             float maxDistance = drawable->GetDrawDistance();
@@ -302,7 +326,8 @@ View::View(Context* context) :
     occlusionBuffer_(0),
     renderTarget_(0),
     substituteRenderTarget_(0),
-    passCommand_(0)
+    passCommand_(0),
+    instancingBufferEnd_(0)
 {
     // Create octree query and scene results vector for each thread
     unsigned numThreads = GetSubsystem<WorkQueue>()->GetNumThreads() + 1; // Worker threads + main thread
@@ -556,6 +581,7 @@ void View::Update(const FrameInfo& frame)
     SendViewEvent(E_BEGINVIEWUPDATE);
 
     int maxSortedInstances = renderer_->GetMaxSortedInstances();
+    bool retainGroups = renderer_->GetRetainedInstancing();
 
     // Clear buffers, geometry, light, occluder & batch list
     renderTargets_.Clear();
@@ -566,7 +592,7 @@ void View::Update(const FrameInfo& frame)
     activeOccluders_ = 0;
     vertexLightQueues_.Clear();
     for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
-        i->second_.Clear(maxSortedInstances);
+        i->second_.Clear(maxSortedInstances, retainGroups);
 
     if (hasScenePasses_ && (!cullCamera_ || !octree_))
     {
@@ -703,6 +729,14 @@ View* View::GetSourceView() const
     return sourceView_;
 }
 
+VertexBuffer* View::GetInstancingBuffer() const
+{
+    if (sourceView_)
+        return sourceView_->GetInstancingBuffer();
+    else
+        return instancingBuffer_ ? instancingBuffer_.Get() : renderer_->GetInstancingBuffer();
+}
+
 void View::SetGlobalShaderParameters()
 {
     graphics_->SetShaderParameter(VSP_DELTATIME, frame_.timeStep_);
@@ -1037,6 +1071,7 @@ void View::GetLightBatches()
         lightQueues_.Resize(numLightQueues);
         maxLightsDrawables_.Clear();
         unsigned maxSortedInstances = (unsigned)renderer_->GetMaxSortedInstances();
+        bool retainGroups = renderer_->GetRetainedInstancing();
 
         for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
         {
@@ -1056,11 +1091,12 @@ void View::GetLightBatches()
                 // Initialize light queue and store it to the light so that it can be found later
                 LightBatchQueue& lightQueue = lightQueues_[usedLightQueues++];
                 light->SetLightQueue(&lightQueue);
+                lightQueue.sortID_ = usedLightQueues;
                 lightQueue.light_ = light;
                 lightQueue.negative_ = light->IsNegative();
                 lightQueue.shadowMap_ = 0;
-                lightQueue.litBaseBatches_.Clear(maxSortedInstances);
-                lightQueue.litBatches_.Clear(maxSortedInstances);
+                lightQueue.litBaseBatches_.Clear(maxSortedInstances, retainGroups);
+                lightQueue.litBatches_.Clear(maxSortedInstances, retainGroups);
                 if (forwardLightsCommand_)
                 {
                     SetQueueShaderDefines(lightQueue.litBaseBatches_, *forwardLightsCommand_);
@@ -1091,7 +1127,7 @@ void View::GetLightBatches()
                     shadowQueue.shadowCamera_ = shadowCamera;
                     shadowQueue.nearSplit_ = query.shadowNearSplits_[j];
                     shadowQueue.farSplit_ = query.shadowFarSplits_[j];
-                    shadowQueue.shadowBatches_.Clear(maxSortedInstances);
+                    shadowQueue.shadowBatches_.Clear(maxSortedInstances, retainGroups);
 
                     // Setup the shadow split viewport and finalize shadow camera parameters
                     shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, lightQueue.shadowMap_);
@@ -1273,6 +1309,7 @@ void View::GetBaseBatches()
                         if (i == vertexLightQueues_.End())
                         {
                             i = vertexLightQueues_.Insert(MakePair(hash, LightBatchQueue()));
+                            i->second_.sortID_ = lightQueues_.Size() + vertexLightQueues_.Size();
                             i->second_.light_ = 0;
                             i->second_.shadowMap_ = 0;
                             i->second_.vertexLights_ = drawableVertexLights;
@@ -2250,7 +2287,18 @@ void View::UpdateOccluders(PODVector<Drawable*>& occluders, Camera* camera)
 void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& occluders)
 {
     buffer->SetMaxTriangles((unsigned)maxOccluderTriangles_);
-    buffer->Clear();
+
+    // With temporal occlusion continue from the reprojected depth of the previous frames, and redraw each occluder only once
+    // per refresh interval. The occluders are spread over the frames by their ID
+    unsigned refreshInterval = 1;
+    if (renderer_->GetTemporalOcclusion())
+    {
+        unsigned interval = (unsigned)renderer_->GetOccluderRefreshInterval();
+        if (buffer->Reproject(interval - 1))
+            refreshInterval = interval;
+    }
+    else
+        buffer->Clear();
 
     if (!buffer->IsThreaded())
     {
@@ -2258,6 +2306,8 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
         for (unsigned i = 0; i < occluders.Size(); ++i)
         {
             Drawable* occluder = occluders[i];
+            if (refreshInterval > 1 && (occluder->GetID() + frame_.frameNumber_) % refreshInterval)
+                continue;
             if (i > 0)
             {
                 // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary
@@ -2279,9 +2329,13 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
         // In threaded mode submit all triangles first, then render (cannot test in this case)
         for (unsigned i = 0; i < occluders.Size(); ++i)
         {
+            Drawable* occluder = occluders[i];
+            if (refreshInterval > 1 && (occluder->GetID() + frame_.frameNumber_) % refreshInterval)
+                continue;
+
             // Check for running out of triangles
             ++activeOccluders_;
-            if (!occluders[i]->DrawOcclusion(buffer))
+            if (!occluder->DrawOcclusion(buffer))
                 break;
         }
 
@@ -2294,6 +2348,8 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
 
 void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
 {
+    URHO3D_PROFILE(ProcessLight);
+
     Light* light = query.light_;
     LightType type = light->GetLightType();
     unsigned lightMask = light->GetLightMask();
@@ -2917,7 +2973,7 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
         BatchGroupKey key(batch);
 
         HashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
-        if (i == queue.batchGroups_.End())
+        if (i == queue.batchGroups_.End() || i->second_.instances_.Empty())
         {
             // Create a new group based on the batch
             // In case the group remains below the instancing limit, do not enable instancing shaders yet
@@ -2925,7 +2981,15 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
             newGroup.geometryType_ = GEOM_STATIC;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows, queue);
             newGroup.CalculateSortKey();
-            i = queue.batchGroups_.Insert(MakePair(key, newGroup));
+            if (i == queue.batchGroups_.End())
+                i = queue.batchGroups_.Insert(MakePair(key, newGroup));
+            else
+            {
+                // Refresh a group retained from the last frame, but keep its instancing buffer slots
+                newGroup.startIndex_ = i->second_.startIndex_;
+                newGroup.numReservedInstances_ = i->second_.numReservedInstances_;
+                i->second_ = newGroup;
+            }
         }
 
         int oldSize = i->second_.instances_.Size();
@@ -2972,6 +3036,13 @@ void View::PrepareInstancingBuffer()
 
     URHO3D_PROFILE(PrepareInstancingBuffer);
 
+    if (renderer_->GetRetainedInstancing())
+    {
+        PrepareRetainedInstancingBuffer();
+        return;
+    }
+    instancingBuffer_.Reset();
+
     unsigned totalInstances = 0;
 
     for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
@@ -3009,6 +3080,85 @@ void View::PrepareInstancingBuffer()
     instancingBuffer->Unlock();
 }
 
+void View::PrepareRetainedInstancingBuffer()
+{
+    // Recreate the buffer if the instance layout has changed
+    const PODVector<VertexElement>& elements = renderer_->GetInstancingBuffer()->GetElements();
+    bool repack = false;
+    if (!instancingBuffer_ || instancingBuffer_->GetElements() != elements)
+    {
+        instancingBuffer_ = new VertexBuffer(context_);
+        instancingBuffer_->SetShadowed(true);
+        instancingBuffer_->SetSize(INSTANCING_BUFFER_DEFAULT_SIZE, elements);
+        instancingBufferEnd_ = 0;
+        repack = true;
+    }
+
+    PODVector<BatchQueue*> queues;
+    for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
+        queues.Push(&i->second_);
+    for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+    {
+        for (unsigned j = 0; j < i->shadowSplits_.Size(); ++j)
+            queues.Push(&i->shadowSplits_[j].shadowBatches_);
+        queues.Push(&i->litBaseBatches_);
+        queues.Push(&i->litBatches_);
+    }
+
+    // Keep the groups in their previous slots if they still fit, and reserve new slots after the previously reserved ones
+    unsigned bufferSize = instancingBuffer_->GetVertexCount();
+    unsigned freeIndex = instancingBufferEnd_;
+    if (!repack)
+    {
+        for (unsigned i = 0; i < queues.Size(); ++i)
+            repack |= queues[i]->ReserveInstancingSlots(freeIndex, bufferSize, false) != 0;
+    }
+
+    // If out of space, reserve all slots again from the beginning, which also removes the holes left by removed groups.
+    // Grow the buffer if necessary, leaving room for new groups
+    if (repack)
+    {
+        freeIndex = 0;
+        for (unsigned i = 0; i < queues.Size(); ++i)
+            queues[i]->ReserveInstancingSlots(freeIndex, M_MAX_UNSIGNED, true);
+
+        // Start from the default size, as the buffer is empty if creating it failed. Fail also if the size would overflow
+        unsigned requiredSize = freeIndex + freeIndex / 2;
+        unsigned newSize = Max(bufferSize, (unsigned)INSTANCING_BUFFER_DEFAULT_SIZE);
+        while (newSize < requiredSize && newSize <= (M_MAX_UNSIGNED >> 1))
+            newSize <<= 1;
+        if (requiredSize < freeIndex || newSize < requiredSize || (newSize != bufferSize &&
+            !instancingBuffer_->SetSize(newSize, elements)))
+        {
+            URHO3D_LOGERROR("Failed to resize retained instancing buffer to " + String(newSize));
+            instancingBuffer_.Reset();
+            instancingBufferEnd_ = 0;
+
+            // Draw the groups non-instanced this frame, and try again on the next
+            for (unsigned i = 0; i < queues.Size(); ++i)
+            {
+                freeIndex = 0;
+                queues[i]->ReserveInstancingSlots(freeIndex, 0, true);
+            }
+            return;
+        }
+    }
+
+    instancingBufferEnd_ = freeIndex;
+
+    // Write the instance data and upload the changed ranges. After repacking everything is uploaded at once
+    unsigned dirtyStart = 0;
+    unsigned dirtyEnd = repack ? instancingBufferEnd_ : 0;
+    for (unsigned i = 0; i < queues.Size(); ++i)
+        queues[i]->UpdateRetainedInstancingData(instancingBuffer_, dirtyStart, dirtyEnd);
+
+    if (dirtyEnd > dirtyStart)
+    {
+        instancingBuffer_->SetDataRange(instancingBuffer_->GetShadowData() + dirtyStart * instancingBuffer_->GetVertexSize(),
+            dirtyStart, dirtyEnd - dirtyStart);
+    }
+}
+
 void View::SetupLightVolumeBatch(Batch& batch)
 {
     Light* light = batch.lightQueue_->light_;
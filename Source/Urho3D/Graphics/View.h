@@ -46,6 +46,7 @@ class RenderSurface;
 class Technique;
 class Texture;
 class Texture2D;
+class VertexBuffer;
 class Viewport;
 class Zone;
 struct RenderPathCommand;
@@ -180,6 +181,9 @@ public:
     /// Return the source view that was already prepared. Used when viewports specify the same culling camera.
     View* GetSourceView() const;
 
+    /// Return the instancing buffer used by the batch groups. This is the view's own buffer when retained instancing is in use.
+    VertexBuffer* GetInstancingBuffer() const;
+
     /// Set global (per-frame) shader parameters. Called by Batch and internally by View.
     void SetGlobalShaderParameters();
     /// Set camera-specific shader parameters. Called by Batch and internally by View.
@@ -265,6 +269,8 @@ private:
     void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
     /// Prepare instancing buffer by filling it with all instance transforms.
     void PrepareInstancingBuffer();
+    /// Prepare the view's retained instancing buffer by keeping the batch groups in their previous slots and uploading only the changed instances.
+    void PrepareRetainedInstancingBuffer();
     /// Set up a light volume rendering batch.
     void SetupLightVolumeBatch(Batch& batch);
     /// Check whether a light queue needs shadow rendering.
@@ -437,6 +443,10 @@ private:
     const RenderPathCommand* passCommand_;
     /// Flag for scene being resolved from the backbuffer.
     bool usedResolve_;
+    /// Instancing buffer retained between frames.
+    SharedPtr<VertexBuffer> instancingBuffer_;
+    /// End of the reserved slots in the retained instancing buffer.
+    unsigned instancingBufferEnd_;
 };
 
 }
@@ -27,24 +27,137 @@
 #include "../IO/Deserializer.h"
 #include "../IO/Serializer.h"
 #include "../IO/VectorBuffer.h"
+#include "../Math/MathDefs.h"
 
 #include <LZ4/lz4.h>
 #include <LZ4/lz4hc.h>
+#include <ZSTD/zdict.h>
+#include <ZSTD/zstd.h>
 
 namespace Urho3D
 {
 
+/// Zstandard compression level used by the Zstandard codec.
+static const int ZSTD_COMPRESSION_LEVEL = 19;
+
+/// Pool of Zstandard decompression contexts. Reused, as creating a context allocates and touches a large buffer.
+class ZstdContextPool
+{
+public:
+    /// Destruct. Free the contexts.
+    ~ZstdContextPool()
+    {
+        for (unsigned i = 0; i < contexts_.Size(); ++i)
+            ZSTD_freeDCtx(contexts_[i]);
+    }
+
+    /// Take a context from the pool, or create a new one if the pool is empty. Return null if fails.
+    ZSTD_DCtx* Acquire()
+    {
+        {
+            MutexLock lock(mutex_);
+            if (contexts_.Size())
+            {
+                ZSTD_DCtx* context = contexts_.Back();
+                contexts_.Pop();
+                return context;
+            }
+        }
+
+        return ZSTD_createDCtx();
+    }
+
+    /// Return a context to the pool.
+    void Release(ZSTD_DCtx* context)
+    {
+        MutexLock lock(mutex_);
+        contexts_.Push(context);
+    }
+
+private:
+    /// Free contexts.
+    PODVector<ZSTD_DCtx*> contexts_;
+    /// Mutex for accessing the contexts from several threads.
+    Mutex mutex_;
+};
+
+static ZstdContextPool zstdContexts;
+
+CompressionDictionary::CompressionDictionary(const void* data, unsigned size) :
+    decompressionDictionary_(0),
+    refs_(1)
+{
+    data_.Resize(size);
+    if (size)
+    {
+        memcpy(&data_[0], data, size);
+        decompressionDictionary_ = ZSTD_createDDict(&data_[0], size);
+    }
+}
+
+CompressionDictionary::~CompressionDictionary()
+{
+    ZSTD_freeDDict((ZSTD_DDict*)decompressionDictionary_);
+}
+
+void CompressionDictionary::AddRef()
+{
+    MutexLock lock(mutex_);
+    ++refs_;
+}
+
+void CompressionDictionary::ReleaseRef()
+{
+    bool destroy;
+    {
+        MutexLock lock(mutex_);
+        destroy = --refs_ == 0;
+    }
+
+    if (destroy)
+        delete this;
+}
+
 unsigned EstimateCompressBound(unsigned srcSize)
 {
-    return (unsigned)LZ4_compressBound(srcSize);
+    return (unsigned)Max(LZ4_compressBound(srcSize), (int)ZSTD_COMPRESSBOUND(srcSize));
 }
 
-unsigned CompressData(void* dest, const void* src, unsigned srcSize)
+unsigned CompressData(void* dest, const void* src, unsigned srcSize, CompressionCodec codec, const CompressionDictionary* dictionary)
 {
     if (!dest || !src || !srcSize)
         return 0;
-    else
-        return (unsigned)LZ4_compress_HC((const char*)src, (char*)dest, srcSize, LZ4_compressBound(srcSize), 0);
+
+    switch (codec)
+    {
+    case COMPRESSION_ZSTD:
+        {
+            ZSTD_CCtx* context = ZSTD_createCCtx();
+            if (!context)
+                return 0;
+
+            size_t ret;
+            if (dictionary && dictionary->GetData().Size())
+            {
+                ret = ZSTD_compress_usingDict(context, dest, ZSTD_COMPRESSBOUND(srcSize), src, srcSize, &dictionary->GetData()[0],
+                    dictionary->GetData().Size(), ZSTD_COMPRESSION_LEVEL);
+            }
+            else
+                ret = ZSTD_compressCCtx(context, dest, ZSTD_COMPRESSBOUND(srcSize), src, srcSize, ZSTD_COMPRESSION_LEVEL);
+
+            ZSTD_freeCCtx(context);
+            return ZSTD_isError(ret) ? 0 : (unsigned)ret;
+        }
+
+    case COMPRESSION_LZ4:
+        return (unsigned)LZ4_compress_default((const char*)src, (char*)dest, srcSize, LZ4_compressBound(srcSize));
+
+    case COMPRESSION_LZ4HC_MAX:
+        return (unsigned)LZ4_compress_HC((const char*)src, (char*)dest, srcSize, LZ4_compressBound(srcSize), LZ4HC_CLEVEL_MAX);
+
+    default:
+        return (unsigned)LZ4_compress_HC((const char*)src, (char*)dest, srcSize, LZ4_compressBound(srcSize), LZ4HC_CLEVEL_DEFAULT);
+    }
 }
 
 unsigned DecompressData(void* dest, const void* src, unsigned destSize)
@@ -55,8 +168,70 @@ unsigned DecompressData(void* dest, const void* src, unsigned destSize)
         return (unsigned)LZ4_decompress_fast((const char*)src, (char*)dest, destSize);
 }
 
-bool CompressStream(Serializer& dest, Deserializer& src)
+CompressionFormat GetCompressionFormat(CompressionCodec codec)
+{
+    return codec == COMPRESSION_ZSTD ? COMPRESSION_FORMAT_ZSTD : COMPRESSION_FORMAT_LZ4;
+}
+
+bool DecompressBlock(void* dest, unsigned destSize, const void* src, unsigned srcSize, CompressionFormat format,
+    const CompressionDictionary* dictionary)
 {
+    if (!dest || !src)
+        return false;
+
+    switch (format)
+    {
+    case COMPRESSION_FORMAT_LZ4:
+        return LZ4_decompress_safe((const char*)src, (char*)dest, srcSize, destSize) == (int)destSize;
+
+    case COMPRESSION_FORMAT_ZSTD:
+        {
+            if (dictionary && !dictionary->GetDecompressionDictionary())
+                return false;
+
+            ZSTD_DCtx* context = zstdContexts.Acquire();
+            if (!context)
+                return false;
+
+            size_t ret = dictionary ? ZSTD_decompress_usingDDict(context, dest, destSize, src, srcSize,
+                (const ZSTD_DDict*)dictionary->GetDecompressionDictionary()) : ZSTD_decompressDCtx(context, dest, destSize, src, srcSize);
+
+            zstdContexts.Release(context);
+            return !ZSTD_isError(ret) && ret == destSize;
+        }
+
+    default:
+        return false;
+    }
+}
+
+bool TrainCompressionDictionary(PODVector<unsigned char>& dest, const void* samples, const PODVector<unsigned>& sampleSizes, unsigned maxSize)
+{
+    if (!samples || sampleSizes.Empty() || !maxSize)
+        return false;
+
+    PODVector<size_t> sizes(sampleSizes.Size());
+    for (unsigned i = 0; i < sampleSizes.Size(); ++i)
+        sizes[i] = sampleSizes[i];
+
+    dest.Resize(maxSize);
+    size_t ret = ZDICT_trainFromBuffer(&dest[0], maxSize, samples, &sizes[0], sizes.Size());
+    if (ZDICT_isError(ret))
+    {
+        dest.Clear();
+        return false;
+    }
+
+    dest.Resize((unsigned)ret);
+    return true;
+}
+
+bool CompressStream(Serializer& dest, Deserializer& src, CompressionCodec codec)
+{
+    // The stream has no format marker, so always compress as LZ4
+    if (codec == COMPRESSION_ZSTD)
+        codec = COMPRESSION_LZ4HC;
+
     unsigned srcSize = src.GetSize() - src.GetPosition();
     // Prepend the source and dest. data size in the stream so that we know to buffer & uncompress the right amount
     if (!srcSize)
@@ -73,7 +248,7 @@ bool CompressStream(Serializer& dest, Deserializer& src)
     if (src.Read(srcBuffer, srcSize) != srcSize)
         return false;
 
-    unsigned destSize = (unsigned)LZ4_compress_HC((const char*)srcBuffer.Get(), (char*)destBuffer.Get(), srcSize, LZ4_compressBound(srcSize), 0);
+    unsigned destSize = CompressData(destBuffer.Get(), srcBuffer.Get(), srcSize, codec);
     bool success = true;
     success &= dest.WriteUInt(srcSize);
     success &= dest.WriteUInt(destSize);
@@ -104,11 +279,11 @@ bool DecompressStream(Serializer& dest, Deserializer& src)
     return dest.Write(destBuffer, destSize) == destSize;
 }
 
-VectorBuffer CompressVectorBuffer(VectorBuffer& src)
+VectorBuffer CompressVectorBuffer(VectorBuffer& src, CompressionCodec codec)
 {
     VectorBuffer ret;
     src.Seek(0);
-    CompressStream(ret, src);
+    CompressStream(ret, src, codec);
     ret.Seek(0);
     return ret;
 }
@@ -28,6 +28,9 @@
 #include <Urho3D/Urho3D.h>
 #endif
 
+#include "../Container/Vector.h"
+#include "../Core/Mutex.h"
+
 namespace Urho3D
 {
 
@@ -35,18 +38,86 @@ class Deserializer;
 class Serializer;
 class VectorBuffer;
 
-/// Estimate and return worst case LZ4 compressed output size in bytes for given input size.
+/// Compressed data format, which selects the decompressor. Stored in version 2 package files, so that further formats can be added without changing the package file format.
+enum CompressionFormat
+{
+    /// LZ4 block format.
+    COMPRESSION_FORMAT_LZ4 = 0,
+    /// Zstandard frame format, optionally using a dictionary.
+    COMPRESSION_FORMAT_ZSTD,
+    /// Number of supported formats.
+    MAX_COMPRESSION_FORMATS
+};
+
+/// Compression codec. The LZ4 codecs produce LZ4 data, which is decompressed the same way and equally fast regardless of the codec.
+enum CompressionCodec
+{
+    /// LZ4 fast compression.
+    COMPRESSION_LZ4 = 0,
+    /// LZ4 high compression at the default level. Slower to compress, smaller output.
+    COMPRESSION_LZ4HC,
+    /// LZ4 high compression at the maximum level using optimal parsing. Slowest to compress, smallest output.
+    COMPRESSION_LZ4HC_MAX,
+    /// Zstandard at a high compression level. Much smaller output than LZ4, especially with a dictionary trained on similar data, but several times slower to decompress.
+    COMPRESSION_ZSTD
+};
+
+/// Compression dictionary for the Zstandard format, trained on samples of the data to be compressed. Shared between the package file and the files opened from it, which may be read in worker threads, so it is reference counted under a mutex.
+class URHO3D_API CompressionDictionary
+{
+public:
+    /// Construct from dictionary data. The constructing code holds the first reference.
+    CompressionDictionary(const void* data, unsigned size);
+
+    /// Add a reference.
+    void AddRef();
+    /// Release a reference. Destroy the dictionary when no references remain.
+    void ReleaseRef();
+
+    /// Return the dictionary data.
+    const PODVector<unsigned char>& GetData() const { return data_; }
+
+    /// Return the digested decompression dictionary, or null if the data is not a valid dictionary.
+    void* GetDecompressionDictionary() const { return decompressionDictionary_; }
+
+private:
+    /// Prevent copy construction.
+    CompressionDictionary(const CompressionDictionary& rhs);
+    /// Prevent assignment.
+    CompressionDictionary& operator =(const CompressionDictionary& rhs);
+    /// Destruct. Only called when the last reference is released.
+    ~CompressionDictionary();
+
+    /// Dictionary data.
+    PODVector<unsigned char> data_;
+    /// Digested decompression dictionary.
+    void* decompressionDictionary_;
+    /// Reference count.
+    unsigned refs_;
+    /// Reference count mutex.
+    Mutex mutex_;
+};
+
+/// Estimate and return worst case compressed output size in bytes for given input size, valid for all codecs.
 URHO3D_API unsigned EstimateCompressBound(unsigned srcSize);
-/// Compress data using the LZ4 algorithm and return the compressed data size. The needed destination buffer worst-case size is given by EstimateCompressBound().
-URHO3D_API unsigned CompressData(void* dest, const void* src, unsigned srcSize);
+/// Compress data and return the compressed data size, or 0 on failure. The needed destination buffer worst-case size is given by EstimateCompressBound(). The dictionary is only used by the Zstandard codec.
+URHO3D_API unsigned CompressData(void* dest, const void* src, unsigned srcSize, CompressionCodec codec = COMPRESSION_LZ4HC,
+    const CompressionDictionary* dictionary = 0);
 /// Uncompress data using the LZ4 algorithm. The uncompressed data size must be known. Return the number of compressed data bytes consumed.
 URHO3D_API unsigned DecompressData(void* dest, const void* src, unsigned destSize);
-/// Compress a source stream (from current position to the end) to the destination stream using the LZ4 algorithm. Return true on success.
-URHO3D_API bool CompressStream(Serializer& dest, Deserializer& src);
+/// Return the data format produced by a compression codec.
+URHO3D_API CompressionFormat GetCompressionFormat(CompressionCodec codec);
+/// Uncompress a block of data in the given format. Both the compressed and the uncompressed data size must be known. Zstandard data compressed with a dictionary needs the same dictionary. Return true on success.
+URHO3D_API bool DecompressBlock(void* dest, unsigned destSize, const void* src, unsigned srcSize, CompressionFormat format = COMPRESSION_FORMAT_LZ4,
+    const CompressionDictionary* dictionary = 0);
+/// Train a Zstandard compression dictionary of at most maxSize bytes from concatenated samples. Return true on success.
+URHO3D_API bool TrainCompressionDictionary(PODVector<unsigned char>& dest, const void* samples, const PODVector<unsigned>& sampleSizes, unsigned maxSize);
+/// Compress a source stream (from current position to the end) to the destination stream using the LZ4 algorithm. The Zstandard codec falls back to LZ4 high compression. Return true on success.
+URHO3D_API bool CompressStream(Serializer& dest, Deserializer& src, CompressionCodec codec = COMPRESSION_LZ4HC);
 /// Decompress a compressed source stream produced using CompressStream() to the destination stream. Return true on success.
 URHO3D_API bool DecompressStream(Serializer& dest, Deserializer& src);
-/// Compress a VectorBuffer using the LZ4 algorithm and return the compressed result buffer.
-URHO3D_API VectorBuffer CompressVectorBuffer(VectorBuffer& src);
+/// Compress a VectorBuffer using the LZ4 algorithm, as with CompressStream(), and return the compressed result buffer.
+URHO3D_API VectorBuffer CompressVectorBuffer(VectorBuffer& src, CompressionCodec codec = COMPRESSION_LZ4HC);
 /// Decompress a VectorBuffer produced using CompressVectorBuffer().
 URHO3D_API VectorBuffer DecompressVectorBuffer(VectorBuffer& src);
 
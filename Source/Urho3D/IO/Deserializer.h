@@ -50,6 +50,8 @@ public:
     virtual unsigned GetChecksum();
     /// Return whether the end of stream has been reached.
     virtual bool IsEof() const { return position_ >= size_; }
+    /// Return pointer to the stream data from its beginning if it resides in memory and can be accessed without reading, or null if not.
+    virtual const unsigned char* GetDirectData() const { return 0; }
 
     /// Set position relative to current position. Return actual new position.
     unsigned SeekRelative(int delta);
@@ -23,6 +23,10 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#ifndef MINI_URHO
+#include "../Core/WorkQueue.h"
+#endif
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -34,7 +38,6 @@
 #endif
 
 #include <cstdio>
-#include <LZ4/lz4.h>
 
 #include "../DebugNew.h"
 
@@ -64,6 +67,60 @@ const char* APK = "/apk/";
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
 static const unsigned SKIP_BUFFER_SIZE = 1024;
+/// Largest possible size of a compressed block, as the block header stores the sizes as 16-bit values.
+static const unsigned MAX_COMPRESSED_BLOCK_SIZE = 65535;
+/// Minimum number of compressed blocks to decompress per work queue task.
+static const unsigned DECOMPRESS_BLOCKS_GRAIN = 4;
+
+/// Compressed block decompression functor for WorkQueue::ParallelFor.
+struct DecompressBlocksWork
+{
+    /// Construct.
+    DecompressBlocksWork(const CompressedBlock* blocks, const unsigned char* source, unsigned sourceOffset, unsigned char* dest,
+        unsigned destPosition, CompressionFormat format, const CompressionDictionary* dictionary, unsigned char* results,
+        unsigned firstBlock) :
+        blocks_(blocks),
+        source_(source),
+        sourceOffset_(sourceOffset),
+        dest_(dest),
+        destPosition_(destPosition),
+        format_(format),
+        dictionary_(dictionary),
+        results_(results),
+        firstBlock_(firstBlock)
+    {
+    }
+
+    /// Decompress a range of blocks.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        for (unsigned i = begin; i < end; ++i)
+        {
+            const CompressedBlock& block = blocks_[i];
+            results_[i - firstBlock_] = (unsigned char)DecompressBlock(dest_ + block.position_ - destPosition_, block.unpackedSize_,
+                source_ + block.offset_ - sourceOffset_, block.packedSize_, format_, dictionary_);
+        }
+    }
+
+    /// Block index.
+    const CompressedBlock* blocks_;
+    /// Compressed data.
+    const unsigned char* source_;
+    /// Package file offset of the compressed data.
+    unsigned sourceOffset_;
+    /// Destination buffer.
+    unsigned char* dest_;
+    /// File position of the destination buffer.
+    unsigned destPosition_;
+    /// Compressed data format.
+    CompressionFormat format_;
+    /// Compression dictionary, or null if none.
+    const CompressionDictionary* dictionary_;
+    /// Per-block success results, written by each block's own task.
+    unsigned char* results_;
+    /// Index of the first block.
+    unsigned firstBlock_;
+};
 
 File::File(Context* context) :
     Object(context),
@@ -72,10 +129,16 @@ File::File(Context* context) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mapping_(0),
+    dictionary_(0),
+    mappedData_(0),
+    mappedSize_(0),
+    mappedPosition_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
     checksum_(0),
+    compressionFormat_(COMPRESSION_FORMAT_LZ4),
     compressed_(false),
     readSyncNeeded_(false),
     writeSyncNeeded_(false)
@@ -89,10 +152,16 @@ File::File(Context* context, const String& fileName, FileMode mode) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mapping_(0),
+    dictionary_(0),
+    mappedData_(0),
+    mappedSize_(0),
+    mappedPosition_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
     checksum_(0),
+    compressionFormat_(COMPRESSION_FORMAT_LZ4),
     compressed_(false),
     readSyncNeeded_(false),
     writeSyncNeeded_(false)
@@ -107,10 +176,16 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mapping_(0),
+    dictionary_(0),
+    mappedData_(0),
+    mappedSize_(0),
+    mappedPosition_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
     checksum_(0),
+    compressionFormat_(COMPRESSION_FORMAT_LZ4),
     compressed_(false),
     readSyncNeeded_(false),
     writeSyncNeeded_(false)
@@ -137,11 +212,28 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
-    bool success = OpenInternal(package->GetName(), FILE_READ, true);
-    if (!success)
+    // A memory-mapped package file does not need to be opened again, just read from the mapping
+    if (package->IsMemoryMapped())
     {
-        URHO3D_LOGERROR("Could not open package file " + fileName);
-        return false;
+        Close();
+        readSyncNeeded_ = false;
+        writeSyncNeeded_ = false;
+        // Reference the mapping, so that it stays valid even if the package file is removed while this file is open
+        mapping_ = package->GetMapping();
+        mapping_->AddRef();
+        mappedData_ = mapping_->GetData();
+        mappedSize_ = mapping_->GetSize();
+        mode_ = FILE_READ;
+        position_ = 0;
+    }
+    else
+    {
+        bool success = OpenInternal(package->GetName(), FILE_READ, true);
+        if (!success)
+        {
+            URHO3D_LOGERROR("Could not open package file " + fileName);
+            return false;
+        }
     }
 
     fileName_ = fileName;
@@ -149,6 +241,11 @@ bool File::Open(PackageFile* package, const String& fileName)
     checksum_ = entry->checksum_;
     size_ = entry->size_;
     compressed_ = package->IsCompressed();
+    compressionFormat_ = package->GetCompressionFormat();
+    // Reference the dictionary for the same reason as the mapping
+    dictionary_ = package->GetDictionary();
+    if (dictionary_)
+        dictionary_->AddRef();
 
     // Seek to beginning of package entry's file data
     SeekInternal(offset_);
@@ -218,25 +315,28 @@ unsigned File::Read(void* dest, unsigned size)
         {
             if (!readBuffer_ || readBufferOffset_ >= readBufferSize_)
             {
-                unsigned char blockHeaderBytes[4];
-                ReadInternal(blockHeaderBytes, sizeof blockHeaderBytes);
-
-                MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
-                unsigned unpackedSize = blockHeader.ReadUShort();
-                unsigned packedSize = blockHeader.ReadUShort();
-
-                if (!readBuffer_)
+                // At a block boundary. If the read covers whole blocks, decompress them straight to the destination
+                if (sizeLeft >= MAX_COMPRESSED_BLOCK_SIZE && BuildBlockIndex())
                 {
-                    readBuffer_ = new unsigned char[unpackedSize];
-                    inputBuffer_ = new unsigned char[LZ4_compressBound(unpackedSize)];
+                    unsigned first = FindBlock(position_);
+                    unsigned last = first;
+                    while (last < blocks_.Size() && blocks_[last].position_ + blocks_[last].unpackedSize_ <= position_ + sizeLeft)
+                        ++last;
+
+                    if (!DecompressBlocks(first, last, destPtr))
+                        break;
+
+                    unsigned copySize = blocks_[last - 1].position_ + blocks_[last - 1].unpackedSize_ - position_;
+                    destPtr += copySize;
+                    sizeLeft -= copySize;
+                    readBufferOffset_ = 0;
+                    readBufferSize_ = 0;
+                    position_ += copySize;
+                    continue;
                 }
 
-                /// \todo Handle errors
-                ReadInternal(inputBuffer_.Get(), packedSize);
-                LZ4_decompress_fast((const char*)inputBuffer_.Get(), (char*)readBuffer_.Get(), unpackedSize);
-
-                readBufferSize_ = unpackedSize;
-                readBufferOffset_ = 0;
+                if (!ReadBlock())
+                    break;
             }
 
             unsigned copySize = Min((readBufferSize_ - readBufferOffset_), sizeLeft);
@@ -247,7 +347,7 @@ unsigned File::Read(void* dest, unsigned size)
             position_ += copySize;
         }
 
-        return size;
+        return size - sizeLeft;
     }
 
     // Need to reassign the position due to internal buffering when transitioning from writing to reading
@@ -284,23 +384,51 @@ unsigned File::Seek(unsigned position)
 
     if (compressed_)
     {
+        unsigned blockStart = position_ - readBufferOffset_;
+
+        // Seek within the current block
+        if (position == position_)
+            return position_;
+        else if (position >= blockStart && position < blockStart + readBufferSize_)
+        {
+            readBufferOffset_ = position - blockStart;
+            position_ = position;
+        }
         // Start over from the beginning
-        if (position == 0)
+        else if (position == 0)
         {
             position_ = 0;
             readBufferOffset_ = 0;
             readBufferSize_ = 0;
             SeekInternal(offset_);
         }
-        // Skip bytes
+        // Jump to the block containing the position using the block index
+        else if (BuildBlockIndex())
+        {
+            const CompressedBlock& block = blocks_[FindBlock(position)];
+            position_ = block.position_;
+            readBufferOffset_ = 0;
+            readBufferSize_ = 0;
+            SeekInternal(block.offset_ - 4);
+
+            if (position > position_ && ReadBlock())
+            {
+                readBufferOffset_ = position - position_;
+                position_ = position;
+            }
+        }
+        // Skip bytes if the block index could not be built
         else if (position >= position_)
         {
             unsigned char skipBuffer[SKIP_BUFFER_SIZE];
             while (position > position_)
-                Read(skipBuffer, Min(position - position_, SKIP_BUFFER_SIZE));
+            {
+                if (!Read(skipBuffer, Min(position - position_, SKIP_BUFFER_SIZE)))
+                    break;
+            }
         }
         else
-            URHO3D_LOGERROR("Seeking backward in a compressed file is not supported");
+            URHO3D_LOGERROR("Seeking backward in a corrupted compressed file is not supported");
 
         return position_;
     }
@@ -352,6 +480,19 @@ unsigned File::Write(const void* data, unsigned size)
     return size;
 }
 
+unsigned File::ReadAll(void* dest)
+{
+    if (Seek(0) != 0)
+        return 0;
+
+    return Read(dest, size_);
+}
+
+const unsigned char* File::GetDirectData() const
+{
+    return mappedData_ && !compressed_ ? mappedData_ + offset_ : 0;
+}
+
 unsigned File::GetChecksum()
 {
     if (offset_ || checksum_)
@@ -393,6 +534,28 @@ void File::Close()
 
     readBuffer_.Reset();
     inputBuffer_.Reset();
+    readBufferOffset_ = 0;
+    readBufferSize_ = 0;
+    blocks_.Clear();
+
+    if (dictionary_)
+    {
+        dictionary_->ReleaseRef();
+        dictionary_ = 0;
+    }
+
+    if (mapping_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+        mappedData_ = 0;
+        mappedSize_ = 0;
+        mappedPosition_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
 
     if (handle_)
     {
@@ -419,9 +582,9 @@ void File::SetName(const String& name)
 bool File::IsOpen() const
 {
 #ifdef __ANDROID__
-    return handle_ != 0 || assetHandle_ != 0;
+    return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
 #else
-    return handle_ != 0;
+    return handle_ != 0 || mappedData_ != 0;
 #endif
 }
 
@@ -525,6 +688,15 @@ bool File::OpenInternal(const String& fileName, FileMode mode, bool fromPackage)
 
 bool File::ReadInternal(void* dest, unsigned size)
 {
+    if (mappedData_)
+    {
+        if (mappedPosition_ + size > mappedSize_)
+            return false;
+        memcpy(dest, mappedData_ + mappedPosition_, size);
+        mappedPosition_ += size;
+        return true;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -537,6 +709,12 @@ bool File::ReadInternal(void* dest, unsigned size)
 
 void File::SeekInternal(unsigned newPosition)
 {
+    if (mappedData_)
+    {
+        mappedPosition_ = newPosition;
+        return;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -550,4 +728,185 @@ void File::SeekInternal(unsigned newPosition)
         fseek((FILE*)handle_, newPosition, SEEK_SET);
 }
 
+unsigned File::TellInternal() const
+{
+    if (mappedData_)
+        return mappedPosition_;
+
+#ifdef __ANDROID__
+    if (assetHandle_)
+        return (unsigned)SDL_RWtell(assetHandle_);
+    else
+#endif
+        return (unsigned)ftell((FILE*)handle_);
+}
+
+bool File::ReadBlock()
+{
+    unsigned char blockHeaderBytes[4];
+    if (!ReadInternal(blockHeaderBytes, sizeof blockHeaderBytes))
+        return false;
+
+    MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
+    unsigned unpackedSize = blockHeader.ReadUShort();
+    unsigned packedSize = blockHeader.ReadUShort();
+
+    // Allocate for the largest possible block, as reading may start from any block after a seek
+    if (!readBuffer_)
+    {
+        readBuffer_ = new unsigned char[MAX_COMPRESSED_BLOCK_SIZE];
+        if (!mappedData_)
+            inputBuffer_ = new unsigned char[MAX_COMPRESSED_BLOCK_SIZE];
+    }
+
+    if (mappedData_)
+    {
+        // Decompress straight from the memory-mapped package file
+        if (mappedPosition_ + packedSize > mappedSize_ || !DecompressBlock(readBuffer_.Get(), unpackedSize, mappedData_ +
+            mappedPosition_, packedSize, compressionFormat_, dictionary_))
+            return false;
+        mappedPosition_ += packedSize;
+    }
+    else
+    {
+        if (!ReadInternal(inputBuffer_.Get(), packedSize) || !DecompressBlock(readBuffer_.Get(), unpackedSize, inputBuffer_.Get(),
+            packedSize, compressionFormat_, dictionary_))
+            return false;
+    }
+
+    readBufferSize_ = unpackedSize;
+    readBufferOffset_ = 0;
+    return true;
+}
+
+bool File::BuildBlockIndex()
+{
+    if (!blocks_.Empty())
+        return true;
+
+    // Reading continues from the internal file position if the index can not be built, so restore it afterward
+    unsigned savedPosition = TellInternal();
+    unsigned savedBufferOffset = readBufferOffset_;
+    unsigned savedBufferSize = readBufferSize_;
+
+    // Walk the block headers. The compressed data is not read, so this is much faster than decompressing
+    unsigned offset = offset_;
+    unsigned position = 0;
+    while (position < size_)
+    {
+        unsigned char blockHeaderBytes[4];
+        if (mappedData_)
+        {
+            if (offset + sizeof blockHeaderBytes > mappedSize_)
+                break;
+            memcpy(blockHeaderBytes, mappedData_ + offset, sizeof blockHeaderBytes);
+        }
+        else
+        {
+            SeekInternal(offset);
+            if (!ReadInternal(blockHeaderBytes, sizeof blockHeaderBytes))
+                break;
+        }
+
+        MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
+        CompressedBlock block;
+        block.offset_ = offset + sizeof blockHeaderBytes;
+        block.unpackedSize_ = blockHeader.ReadUShort();
+        block.packedSize_ = blockHeader.ReadUShort();
+        block.position_ = position;
+        if (!block.unpackedSize_)
+            break;
+
+        blocks_.Push(block);
+        offset = block.offset_ + block.packedSize_;
+        position += block.unpackedSize_;
+    }
+
+    SeekInternal(savedPosition);
+    readBufferOffset_ = savedBufferOffset;
+    readBufferSize_ = savedBufferSize;
+
+    if (position < size_ || (mappedData_ && offset > mappedSize_))
+    {
+        URHO3D_LOGERROR("Corrupted compressed data in file " + GetName());
+        blocks_.Clear();
+        return false;
+    }
+
+    return true;
+}
+
+unsigned File::FindBlock(unsigned position) const
+{
+    // Binary search for the last block starting at or before the position
+    unsigned first = 0;
+    unsigned last = blocks_.Size();
+    while (last - first > 1)
+    {
+        unsigned middle = (first + last) / 2;
+        if (blocks_[middle].position_ <= position)
+            first = middle;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+bool File::DecompressBlocks(unsigned first, unsigned last, unsigned char* dest)
+{
+    if (first >= last)
+        return false;
+
+    URHO3D_PROFILE(DecompressBlocks);
+
+    unsigned sourceOffset = blocks_[first].offset_;
+    unsigned sourceEnd = blocks_[last - 1].offset_ + blocks_[last - 1].packedSize_;
+    const unsigned char* source;
+    SharedArrayPtr<unsigned char> sourceBuffer;
+
+    if (mappedData_)
+    {
+        source = mappedData_ + sourceOffset;
+        mappedPosition_ = sourceEnd;
+    }
+    else
+    {
+        // Read all the compressed data at once. The block headers in between are skipped when decompressing
+        sourceBuffer = new unsigned char[sourceEnd - sourceOffset];
+        SeekInternal(sourceOffset);
+        if (!ReadInternal(sourceBuffer.Get(), sourceEnd - sourceOffset))
+        {
+            SeekInternal(blocks_[first].offset_ - 4);
+            return false;
+        }
+        source = sourceBuffer.Get();
+    }
+
+    PODVector<unsigned char> results(last - first);
+    DecompressBlocksWork work(&blocks_[0], source, sourceOffset, dest, blocks_[first].position_, compressionFormat_,
+        dictionary_, &results[0], first);
+
+#ifndef MINI_URHO
+    // Only the main thread and the work queue's own threads may submit work; for example background loading threads decompress by themselves
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue && last - first > DECOMPRESS_BLOCKS_GRAIN && (Thread::IsMainThread() || queue->GetThreadIndex()))
+        queue->ParallelFor(first, last, DECOMPRESS_BLOCKS_GRAIN, work);
+    else
+#endif
+        work(first, last, 0);
+
+    for (unsigned i = 0; i < results.Size(); ++i)
+    {
+        if (!results[i])
+        {
+            URHO3D_LOGERROR("Corrupted compressed data in file " + GetName());
+            SeekInternal(blocks_[first].offset_ - 4);
+            return false;
+        }
+    }
+
+    return true;
+}
+
 }
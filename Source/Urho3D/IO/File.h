@@ -25,6 +25,7 @@
 #include "../Container/ArrayPtr.h"
 #include "../Core/Object.h"
 #include "../IO/AbstractFile.h"
+#include "../IO/Compression.h"
 
 #ifdef __ANDROID__
 struct SDL_RWops;
@@ -55,6 +56,20 @@ enum FileMode
 };
 
 class PackageFile;
+class PackageFileMapping;
+
+/// Compressed block of a file within a package file.
+struct CompressedBlock
+{
+    /// Offset of the compressed data within the package file.
+    unsigned offset_;
+    /// Compressed size.
+    unsigned packedSize_;
+    /// Position of the uncompressed data within the file.
+    unsigned position_;
+    /// Uncompressed size.
+    unsigned unpackedSize_;
+};
 
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public AbstractFile
@@ -77,12 +92,16 @@ public:
     virtual unsigned Seek(unsigned position);
     /// Write bytes to the file. Return number of bytes actually written.
     virtual unsigned Write(const void* data, unsigned size);
+    /// Read the whole file from the beginning to a buffer of at least GetSize() bytes. A compressed file is decompressed straight to the buffer, using the work queue threads if possible. Return number of bytes actually read.
+    unsigned ReadAll(void* dest);
 
     /// Return the file name.
     virtual const String& GetName() const { return fileName_; }
 
     /// Return a checksum of the file contents using the SDBM hash algorithm.
     virtual unsigned GetChecksum();
+    /// Return pointer to the file data if opened uncompressed from a memory-mapped package file, or null if not.
+    virtual const unsigned char* GetDirectData() const;
 
     /// Open a filesystem file. Return true if successful.
     bool Open(const String& fileName, FileMode mode = FILE_READ);
@@ -107,6 +126,9 @@ public:
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return whether the file is read from a memory-mapped package file.
+    bool IsMemoryMapped() const { return mappedData_ != 0; }
+
 private:
     /// Open file internally using either C standard IO functions or SDL RWops for Android asset files. Return true if successful.
     bool OpenInternal(const String& fileName, FileMode mode, bool fromPackage = false);
@@ -114,6 +136,16 @@ private:
     bool ReadInternal(void* dest, unsigned size);
     /// Seek in file internally using either C standard IO functions or SDL RWops for Android asset files.
     void SeekInternal(unsigned newPosition);
+    /// Return the internal file position.
+    unsigned TellInternal() const;
+    /// Read and decompress the next block of a compressed file to the read buffer. Return true if successful.
+    bool ReadBlock();
+    /// Build the block index of a compressed file if not built yet. Return true if successful.
+    bool BuildBlockIndex();
+    /// Return index of the compressed block containing a position. The block index must have been built.
+    unsigned FindBlock(unsigned position) const;
+    /// Decompress a range of whole compressed blocks to a destination buffer. Moves the internal file position past the last block. Return true if successful.
+    bool DecompressBlocks(unsigned first, unsigned last, unsigned char* dest);
 
     /// File name.
     String fileName_;
@@ -125,10 +157,22 @@ private:
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
 #endif
+    /// Memory mapping of the package file, referenced while the file is open.
+    PackageFileMapping* mapping_;
+    /// Compression dictionary of the package file, referenced while the file is open.
+    CompressionDictionary* dictionary_;
+    /// Memory-mapped package file data.
+    const unsigned char* mappedData_;
+    /// Memory-mapped package file size.
+    unsigned mappedSize_;
+    /// Read position within the memory-mapped package file.
+    unsigned mappedPosition_;
     /// Read buffer for Android asset or compressed file loading.
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Decompression input buffer for compressed file loading.
     SharedArrayPtr<unsigned char> inputBuffer_;
+    /// Block index of a compressed file, built on demand for seeking and large reads.
+    PODVector<CompressedBlock> blocks_;
     /// Read buffer position.
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
@@ -137,6 +181,8 @@ private:
     unsigned offset_;
     /// Content checksum.
     unsigned checksum_;
+    /// Compressed data format of a file within a package file.
+    CompressionFormat compressionFormat_;
     /// Compression flag.
     bool compressed_;
     /// Synchronization needed before read -flag.
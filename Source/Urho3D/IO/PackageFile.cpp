@@ -23,37 +23,69 @@
 #include "../Precompiled.h"
 
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
 PackageFile::PackageFile(Context* context) :
     Object(context),
+    directory_(0),
+    names_(0),
+    numFiles_(0),
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
+    mapping_(0),
+    dictionary_(0),
+    compressionFormat_(COMPRESSION_FORMAT_LZ4),
     compressed_(false)
 {
 }
 
-PackageFile::PackageFile(Context* context, const String& fileName, unsigned startOffset) :
+PackageFile::PackageFile(Context* context, const String& fileName, unsigned startOffset, bool memoryMapped) :
     Object(context),
+    directory_(0),
+    names_(0),
+    numFiles_(0),
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
+    mapping_(0),
+    dictionary_(0),
+    compressionFormat_(COMPRESSION_FORMAT_LZ4),
     compressed_(false)
 {
-    Open(fileName, startOffset);
+    Open(fileName, startOffset, memoryMapped);
 }
 
 PackageFile::~PackageFile()
 {
+    UnmapFile();
+    ReleaseDictionary();
 }
 
-bool PackageFile::Open(const String& fileName, unsigned startOffset)
+bool PackageFile::Open(const String& fileName, unsigned startOffset, bool memoryMapped)
 {
+    UnmapFile();
+    ReleaseDictionary();
+    entries_.Clear();
+    directory_ = 0;
+    names_ = 0;
+    directoryBuffer_.Clear();
+    numFiles_ = 0;
+    totalDataSize_ = 0;
+
     SharedPtr<File> file(new File(context_, fileName));
     if (!file->IsOpen())
         return false;
@@ -61,7 +93,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "UPK2")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -78,7 +110,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
 
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "UPK2")
         {
             URHO3D_LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -89,31 +121,60 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
     compressed_ = id == "ULZ4";
+    compressionFormat_ = COMPRESSION_FORMAT_LZ4;
 
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
-    for (unsigned i = 0; i < numFiles; ++i)
+    if (id == "UPK2")
     {
-        String entryName = file->ReadString();
-        PackageEntry newEntry;
-        newEntry.offset_ = file->ReadUInt() + startOffset;
-        totalDataSize_ += (newEntry.size_ = file->ReadUInt());
-        newEntry.checksum_ = file->ReadUInt();
-        if (!compressed_ && newEntry.offset_ + newEntry.size_ > totalSize_)
+        unsigned flags = file->ReadUInt();
+        compressed_ = (flags & PACKAGE_COMPRESSED) != 0;
+        unsigned format = (flags & PACKAGE_FORMAT_MASK) >> PACKAGE_FORMAT_SHIFT;
+        if (format >= MAX_COMPRESSION_FORMATS)
         {
-            URHO3D_LOGERROR("File entry " + entryName + " outside package file");
+            URHO3D_LOGERROR(fileName + " uses an unsupported compression format");
             return false;
         }
-        else
-            entries_[entryName] = newEntry;
+        compressionFormat_ = (CompressionFormat)format;
+        unsigned namesSize = file->ReadUInt();
+        unsigned dictionarySize = (flags & PACKAGE_DICTIONARY) ? file->ReadUInt() : 0;
+        if (!ReadDirectory(file, startOffset, numFiles, namesSize, dictionarySize, memoryMapped))
+            return false;
+    }
+    else
+    {
+        for (unsigned i = 0; i < numFiles; ++i)
+        {
+            String entryName = file->ReadString();
+            PackageEntry newEntry;
+            newEntry.offset_ = file->ReadUInt() + startOffset;
+            totalDataSize_ += (newEntry.size_ = file->ReadUInt());
+            newEntry.checksum_ = file->ReadUInt();
+            if (!compressed_ && newEntry.offset_ + newEntry.size_ > totalSize_)
+            {
+                URHO3D_LOGERROR("File entry " + entryName + " outside package file");
+                return false;
+            }
+            else
+                entries_[entryName] = newEntry;
+        }
+
+        numFiles_ = entries_.Size();
     }
 
+    // If memory-mapping fails, the files are read from the package file normally
+    if (memoryMapped && !mapping_ && !MapFile())
+        URHO3D_LOGWARNING("Could not memory-map package file " + fileName);
+
     return true;
 }
 
 bool PackageFile::Exists(const String& fileName) const
 {
+    if (directory_)
+        return FindDirectoryEntry(fileName) != 0;
+
     bool found = entries_.Find(fileName) != entries_.End();
 
 #ifdef _WIN32
@@ -136,6 +197,12 @@ bool PackageFile::Exists(const String& fileName) const
 
 const PackageEntry* PackageFile::GetEntry(const String& fileName) const
 {
+    if (directory_)
+    {
+        const PackageDirectoryEntry* entry = FindDirectoryEntry(fileName);
+        return entry ? &entry->entry_ : 0;
+    }
+
     HashMap<String, PackageEntry>::ConstIterator i = entries_.Find(fileName);
     if (i != entries_.End())
         return &i->second_;
@@ -155,4 +222,282 @@ const PackageEntry* PackageFile::GetEntry(const String& fileName) const
     return 0;
 }
 
+const HashMap<String, PackageEntry>& PackageFile::GetEntries() const
+{
+    if (directory_)
+    {
+        MutexLock lock(entriesMutex_);
+        if (entries_.Empty())
+        {
+            for (unsigned i = 0; i < numFiles_; ++i)
+                entries_[String(names_ + directory_[i].nameOffset_)] = directory_[i].entry_;
+        }
+    }
+
+    return entries_;
+}
+
+const Vector<String> PackageFile::GetEntryNames() const
+{
+    if (!directory_)
+        return entries_.Keys();
+
+    Vector<String> ret;
+    ret.Reserve(numFiles_);
+    for (unsigned i = 0; i < numFiles_; ++i)
+        ret.Push(String(names_ + directory_[i].nameOffset_));
+    return ret;
+}
+
+const PODVector<StringHash> PackageFile::GetEntryNameHashes() const
+{
+    PODVector<StringHash> ret;
+    ret.Reserve(numFiles_);
+
+    if (directory_)
+    {
+        for (unsigned i = 0; i < numFiles_; ++i)
+            ret.Push(StringHash(directory_[i].nameHash_));
+    }
+    else
+    {
+        for (HashMap<String, PackageEntry>::ConstIterator i = entries_.Begin(); i != entries_.End(); ++i)
+            ret.Push(StringHash(i->first_));
+    }
+
+    return ret;
+}
+
+bool PackageFile::ReadDirectory(File* file, unsigned startOffset, unsigned numFiles, unsigned namesSize, unsigned dictionarySize,
+    bool memoryMapped)
+{
+    unsigned directoryOffset = file->GetPosition();
+    // Compare each size against the space remaining, as adding the sizes of a corrupt directory could wrap around
+    unsigned entriesSize = numFiles * sizeof(PackageDirectoryEntry);
+    if (directoryOffset > totalSize_ || numFiles > (totalSize_ - directoryOffset) / sizeof(PackageDirectoryEntry) ||
+        namesSize > totalSize_ - directoryOffset - entriesSize || dictionarySize > totalSize_ - directoryOffset - entriesSize - namesSize)
+    {
+        URHO3D_LOGERROR("Directory outside package file " + fileName_);
+        return false;
+    }
+
+    // Search the directory straight from the memory-mapped file if possible. If the package does not start at the beginning
+    // of the file, the offsets need adjusting, so the directory has to be copied
+    const unsigned char* directory;
+    if (memoryMapped && !startOffset && MapFile())
+        directory = mapping_->GetData() + directoryOffset;
+    else
+    {
+        directoryBuffer_.Resize(entriesSize + namesSize);
+        if (directoryBuffer_.Size() && file->Read(&directoryBuffer_[0], directoryBuffer_.Size()) != directoryBuffer_.Size())
+        {
+            URHO3D_LOGERROR("Could not read directory of package file " + fileName_);
+            return false;
+        }
+
+        directory = directoryBuffer_.Size() ? &directoryBuffer_[0] : 0;
+        if (startOffset)
+        {
+            PackageDirectoryEntry* entries = (PackageDirectoryEntry*)directory;
+            for (unsigned i = 0; i < numFiles; ++i)
+                entries[i].entry_.offset_ += startOffset;
+        }
+    }
+
+    const PackageDirectoryEntry* entries = (const PackageDirectoryEntry*)directory;
+    const char* names = (const char*)directory + entriesSize;
+    if (namesSize && names[namesSize - 1])
+    {
+        URHO3D_LOGERROR("Invalid name table in package file " + fileName_);
+        return false;
+    }
+
+    for (unsigned i = 0; i < numFiles; ++i)
+    {
+        const PackageDirectoryEntry& entry = entries[i];
+        if (entry.nameOffset_ >= namesSize)
+        {
+            URHO3D_LOGERROR("Invalid name table in package file " + fileName_);
+            return false;
+        }
+        if (!compressed_ && (entry.entry_.offset_ > totalSize_ || entry.entry_.size_ > totalSize_ - entry.entry_.offset_))
+        {
+            URHO3D_LOGERROR("File entry " + String(names + entry.nameOffset_) + " outside package file");
+            return false;
+        }
+
+        totalDataSize_ += entry.entry_.size_;
+    }
+
+    if (dictionarySize)
+    {
+        // The dictionary follows the name table
+        if (mapping_ && !startOffset)
+            dictionary_ = new CompressionDictionary(names + namesSize, dictionarySize);
+        else
+        {
+            PODVector<unsigned char> dictionaryData(dictionarySize);
+            if (file->Read(&dictionaryData[0], dictionarySize) != dictionarySize)
+            {
+                URHO3D_LOGERROR("Could not read compression dictionary of package file " + fileName_);
+                return false;
+            }
+            dictionary_ = new CompressionDictionary(&dictionaryData[0], dictionarySize);
+        }
+
+        if (!dictionary_->GetDecompressionDictionary())
+        {
+            URHO3D_LOGERROR("Invalid compression dictionary in package file " + fileName_);
+            return false;
+        }
+    }
+
+    directory_ = numFiles ? entries : 0;
+    names_ = names;
+    numFiles_ = numFiles;
+    return true;
+}
+
+const PackageDirectoryEntry* PackageFile::FindDirectoryEntry(const String& fileName) const
+{
+    // Binary search for the first entry with the name hash
+    unsigned nameHash = StringHash(fileName).Value();
+    unsigned first = 0;
+    unsigned last = numFiles_;
+    while (first < last)
+    {
+        unsigned middle = (first + last) / 2;
+        if (directory_[middle].nameHash_ < nameHash)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    // Then compare the names of the entries with the same hash
+    const PackageDirectoryEntry* found = 0;
+    for (unsigned i = first; i < numFiles_ && directory_[i].nameHash_ == nameHash; ++i)
+    {
+        const char* name = names_ + directory_[i].nameOffset_;
+        if (!String::Compare(name, fileName.CString(), true))
+            return &directory_[i];
+
+#ifdef _WIN32
+        // On Windows perform a fallback case-insensitive search. The name hash is case-insensitive, so only the entries with
+        // the same hash need to be checked
+        if (!found && !String::Compare(name, fileName.CString(), false))
+            found = &directory_[i];
+#endif
+    }
+
+    return found;
+}
+
+bool PackageFile::MapFile()
+{
+    if (!totalSize_)
+        return false;
+
+#ifdef __ANDROID__
+    // Android asset files can not be memory-mapped
+    if (URHO3D_IS_ASSET(fileName_))
+        return false;
+#endif
+
+    mapping_ = PackageFileMapping::Map(fileName_, totalSize_);
+    return mapping_ != 0;
+}
+
+void PackageFile::UnmapFile()
+{
+    // Files opened from the package may still hold the mapping, in which case it is unmapped when they are closed
+    if (mapping_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+    }
+}
+
+void PackageFile::ReleaseDictionary()
+{
+    // Files opened from the package may still hold the dictionary, in which case it is destroyed when they are closed
+    if (dictionary_)
+    {
+        dictionary_->ReleaseRef();
+        dictionary_ = 0;
+    }
+}
+
+PackageFileMapping::PackageFileMapping(unsigned char* data, void* handle, unsigned size) :
+    data_(data),
+    handle_(handle),
+    size_(size),
+    refs_(1)
+{
+}
+
+PackageFileMapping::~PackageFileMapping()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle((HANDLE)handle_);
+#else
+    munmap(data_, size_);
+#endif
+}
+
+PackageFileMapping* PackageFileMapping::Map(const String& fileName, unsigned size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileW(GetWideNativePath(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+
+    // The mapping keeps the file open, so the file handle can be closed right away
+    HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+    if (!mapping)
+        return 0;
+
+    unsigned char* data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return 0;
+    }
+
+    return new PackageFileMapping(data, mapping, size);
+#else
+    int file = open(GetNativePath(fileName).CString(), O_RDONLY);
+    if (file < 0)
+        return 0;
+
+    // The mapping keeps the file open, so the file descriptor can be closed right away
+    void* data = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        return 0;
+
+    return new PackageFileMapping((unsigned char*)data, 0, size);
+#endif
+}
+
+void PackageFileMapping::AddRef()
+{
+    MutexLock lock(mutex_);
+    ++refs_;
+}
+
+void PackageFileMapping::ReleaseRef()
+{
+    bool destroy;
+    {
+        MutexLock lock(mutex_);
+        destroy = --refs_ == 0;
+    }
+
+    if (destroy)
+        delete this;
+}
+
 }
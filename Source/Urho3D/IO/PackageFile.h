@@ -22,11 +22,15 @@
 
 #pragma once
 
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
+#include "../IO/Compression.h"
 
 namespace Urho3D
 {
 
+class File;
+
 /// %File entry within the package file.
 struct PackageEntry
 {
@@ -38,6 +42,66 @@ struct PackageEntry
     unsigned checksum_;
 };
 
+/// %File entry in the directory of a version 2 package file. Stored as is in the file, sorted by name hash.
+struct PackageDirectoryEntry
+{
+    /// File entry. The offset is from the beginning of the package.
+    PackageEntry entry_;
+    /// Case-insensitive hash of the name.
+    unsigned nameHash_;
+    /// Offset of the zero-terminated name from the beginning of the name table.
+    unsigned nameOffset_;
+};
+
+/// Version 2 package file flag for compressed files.
+static const unsigned PACKAGE_COMPRESSED = 0x1;
+/// Version 2 package file flag for a compression dictionary, whose size follows the name table size in the header and whose data follows the name table.
+static const unsigned PACKAGE_DICTIONARY = 0x2;
+/// Version 2 package file flags mask for the compressed data format.
+static const unsigned PACKAGE_FORMAT_MASK = 0xff00;
+/// Version 2 package file flags bit shift for the compressed data format.
+static const unsigned PACKAGE_FORMAT_SHIFT = 8;
+
+/// Memory mapping of a package file. Shared by the package file and the files opened from it, so that it is unmapped only after all of them have released it. The reference count is changed under a mutex, as files may be closed in worker threads.
+class URHO3D_API PackageFileMapping
+{
+public:
+    /// Memory-map a file for reading. Return the mapping with one reference, or null if fails.
+    static PackageFileMapping* Map(const String& fileName, unsigned size);
+
+    /// Add a reference.
+    void AddRef();
+    /// Release a reference. Unmaps the file and destroys the mapping when no references remain.
+    void ReleaseRef();
+
+    /// Return the mapped data.
+    const unsigned char* GetData() const { return data_; }
+
+    /// Return the mapped size.
+    unsigned GetSize() const { return size_; }
+
+private:
+    /// Construct.
+    PackageFileMapping(unsigned char* data, void* handle, unsigned size);
+    /// Destruct. Unmap the file.
+    ~PackageFileMapping();
+    /// Prevent copy construction.
+    PackageFileMapping(const PackageFileMapping& rhs);
+    /// Prevent assignment.
+    PackageFileMapping& operator =(const PackageFileMapping& rhs);
+
+    /// Mapped data.
+    unsigned char* data_;
+    /// Operating system file mapping handle.
+    void* handle_;
+    /// Mapped size.
+    unsigned size_;
+    /// Reference count.
+    unsigned refs_;
+    /// Reference count mutex.
+    Mutex mutex_;
+};
+
 /// Stores files of a directory tree sequentially for convenient access.
 class URHO3D_API PackageFile : public Object
 {
@@ -47,19 +111,19 @@ public:
     /// Construct.
     PackageFile(Context* context);
     /// Construct and open.
-    PackageFile(Context* context, const String& fileName, unsigned startOffset = 0);
+    PackageFile(Context* context, const String& fileName, unsigned startOffset = 0, bool memoryMapped = false);
     /// Destruct.
     virtual ~PackageFile();
 
-    /// Open the package file. Return true if successful.
-    bool Open(const String& fileName, unsigned startOffset = 0);
+    /// Open the package file, optionally memory-mapping it for reading the files without opening the package file again. Return true if successful.
+    bool Open(const String& fileName, unsigned startOffset = 0, bool memoryMapped = false);
     /// Check if a file exists within the package file. This will be case-insensitive on Windows and case-sensitive on other platforms.
     bool Exists(const String& fileName) const;
     /// Return the file entry corresponding to the name, or null if not found. This will be case-insensitive on Windows and case-sensitive on other platforms.
     const PackageEntry* GetEntry(const String& fileName) const;
 
-    /// Return all file entries.
-    const HashMap<String, PackageEntry>& GetEntries() const { return entries_; }
+    /// Return all file entries. For a version 2 package file the map is built on the first call, which is slow for a large package; prefer GetEntryNames() or GetEntryNameHashes() when the entries are not needed.
+    const HashMap<String, PackageEntry>& GetEntries() const;
 
     /// Return the package file name.
     const String& GetName() const { return fileName_; }
@@ -68,7 +132,7 @@ public:
     StringHash GetNameHash() const { return nameHash_; }
 
     /// Return number of files.
-    unsigned GetNumFiles() const { return entries_.Size(); }
+    unsigned GetNumFiles() const { return numFiles_; }
 
     /// Return total size of the package file.
     unsigned GetTotalSize() const { return totalSize_; }
@@ -82,12 +146,53 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return the data format of compressed files.
+    CompressionFormat GetCompressionFormat() const { return compressionFormat_; }
+
+    /// Return the compression dictionary, or null if the files are compressed without one. Add a reference to keep it after the package file is destroyed.
+    CompressionDictionary* GetDictionary() const { return dictionary_; }
+
+    /// Return whether the package file is memory-mapped.
+    bool IsMemoryMapped() const { return mapping_ != 0; }
+
+    /// Return the memory-mapped package file data, or null if not memory-mapped.
+    const unsigned char* GetMappedData() const { return mapping_ ? mapping_->GetData() : 0; }
+
+    /// Return the memory mapping of the package file, or null if not memory-mapped. Add a reference to keep it mapped after the package file is destroyed.
+    PackageFileMapping* GetMapping() const { return mapping_; }
+
+    /// Return whether the package file uses the version 2 format with a sorted directory.
+    bool HasDirectory() const { return directory_ != 0; }
+
     /// Return list of file names in the package.
-    const Vector<String> GetEntryNames() const { return entries_.Keys(); }
+    const Vector<String> GetEntryNames() const;
+    /// Return list of the file name hashes in the package. For a version 2 package file these are read from the directory without hashing the names.
+    const PODVector<StringHash> GetEntryNameHashes() const;
 
 private:
-    /// File entries.
-    HashMap<String, PackageEntry> entries_;
+    /// Read and validate the directory of a version 2 package file. Return true if successful.
+    bool ReadDirectory(File* file, unsigned startOffset, unsigned numFiles, unsigned namesSize, unsigned dictionarySize, bool memoryMapped);
+    /// Search the directory of a version 2 package file. This will be case-insensitive on Windows and case-sensitive on other platforms.
+    const PackageDirectoryEntry* FindDirectoryEntry(const String& fileName) const;
+    /// Memory-map the package file. Return true if successful.
+    bool MapFile();
+    /// Unmap the package file.
+    void UnmapFile();
+    /// Release the compression dictionary.
+    void ReleaseDictionary();
+
+    /// File entries. Built on demand for a version 2 package file.
+    mutable HashMap<String, PackageEntry> entries_;
+    /// Mutex for building the file entries on demand.
+    mutable Mutex entriesMutex_;
+    /// Sorted directory of a version 2 package file, either memory-mapped or in the directory buffer. Null for the original format.
+    const PackageDirectoryEntry* directory_;
+    /// Name table of a version 2 package file.
+    const char* names_;
+    /// Directory buffer of a version 2 package file, when it is not searched directly from the memory-mapped file.
+    PODVector<unsigned char> directoryBuffer_;
+    /// Number of files.
+    unsigned numFiles_;
     /// File name.
     String fileName_;
     /// Package file name hash.
@@ -98,6 +203,12 @@ private:
     unsigned totalDataSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Memory mapping of the package file.
+    PackageFileMapping* mapping_;
+    /// Compression dictionary.
+    CompressionDictionary* dictionary_;
+    /// Compressed data format.
+    CompressionFormat compressionFormat_;
     /// Compressed flag.
     bool compressed_;
 };
@@ -477,7 +477,17 @@ void Constraint::OnMarkedDirty(Node* node)
 {
     /// \todo This does not catch the connected body node's scale changing
     if (HasWorldScaleChanged(cachedWorldScale_, node->GetWorldScale()))
+    {
+        // Physics operations are not safe from worker threads
+        Scene* scene = GetScene();
+        if (scene && scene->IsThreadedUpdate())
+        {
+            scene->DelayedMarkedDirty(this);
+            return;
+        }
+
         ApplyFrames();
+    }
 }
 
 void Constraint::CreateConstraint()
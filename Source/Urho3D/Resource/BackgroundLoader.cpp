@@ -25,7 +25,9 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
@@ -36,92 +38,260 @@
 namespace Urho3D
 {
 
+/// Background loader thread.
+class BackgroundLoaderThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoaderThread(BackgroundLoader* owner) :
+        owner_(owner)
+    {
+    }
+
+    /// Load resources until stopped.
+    virtual void ThreadFunction()
+    {
+        owner_->ProcessItems();
+    }
+
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+};
+
+static inline bool CompareQueueEntries(const BackgroundLoadQueueEntry& lhs, const BackgroundLoadQueueEntry& rhs)
+{
+    // Return true if lhs should be loaded after rhs
+    return lhs.priority_ != rhs.priority_ ? lhs.priority_ < rhs.priority_ : lhs.order_ > rhs.order_;
+}
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(Clamp((int)GetNumPhysicalCPUs() - 1, 1, 4)),
+    queueOrder_(0),
+    shutDown_(false)
 {
 }
 
 BackgroundLoader::~BackgroundLoader()
 {
+    StopThreads();
+
     MutexLock lock(backgroundLoadMutex_);
 
+    loadQueue_.Clear();
     backgroundLoadQueue_.Clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::ProcessItems()
 {
-    while (shouldRun_)
-    {
-        backgroundLoadMutex_.Acquire();
+    backgroundLoadMutex_.Acquire();
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
+    for (;;)
+    {
+        if (shutDown_)
         {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
+            // Pass the wakeup on to the next thread
+            backgroundLoadMutex_.Release();
+            workAvailable_.Set();
+            return;
         }
 
-        if (i == backgroundLoadQueue_.End())
+        BackgroundLoadItem* item = PopQueuedItem();
+        if (!item)
         {
-            // No resources to load found
+            // Sleep until more resources are queued
             backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            workAvailable_.Wait();
+            backgroundLoadMutex_.Acquire();
+            continue;
         }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
 
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
+        // The condition wakes only one thread at a time, so wake the next one if there is more to load. The item is not
+        // removed from the queue as long as it is in the "loading" state
+        if (!loadQueue_.Empty())
+            workAvailable_.Set();
+        backgroundLoadMutex_.Release();
+
+        bool success = LoadItem(*item);
+
+        backgroundLoadMutex_.Acquire();
+        CompleteItem(*item, success);
+    }
+}
+
+void BackgroundLoader::StartThreads()
+{
+    if (!threads_.Empty())
+        return;
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        SharedPtr<BackgroundLoaderThread> thread(new BackgroundLoaderThread(this));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    if (threads_.Empty())
+        return;
+
+    // The threads pass the wakeup on to each other when exiting
+    shutDown_ = true;
+    workAvailable_.Set();
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Stop();
+
+    threads_.Clear();
+    shutDown_ = false;
+}
+
+void BackgroundLoader::SetNumThreads(unsigned num)
+{
+    num = Max(num, 1U);
+    if (num == numThreads_)
+        return;
+
+    bool restart = !threads_.Empty();
+    StopThreads();
+    numThreads_ = num;
+    if (restart)
+    {
+        StartThreads();
+        workAvailable_.Set();
+    }
+}
+
+void BackgroundLoader::PushQueueEntry(const Pair<StringHash, StringHash>& key, int priority)
+{
+    BackgroundLoadQueueEntry entry;
+    entry.priority_ = priority;
+    entry.order_ = queueOrder_++;
+    entry.key_ = key;
+
+    // Sift up
+    unsigned index = loadQueue_.Size();
+    loadQueue_.Push(entry);
+    while (index > 0)
+    {
+        unsigned parent = (index - 1) / 2;
+        if (!CompareQueueEntries(loadQueue_[parent], entry))
+            break;
+        loadQueue_[index] = loadQueue_[parent];
+        index = parent;
+    }
+    loadQueue_[index] = entry;
+}
+
+BackgroundLoadItem* BackgroundLoader::PopQueuedItem()
+{
+    while (!loadQueue_.Empty())
+    {
+        BackgroundLoadQueueEntry top = loadQueue_.Front();
+
+        // Sift down the last entry from the top
+        BackgroundLoadQueueEntry last = loadQueue_.Back();
+        loadQueue_.Pop();
+        unsigned size = loadQueue_.Size();
+        if (size)
+        {
+            unsigned index = 0;
+            for (;;)
             {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
+                unsigned child = index * 2 + 1;
+                if (child >= size)
+                    break;
+                if (child + 1 < size && CompareQueueEntries(loadQueue_[child], loadQueue_[child + 1]))
+                    ++child;
+                if (!CompareQueueEntries(last, loadQueue_[child]))
+                    break;
+                loadQueue_[index] = loadQueue_[child];
+                index = child;
             }
+            loadQueue_[index] = last;
+        }
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+        // Skip stale entries: the resource has been loaded by another thread, or its priority was raised and it was queued
+        // again
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(top.key_);
+        if (i == backgroundLoadQueue_.End())
+            continue;
+        BackgroundLoadItem& item = i->second_;
+        if (item.resource_->GetAsyncLoadState() != ASYNC_QUEUED || item.priority_ != top.priority_)
+            continue;
 
-                item.dependents_.Clear();
-            }
+        item.resource_->SetAsyncLoadState(ASYNC_LOADING);
+        return &item;
+    }
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+    return 0;
+}
+
+bool BackgroundLoader::LoadItem(BackgroundLoadItem& item)
+{
+    Resource* resource = item.resource_;
+    SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+    return file && resource->BeginLoad(*file);
+}
+
+void BackgroundLoader::CompleteItem(BackgroundLoadItem& item, bool success)
+{
+    Resource* resource = item.resource_;
+
+    // Process dependencies now
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End(); ++i)
+        {
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
+
+        item.dependents_.Clear();
     }
+
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    resourceLoaded_.Set();
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller,
+    int priority)
 {
     StringHash nameHash(name);
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
 
     MutexLock lock(backgroundLoadMutex_);
 
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.Find(key) != backgroundLoadQueue_.End())
+    // If this is a resource calling for the background load of more resources, load the dependency at least at the same
+    // priority so that the caller is not starved
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.End();
+    if (caller)
+    {
+        j = backgroundLoadQueue_.Find(MakePair(caller->GetType(), caller->GetNameHash()));
+        if (j != backgroundLoadQueue_.End())
+            priority = Max(priority, j->second_.priority_);
+    }
+
+    // Check if already exists in the queue. If still waiting for a loader thread, raise the priority if necessary
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator existing = backgroundLoadQueue_.Find(key);
+    if (existing != backgroundLoadQueue_.End())
+    {
+        BackgroundLoadItem& item = existing->second_;
+        if (priority > item.priority_ && item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+        {
+            item.priority_ = priority;
+            PushQueueEntry(key, priority);
+        }
         return false;
+    }
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = priority;
 
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -147,15 +317,13 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
     item.resource_->SetName(name);
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
 
-    // If this is a resource calling for the background load of more resources, mark the dependency as necessary
+    // Mark the dependency as necessary for the caller
     if (caller)
     {
-        Pair<StringHash, StringHash> callerKey = MakePair(caller->GetType(), caller->GetNameHash());
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(callerKey);
         if (j != backgroundLoadQueue_.End())
         {
             BackgroundLoadItem& callerItem = j->second_;
-            item.dependents_.Insert(callerKey);
+            item.dependents_.Insert(j->first_);
             callerItem.dependencies_.Insert(key);
         }
         else
@@ -163,9 +331,10 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
                        " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    // Start the loader threads now and wake one of them
+    PushQueueEntry(key, priority);
+    StartThreads();
+    workAvailable_.Set();
 
     return true;
 }
@@ -179,33 +348,62 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
-        backgroundLoadMutex_.Release();
+        BackgroundLoadItem& item = i->second_;
+        Resource* resource = item.resource_;
+        HiresTimer waitTimer;
+        bool didWait = false;
 
+        for (;;)
         {
-            Resource* resource = i->second_.resource_;
-            HiresTimer waitTimer;
-            bool didWait = false;
-
-            for (;;)
+            // Rather than wait for the loader threads, load the resource and its dependencies on this thread if they have
+            // not been started yet. Loading the resource may queue more dependencies
+            BackgroundLoadItem* load = 0;
+            if (resource->GetAsyncLoadState() == ASYNC_QUEUED)
+                load = &item;
+            else
             {
-                unsigned numDeps = i->second_.dependencies_.Size();
-                AsyncLoadState state = resource->GetAsyncLoadState();
-                if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
+                for (HashSet<Pair<StringHash, StringHash> >::ConstIterator j = item.dependencies_.Begin();
+                     j != item.dependencies_.End(); ++j)
                 {
-                    didWait = true;
-                    Time::Sleep(1);
+                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator k = backgroundLoadQueue_.Find(*j);
+                    if (k != backgroundLoadQueue_.End() && k->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+                    {
+                        load = &k->second_;
+                        break;
+                    }
                 }
-                else
-                    break;
             }
 
-            if (didWait)
-                URHO3D_LOGDEBUG("Waited " + String(waitTimer.GetUSec(false) / 1000) + " ms for background loaded resource " +
-                         resource->GetName());
+            if (load)
+            {
+                load->resource_->SetAsyncLoadState(ASYNC_LOADING);
+                backgroundLoadMutex_.Release();
+                bool success = LoadItem(*load);
+                backgroundLoadMutex_.Acquire();
+                CompleteItem(*load, success);
+                continue;
+            }
+
+            // Wait for the rest being loaded by the loader threads
+            if (!item.dependencies_.Empty() || resource->GetAsyncLoadState() == ASYNC_LOADING)
+            {
+                didWait = true;
+                backgroundLoadMutex_.Release();
+                resourceLoaded_.Wait();
+                backgroundLoadMutex_.Acquire();
+            }
+            else
+                break;
         }
 
+        backgroundLoadMutex_.Release();
+
+        if (didWait)
+            URHO3D_LOGDEBUG("Waited " + String(waitTimer.GetUSec(false) / 1000) + " ms for background loaded resource " +
+                     resource->GetName());
+
         // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
-        FinishBackgroundLoading(i->second_);
+        FinishBackgroundLoading(item);
 
         backgroundLoadMutex_.Acquire();
         backgroundLoadQueue_.Erase(i);
@@ -217,7 +415,7 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    if (!threads_.Empty())
     {
         HiresTimer timer;
 
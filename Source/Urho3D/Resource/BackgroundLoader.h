@@ -24,15 +24,16 @@
 
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
+#include "../Core/Condition.h"
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Container/RefCounted.h"
-#include "../Core/Thread.h"
 #include "../Math/StringHash.h"
 
 namespace Urho3D
 {
 
+class BackgroundLoaderThread;
 class Resource;
 class ResourceCache;
 
@@ -45,34 +46,64 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     HashSet<Pair<StringHash, StringHash> > dependents_;
+    /// Load priority. Higher value = will be loaded first.
+    int priority_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
 };
 
+/// Priority queue entry of a resource waiting for a loader thread.
+struct BackgroundLoadQueueEntry
+{
+    /// Load priority at the time of queuing. The entry is stale if the item's priority has changed since.
+    int priority_;
+    /// Queuing order, to load resources of equal priority in the order they were requested.
+    unsigned order_;
+    /// Resource type and name hash.
+    Pair<StringHash, StringHash> key_;
+};
+
 /// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+class BackgroundLoader : public RefCounted
 {
+    friend class BackgroundLoaderThread;
+
 public:
     /// Construct.
     BackgroundLoader(ResourceCache* owner);
 
-    /// Destruct. Forcibly clear the load queue.
+    /// Destruct. Stop the loader threads and forcibly clear the load queue.
     ~BackgroundLoader();
 
-    /// Resource background loading loop.
-    virtual void ThreadFunction();
-
-    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
-    /// Wait and finish possible loading of a resource when being requested from the cache.
+    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. If already queued, raise the priority if higher. Return true if queued (not a duplicate and resource was a known type).
+    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, int priority);
+    /// Wait and finish possible loading of a resource when being requested from the cache. A resource still waiting for a loader thread is loaded on the calling thread instead.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
+    /// Set number of loader threads. Loader threads already running are restarted.
+    void SetNumThreads(unsigned num);
 
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
 
 private:
+    /// Resource background loading loop. Called by the loader threads.
+    void ProcessItems();
+    /// Start the loader threads if not running yet.
+    void StartThreads();
+    /// Stop the loader threads and wait for them to finish.
+    void StopThreads();
+    /// Add a resource to the priority queue of resources waiting for a loader thread.
+    void PushQueueEntry(const Pair<StringHash, StringHash>& key, int priority);
+    /// Take the highest priority queued resource and mark it loading. Return null if none. The mutex must be held.
+    BackgroundLoadItem* PopQueuedItem();
+    /// Perform the BeginLoad() phase of a resource claimed for loading. Must be called without holding the mutex.
+    bool LoadItem(BackgroundLoadItem& item);
+    /// Release the dependents of a loaded resource, set its load state and wake the waiting thread. The mutex must be held.
+    void CompleteItem(BackgroundLoadItem& item, bool success);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
@@ -82,6 +113,20 @@ private:
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Binary heap of resources waiting for a loader thread, highest priority first.
+    PODVector<BackgroundLoadQueueEntry> loadQueue_;
+    /// Loader threads.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Condition set when resources are queued for the loader threads.
+    Condition workAvailable_;
+    /// Condition set when a resource has been loaded, for waking the main thread waiting for it.
+    Condition resourceLoaded_;
+    /// Number of loader threads.
+    unsigned numThreads_;
+    /// Counter for the queuing order.
+    unsigned queueOrder_;
+    /// Shutting down flag for the loader threads.
+    volatile bool shutDown_;
 };
 
 }
@@ -2300,9 +2300,19 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
-    SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
-    source.Read(buffer.Get(), dataSize);
-    return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int*)&components, 0);
+    // Decode straight from memory if possible, for example from a memory-mapped package file
+    const unsigned char* data = source.GetPosition() ? 0 : source.GetDirectData();
+    SharedArrayPtr<unsigned char> buffer;
+    if (!data)
+    {
+        buffer = new unsigned char[dataSize];
+        source.Read(buffer.Get(), dataSize);
+        data = buffer.Get();
+    }
+    else
+        source.Seek(dataSize);
+
+    return stbi_load_from_memory(data, dataSize, &width, &height, (int*)&components, 0);
 }
 
 void Image::FreeImageData(unsigned char* pixelData)
@@ -122,13 +122,21 @@ bool JSONFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    SharedArrayPtr<char> buffer(new char[dataSize + 1]);
-    if (source.Read(buffer.Get(), dataSize) != dataSize)
-        return false;
-    buffer[dataSize] = '\0';
+    // Parse straight from memory if possible, for example from a memory-mapped package file
+    const char* data = source.GetPosition() ? 0 : (const char*)source.GetDirectData();
+    SharedArrayPtr<char> buffer;
+    if (!data)
+    {
+        buffer = new char[dataSize];
+        if (source.Read(buffer.Get(), dataSize) != dataSize)
+            return false;
+        data = buffer.Get();
+    }
+    else
+        source.Seek(dataSize);
 
     rapidjson::Document document;
-    if (document.Parse<kParseCommentsFlag | kParseTrailingCommasFlag>(buffer).HasParseError())
+    if (document.Parse<kParseCommentsFlag | kParseTrailingCommasFlag>(data, dataSize).HasParseError())
     {
         URHO3D_LOGERROR("Could not parse JSON data from " + source.GetName());
         return false;
@@ -72,6 +72,7 @@ ResourceCache::ResourceCache(Context* context) :
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
+    memoryMapPackages_(false),
     isRouting_(false),
     finishBackgroundResourcesMs_(5)
 {
@@ -79,7 +80,7 @@ ResourceCache::ResourceCache(Context* context) :
     RegisterResourceLibrary(context_);
 
 #ifdef URHO3D_THREADING
-    // Create resource background loader. Its thread will start on the first background request
+    // Create resource background loader. Its threads will start on the first background request
     backgroundLoader_ = new BackgroundLoader(this);
 #endif
 
@@ -156,7 +157,7 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
 bool ResourceCache::AddPackageFile(const String& fileName, unsigned priority)
 {
     SharedPtr<PackageFile> package(new PackageFile(context_));
-    return package->Open(fileName) && AddPackageFile(package);
+    return package->Open(fileName, 0, memoryMapPackages_) && AddPackageFile(package);
 }
 
 bool ResourceCache::AddManualResource(Resource* resource)
@@ -635,7 +636,8 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller,
+    int priority)
 {
 #ifdef URHO3D_THREADING
     // If empty name, fail immediately
@@ -648,7 +650,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
     if (FindResource(type, nameHash) != noResource)
         return false;
 
-    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller, priority);
 #else
     // When threading not supported, fall back to synchronous loading
     return GetResource(type, nameIn, sendEventOnFailure);
@@ -708,6 +710,22 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String
     return resource;
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(num);
+#endif
+}
+
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
 unsigned ResourceCache::GetNumBackgroundLoadResources() const
 {
 #ifdef URHO3D_THREADING
@@ -1004,10 +1022,10 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 {
     HashSet<StringHash> affectedGroups;
 
-    const HashMap<String, PackageEntry>& entries = package->GetEntries();
-    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+    const PODVector<StringHash> nameHashes = package->GetEntryNameHashes();
+    for (PODVector<StringHash>::ConstIterator i = nameHashes.Begin(); i != nameHashes.End(); ++i)
     {
-        StringHash nameHash(i->first_);
+        const StringHash& nameHash = *i;
 
         // We do not know the actual resource type, so search all type containers
         for (HashMap<StringHash, ResourceGroup>::Iterator j = resourceGroups_.Begin(); j != resourceGroups_.End(); ++j)
@@ -87,11 +87,20 @@ bool XMLFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    SharedArrayPtr<char> buffer(new char[dataSize]);
-    if (source.Read(buffer.Get(), dataSize) != dataSize)
-        return false;
+    // Parse straight from memory if possible, for example from a memory-mapped package file
+    const char* data = source.GetPosition() ? 0 : (const char*)source.GetDirectData();
+    SharedArrayPtr<char> buffer;
+    if (!data)
+    {
+        buffer = new char[dataSize];
+        if (source.Read(buffer.Get(), dataSize) != dataSize)
+            return false;
+        data = buffer.Get();
+    }
+    else
+        source.Seek(dataSize);
 
-    if (!document_->load_buffer(buffer.Get(), dataSize))
+    if (!document_->load_buffer(data, dataSize))
     {
         URHO3D_LOGERROR("Could not parse XML data from " + source.GetName());
         document_->reset();
@@ -37,12 +37,14 @@ LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
-    delayedStartCalled_(false)
+    delayedStartCalled_(false),
+    threadSafeUpdate_(false)
 {
 }
 
 LogicComponent::~LogicComponent()
 {
+    ClearUpdateSubscription();
 }
 
 void LogicComponent::OnSetEnabled()
@@ -75,6 +77,16 @@ void LogicComponent::SetUpdateEventMask(unsigned char mask)
     }
 }
 
+void LogicComponent::SetThreadSafeUpdate(bool enable)
+{
+    if (enable != threadSafeUpdate_)
+    {
+        ClearUpdateSubscription();
+        threadSafeUpdate_ = enable;
+        UpdateEventSubscription();
+    }
+}
+
 void LogicComponent::OnNodeSet(Node* node)
 {
     if (node)
@@ -95,8 +107,7 @@ void LogicComponent::OnSceneSet(Scene* scene)
         UpdateEventSubscription();
     else
     {
-        UnsubscribeFromEvent(E_SCENEUPDATE);
-        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+        ClearUpdateSubscription();
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
         UnsubscribeFromEvent(E_PHYSICSPRESTEP);
         UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
@@ -114,27 +125,41 @@ void LogicComponent::UpdateEventSubscription()
     bool enabled = IsEnabledEffective();
 
     bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
-    if (needUpdate && !(currentEventMask_ & USE_UPDATE))
-    {
-        SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(LogicComponent, HandleSceneUpdate));
-        currentEventMask_ |= USE_UPDATE;
-    }
-    else if (!needUpdate && (currentEventMask_ & USE_UPDATE))
-    {
-        UnsubscribeFromEvent(scene, E_SCENEUPDATE);
-        currentEventMask_ &= ~USE_UPDATE;
-    }
-
     bool needPostUpdate = enabled && (updateEventMask_ & USE_POSTUPDATE);
-    if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
+
+    if (threadSafeUpdate_)
     {
-        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(LogicComponent, HandleScenePostUpdate));
-        currentEventMask_ |= USE_POSTUPDATE;
+        // Register to the scene's batched update instead of the update events
+        unsigned char mask = (unsigned char)((needUpdate ? USE_UPDATE : 0) | (needPostUpdate ? USE_POSTUPDATE : 0));
+        unsigned char currentMask = (unsigned char)(currentEventMask_ & (USE_UPDATE | USE_POSTUPDATE));
+        scene->AddThreadSafeUpdate(this, mask & ~currentMask);
+        scene->RemoveThreadSafeUpdate(this, currentMask & ~mask);
+        currentEventMask_ = (currentEventMask_ & ~(USE_UPDATE | USE_POSTUPDATE)) | mask;
+        threadSafeScene_ = scene;
     }
-    else if (!needPostUpdate && (currentEventMask_ & USE_POSTUPDATE))
+    else
     {
-        UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
-        currentEventMask_ &= ~USE_POSTUPDATE;
+        if (needUpdate && !(currentEventMask_ & USE_UPDATE))
+        {
+            SubscribeToEvent(scene, URHO3D_TYPED_HANDLER(LogicComponent, HandleSceneUpdate));
+            currentEventMask_ |= USE_UPDATE;
+        }
+        else if (!needUpdate && (currentEventMask_ & USE_UPDATE))
+        {
+            UnsubscribeFromEvent(scene, E_SCENEUPDATE);
+            currentEventMask_ &= ~USE_UPDATE;
+        }
+
+        if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
+        {
+            SubscribeToEvent(scene, URHO3D_TYPED_HANDLER(LogicComponent, HandleScenePostUpdate));
+            currentEventMask_ |= USE_POSTUPDATE;
+        }
+        else if (!needPostUpdate && (currentEventMask_ & USE_POSTUPDATE))
+        {
+            UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
+            currentEventMask_ &= ~USE_POSTUPDATE;
+        }
     }
 
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
@@ -168,10 +193,37 @@ void LogicComponent::UpdateEventSubscription()
 #endif
 }
 
-void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::ClearUpdateSubscription()
 {
-    using namespace SceneUpdate;
+    if (threadSafeScene_)
+    {
+        threadSafeScene_->RemoveThreadSafeUpdate(this, currentEventMask_);
+        threadSafeScene_.Reset();
+    }
+    else if (currentEventMask_ & (USE_UPDATE | USE_POSTUPDATE))
+    {
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+    }
 
+    currentEventMask_ &= ~(USE_UPDATE | USE_POSTUPDATE);
+}
+
+void LogicComponent::CallDelayedStart()
+{
+    if (delayedStartCalled_)
+        return;
+
+    DelayedStart();
+    delayedStartCalled_ = true;
+
+    // If did not need actual updates, this removes the component from the update
+    if (!(updateEventMask_ & USE_UPDATE))
+        UpdateEventSubscription();
+}
+
+void LogicComponent::HandleSceneUpdate(const SceneUpdateEventData& eventData)
+{
     // Execute user-defined delayed start function before first update
     if (!delayedStartCalled_)
     {
@@ -188,15 +240,13 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
     }
 
     // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(eventData.timeStep_);
 }
 
-void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::HandleScenePostUpdate(const ScenePostUpdateEventData& eventData)
 {
-    using namespace ScenePostUpdate;
-
     // Execute user-defined post-update function
-    PostUpdate(eventData[P_TIMESTEP].GetFloat());
+    PostUpdate(eventData.timeStep_);
 }
 
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
@@ -27,6 +27,10 @@
 namespace Urho3D
 {
 
+class Scene;
+struct SceneUpdateEventData;
+struct ScenePostUpdateEventData;
+
 /// Bitmask for using the scene update event.
 static const unsigned char USE_UPDATE = 0x1;
 /// Bitmask for using the scene post-update event.
@@ -41,6 +45,8 @@ class URHO3D_API LogicComponent : public Component
 {
     URHO3D_OBJECT(LogicComponent, Component);
 
+    friend class Scene;
+
     /// Construct.
     LogicComponent(Context* context);
     /// Destruct.
@@ -69,6 +75,8 @@ class URHO3D_API LogicComponent : public Component
 
     /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(unsigned char mask);
+    /// Declare Update() and PostUpdate() thread-safe. They are then called by the scene in a batch after the corresponding update event, in the worker threads if the scene has parallel update enabled. They must not send events or create or remove scene content. FixedUpdate() and FixedPostUpdate() are not affected. Note that this is not an attribute, like the update event mask.
+    void SetThreadSafeUpdate(bool enable);
 
     /// Return what update events are subscribed to.
     unsigned char GetUpdateEventMask() const { return updateEventMask_; }
@@ -76,6 +84,9 @@ class URHO3D_API LogicComponent : public Component
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
 
+    /// Return whether Update() and PostUpdate() are declared thread-safe.
+    bool IsThreadSafeUpdate() const { return threadSafeUpdate_; }
+
 protected:
     /// Handle scene node being assigned at creation.
     virtual void OnNodeSet(Node* node);
@@ -85,10 +96,14 @@ protected:
 private:
     /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
     void UpdateEventSubscription();
+    /// Unsubscribe from the scene update and post-update, whether through events or the scene's thread-safe update.
+    void ClearUpdateSubscription();
+    /// Call the delayed start function if not called yet. Called by the scene before the first thread-safe update.
+    void CallDelayedStart();
     /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleSceneUpdate(const SceneUpdateEventData& eventData);
     /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleScenePostUpdate(const ScenePostUpdateEventData& eventData);
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
     /// Handle physics pre-step event.
     void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
@@ -101,6 +116,10 @@ private:
     unsigned char currentEventMask_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Thread-safe update flag.
+    bool threadSafeUpdate_;
+    /// Scene the thread-safe update is registered to.
+    WeakPtr<Scene> threadSafeScene_;
 };
 
 }
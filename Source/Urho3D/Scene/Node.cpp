@@ -58,7 +58,9 @@ Node::Node(Context* context) :
     position_(Vector3::ZERO),
     rotation_(Quaternion::IDENTITY),
     scale_(Vector3::ONE),
-    worldRotation_(Quaternion::IDENTITY)
+    worldRotation_(Quaternion::IDENTITY),
+    transformLevel_(M_MAX_UNSIGNED),
+    transformIndex_(M_MAX_UNSIGNED)
 {
     impl_ = new NodeImpl();
     impl_->owner_ = 0;
@@ -748,6 +750,8 @@ void Node::MarkDirty()
         if (cur->dirty_)
             return;
         cur->dirty_ = true;
+        if (cur->transformLevel_ != M_MAX_UNSIGNED)
+            cur->scene_->MarkTransformDirty(cur->transformLevel_, cur->transformIndex_);
 
         // Notify listener components first, then mark child nodes
         for (Vector<WeakPtr<Component> >::Iterator i = cur->listeners_.Begin(); i != cur->listeners_.End();)
@@ -824,6 +828,7 @@ void Node::AddChild(Node* node, unsigned index)
                 eventData[P_NODE] = node;
 
                 scene_->SendEvent(E_NODEREMOVED, eventData);
+                scene_->NodeReparented(node);
             }
 
             oldParent->children_.Remove(nodeShared);
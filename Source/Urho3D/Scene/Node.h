@@ -75,6 +75,7 @@ class URHO3D_API Node : public Animatable
     URHO3D_OBJECT(Node, Animatable);
 
     friend class Connection;
+    friend class TransformStore;
 
 public:
     /// Construct.
@@ -695,6 +696,10 @@ private:
     Vector<WeakPtr<Component> > listeners_;
     /// Pointer to implementation.
     UniquePtr<NodeImpl> impl_;
+    /// Depth level in the scene's transform store, or M_MAX_UNSIGNED if not stored.
+    unsigned transformLevel_;
+    /// Index within the depth level in the scene's transform store, or index of pending insertion if not stored yet, or M_MAX_UNSIGNED if neither.
+    unsigned transformIndex_;
 
 protected:
     /// User variables.
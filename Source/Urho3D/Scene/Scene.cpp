@@ -34,6 +34,7 @@
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
 #include "../Scene/Component.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
@@ -54,6 +55,91 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const unsigned PARALLEL_UPDATE_GRAIN_SIZE = 64;
+
+static bool CompareComponentTypes(const LogicComponent* lhs, const LogicComponent* rhs)
+{
+    return lhs->GetType() < rhs->GetType();
+}
+
+/// Thread-safe logic component update functor for WorkQueue::ParallelFor.
+struct LogicComponentUpdateWork
+{
+    /// Construct.
+    LogicComponentUpdateWork(LogicComponent** components, float timeStep, bool postUpdate) :
+        components_(components),
+        timeStep_(timeStep),
+        postUpdate_(postUpdate)
+    {
+    }
+
+    /// Update a range of components.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        if (postUpdate_)
+        {
+            for (unsigned i = begin; i < end; ++i)
+                components_[i]->PostUpdate(timeStep_);
+        }
+        else
+        {
+            for (unsigned i = begin; i < end; ++i)
+                components_[i]->Update(timeStep_);
+        }
+    }
+
+    /// Components.
+    LogicComponent** components_;
+    /// Timestep.
+    float timeStep_;
+    /// Post-update flag.
+    bool postUpdate_;
+};
+
+/// Smoothed transform update functor for WorkQueue::ParallelFor.
+struct SmoothedTransformUpdateWork
+{
+    /// Construct.
+    SmoothedTransformUpdateWork(SmoothedTransform** transforms, float constant, float squaredSnapThreshold) :
+        transforms_(transforms),
+        constant_(constant),
+        squaredSnapThreshold_(squaredSnapThreshold)
+    {
+    }
+
+    /// Update a range of smoothed transforms.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const
+    {
+        for (unsigned i = begin; i < end; ++i)
+            transforms_[i]->Update(constant_, squaredSnapThreshold_);
+    }
+
+    /// Smoothed transforms.
+    SmoothedTransform** transforms_;
+    /// Smoothing constant.
+    float constant_;
+    /// Squared snap threshold.
+    float squaredSnapThreshold_;
+};
+
+/// Return whether any of the smoothed transforms' nodes is a descendant of another's.
+static bool HasNestedSmoothedTransforms(const PODVector<SmoothedTransform*>& transforms)
+{
+    HashSet<Node*> nodes;
+    for (PODVector<SmoothedTransform*>::ConstIterator i = transforms.Begin(); i != transforms.End(); ++i)
+        nodes.Insert((*i)->GetNode());
+
+    for (PODVector<SmoothedTransform*>::ConstIterator i = transforms.Begin(); i != transforms.End(); ++i)
+    {
+        for (Node* parent = (*i)->GetNode()->GetParent(); parent; parent = parent->GetParent())
+        {
+            if (nodes.Contains(parent))
+                return true;
+        }
+    }
+
+    return false;
+}
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -69,13 +155,17 @@ Scene::Scene(Context* context) :
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    parallelUpdate_(false),
+    batchedTransformUpdate_(false),
+    threadSafeUpdatesDirty_(false),
+    threadSafePostUpdatesDirty_(false)
 {
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
     NodeAdded(this);
 
-    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(Scene, HandleUpdate));
+    SubscribeToEvent(URHO3D_TYPED_HANDLER(Scene, HandleUpdate));
     SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(Scene, HandleResourceBackgroundLoaded));
 }
 
@@ -669,6 +759,22 @@ void Scene::SetAsyncLoadingMs(int ms)
     asyncLoadingMs_ = Max(ms, 1);
 }
 
+void Scene::SetParallelUpdate(bool enable)
+{
+    parallelUpdate_ = enable;
+}
+
+void Scene::SetBatchedTransformUpdate(bool enable)
+{
+    if (enable == batchedTransformUpdate_)
+        return;
+
+    batchedTransformUpdate_ = enable;
+    // Release the node indices so that marking nodes dirty no longer touches the store
+    if (!enable)
+        transformStore_.Clear(this);
+}
+
 void Scene::SetElapsedTime(float time)
 {
     elapsedTime_ = time;
@@ -771,15 +877,19 @@ void Scene::Update(float timeStep)
 
     timeStep *= timeScale_;
 
+    // Update variable timestep logic
+    SceneUpdateEventData update;
+    update.scene_ = this;
+    update.timeStep_ = timeStep;
+    SendTypedEvent(update);
+    UpdateThreadSafeComponents(false, timeStep);
+
     using namespace SceneUpdate;
 
     VariantMap& eventData = GetEventDataMap();
     eventData[P_SCENE] = this;
     eventData[P_TIMESTEP] = timeStep;
 
-    // Update variable timestep logic
-    SendEvent(E_SCENEUPDATE, eventData);
-
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
 
@@ -790,18 +900,22 @@ void Scene::Update(float timeStep)
     {
         URHO3D_PROFILE(UpdateSmoothing);
 
-        float constant = 1.0f - Clamp(powf(2.0f, -timeStep * smoothingConstant_), 0.0f, 1.0f);
-        float squaredSnapThreshold = snapThreshold_ * snapThreshold_;
-
-        using namespace UpdateSmoothing;
-
-        smoothingData_[P_CONSTANT] = constant;
-        smoothingData_[P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold;
-        SendEvent(E_UPDATESMOOTHING, smoothingData_);
+        UpdateSmoothingEventData smoothing;
+        smoothing.constant_ = 1.0f - Clamp(powf(2.0f, -timeStep * smoothingConstant_), 0.0f, 1.0f);
+        smoothing.squaredSnapThreshold_ = snapThreshold_ * snapThreshold_;
+        SendTypedEvent(smoothing);
+        UpdateSmoothedTransforms(smoothing.constant_, smoothing.squaredSnapThreshold_);
     }
 
     // Post-update variable timestep logic
-    SendEvent(E_SCENEPOSTUPDATE, eventData);
+    ScenePostUpdateEventData postUpdate;
+    postUpdate.scene_ = this;
+    postUpdate.timeStep_ = timeStep;
+    SendTypedEvent(postUpdate);
+    UpdateThreadSafeComponents(true, timeStep);
+
+    if (batchedTransformUpdate_)
+        UpdateWorldTransforms();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -839,6 +953,61 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::AddThreadSafeUpdate(LogicComponent* component, unsigned char mask)
+{
+    if (!component)
+        return;
+
+    if (mask & USE_UPDATE)
+    {
+        threadSafeUpdates_.Push(component);
+        threadSafeUpdatesDirty_ = true;
+        if (!component->IsDelayedStartCalled())
+            threadSafeDelayedStarts_.Push(component);
+    }
+    if (mask & USE_POSTUPDATE)
+    {
+        threadSafePostUpdates_.Push(component);
+        threadSafePostUpdatesDirty_ = true;
+    }
+}
+
+void Scene::RemoveThreadSafeUpdate(LogicComponent* component, unsigned char mask)
+{
+    if (mask & USE_UPDATE)
+    {
+        if (threadSafeUpdates_.RemoveSwap(component))
+            threadSafeUpdatesDirty_ = true;
+        threadSafeDelayedStarts_.Remove(component);
+    }
+    if (mask & USE_POSTUPDATE)
+    {
+        if (threadSafePostUpdates_.RemoveSwap(component))
+            threadSafePostUpdatesDirty_ = true;
+    }
+}
+
+void Scene::AddSmoothedTransform(SmoothedTransform* transform)
+{
+    if (transform)
+        smoothedTransforms_.Push(transform);
+}
+
+void Scene::RemoveSmoothedTransform(SmoothedTransform* transform)
+{
+    smoothedTransforms_.RemoveSwap(transform);
+}
+
+void Scene::UpdateWorldTransforms()
+{
+    if (!batchedTransformUpdate_)
+        return;
+
+    URHO3D_PROFILE(UpdateWorldTransforms);
+
+    transformStore_.Update(this, GetSubsystem<WorkQueue>());
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -914,6 +1083,7 @@ void Scene::NodeAdded(Node* node)
         oldScene->NodeRemoved(node);
 
     node->SetScene(this);
+    transformStore_.AddNode(node);
 
     // If the new node has an ID of zero (default), assign a replicated ID now
     unsigned id = node->GetID();
@@ -990,6 +1160,7 @@ void Scene::NodeRemoved(Node* node)
     else
         localNodes_.Erase(id);
 
+    transformStore_.RemoveNode(node);
     node->ResetScene();
 
     // Remove node from tag cache
@@ -1009,6 +1180,11 @@ void Scene::NodeRemoved(Node* node)
         NodeRemoved(*i);
 }
 
+void Scene::NodeReparented(Node* node)
+{
+    transformStore_.ReparentNode(node);
+}
+
 void Scene::ComponentAdded(Component* component)
 {
     if (!component)
@@ -1064,6 +1240,82 @@ void Scene::ComponentRemoved(Component* component)
     component->OnSceneSet(0);
 }
 
+void Scene::UpdateThreadSafeComponents(bool postUpdate, float timeStep)
+{
+    // Call delayed starts in the main thread first, as they are not assumed to be thread-safe. This may remove components
+    // that only wanted the delayed start from the update list. Pop the components one at a time from the list, as a delayed
+    // start may also remove or destroy other pending components. Reverse first to pop them in the order they were added
+    if (!postUpdate && !threadSafeDelayedStarts_.Empty())
+    {
+        for (unsigned i = 0, j = threadSafeDelayedStarts_.Size() - 1; i < j; ++i, --j)
+            Swap(threadSafeDelayedStarts_[i], threadSafeDelayedStarts_[j]);
+
+        while (!threadSafeDelayedStarts_.Empty())
+        {
+            LogicComponent* component = threadSafeDelayedStarts_.Back();
+            threadSafeDelayedStarts_.Pop();
+            component->CallDelayedStart();
+        }
+    }
+
+    PODVector<LogicComponent*>& components = postUpdate ? threadSafePostUpdates_ : threadSafeUpdates_;
+    if (components.Empty())
+        return;
+
+    URHO3D_PROFILE(UpdateThreadSafeComponents);
+
+    // Keep components of the same type adjacent, so that each thread mostly runs the same update function
+    bool& dirty = postUpdate ? threadSafePostUpdatesDirty_ : threadSafeUpdatesDirty_;
+    if (dirty)
+    {
+        Sort(components.Begin(), components.End(), CompareComponentTypes);
+        dirty = false;
+    }
+
+    // Copy the list, as components may not be added or removed while iterating
+    PODVector<LogicComponent*> updateComponents = components;
+    LogicComponentUpdateWork work(&updateComponents[0], timeStep, postUpdate);
+
+    if (parallelUpdate_)
+    {
+        BeginThreadedUpdate();
+        GetSubsystem<WorkQueue>()->ParallelFor(0, updateComponents.Size(), PARALLEL_UPDATE_GRAIN_SIZE, work);
+        EndThreadedUpdate();
+    }
+    else
+        work(0, updateComponents.Size(), 0);
+}
+
+void Scene::UpdateSmoothedTransforms(float constant, float squaredSnapThreshold)
+{
+    if (smoothedTransforms_.Empty())
+        return;
+
+    SmoothedTransformUpdateWork work(&smoothedTransforms_[0], constant, squaredSnapThreshold);
+
+    // Moving a node marks its whole subtree dirty, so update in parallel only when no smoothed node is inside another's
+    // subtree. Otherwise a worker could be moving a child while another marks it dirty
+    if (parallelUpdate_ && smoothedTransforms_.Size() > 1 && !HasNestedSmoothedTransforms(smoothedTransforms_))
+    {
+        BeginThreadedUpdate();
+        GetSubsystem<WorkQueue>()->ParallelFor(0, smoothedTransforms_.Size(), PARALLEL_UPDATE_GRAIN_SIZE, work);
+        EndThreadedUpdate();
+    }
+    else
+        work(0, smoothedTransforms_.Size(), 0);
+
+    // Remove the transforms which finished smoothing
+    for (unsigned i = smoothedTransforms_.Size() - 1; i < smoothedTransforms_.Size(); --i)
+    {
+        SmoothedTransform* transform = smoothedTransforms_[i];
+        if (!transform->IsInProgress())
+        {
+            transform->OnSmoothingFinished();
+            smoothedTransforms_.EraseSwap(i);
+        }
+    }
+}
+
 void Scene::SetVarNamesAttr(const String& value)
 {
     Vector<String> varNames = value.Split(';');
@@ -1162,13 +1414,12 @@ void Scene::MarkReplicationDirty(Node* node)
     }
 }
 
-void Scene::HandleUpdate(StringHash eventType, VariantMap& eventData)
+void Scene::HandleUpdate(const UpdateEventData& eventData)
 {
     if (!updateEnabled_)
         return;
 
-    using namespace Update;
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(eventData.timeStep_);
 }
 
 void Scene::HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData)
@@ -1528,6 +1779,38 @@ void Scene::PreloadResourcesJSON(const JSONValue& value)
 #endif
 }
 
+void SceneUpdateEventData::ToVariantMap(VariantMap& eventData) const
+{
+    using namespace SceneUpdate;
+
+    eventData[P_SCENE] = scene_;
+    eventData[P_TIMESTEP] = timeStep_;
+}
+
+void SceneUpdateEventData::FromVariantMap(VariantMap& eventData)
+{
+    using namespace SceneUpdate;
+
+    scene_ = static_cast<Scene*>(eventData[P_SCENE].GetPtr());
+    timeStep_ = eventData[P_TIMESTEP].GetFloat();
+}
+
+void ScenePostUpdateEventData::ToVariantMap(VariantMap& eventData) const
+{
+    using namespace ScenePostUpdate;
+
+    eventData[P_SCENE] = scene_;
+    eventData[P_TIMESTEP] = timeStep_;
+}
+
+void ScenePostUpdateEventData::FromVariantMap(VariantMap& eventData)
+{
+    using namespace ScenePostUpdate;
+
+    scene_ = static_cast<Scene*>(eventData[P_SCENE].GetPtr());
+    timeStep_ = eventData[P_TIMESTEP].GetFloat();
+}
+
 void RegisterSceneLibrary(Context* context)
 {
     ValueAnimation::RegisterObject(context);
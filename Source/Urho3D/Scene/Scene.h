@@ -28,12 +28,16 @@
 #include "../Resource/JSONFile.h"
 #include "../Scene/Node.h"
 #include "../Scene/SceneResolver.h"
+#include "../Scene/TransformStore.h"
 
 namespace Urho3D
 {
 
 class File;
+class LogicComponent;
 class PackageFile;
+class SmoothedTransform;
+struct UpdateEventData;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
 static const unsigned LAST_REPLICATED_ID = 0xffffff;
@@ -154,6 +158,10 @@ public:
     void SetSnapThreshold(float threshold);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Enable or disable updating logic components that have declared their update thread-safe, and smoothed transforms, in the worker threads. Default false.
+    void SetParallelUpdate(bool enable);
+    /// Enable or disable updating the world transforms of all dirty nodes in one batched pass at the end of the scene update, instead of lazily on first access. Default false.
+    void SetBatchedTransformUpdate(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -205,6 +213,12 @@ public:
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
 
+    /// Return whether thread-safe components are updated in the worker threads.
+    bool IsParallelUpdate() const { return parallelUpdate_; }
+
+    /// Return whether world transforms are updated in a batched pass.
+    bool IsBatchedTransformUpdate() const { return batchedTransformUpdate_; }
+
     /// Return required package files.
     const Vector<SharedPtr<PackageFile> >& GetRequiredPackageFiles() const { return requiredPackageFiles_; }
 
@@ -223,6 +237,19 @@ public:
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
 
+    /// Add a logic component with a thread-safe update for the update events in the mask (USE_UPDATE and/or USE_POSTUPDATE). Called by LogicComponent.
+    void AddThreadSafeUpdate(LogicComponent* component, unsigned char mask);
+    /// Remove a logic component with a thread-safe update from the update events in the mask. Called by LogicComponent.
+    void RemoveThreadSafeUpdate(LogicComponent* component, unsigned char mask);
+    /// Add a smoothed transform with smoothing in progress. Called by SmoothedTransform.
+    void AddSmoothedTransform(SmoothedTransform* transform);
+    /// Remove a smoothed transform. Called by SmoothedTransform.
+    void RemoveSmoothedTransform(SmoothedTransform* transform);
+    /// Update the world transforms of all dirty nodes now. Called at the end of the scene update if batched transform update is enabled.
+    void UpdateWorldTransforms();
+    /// Mark a node's world transform dirty in the transform store. Called by Node.
+    void MarkTransformDirty(unsigned level, unsigned index) { transformStore_.MarkDirty(level, index); }
+
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
     /// Get free component ID, either non-local or local.
@@ -237,6 +264,8 @@ public:
     void NodeAdded(Node* node);
     /// Node removed. Remove from ID map.
     void NodeRemoved(Node* node);
+    /// Node reparented within the scene. Called by Node.
+    void NodeReparented(Node* node);
     /// Component added. Add to ID map.
     void ComponentAdded(Component* component);
     /// Component removed. Remove from ID map.
@@ -258,7 +287,7 @@ public:
 
 private:
     /// Handle the logic update event to update the scene, if active.
-    void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleUpdate(const UpdateEventData& eventData);
     /// Handle a background loaded resource completing.
     void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData);
     /// Update asynchronous loading.
@@ -275,6 +304,10 @@ private:
     void PreloadResourcesXML(const XMLElement& element);
     /// Preload resources from a JSON scene or object prefab file.
     void PreloadResourcesJSON(const JSONValue& value);
+    /// Update the logic components which have a thread-safe update for either the update or post-update event.
+    void UpdateThreadSafeComponents(bool postUpdate, float timeStep);
+    /// Update the smoothed transforms and remove the ones which have finished smoothing.
+    void UpdateSmoothedTransforms(float constant, float squaredSnapThreshold);
 
     /// Replicated scene nodes by ID.
     HashMap<unsigned, Node*> replicatedNodes_;
@@ -304,8 +337,16 @@ private:
     PODVector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
     Mutex sceneMutex_;
-    /// Preallocated event data map for smoothing update events.
-    VariantMap smoothingData_;
+    /// Logic components with a thread-safe update, sorted by type when updated.
+    PODVector<LogicComponent*> threadSafeUpdates_;
+    /// Logic components with a thread-safe post-update, sorted by type when updated.
+    PODVector<LogicComponent*> threadSafePostUpdates_;
+    /// Logic components with a thread-safe update that still need their delayed start called in the main thread.
+    PODVector<LogicComponent*> threadSafeDelayedStarts_;
+    /// Smoothed transforms with smoothing in progress.
+    PODVector<SmoothedTransform*> smoothedTransforms_;
+    /// Per-depth transform store for the batched transform update.
+    TransformStore transformStore_;
     /// Next free non-local node ID.
     unsigned replicatedNodeID_;
     /// Next free non-local component ID.
@@ -332,6 +373,14 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Parallel update of thread-safe components flag.
+    bool parallelUpdate_;
+    /// Batched world transform update flag.
+    bool batchedTransformUpdate_;
+    /// Thread-safe update list needs sorting flag.
+    bool threadSafeUpdatesDirty_;
+    /// Thread-safe post-update list needs sorting flag.
+    bool threadSafePostUpdatesDirty_;
 };
 
 /// Register Scene library objects.
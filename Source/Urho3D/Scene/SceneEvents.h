@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+class Scene;
+
 /// Variable timestep scene update.
 URHO3D_EVENT(E_SCENEUPDATE, SceneUpdate)
 {
@@ -34,6 +36,22 @@ URHO3D_EVENT(E_SCENEUPDATE, SceneUpdate)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the variable timestep scene update.
+struct URHO3D_API SceneUpdateEventData
+{
+    URHO3D_TYPED_EVENT(SceneUpdateEventData, E_SCENEUPDATE)
+
+    /// Convert to event parameters.
+    void ToVariantMap(VariantMap& eventData) const;
+    /// Convert from event parameters.
+    void FromVariantMap(VariantMap& eventData);
+
+    /// Scene being updated.
+    Scene* scene_;
+    /// Timestep in seconds.
+    float timeStep_;
+};
+
 /// Scene subsystem update.
 URHO3D_EVENT(E_SCENESUBSYSTEMUPDATE, SceneSubsystemUpdate)
 {
@@ -48,6 +66,31 @@ URHO3D_EVENT(E_UPDATESMOOTHING, UpdateSmoothing)
     URHO3D_PARAM(P_SQUAREDSNAPTHRESHOLD, SquaredSnapThreshold);  // float
 }
 
+/// Typed payload of the scene transform smoothing update.
+struct UpdateSmoothingEventData
+{
+    URHO3D_TYPED_EVENT(UpdateSmoothingEventData, E_UPDATESMOOTHING)
+
+    /// Convert to event parameters.
+    void ToVariantMap(VariantMap& eventData) const
+    {
+        eventData[UpdateSmoothing::P_CONSTANT] = constant_;
+        eventData[UpdateSmoothing::P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold_;
+    }
+
+    /// Convert from event parameters.
+    void FromVariantMap(VariantMap& eventData)
+    {
+        constant_ = eventData[UpdateSmoothing::P_CONSTANT].GetFloat();
+        squaredSnapThreshold_ = eventData[UpdateSmoothing::P_SQUAREDSNAPTHRESHOLD].GetFloat();
+    }
+
+    /// Smoothing constant.
+    float constant_;
+    /// Squared snap threshold.
+    float squaredSnapThreshold_;
+};
+
 /// Scene drawable update finished. Custom animation (eg. IK) can be done at this point.
 URHO3D_EVENT(E_SCENEDRAWABLEUPDATEFINISHED, SceneDrawableUpdateFinished)
 {
@@ -93,6 +136,22 @@ URHO3D_EVENT(E_SCENEPOSTUPDATE, ScenePostUpdate)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the variable timestep scene post-update.
+struct URHO3D_API ScenePostUpdateEventData
+{
+    URHO3D_TYPED_EVENT(ScenePostUpdateEventData, E_SCENEPOSTUPDATE)
+
+    /// Convert to event parameters.
+    void ToVariantMap(VariantMap& eventData) const;
+    /// Convert from event parameters.
+    void FromVariantMap(VariantMap& eventData);
+
+    /// Scene being updated.
+    Scene* scene_;
+    /// Timestep in seconds.
+    float timeStep_;
+};
+
 /// Asynchronous scene loading progress.
 URHO3D_EVENT(E_ASYNCLOADPROGRESS, AsyncLoadProgress)
 {
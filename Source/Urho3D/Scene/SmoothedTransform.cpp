@@ -43,6 +43,8 @@ SmoothedTransform::SmoothedTransform(Context* context) :
 
 SmoothedTransform::~SmoothedTransform()
 {
+    if (smoothingScene_)
+        smoothingScene_->RemoveSmoothedTransform(this);
 }
 
 void SmoothedTransform::RegisterObject(Context* context)
@@ -90,25 +92,15 @@ void SmoothedTransform::Update(float constant, float squaredSnapThreshold)
         }
     }
 
-    // If smoothing has completed, unsubscribe from the update event
-    if (!smoothingMask_)
-    {
-        UnsubscribeFromEvent(GetScene(), E_UPDATESMOOTHING);
-        subscribed_ = false;
-    }
+    // If smoothing has completed, the scene will remove the transform from the smoothing update afterward, as this may be
+    // called from a worker thread
 }
 
 void SmoothedTransform::SetTargetPosition(const Vector3& position)
 {
     targetPosition_ = position;
     smoothingMask_ |= SMOOTH_POSITION;
-
-    // Subscribe to smoothing update if not yet subscribed
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, URHO3D_HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    StartSmoothing();
 
     SendEvent(E_TARGETPOSITION);
 }
@@ -117,12 +109,7 @@ void SmoothedTransform::SetTargetRotation(const Quaternion& rotation)
 {
     targetRotation_ = rotation;
     smoothingMask_ |= SMOOTH_ROTATION;
-
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, URHO3D_HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    StartSmoothing();
 
     SendEvent(E_TARGETROTATION);
 }
@@ -169,13 +156,34 @@ void SmoothedTransform::OnNodeSet(Node* node)
     }
 }
 
-void SmoothedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData)
+void SmoothedTransform::OnSceneSet(Scene* scene)
+{
+    if (!scene && smoothingScene_)
+    {
+        smoothingScene_->RemoveSmoothedTransform(this);
+        OnSmoothingFinished();
+    }
+}
+
+void SmoothedTransform::StartSmoothing()
 {
-    using namespace UpdateSmoothing;
+    // Register to the smoothing update if not yet registered
+    if (!subscribed_)
+    {
+        Scene* scene = GetScene();
+        if (scene)
+        {
+            scene->AddSmoothedTransform(this);
+            smoothingScene_ = scene;
+            subscribed_ = true;
+        }
+    }
+}
 
-    float constant = eventData[P_CONSTANT].GetFloat();
-    float squaredSnapThreshold = eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat();
-    Update(constant, squaredSnapThreshold);
+void SmoothedTransform::OnSmoothingFinished()
+{
+    smoothingScene_.Reset();
+    subscribed_ = false;
 }
 
 }
@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+class Scene;
+
 /// No ongoing smoothing.
 static const unsigned SMOOTH_NONE = 0;
 /// Ongoing position smoothing.
@@ -39,6 +41,8 @@ class URHO3D_API SmoothedTransform : public Component
 {
     URHO3D_OBJECT(SmoothedTransform, Component);
 
+    friend class Scene;
+
 public:
     /// Construct.
     SmoothedTransform(Context* context);
@@ -75,10 +79,14 @@ public:
 protected:
     /// Handle scene node being assigned at creation.
     virtual void OnNodeSet(Node* node);
+    /// Handle scene being assigned.
+    virtual void OnSceneSet(Scene* scene);
 
 private:
-    /// Handle smoothing update event.
-    void HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData);
+    /// Register to the scene's smoothing update if not registered yet.
+    void StartSmoothing();
+    /// Handle smoothing finished. Called by the scene when it removes the transform from the smoothing update.
+    void OnSmoothingFinished();
 
     /// Target position.
     Vector3 targetPosition_;
@@ -86,8 +94,10 @@ private:
     Quaternion targetRotation_;
     /// Active smoothing operations bitmask.
     unsigned char smoothingMask_;
-    /// Subscribed to smoothing update event flag.
+    /// Registered to the scene's smoothing update flag.
     bool subscribed_;
+    /// Scene the smoothing update is registered to.
+    WeakPtr<Scene> smoothingScene_;
 };
 
 }
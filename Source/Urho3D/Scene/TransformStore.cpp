@@ -0,0 +1,323 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/WorkQueue.h"
+#include "../Scene/Scene.h"
+#include "../Scene/TransformStore.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Minimum nodes per thread when splitting a depth level across the worker threads.
+static const unsigned TRANSFORM_GRAIN_SIZE = 512;
+
+/// Transform store update functor for WorkQueue::ParallelFor.
+struct TransformStoreUpdateWork
+{
+    /// Construct.
+    TransformStoreUpdateWork(TransformStore* store, unsigned level) :
+        store_(store),
+        level_(level)
+    {
+    }
+
+    /// Update a range of nodes.
+    void operator ()(unsigned begin, unsigned end, unsigned threadIndex) const { store_->UpdateRange(level_, begin, end); }
+
+    /// Transform store.
+    TransformStore* store_;
+    /// Depth level.
+    unsigned level_;
+};
+
+TransformStore::TransformStore() :
+    rebuildNeeded_(true)
+{
+}
+
+TransformStore::~TransformStore()
+{
+}
+
+void TransformStore::AddNode(Node* node)
+{
+    // A pending rebuild picks up all nodes from the scene hierarchy
+    if (rebuildNeeded_)
+        return;
+
+    node->transformLevel_ = M_MAX_UNSIGNED;
+    node->transformIndex_ = pendingNodes_.Size();
+    pendingNodes_.Push(node);
+}
+
+void TransformStore::RemoveNode(Node* node)
+{
+    if (node->transformLevel_ != M_MAX_UNSIGNED)
+        EraseNode(node);
+    else if (node->transformIndex_ != M_MAX_UNSIGNED)
+    {
+        unsigned index = node->transformIndex_;
+        pendingNodes_.EraseSwap(index);
+        if (index < pendingNodes_.Size())
+            pendingNodes_[index]->transformIndex_ = index;
+    }
+
+    node->transformLevel_ = M_MAX_UNSIGNED;
+    node->transformIndex_ = M_MAX_UNSIGNED;
+}
+
+void TransformStore::ReparentNode(Node* node)
+{
+    // The depth of the whole subtree may change. Children of a pending node are pending as well
+    if (node->transformLevel_ == M_MAX_UNSIGNED)
+        return;
+
+    EraseNode(node);
+    AddNode(node);
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        ReparentNode(*i);
+}
+
+void TransformStore::Update(Scene* scene, WorkQueue* queue)
+{
+    if (rebuildNeeded_)
+        Rebuild(scene);
+    else if (!pendingNodes_.Empty())
+    {
+        // Inserting a pending parent clears its pending index, so that it is not inserted twice
+        for (unsigned i = 0; i < pendingNodes_.Size(); ++i)
+        {
+            Node* node = pendingNodes_[i];
+            if (node->transformLevel_ == M_MAX_UNSIGNED && node->transformIndex_ != M_MAX_UNSIGNED)
+                InsertNode(scene, node);
+        }
+        pendingNodes_.Clear();
+    }
+
+    // Each level only reads the world transforms of the previous level, so the nodes within a level can be updated in any order
+    for (unsigned i = 0; i < levels_.Size() && !levels_[i].nodes_.Empty(); ++i)
+    {
+        unsigned numNodes = levels_[i].nodes_.Size();
+        if (queue)
+            queue->ParallelFor(0, numNodes, TRANSFORM_GRAIN_SIZE, TransformStoreUpdateWork(this, i));
+        else
+            UpdateRange(i, 0, numNodes);
+    }
+}
+
+void TransformStore::Clear(Scene* scene)
+{
+    PODVector<Node*> nodes;
+    scene->GetChildren(nodes, true);
+    for (PODVector<Node*>::Iterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        (*i)->transformLevel_ = M_MAX_UNSIGNED;
+        (*i)->transformIndex_ = M_MAX_UNSIGNED;
+    }
+
+    levels_.Clear();
+    pendingNodes_.Clear();
+    rebuildNeeded_ = true;
+}
+
+unsigned TransformStore::GetNumNodes() const
+{
+    unsigned numNodes = 0;
+    for (unsigned i = 0; i < levels_.Size(); ++i)
+        numNodes += levels_[i].nodes_.Size();
+    return numNodes;
+}
+
+unsigned TransformStore::GetNumLevels() const
+{
+    // A level can only be empty if all the levels below it are
+    unsigned numLevels = 0;
+    while (numLevels < levels_.Size() && !levels_[numLevels].nodes_.Empty())
+        ++numLevels;
+    return numLevels;
+}
+
+void TransformStore::Rebuild(Scene* scene)
+{
+    levels_.Clear();
+    pendingNodes_.Clear();
+
+    // Breadth-first traversal, so that each level is complete before its children are appended to the next one
+    const Vector<SharedPtr<Node> >& roots = scene->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = roots.Begin(); i != roots.End(); ++i)
+        AppendNode(*i, 0, M_MAX_UNSIGNED);
+
+    for (unsigned level = 0; level < levels_.Size(); ++level)
+    {
+        for (unsigned i = 0; i < levels_[level].nodes_.Size(); ++i)
+        {
+            const Vector<SharedPtr<Node> >& children = levels_[level].nodes_[i]->GetChildren();
+            for (Vector<SharedPtr<Node> >::ConstIterator j = children.Begin(); j != children.End(); ++j)
+                AppendNode(*j, level + 1, i);
+        }
+    }
+
+    rebuildNeeded_ = false;
+}
+
+void TransformStore::InsertNode(Scene* scene, Node* node)
+{
+    Node* parent = node->GetParent();
+    if (parent == scene)
+    {
+        AppendNode(node, 0, M_MAX_UNSIGNED);
+        return;
+    }
+
+    // A parent that is neither stored nor pending has left the scene; leave the node to update lazily
+    if (parent && parent->transformLevel_ == M_MAX_UNSIGNED && parent->transformIndex_ != M_MAX_UNSIGNED)
+        InsertNode(scene, parent);
+    if (!parent || parent->transformLevel_ == M_MAX_UNSIGNED)
+    {
+        node->transformIndex_ = M_MAX_UNSIGNED;
+        return;
+    }
+
+    AppendNode(node, parent->transformLevel_ + 1, parent->transformIndex_);
+}
+
+void TransformStore::AppendNode(Node* node, unsigned level, unsigned parent)
+{
+    if (levels_.Size() <= level)
+        levels_.Resize(level + 1);
+
+    TransformStoreLevel& dest = levels_[level];
+    node->transformLevel_ = level;
+    node->transformIndex_ = dest.nodes_.Size();
+
+    dest.nodes_.Push(node);
+    dest.parents_.Push(parent);
+    for (unsigned i = 0; i < TRANSFORM_STORE_COMPONENTS; ++i)
+        dest.locals_[i].Push(0.0f);
+    dest.worldTransforms_.Push(Matrix3x4::IDENTITY);
+    dest.worldRotations_.Push(Quaternion::IDENTITY);
+    dest.dirty_.Push(1);
+}
+
+void TransformStore::EraseNode(Node* node)
+{
+    unsigned level = node->transformLevel_;
+    unsigned index = node->transformIndex_;
+    TransformStoreLevel& src = levels_[level];
+
+    src.nodes_.EraseSwap(index);
+    src.parents_.EraseSwap(index);
+    for (unsigned i = 0; i < TRANSFORM_STORE_COMPONENTS; ++i)
+        src.locals_[i].EraseSwap(index);
+    src.worldTransforms_.EraseSwap(index);
+    src.worldRotations_.EraseSwap(index);
+    src.dirty_.EraseSwap(index);
+
+    node->transformLevel_ = M_MAX_UNSIGNED;
+    node->transformIndex_ = M_MAX_UNSIGNED;
+
+    // Point the moved node and the stored children of it to its new index
+    if (index < src.nodes_.Size())
+    {
+        Node* moved = src.nodes_[index];
+        moved->transformIndex_ = index;
+
+        const Vector<SharedPtr<Node> >& children = moved->GetChildren();
+        for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        {
+            if ((*i)->transformLevel_ == level + 1)
+                levels_[level + 1].parents_[(*i)->transformIndex_] = index;
+        }
+    }
+}
+
+void TransformStore::UpdateRange(unsigned level, unsigned begin, unsigned end)
+{
+    TransformStoreLevel& dest = levels_[level];
+    Node** nodes = &dest.nodes_[0];
+    const unsigned* parents = &dest.parents_[0];
+    unsigned char* dirty = &dest.dirty_[0];
+    float* px = &dest.locals_[0][0];
+    float* py = &dest.locals_[1][0];
+    float* pz = &dest.locals_[2][0];
+    float* rw = &dest.locals_[3][0];
+    float* rx = &dest.locals_[4][0];
+    float* ry = &dest.locals_[5][0];
+    float* rz = &dest.locals_[6][0];
+    float* sx = &dest.locals_[7][0];
+    float* sy = &dest.locals_[8][0];
+    float* sz = &dest.locals_[9][0];
+
+    // Gather the local transforms of the dirty nodes first, as animation may have changed them silently
+    for (unsigned i = begin; i < end; ++i)
+    {
+        if (!dirty[i])
+            continue;
+
+        const Node* node = nodes[i];
+        px[i] = node->position_.x_;
+        py[i] = node->position_.y_;
+        pz[i] = node->position_.z_;
+        rw[i] = node->rotation_.w_;
+        rx[i] = node->rotation_.x_;
+        ry[i] = node->rotation_.y_;
+        rz[i] = node->rotation_.z_;
+        sx[i] = node->scale_.x_;
+        sy[i] = node->scale_.y_;
+        sz[i] = node->scale_.z_;
+    }
+
+    // Assume the root node (scene) has identity transform, as in Node::UpdateWorldTransform()
+    const Matrix3x4* parentTransforms = level ? &levels_[level - 1].worldTransforms_[0] : 0;
+    const Quaternion* parentRotations = level ? &levels_[level - 1].worldRotations_[0] : 0;
+
+    for (unsigned i = begin; i < end; ++i)
+    {
+        if (!dirty[i])
+            continue;
+
+        Quaternion rotation(rw[i], rx[i], ry[i], rz[i]);
+        Matrix3x4 transform(Vector3(px[i], py[i], pz[i]), rotation, Vector3(sx[i], sy[i], sz[i]));
+        if (parentTransforms)
+        {
+            transform = parentTransforms[parents[i]] * transform;
+            rotation = parentRotations[parents[i]] * rotation;
+        }
+
+        dest.worldTransforms_[i] = transform;
+        dest.worldRotations_[i] = rotation;
+
+        Node* node = nodes[i];
+        node->worldTransform_ = transform;
+        node->worldRotation_ = rotation;
+        node->dirty_ = false;
+        dirty[i] = 0;
+    }
+}
+
+}
@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2008-2017 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/Matrix3x4.h"
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+class WorkQueue;
+
+/// Number of local transform components per node in the transform store: position x, y, z, rotation w, x, y, z and scale x, y, z.
+static const unsigned TRANSFORM_STORE_COMPONENTS = 10;
+
+/// Nodes of one hierarchy depth in the transform store.
+struct TransformStoreLevel
+{
+    /// Nodes.
+    PODVector<Node*> nodes_;
+    /// Parent index of each node in the previous level, or M_MAX_UNSIGNED on the first level.
+    PODVector<unsigned> parents_;
+    /// Local transform component arrays.
+    PODVector<float> locals_[TRANSFORM_STORE_COMPONENTS];
+    /// World transforms.
+    PODVector<Matrix3x4> worldTransforms_;
+    /// World rotations.
+    PODVector<Quaternion> worldRotations_;
+    /// World transform dirty flags.
+    PODVector<unsigned char> dirty_;
+};
+
+/// Scene-owned store of node transforms in contiguous per-depth arrays, for propagating the world transforms of all dirty nodes in one batched pass. Node's lazily updated world transform remains valid; the store only refreshes it ahead of time.
+class URHO3D_API TransformStore
+{
+    friend struct TransformStoreUpdateWork;
+
+public:
+    /// Construct.
+    TransformStore();
+    /// Destruct.
+    ~TransformStore();
+
+    /// Add a node to the store. It is inserted on the next update, once its parent is known.
+    void AddNode(Node* node);
+    /// Remove a node from the store. Its children must be removed separately.
+    void RemoveNode(Node* node);
+    /// Move a node and its children back to pending insertion before the node changes parent.
+    void ReparentNode(Node* node);
+    /// Mark a node's world transform dirty by its depth level and index. Is thread-safe for different nodes.
+    void MarkDirty(unsigned level, unsigned index) { levels_[level].dirty_[index] = 1; }
+    /// Update the world transforms of the dirty nodes one depth level at a time, inserting pending nodes first. Levels with enough nodes are split across the work queue's threads.
+    void Update(Scene* scene, WorkQueue* queue);
+    /// Remove all nodes of the scene from the store. The store will be rebuilt from the scene hierarchy on the next update.
+    void Clear(Scene* scene);
+
+    /// Return number of nodes in the store.
+    unsigned GetNumNodes() const;
+    /// Return number of depth levels.
+    unsigned GetNumLevels() const;
+    /// Return number of nodes waiting to be inserted on the next update.
+    unsigned GetNumPendingNodes() const { return pendingNodes_.Size(); }
+    /// Return whether the store will be rebuilt from the scene hierarchy on the next update.
+    bool IsRebuildNeeded() const { return rebuildNeeded_; }
+
+private:
+    /// Rebuild all depth levels from the scene hierarchy and mark all nodes dirty.
+    void Rebuild(Scene* scene);
+    /// Insert a pending node to the depth level below its parent, inserting a pending parent first.
+    void InsertNode(Scene* scene, Node* node);
+    /// Append a node to a depth level and mark it dirty.
+    void AppendNode(Node* node, unsigned level, unsigned parent);
+    /// Erase a node from its depth level by swapping the last node of the level in its place.
+    void EraseNode(Node* node);
+    /// Update the world transforms of the dirty nodes in an index range of a depth level. The previous level must have been updated already.
+    void UpdateRange(unsigned level, unsigned begin, unsigned end);
+
+    /// Depth levels.
+    Vector<TransformStoreLevel> levels_;
+    /// Nodes added or reparented since the last update.
+    PODVector<Node*> pendingNodes_;
+    /// Rebuild needed flag.
+    bool rebuildNeeded_;
+};
+
+}